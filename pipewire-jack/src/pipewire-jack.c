@@ -122,8 +122,29 @@ typedef void (*mix_func) (float *dst, float *src[], uint32_t n_src, bool aligned
 
 static mix_func mix_function;
 
+struct object_entry {
+	struct spa_list link;
+	struct object *object;
+	uint32_t hash;
+};
+
+struct object_hash {
+	struct spa_list *buckets;
+	uint32_t mask;
+	uint32_t count;
+};
+
+#define PORT_NAME_NAME		0
+#define PORT_NAME_ALIAS1	1
+#define PORT_NAME_ALIAS2	2
+#define PORT_NAME_SYSTEM	3
+#define N_PORT_NAMES		4
+
 struct object {
 	struct spa_list link;
+	struct object_entry id_entry;
+	struct object_entry serial_entry;
+	struct object_entry name_entry[N_PORT_NAMES];
 
 	struct client *client;
 
@@ -275,6 +296,16 @@ struct link {
 	int signalfd;
 };
 
+struct port_cache {
+	uint32_t generation;
+	unsigned long flags;
+	char *port_name_pattern;
+	char *type_name_pattern;
+	char *target;
+	struct pw_array ports;		/* sorted struct object * */
+	unsigned int valid:1;
+};
+
 struct context {
 	struct pw_loop *l;
 	struct pw_thread_loop *loop;	/* thread_lock protects all below */
@@ -287,6 +318,14 @@ struct context {
 	pthread_mutex_t lock;		/* protects map and lists below, in addition to thread_lock */
 	struct spa_list objects;
 	uint32_t free_count;
+
+	/* the hashes only grow on insert, which is done with both the
+	 * thread_lock and lock held */
+	struct object_hash ids;
+	struct object_hash serials;
+	struct object_hash names;
+	uint32_t ports_generation;	/* changes when jack_get_ports() can change */
+	struct port_cache port_cache;
 };
 
 #define GET_DIRECTION(f)	((f) & JackPortIsInput ? SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT)
@@ -485,6 +524,146 @@ int pw_jack_match_rules(const char *rules, size_t size, const struct spa_dict *p
 		int (*matched) (void *data, const char *action, const char *val, int len),
 		void *data);
 
+static const size_t port_name_offsets[N_PORT_NAMES] = {
+	[PORT_NAME_NAME] = offsetof(struct object, port.name),
+	[PORT_NAME_ALIAS1] = offsetof(struct object, port.alias1),
+	[PORT_NAME_ALIAS2] = offsetof(struct object, port.alias2),
+	[PORT_NAME_SYSTEM] = offsetof(struct object, port.system),
+};
+
+static inline const char *object_port_name(struct object *o, uint32_t idx)
+{
+	return SPA_PTROFF(o, port_name_offsets[idx], const char);
+}
+
+static inline uint32_t hash_id(uint32_t id)
+{
+	return id * 0x9e3779b1u;
+}
+
+static inline uint32_t hash_name(const char *name)
+{
+	/* FNV-1a */
+	uint32_t hash = 0x811c9dc5u;
+	while (*name)
+		hash = (hash ^ (uint8_t)*name++) * 0x01000193u;
+	return hash;
+}
+
+static int object_hash_init(struct object_hash *h, uint32_t size)
+{
+	uint32_t i;
+
+	h->buckets = calloc(size, sizeof(struct spa_list));
+	if (h->buckets == NULL)
+		return -errno;
+	for (i = 0; i < size; i++)
+		spa_list_init(&h->buckets[i]);
+	h->mask = size - 1;
+	h->count = 0;
+	return 0;
+}
+
+static void object_hash_clear(struct object_hash *h)
+{
+	free(h->buckets);
+	spa_zero(*h);
+}
+
+static inline struct spa_list *object_hash_bucket(struct object_hash *h, uint32_t hash)
+{
+	return &h->buckets[hash & h->mask];
+}
+
+/* entries of a bucket can only move to the same new bucket, the
+ * order in the chains is kept */
+static void object_hash_grow(struct object_hash *h)
+{
+	struct object_hash n;
+	struct object_entry *e;
+	uint32_t i;
+
+	if (object_hash_init(&n, (h->mask + 1) * 2) < 0)
+		return;
+	for (i = 0; i <= h->mask; i++) {
+		spa_list_consume(e, &h->buckets[i], link) {
+			spa_list_remove(&e->link);
+			spa_list_append(object_hash_bucket(&n, e->hash), &e->link);
+		}
+	}
+	n.count = h->count;
+	free(h->buckets);
+	*h = n;
+}
+
+static void object_hash_insert(struct object_hash *h, struct object_entry *e, uint32_t hash)
+{
+	if (h->count >= (h->mask + 1) * 2)
+		object_hash_grow(h);
+	e->hash = hash;
+	spa_list_append(object_hash_bucket(h, hash), &e->link);
+	h->count++;
+}
+
+static void object_hash_remove(struct object_hash *h, struct object_entry *e)
+{
+	if (spa_list_is_empty(&e->link))
+		return;
+	spa_list_remove(&e->link);
+	spa_list_init(&e->link);
+	h->count--;
+}
+
+static inline void ports_changed(struct client *c)
+{
+	SPA_ATOMIC_INC(c->context.ports_generation);
+}
+
+/* call with the lock held, objects without an id are not in the id hash */
+static void object_set_id(struct client *c, struct object *o, uint32_t id, uint32_t serial)
+{
+	object_hash_remove(&c->context.ids, &o->id_entry);
+	object_hash_remove(&c->context.serials, &o->serial_entry);
+	o->id = id;
+	o->serial = serial;
+	if (id != SPA_ID_INVALID)
+		object_hash_insert(&c->context.ids, &o->id_entry, hash_id(id));
+	object_hash_insert(&c->context.serials, &o->serial_entry, hash_id(serial));
+	ports_changed(c);
+}
+
+/* call with the lock held after changing the port names */
+static void object_update_names(struct client *c, struct object *o)
+{
+	const char *name;
+	uint32_t i;
+
+	for (i = 0; i < N_PORT_NAMES; i++) {
+		object_hash_remove(&c->context.names, &o->name_entry[i]);
+		name = object_port_name(o, i);
+		if (name[0] != '\0')
+			object_hash_insert(&c->context.names, &o->name_entry[i],
+					hash_name(name));
+	}
+	ports_changed(c);
+}
+
+static void object_unlink_names(struct client *c, struct object *o)
+{
+	uint32_t i;
+	for (i = 0; i < N_PORT_NAMES; i++)
+		object_hash_remove(&c->context.names, &o->name_entry[i]);
+}
+
+static void port_cache_clear(struct port_cache *pc)
+{
+	free(pc->port_name_pattern);
+	free(pc->type_name_pattern);
+	free(pc->target);
+	pw_array_clear(&pc->ports);
+	spa_zero(*pc);
+}
+
 static struct object * alloc_object(struct client *c, int type)
 {
 	struct object *o;
@@ -507,6 +686,14 @@ static struct object * alloc_object(struct client *c, int type)
 	o->client = c;
 	o->removed = false;
 	o->type = type;
+	o->id_entry.object = o;
+	spa_list_init(&o->id_entry.link);
+	o->serial_entry.object = o;
+	spa_list_init(&o->serial_entry.link);
+	for (i = 0; i < N_PORT_NAMES; i++) {
+		o->name_entry[i].object = o;
+		spa_list_init(&o->name_entry[i].link);
+	}
 	pw_log_debug("%p: object:%p type:%d", c, o, type);
 
 	return o;
@@ -520,6 +707,7 @@ static void recycle_objects(struct client *c, uint32_t remain)
 		if (o->removed) {
 			pw_log_debug("%p: recycle object:%p type:%d id:%u/%u",
 					c, o, o->type, o->id, o->serial);
+			object_hash_remove(&c->context.serials, &o->serial_entry);
 			spa_list_remove(&o->link);
 			memset(o, 0, sizeof(struct object));
 			spa_list_append(&globals.free_objects, &o->link);
@@ -539,8 +727,11 @@ static void free_object(struct client *c, struct object *o)
 	pthread_mutex_lock(&c->context.lock);
 	spa_list_remove(&o->link);
 	o->removed = true;
+	object_hash_remove(&c->context.ids, &o->id_entry);
+	object_unlink_names(c, o);
 	o->id = SPA_ID_INVALID;
 	spa_list_append(&c->context.objects, &o->link);
+	ports_changed(c);
 	if (++c->context.free_count > RECYCLE_THRESHOLD)
 		recycle_objects(c, RECYCLE_THRESHOLD / 2);
 	pthread_mutex_unlock(&c->context.lock);
@@ -791,38 +982,55 @@ static inline bool client_port_visible(struct client *c, struct object *o)
 
 static struct object *find_port_by_name(struct client *c, const char *name)
 {
+	struct object_entry *e;
 	struct object *o;
+	uint32_t idx, hash = hash_name(name);
 
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->type != INTERFACE_Port || o->removed ||
+	spa_list_for_each(e, object_hash_bucket(&c->context.names, hash), link) {
+		o = e->object;
+		if (e->hash != hash || o->type != INTERFACE_Port || o->removed ||
 		    (!client_port_visible(c, o)))
 			continue;
-		if (spa_streq(o->port.name, name) ||
-		    spa_streq(o->port.alias1, name) ||
-		    spa_streq(o->port.alias2, name))
-			return o;
-		if (is_port_default(c, o) && spa_streq(o->port.system, name))
-			return o;
+		idx = e - o->name_entry;
+		if (!spa_streq(object_port_name(o, idx), name))
+			continue;
+		if (idx == PORT_NAME_SYSTEM && !is_port_default(c, o))
+			continue;
+		return o;
 	}
 	return NULL;
 }
 
 static struct object *find_by_id(struct client *c, uint32_t id)
 {
+	struct object_entry *e;
 	struct object *o;
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->id == id)
-			return o;
+	uint32_t hash;
+
+	if (id == SPA_ID_INVALID) {
+		/* removed objects and our unregistered ports are not hashed */
+		spa_list_for_each(o, &c->context.objects, link) {
+			if (o->id == id)
+				return o;
+		}
+		return NULL;
+	}
+	hash = hash_id(id);
+	spa_list_for_each(e, object_hash_bucket(&c->context.ids, hash), link) {
+		if (e->object->id == id)
+			return e->object;
 	}
 	return NULL;
 }
 
 static struct object *find_by_serial(struct client *c, uint32_t serial)
 {
-	struct object *o;
-	spa_list_for_each(o, &c->context.objects, link) {
-		if (o->serial == serial)
-			return o;
+	struct object_entry *e;
+	uint32_t hash = hash_id(serial);
+
+	spa_list_for_each(e, object_hash_bucket(&c->context.serials, hash), link) {
+		if (e->object->serial == serial)
+			return e->object;
 	}
 	return NULL;
 }
@@ -1120,6 +1328,7 @@ static int queue_notify(struct client *c, int type, struct object *o, int arg1,
 	case NOTIFY_TYPE_PORTREGISTRATION:
 		emit = c->portregistration_callback != NULL && o != NULL;
 		o->visible = arg1;
+		ports_changed(c);
 		break;
 	case NOTIFY_TYPE_CONNECT:
 		emit = c->connect_callback != NULL && o != NULL;
@@ -3158,6 +3367,7 @@ static int metadata_property(void *data, uint32_t id,
 			if (value == NULL)
 				c->metadata->default_audio_source[0] = '\0';
 		}
+		ports_changed(c);
 	} else {
 		if ((o = find_id(c, id, true)) == NULL)
 			return -EINVAL;
@@ -3562,6 +3772,10 @@ static void registry_event_global(void *data, uint32_t id,
 		o->port.node_id = node_id;
 		o->port.is_monitor = is_monitor;
 
+		pthread_mutex_lock(&c->context.lock);
+		object_update_names(c, o);
+		pthread_mutex_unlock(&c->context.lock);
+
 		pw_log_debug("%p: %p add port %d name:%s %d", c, o, id,
 				o->port.name, type_id);
 	}
@@ -3657,8 +3871,9 @@ static void registry_event_global(void *data, uint32_t id,
 		goto exit;
 	}
 
-	o->id = id;
-	o->serial = serial;
+	pthread_mutex_lock(&c->context.lock);
+	object_set_id(c, o, id, serial);
+	pthread_mutex_unlock(&c->context.lock);
 
 	switch (o->type) {
 	case INTERFACE_Node:
@@ -3716,6 +3931,7 @@ static void registry_event_global_remove(void *data, uint32_t id)
 				c->metadata->default_audio_sink[0] = '\0';
 			if (spa_streq(o->node.node_name, c->metadata->default_audio_source))
 				c->metadata->default_audio_source[0] = '\0';
+			ports_changed(c);
 		}
 		if (find_node(c, o->node.name) == NULL) {
 			pw_log_info("%p: client %u removed \"%s\"", c, o->id, o->node.name);
@@ -3814,6 +4030,7 @@ jack_client_t * jack_client_open (const char *client_name,
 
 	pthread_mutex_init(&client->context.lock, NULL);
 	spa_list_init(&client->context.objects);
+	pw_array_init(&client->context.port_cache.ports, sizeof(void*) * 32);
 
 	client->node_id = SPA_ID_INVALID;
 
@@ -3848,6 +4065,11 @@ jack_client_t * jack_client_open (const char *client_name,
 	if (client->props == NULL)
 		goto no_props;
 
+	if (object_hash_init(&client->context.ids, 64) < 0 ||
+	    object_hash_init(&client->context.serials, 64) < 0 ||
+	    object_hash_init(&client->context.names, 64) < 0)
+		goto no_props;
+
 	client->context.loop = pw_thread_loop_new(client->name, NULL);
 	if (client->context.loop == NULL)
 		goto no_props;
@@ -4164,6 +4386,11 @@ int jack_client_close (jack_client_t *client)
 		free_object(c, o);
 	recycle_objects(c, 0);
 
+	port_cache_clear(&c->context.port_cache);
+	object_hash_clear(&c->context.ids);
+	object_hash_clear(&c->context.serials);
+	object_hash_clear(&c->context.names);
+
 	pw_map_clear(&c->ports[SPA_DIRECTION_INPUT]);
 	pw_map_clear(&c->ports[SPA_DIRECTION_OUTPUT]);
 
@@ -5048,6 +5275,10 @@ jack_port_t * jack_port_register (jack_client_t *client,
 	param_latency_other(c, p, &params[n_params++], &b);
 
 	pw_thread_loop_lock(c->context.loop);
+	pthread_mutex_lock(&c->context.lock);
+	object_update_names(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+
 	if (create_mix(c, p, SPA_ID_INVALID, SPA_ID_INVALID) == NULL) {
 		res = -errno;
 		pw_log_warn("can't create mix for port %s: %m", port_name);
@@ -5605,7 +5836,11 @@ int jack_port_rename (jack_client_t* client, jack_port_t *port, const char *port
 	}
 
 	pw_properties_set(p->props, PW_KEY_PORT_NAME, port_name);
+
+	pthread_mutex_lock(&c->context.lock);
 	snprintf(o->port.name, sizeof(o->port.name), "%s:%s", c->name, port_name);
+	object_update_names(c, o);
+	pthread_mutex_unlock(&c->context.lock);
 
 	p->info.change_mask |= SPA_PORT_CHANGE_MASK_PROPS;
 	p->info.props = &p->props->dict;
@@ -5648,6 +5883,7 @@ int jack_port_set_alias (jack_port_t *port, const char *alias)
 		goto done;
 	}
 
+	pthread_mutex_lock(&c->context.lock);
 	if (o->port.alias1[0] == '\0') {
 		key = PW_KEY_OBJECT_PATH;
 		snprintf(o->port.alias1, sizeof(o->port.alias1), "%s", alias);
@@ -5657,6 +5893,13 @@ int jack_port_set_alias (jack_port_t *port, const char *alias)
 		snprintf(o->port.alias2, sizeof(o->port.alias2), "%s", alias);
 	}
 	else {
+		key = NULL;
+	}
+	if (key != NULL)
+		object_update_names(c, o);
+	pthread_mutex_unlock(&c->context.lock);
+
+	if (key == NULL) {
 		res = -1;
 		goto done;
 	}
@@ -6259,6 +6502,62 @@ static int port_compare_func(const void *v1, const void *v2)
 	return res;
 }
 
+static bool port_cache_match(struct port_cache *pc, uint32_t generation,
+		const char *port_name_pattern, const char *type_name_pattern,
+		unsigned long flags, const char *target)
+{
+	return pc->valid && pc->generation == generation &&
+		pc->flags == flags &&
+		spa_streq(pc->port_name_pattern, port_name_pattern) &&
+		spa_streq(pc->type_name_pattern, type_name_pattern) &&
+		spa_streq(pc->target, target);
+}
+
+static void port_cache_update(struct port_cache *pc, uint32_t generation,
+		const char *port_name_pattern, const char *type_name_pattern,
+		unsigned long flags, const char *target,
+		struct object **ports, uint32_t count)
+{
+	free(pc->port_name_pattern);
+	free(pc->type_name_pattern);
+	free(pc->target);
+	pc->port_name_pattern = port_name_pattern ? strdup(port_name_pattern) : NULL;
+	pc->type_name_pattern = type_name_pattern ? strdup(type_name_pattern) : NULL;
+	pc->target = target ? strdup(target) : NULL;
+	pc->flags = flags;
+	pc->generation = generation;
+
+	pc->valid = (port_name_pattern == NULL || pc->port_name_pattern != NULL) &&
+		(type_name_pattern == NULL || pc->type_name_pattern != NULL) &&
+		(target == NULL || pc->target != NULL);
+
+	pw_array_reset(&pc->ports);
+	if (count > 0) {
+		void *p = pw_array_add(&pc->ports, count * sizeof(struct object *));
+		if (p != NULL)
+			memcpy(p, ports, count * sizeof(struct object *));
+		else
+			pc->valid = false;
+	}
+}
+
+/* make a new NULL terminated array with the port names, the caller frees
+ * it with jack_free() */
+static const char **port_names(struct object **ports, uint32_t count)
+{
+	const char **res;
+	uint32_t i;
+
+	if (count == 0)
+		return NULL;
+	if ((res = malloc((count + 1) * sizeof(const char *))) == NULL)
+		return NULL;
+	for (i = 0; i < count; i++)
+		res[i] = port_name(ports[i]);
+	res[count] = NULL;
+	return res;
+}
+
 SPA_EXPORT
 const char ** jack_get_ports (jack_client_t *client,
                               const char *port_name_pattern,
@@ -6266,11 +6565,12 @@ const char ** jack_get_ports (jack_client_t *client,
                               unsigned long flags)
 {
 	struct client *c = (struct client *) client;
+	struct port_cache *pc;
 	const char **res;
 	struct object *o;
 	struct pw_array tmp;
 	const char *str;
-	uint32_t i, count;
+	uint32_t count, generation;
 	int r;
 	regex_t port_regex, type_regex;
 
@@ -6278,25 +6578,47 @@ const char ** jack_get_ports (jack_client_t *client,
 
 	str = getenv("PIPEWIRE_NODE");
 
-	if (port_name_pattern && port_name_pattern[0]) {
+	if (port_name_pattern && !port_name_pattern[0])
+		port_name_pattern = NULL;
+	if (type_name_pattern && !type_name_pattern[0])
+		type_name_pattern = NULL;
+
+	pw_log_debug("%p: ports target:%s name:\"%s\" type:\"%s\" flags:%08lx", c, str,
+			port_name_pattern, type_name_pattern, flags);
+
+	/* bulk connect scripts ask for the same ports over and over again,
+	 * reuse the sorted result until something changes */
+	pc = &c->context.port_cache;
+	pthread_mutex_lock(&c->context.lock);
+	generation = SPA_ATOMIC_LOAD(c->context.ports_generation);
+	if (port_cache_match(pc, generation, port_name_pattern,
+				type_name_pattern, flags, str)) {
+		res = port_names(pc->ports.data,
+				pw_array_get_len(&pc->ports, struct object *));
+		pthread_mutex_unlock(&c->context.lock);
+		return res;
+	}
+	pthread_mutex_unlock(&c->context.lock);
+
+	if (port_name_pattern) {
 		if ((r = regcomp(&port_regex, port_name_pattern, REG_EXTENDED | REG_NOSUB)) != 0) {
 			pw_log_error("cant compile regex %s: %d", port_name_pattern, r);
 			return NULL;
 		}
 	}
-	if (type_name_pattern && type_name_pattern[0]) {
+	if (type_name_pattern) {
 		if ((r = regcomp(&type_regex, type_name_pattern, REG_EXTENDED | REG_NOSUB)) != 0) {
 			pw_log_error("cant compile regex %s: %d", type_name_pattern, r);
+			if (port_name_pattern)
+				regfree(&port_regex);
 			return NULL;
 		}
 	}
 
-	pw_log_debug("%p: ports target:%s name:\"%s\" type:\"%s\" flags:%08lx", c, str,
-			port_name_pattern, type_name_pattern, flags);
-
 	pthread_mutex_lock(&c->context.lock);
 	pw_array_init(&tmp, sizeof(void*) * 32);
 	count = 0;
+	generation = SPA_ATOMIC_LOAD(c->context.ports_generation);
 
 	spa_list_for_each(o, &c->context.objects, link) {
 		if (o->type != INTERFACE_Port || o->removed || !o->visible)
@@ -6313,7 +6635,7 @@ const char ** jack_get_ports (jack_client_t *client,
 				continue;
 		}
 
-		if (port_name_pattern && port_name_pattern[0]) {
+		if (port_name_pattern) {
 			bool match;
 			match = regexec(&port_regex, o->port.name, 0, NULL, 0) == 0;
 			if (!match && is_port_default(c, o))
@@ -6321,7 +6643,7 @@ const char ** jack_get_ports (jack_client_t *client,
 			if (!match)
 				continue;
 		}
-		if (type_name_pattern && type_name_pattern[0]) {
+		if (type_name_pattern) {
 			if (regexec(&type_regex, type_to_string(o->port.type_id),
 						0, NULL, 0) == REG_NOMATCH)
 				continue;
@@ -6332,22 +6654,20 @@ const char ** jack_get_ports (jack_client_t *client,
 		pw_array_add_ptr(&tmp, o);
 		count++;
 	}
-	pthread_mutex_unlock(&c->context.lock);
 
-	if (count > 0) {
+	if (count > 0)
 		qsort(tmp.data, count, sizeof(struct object *), port_compare_func);
-		pw_array_add_ptr(&tmp, NULL);
-		res = tmp.data;
-		for (i = 0; i < count; i++)
-			res[i] = port_name((struct object*)res[i]);
-	} else {
-		pw_array_clear(&tmp);
-		res = NULL;
-	}
 
-	if (port_name_pattern && port_name_pattern[0])
+	port_cache_update(pc, generation, port_name_pattern, type_name_pattern,
+			flags, str, tmp.data, count);
+	res = port_names(tmp.data, count);
+	pthread_mutex_unlock(&c->context.lock);
+
+	pw_array_clear(&tmp);
+
+	if (port_name_pattern)
 		regfree(&port_regex);
-	if (type_name_pattern && type_name_pattern[0])
+	if (type_name_pattern)
 		regfree(&type_regex);
 
 	return res;
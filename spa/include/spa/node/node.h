@@ -237,6 +237,12 @@ struct spa_node_callbacks {
 #define SPA_NODE_BUFFERS_FLAG_ALLOC	(1 << 0)	/**< Allocate memory for the buffers. This flag
 							  *  is ignored when the port does not have the
 							  *  SPA_PORT_FLAG_CAN_ALLOC_BUFFERS set. */
+#define SPA_NODE_BUFFERS_FLAG_MOVE_DATA	(1 << 1)	/**< The caller owns the buffers and does not
+							  *  share them with other nodes. The port may
+							  *  change the data and maxsize of the
+							  *  SPA_DATA_FLAG_DYNAMIC datas while it holds
+							  *  the buffers, it restores them before the
+							  *  buffers are cleared. */
 
 
 #define SPA_NODE_METHOD_ADD_LISTENER		0
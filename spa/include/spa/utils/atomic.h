@@ -22,6 +22,14 @@ extern "C" {
 #define SPA_ATOMIC_STORE(s,v)		__atomic_store_n(&(s), (v), __ATOMIC_SEQ_CST)
 #define SPA_ATOMIC_XCHG(s,v)		__atomic_exchange_n(&(s), (v), __ATOMIC_SEQ_CST)
 
+#if defined(__x86_64__) || defined(__i386__)
+#define SPA_CPU_PAUSE()			__builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define SPA_CPU_PAUSE()			__asm__ __volatile__("yield" ::: "memory")
+#else
+#define SPA_CPU_PAUSE()			__asm__ __volatile__("" ::: "memory")
+#endif
+
 #define SPA_SEQ_WRITE(s)		SPA_ATOMIC_INC(s)
 #define SPA_SEQ_WRITE_SUCCESS(s1,s2)	((s1) + 1 == (s2) && ((s2) & 1) == 0)
 
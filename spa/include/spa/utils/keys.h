@@ -71,6 +71,8 @@ extern "C" {
 #define SPA_KEY_API_V4L2		"api.v4l2"			/**< key for the v4l2 api */
 #define SPA_KEY_API_V4L2_PATH		"api.v4l2.path"			/**< v4l2 device path as can be
 									  *  used in open() */
+#define SPA_KEY_API_V4L2_IMPORT_DMABUF	"api.v4l2.import-dmabuf"	/**< import DmaBuf buffers from
+									  *  the peer when possible */
 
 /** keys for libcamera api */
 #define SPA_KEY_API_LIBCAMERA		"api.libcamera"			/**< key for the libcamera api */
@@ -0,0 +1,266 @@
+/* Spa ALSA direct rendering */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <errno.h>
+
+#include <spa/utils/defs.h>
+
+#include "alsa-pcm-direct.h"
+
+static inline void *area_addr(struct pcm_direct *d, uint32_t block, uint32_t offset)
+{
+	return SPA_PTROFF(d->area[block], offset * d->stride, void);
+}
+
+int pcm_direct_use_buffers(struct pcm_direct *d, struct spa_buffer **buffers,
+		uint32_t n_buffers, uint32_t n_blocks, uint32_t stride)
+{
+	uint32_t i, j;
+	int res = 0;
+
+	pcm_direct_release_all(d, false);
+
+	spa_list_init(&d->out);
+	d->n_buffers = 0;
+	d->n_regions = 0;
+	d->frames = 0;
+	d->enabled = false;
+
+	if (n_buffers == 0)
+		return 0;
+	if (n_buffers > PCM_DIRECT_MAX_BUFFERS ||
+	    n_blocks == 0 || n_blocks > PCM_DIRECT_MAX_BLOCKS || stride == 0)
+		return -ENOTSUP;
+
+	d->n_blocks = n_blocks;
+	d->stride = stride;
+
+	for (i = 0; i < n_buffers; i++) {
+		struct pcm_direct_buffer *b = &d->buffers[i];
+		struct spa_data *dd = buffers[i]->datas;
+
+		b->id = i;
+		b->buf = buffers[i];
+		b->maxsize = dd[0].maxsize;
+		b->offset = 0;
+		b->frames = 0;
+
+		if (buffers[i]->n_datas != n_blocks)
+			res = -ENOTSUP;
+
+		/* we can only move the data when it is memory we may point
+		 * elsewhere */
+		for (j = 0; j < SPA_MIN(buffers[i]->n_datas, n_blocks); j++) {
+			b->mem[j] = dd[j].data;
+			if (dd[j].type != SPA_DATA_MemPtr || dd[j].data == NULL ||
+			    !SPA_FLAG_IS_SET(dd[j].flags, SPA_DATA_FLAG_DYNAMIC) ||
+			    dd[j].maxsize != b->maxsize)
+				res = -ENOTSUP;
+		}
+		b->out = true;
+		b->fresh = false;
+		spa_list_append(&d->out, &b->link);
+	}
+	d->n_buffers = n_buffers;
+
+	return res;
+}
+
+void pcm_direct_set_area(struct pcm_direct *d, void **area)
+{
+	uint32_t i;
+
+	if (area == NULL) {
+		pcm_direct_release_all(d, false);
+		d->have_area = false;
+		return;
+	}
+	if (d->have_area) {
+		for (i = 0; i < d->n_blocks; i++) {
+			if (d->area[i] != area[i])
+				break;
+		}
+		if (i == d->n_blocks)
+			return;
+		/* the old area is gone, we can't copy from it */
+		pcm_direct_release_all(d, false);
+	}
+	for (i = 0; i < d->n_blocks; i++)
+		d->area[i] = area[i];
+	d->have_area = true;
+}
+
+void pcm_direct_release(struct pcm_direct *d, uint32_t id, bool keep)
+{
+	struct pcm_direct_buffer *b = &d->buffers[id];
+	struct spa_data *dd = b->buf->datas;
+	uint32_t i;
+
+	if (b->frames == 0)
+		return;
+
+	for (i = 0; i < d->n_blocks; i++) {
+		if (keep)
+			memcpy(b->mem[i], area_addr(d, i, b->offset), b->frames * d->stride);
+		dd[i].data = b->mem[i];
+		dd[i].maxsize = b->maxsize;
+	}
+	b->frames = 0;
+	d->n_regions--;
+}
+
+void pcm_direct_release_all(struct pcm_direct *d, bool keep)
+{
+	uint32_t i;
+
+	for (i = 0; d->n_regions > 0 && i < d->n_buffers; i++)
+		pcm_direct_release(d, i, keep);
+}
+
+void pcm_direct_reset(struct pcm_direct *d)
+{
+	uint32_t i;
+
+	pcm_direct_release_all(d, true);
+
+	spa_list_init(&d->out);
+	for (i = 0; i < d->n_buffers; i++) {
+		struct pcm_direct_buffer *b = &d->buffers[i];
+		b->out = true;
+		b->fresh = false;
+		spa_list_append(&d->out, &b->link);
+	}
+}
+
+void pcm_direct_dequeue(struct pcm_direct *d, uint32_t id)
+{
+	struct pcm_direct_buffer *b = &d->buffers[id];
+
+	if (!b->out)
+		return;
+	spa_list_remove(&b->link);
+	b->out = false;
+	b->fresh = false;
+}
+
+void pcm_direct_recycle(struct pcm_direct *d, uint32_t id)
+{
+	struct pcm_direct_buffer *b = &d->buffers[id];
+
+	if (b->out)
+		return;
+	/* the data was written, the region is free again */
+	pcm_direct_release(d, id, false);
+
+	spa_list_append(&d->out, &b->link);
+	b->out = true;
+	b->fresh = true;
+}
+
+/* move the regions that overlap the frames we are going to write back to the
+ * memory of their buffer */
+static void evict(struct pcm_direct *d, struct pcm_direct_buffer *skip,
+		uint32_t offset, uint32_t frames)
+{
+	uint32_t i;
+
+	for (i = 0; i < d->n_buffers; i++) {
+		struct pcm_direct_buffer *b = &d->buffers[i];
+
+		if (b == skip || b->frames == 0)
+			continue;
+		if (b->offset < offset + frames && offset < b->offset + b->frames)
+			pcm_direct_release(d, i, true);
+	}
+}
+
+bool pcm_direct_write(struct pcm_direct *d, uint32_t id, uint32_t offs,
+		uint32_t offset, uint32_t frames)
+{
+	struct pcm_direct_buffer *b = &d->buffers[id];
+	struct spa_data *dd = b->buf->datas;
+	uint32_t i, n_bytes = frames * d->stride;
+
+	if (b->frames > 0 && SPA_PTROFF(dd[0].data, offs, void) == area_addr(d, 0, offset))
+		return false;
+
+	if (d->n_regions > 0)
+		evict(d, b, offset, frames);
+
+	for (i = 0; i < d->n_blocks; i++) {
+		void *dst = area_addr(d, i, offset);
+		void *src = SPA_PTROFF(dd[i].data, offs, void);
+
+		/* data in a region can overlap where it needs to go */
+		if (b->frames > 0)
+			memmove(dst, src, n_bytes);
+		else
+			spa_memcpy(dst, src, n_bytes);
+	}
+	return true;
+}
+
+static void assign(struct pcm_direct *d, struct pcm_direct_buffer *b,
+		uint32_t offset, uint32_t frames)
+{
+	struct spa_data *dd = b->buf->datas;
+	uint32_t i, size = frames * d->stride;
+
+	for (i = 0; i < d->n_blocks; i++) {
+		void *p = area_addr(d, i, offset);
+
+		/* the producer could have started to fill it */
+		if (!b->fresh)
+			memcpy(p, b->mem[i], size);
+		dd[i].data = p;
+		dd[i].maxsize = size;
+	}
+	b->offset = offset;
+	b->frames = frames;
+	d->n_regions++;
+}
+
+uint32_t pcm_direct_update(struct pcm_direct *d, uint32_t offset, uint32_t avail,
+		uint32_t frames)
+{
+	struct pcm_direct_buffer *b;
+	uint32_t i, start, end;
+
+	if (!d->enabled)
+		return 0;
+	if (!d->have_area || frames == 0)
+		goto done;
+
+	if (frames != d->frames) {
+		/* the producer fills each region completely, they all need
+		 * the new size */
+		pcm_direct_release_all(d, true);
+		d->frames = frames;
+	}
+
+	/* new regions go after the ones that are being filled */
+	start = offset;
+	end = offset + avail;
+	for (i = 0; i < d->n_buffers; i++) {
+		b = &d->buffers[i];
+		if (b->frames > 0)
+			start = SPA_MAX(start, b->offset + b->frames);
+	}
+
+	spa_list_for_each(b, &d->out, link) {
+		if (b->frames > 0)
+			continue;
+		if (start > end || end - start < frames ||
+		    frames * d->stride > b->maxsize)
+			break;
+		assign(d, b, start, frames);
+		start += frames;
+	}
+done:
+	spa_list_for_each(b, &d->out, link)
+		b->fresh = false;
+
+	return d->n_regions;
+}
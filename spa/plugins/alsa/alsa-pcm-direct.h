@@ -0,0 +1,108 @@
+/* Spa ALSA direct rendering */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef SPA_ALSA_PCM_DIRECT_H
+#define SPA_ALSA_PCM_DIRECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <spa/utils/list.h>
+#include <spa/buffer/buffer.h>
+#include <spa/param/audio/raw.h>
+
+/* Lets the producer render straight into the mmap area of a playback device.
+ *
+ * Each buffer that is with the producer gets its own region of the free part
+ * of the mmap area, right after the regions of the buffers before it. The
+ * data of the buffer points into its region and the producer fills it in
+ * place. When the buffers come back in the order they were handed out, the
+ * data is already where it needs to be and only has to be committed.
+ *
+ * Writing a buffer into the area moves any other region it overlaps back into
+ * the memory of its buffer first, so data that arrives out of order or with a
+ * different size is still copied correctly. Regions never wrap around the end
+ * of the area, the buffers around the wrap point are copied. */
+
+#define PCM_DIRECT_MAX_BUFFERS	32u
+#define PCM_DIRECT_MAX_BLOCKS	SPA_AUDIO_MAX_CHANNELS
+
+struct pcm_direct_buffer {
+	uint32_t id;
+	struct spa_buffer *buf;
+	struct spa_list link;			/**< in the out list when with the producer */
+
+	void *mem[PCM_DIRECT_MAX_BLOCKS];	/**< the memory of the buffer */
+	uint32_t maxsize;
+
+	uint32_t offset;			/**< first frame of the region */
+	uint32_t frames;			/**< frames in the region, 0 when the
+						  *  buffer uses its own memory */
+	unsigned int out:1;			/**< with the producer */
+	unsigned int fresh:1;			/**< not seen by the producer since
+						  *  it was recycled */
+};
+
+struct pcm_direct {
+	uint32_t n_blocks;
+	uint32_t stride;			/**< bytes per frame in a block */
+	void *area[PCM_DIRECT_MAX_BLOCKS];	/**< first frame of each block of the
+						  *  mmap area */
+	unsigned int have_area:1;
+	unsigned int enabled:1;
+
+	struct pcm_direct_buffer buffers[PCM_DIRECT_MAX_BUFFERS];
+	uint32_t n_buffers;
+	struct spa_list out;			/**< buffers with the producer, in the
+						  *  order they were handed out */
+	uint32_t n_regions;
+	uint32_t frames;			/**< size of the regions */
+};
+
+/** Use new buffers, they are all with the producer. The old buffers are moved
+ * back to their own memory first, use 0 buffers to only do that. Returns 0
+ * when the buffers have DYNAMIC MemPtr data that we can move into the mmap
+ * area. */
+int pcm_direct_use_buffers(struct pcm_direct *d, struct spa_buffer **buffers,
+		uint32_t n_buffers, uint32_t n_blocks, uint32_t stride);
+
+/** Set the address of the first frame of each block of the mmap area, NULL
+ * when the area goes away. */
+void pcm_direct_set_area(struct pcm_direct *d, void **area);
+
+/** Move a buffer back to its own memory. With keep, the data in the region is
+ * copied along. */
+void pcm_direct_release(struct pcm_direct *d, uint32_t id, bool keep);
+void pcm_direct_release_all(struct pcm_direct *d, bool keep);
+
+/** Hand all buffers back to the producer, in order. */
+void pcm_direct_reset(struct pcm_direct *d);
+
+/** The producer handed us a buffer */
+void pcm_direct_dequeue(struct pcm_direct *d, uint32_t id);
+
+/** The data of the buffer was written, it goes back to the producer */
+void pcm_direct_recycle(struct pcm_direct *d, uint32_t id);
+
+/** Write frames of buffer id, starting at byte offs of its data, into the area
+ * at frame offset. Returns true when the data was copied and false when it
+ * was rendered in place. */
+bool pcm_direct_write(struct pcm_direct *d, uint32_t id, uint32_t offs,
+		uint32_t offset, uint32_t frames);
+
+/** Give the buffers with the producer a region of the given size. The free
+ * part of the area starts at offset and has avail frames before it wraps
+ * around. Returns the number of buffers that have a region. */
+uint32_t pcm_direct_update(struct pcm_direct *d, uint32_t offset, uint32_t avail,
+		uint32_t frames);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* SPA_ALSA_PCM_DIRECT_H */
@@ -554,6 +554,7 @@ impl_node_port_enum_params(void *object, int seq,
 static int clear_buffers(struct state *this)
 {
 	if (this->n_buffers > 0) {
+		pcm_direct_use_buffers(&this->direct, NULL, 0, 0, 0);
 		spa_list_init(&this->ready);
 		this->n_buffers = 0;
 	}
@@ -601,6 +602,12 @@ static int port_set_format(void *object,
 			return -EINVAL;
 		}
 
+		/* the regions don't survive a new layout of the mmap area */
+		if (this->direct.enabled) {
+			pcm_direct_release_all(&this->direct, true);
+			pcm_direct_use_buffers(&this->direct, NULL, 0, 0, 0);
+		}
+
 		if ((err = spa_alsa_set_format(this, &info, flags)) < 0)
 			return err;
 
@@ -731,6 +738,16 @@ impl_node_port_use_buffers(void *object,
 	}
 	this->n_buffers = n_buffers;
 
+	/* let the producer render into the mmap area when we may move the
+	 * data of the buffers around */
+	this->direct.enabled = n_buffers > 0 && !this->disable_direct &&
+		SPA_FLAG_IS_SET(flags, SPA_NODE_BUFFERS_FLAG_MOVE_DATA) &&
+		this->use_mmap && snd_pcm_type(this->hndl) == SND_PCM_TYPE_HW &&
+		pcm_direct_use_buffers(&this->direct, buffers, n_buffers,
+				this->blocks, this->frame_size) == 0;
+
+	spa_log_debug(this->log, "%p: direct:%d", this, this->direct.enabled);
+
 	return 0;
 }
 
@@ -798,6 +815,8 @@ static int impl_node_process(void *object)
 		spa_log_trace_fp(this->log, "%p: queue buffer %u", this, io->buffer_id);
 		spa_list_append(&this->ready, &b->link);
 		SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_OUT);
+		if (this->direct.enabled)
+			pcm_direct_dequeue(&this->direct, b->id);
 		io->buffer_id = SPA_ID_INVALID;
 	}
 	if (!spa_list_is_empty(&this->ready)) {
@@ -127,6 +127,8 @@ static int alsa_set_param(struct state *state, const char *k, const char *s)
 		state->disable_batch = spa_atob(s);
 	} else if (spa_streq(k, "api.alsa.disable-tsched")) {
 		state->disable_tsched = spa_atob(s);
+	} else if (spa_streq(k, "api.alsa.disable-direct")) {
+		state->disable_direct = spa_atob(s);
 	} else if (spa_streq(k, "api.alsa.use-chmap")) {
 		state->props.use_chmap = spa_atob(s);
 	} else if (spa_streq(k, "api.alsa.multi-rate")) {
@@ -411,9 +413,17 @@ struct spa_pod *spa_alsa_enum_propinfo(struct state *state,
 			SPA_PROP_INFO_type, SPA_POD_String(state->clock_name),
 			SPA_PROP_INFO_params, SPA_POD_Bool(true));
 		break;
+	case 18:
+		param = spa_pod_builder_add_object(b,
+			SPA_TYPE_OBJECT_PropInfo, SPA_PARAM_PropInfo,
+			SPA_PROP_INFO_name, SPA_POD_String("api.alsa.disable-direct"),
+			SPA_PROP_INFO_description, SPA_POD_String("Disable rendering into the MMAP area"),
+			SPA_PROP_INFO_type, SPA_POD_CHOICE_Bool(state->disable_direct),
+			SPA_PROP_INFO_params, SPA_POD_Bool(true));
+		break;
 	// While adding params here, update the math in default too
 	default:
-		idx -= 17;
+		idx -= 18;
 		if (idx <= state->num_bind_ctls)
 			param = enum_bind_ctl_propinfo(state, idx - 1, b);
 		else
@@ -539,6 +549,9 @@ int spa_alsa_add_prop_params(struct state *state, struct spa_pod_builder *b)
 	spa_pod_builder_string(b, "clock.name");
 	spa_pod_builder_string(b, state->clock_name);
 
+	spa_pod_builder_string(b, "api.alsa.disable-direct");
+	spa_pod_builder_bool(b, state->disable_direct);
+
 	add_bind_ctl_params(state, b);
 
 	spa_pod_builder_pop(b, &f[0]);
@@ -1021,6 +1034,9 @@ int spa_alsa_close(struct state *state)
 
 	spa_alsa_pause(state);
 
+	pcm_direct_release_all(&state->direct, true);
+	pcm_direct_set_area(&state->direct, NULL);
+
 	spa_log_info(state->log, "%p: Device '%s' closing", state, state->name);
 	if ((err = snd_pcm_close(state->hndl)) < 0)
 		spa_log_warn(state->log, "%s: close failed: %s", state->name,
@@ -2270,6 +2286,9 @@ static void reset_buffers(struct state *this)
 	spa_list_init(&this->ready);
 	this->ready_offset = 0;
 
+	if (this->direct.enabled)
+		pcm_direct_reset(&this->direct);
+
 	for (i = 0; i < this->n_buffers; i++) {
 		struct buffer *b = &this->buffers[i];
 		if (this->stream == SND_PCM_STREAM_PLAYBACK) {
@@ -2295,6 +2314,9 @@ static int do_prepare(struct state *state)
 
 	CHECK(set_swparams(state), "swparams");
 
+	/* the ring is reset and filled with silence */
+	pcm_direct_release_all(&state->direct, true);
+
 	if ((!state->linked) && (err = snd_pcm_prepare(state->hndl)) < 0 && err != -EBUSY) {
 		spa_log_error(state->log, "%s: snd_pcm_prepare error: %s",
 				state->name, snd_strerror(err));
@@ -2738,6 +2760,9 @@ static int alsa_write_sync(struct state *state, uint64_t current_time)
 					state->name, avail, delay,
 					target, state->threshold, suppressed);
 
+			/* the ring position moves, get the pending data out of it */
+			pcm_direct_release_all(&state->direct, true);
+
 			if (avail > target)
 				snd_pcm_rewind(state->hndl, avail - target);
 			else if (avail < target)
@@ -2751,6 +2776,27 @@ static int alsa_write_sync(struct state *state, uint64_t current_time)
 	return 0;
 }
 
+/* The regions that the producer renders into are contiguous frames of each
+ * block, the mmap area needs to have that layout. */
+static void set_direct_area(struct state *state, const snd_pcm_channel_area_t *areas)
+{
+	void *area[PCM_DIRECT_MAX_BLOCKS];
+	int i;
+
+	for (i = 0; i < state->blocks; i++) {
+		if (areas[i].step != state->frame_size * 8 ||
+		    (areas[i].first % 8) != 0) {
+			spa_log_info(state->log, "%s: can't render into MMAP area",
+					state->name);
+			pcm_direct_release_all(&state->direct, true);
+			state->direct.enabled = false;
+			return;
+		}
+		area[i] = channel_area_addr(&areas[i], 0);
+	}
+	pcm_direct_set_area(&state->direct, area);
+}
+
 static int alsa_write_frames(struct state *state)
 {
 	snd_pcm_t *hndl = state->hndl;
@@ -2773,6 +2819,9 @@ again:
 		spa_log_trace_fp(state->log, "%p: begin offset:%ld avail:%ld threshold:%d",
 				state, offset, frames, state->threshold);
 		off = offset;
+
+		if (state->direct.enabled)
+			set_direct_area(state, my_areas);
 	} else {
 		off = 0;
 	}
@@ -2800,9 +2849,14 @@ again:
 		n_bytes = n_frames * frame_size;
 
 		if (SPA_LIKELY(state->use_mmap)) {
-			for (i = 0; i < b->buf->n_datas; i++) {
-				spa_memcpy(channel_area_addr(&my_areas[i], off),
-						SPA_PTROFF(d[i].data, offs, void), n_bytes);
+			if (state->direct.enabled) {
+				/* only copies when the data is not in place */
+				pcm_direct_write(&state->direct, b->id, offs, off, n_frames);
+			} else {
+				for (i = 0; i < b->buf->n_datas; i++) {
+					spa_memcpy(channel_area_addr(&my_areas[i], off),
+							SPA_PTROFF(d[i].data, offs, void), n_bytes);
+				}
 			}
 		} else {
 			void *bufs[b->buf->n_datas];
@@ -2820,6 +2874,8 @@ again:
 		if (state->ready_offset >= last_offset) {
 			spa_list_remove(&b->link);
 			SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUT);
+			if (state->direct.enabled)
+				pcm_direct_recycle(&state->direct, b->id);
 			state->io->buffer_id = b->id;
 			spa_log_trace_fp(state->log, "%p: reuse buffer %u", state, b->id);
 
@@ -2852,6 +2908,12 @@ again:
 	if (!spa_list_is_empty(&state->ready) && written > 0)
 		goto again;
 
+	/* let the producer render the next quantum after what we committed */
+	if (state->direct.enabled && state->position)
+		pcm_direct_update(&state->direct, offset + written,
+				spa_list_is_empty(&state->ready) ? frames - written : 0,
+				state->position->clock.duration);
+
 	state->sample_count += total_written;
 
 	if (SPA_UNLIKELY(!state->alsa_started && (total_written > 0 || frames == 0)))
@@ -3508,6 +3570,8 @@ int spa_alsa_pause(struct state *state)
 	state->started = false;
 	spa_loop_invoke(state->data_loop, do_state_sync, 0, NULL, 0, true, state);
 
+	pcm_direct_release_all(&state->direct, true);
+
 	spa_list_for_each(follower, &state->followers, driver_link)
 		spa_alsa_pause(follower);
 
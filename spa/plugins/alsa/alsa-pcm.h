@@ -33,6 +33,7 @@ extern "C" {
 #include <spa/param/tag-utils.h>
 
 #include "alsa.h"
+#include "alsa-pcm-direct.h"
 
 
 #define MAX_RATES	16
@@ -150,6 +151,7 @@ struct state {
 	unsigned int disable_mmap:1;
 	unsigned int disable_batch:1;
 	unsigned int disable_tsched:1;
+	unsigned int disable_direct:1;
 	char clock_name[64];
 	uint32_t quantum_limit;
 
@@ -190,6 +192,8 @@ struct state {
 
 	size_t ready_offset;
 
+	struct pcm_direct direct;
+
 	/* Either a single source for tsched, or a set of pollfds from ALSA */
 	struct spa_source source[MAX_POLL];
 	int timerfd;
@@ -0,0 +1,394 @@
+/* Spa ALSA direct rendering */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <spa/utils/defs.h>
+#include <spa/buffer/alloc.h>
+
+#include "alsa-pcm-direct.h"
+
+#define N_BLOCKS	2
+#define STRIDE		sizeof(int32_t)
+#define RING_FRAMES	256
+#define MAX_FRAMES	128
+#define QUANTUM		32
+
+struct context {
+	struct pcm_direct direct;
+	struct spa_buffer **buffers;
+	uint32_t n_buffers;
+	int32_t ring[N_BLOCKS][RING_FRAMES];
+	void *area[N_BLOCKS];
+	uint32_t appl;
+};
+
+static inline int32_t sample(uint32_t tag, uint32_t block, uint32_t frame)
+{
+	return tag * 100000 + block * 1000 + frame;
+}
+
+static void setup_context(struct context *ctx, uint32_t n_buffers, uint32_t data_flags)
+{
+	struct spa_data datas[N_BLOCKS];
+	uint32_t aligns[N_BLOCKS];
+	uint32_t i;
+
+	spa_zero(*ctx);
+	for (i = 0; i < N_BLOCKS; i++) {
+		datas[i] = (struct spa_data) {
+			.type = SPA_DATA_MemPtr,
+			.flags = data_flags,
+			.maxsize = MAX_FRAMES * STRIDE,
+		};
+		aligns[i] = 16;
+		ctx->area[i] = ctx->ring[i];
+	}
+	ctx->buffers = spa_buffer_alloc_array(n_buffers, 0, 0, NULL,
+			N_BLOCKS, datas, aligns);
+	spa_assert_se(ctx->buffers != NULL);
+	ctx->n_buffers = n_buffers;
+}
+
+static int use_buffers(struct context *ctx)
+{
+	int res;
+
+	res = pcm_direct_use_buffers(&ctx->direct, ctx->buffers, ctx->n_buffers,
+			N_BLOCKS, STRIDE);
+	ctx->direct.enabled = res == 0;
+	pcm_direct_set_area(&ctx->direct, ctx->area);
+	return res;
+}
+
+static void clean_context(struct context *ctx)
+{
+	pcm_direct_use_buffers(&ctx->direct, NULL, 0, 0, 0);
+	free(ctx->buffers);
+}
+
+static bool in_region(struct context *ctx, uint32_t id, uint32_t offset)
+{
+	struct spa_data *d = ctx->buffers[id]->datas;
+	uint32_t i;
+
+	for (i = 0; i < N_BLOCKS; i++) {
+		if (d[i].data != &ctx->ring[i][offset])
+			return false;
+	}
+	return true;
+}
+
+/* the producer renders frames into the buffer at frame offs */
+static void render(struct context *ctx, uint32_t id, uint32_t tag,
+		uint32_t offs, uint32_t frames)
+{
+	struct spa_data *d = ctx->buffers[id]->datas;
+	uint32_t i, j;
+
+	for (i = 0; i < N_BLOCKS; i++) {
+		int32_t *p = d[i].data;
+
+		spa_assert_se((offs + frames) * STRIDE <= d[i].maxsize);
+		for (j = offs; j < offs + frames; j++)
+			p[j] = sample(tag, i, j);
+	}
+}
+
+/* the producer hands a buffer with frames to the sink */
+static void queue(struct context *ctx, uint32_t id, uint32_t frames)
+{
+	struct spa_data *d = ctx->buffers[id]->datas;
+	uint32_t i;
+
+	for (i = 0; i < N_BLOCKS; i++) {
+		d[i].chunk->offset = 0;
+		d[i].chunk->size = frames * STRIDE;
+	}
+	pcm_direct_dequeue(&ctx->direct, id);
+}
+
+/* the sink writes the buffer at the application pointer and recycles it,
+ * returns true when it was copied */
+static bool write_buffer(struct context *ctx, uint32_t id)
+{
+	struct spa_data *d = ctx->buffers[id]->datas;
+	uint32_t frames = d[0].chunk->size / STRIDE;
+	bool copied;
+
+	copied = pcm_direct_write(&ctx->direct, id, d[0].chunk->offset, ctx->appl, frames);
+	pcm_direct_recycle(&ctx->direct, id);
+	ctx->appl += frames;
+	return copied;
+}
+
+static uint32_t update(struct context *ctx, uint32_t frames)
+{
+	return pcm_direct_update(&ctx->direct, ctx->appl,
+			RING_FRAMES - ctx->appl, frames);
+}
+
+static void check_ring(struct context *ctx, uint32_t offset, uint32_t tag,
+		uint32_t first, uint32_t frames)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < N_BLOCKS; i++) {
+		for (j = 0; j < frames; j++)
+			spa_assert_se(ctx->ring[i][offset + j] == sample(tag, i, first + j));
+	}
+}
+
+static void test_queue_before_commit(void)
+{
+	struct context ctx;
+	uint32_t i;
+
+	setup_context(&ctx, 3, SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC);
+	spa_assert_se(use_buffers(&ctx) == 0);
+
+	/* every buffer gets its own region, one after the other */
+	spa_assert_se(update(&ctx, QUANTUM) == 3);
+	for (i = 0; i < 3; i++) {
+		spa_assert_se(in_region(&ctx, i, i * QUANTUM));
+		spa_assert_se(ctx.buffers[i]->datas[0].maxsize == QUANTUM * STRIDE);
+	}
+
+	/* the producer fills all buffers before the sink writes any */
+	for (i = 0; i < 3; i++) {
+		render(&ctx, i, i + 1, 0, QUANTUM);
+		queue(&ctx, i, QUANTUM);
+	}
+	for (i = 0; i < 3; i++)
+		spa_assert_se(!write_buffer(&ctx, i));
+
+	for (i = 0; i < 3; i++)
+		check_ring(&ctx, i * QUANTUM, i + 1, 0, QUANTUM);
+
+	/* the recycled buffers continue after the data we wrote */
+	spa_assert_se(update(&ctx, QUANTUM) == 3);
+	for (i = 0; i < 3; i++)
+		spa_assert_se(in_region(&ctx, i, (i + 3) * QUANTUM));
+
+	/* and the next round is in place again */
+	for (i = 0; i < 3; i++) {
+		render(&ctx, i, i + 4, 0, QUANTUM);
+		queue(&ctx, i, QUANTUM);
+	}
+	for (i = 0; i < 3; i++)
+		spa_assert_se(!write_buffer(&ctx, i));
+	for (i = 0; i < 6; i++)
+		check_ring(&ctx, i * QUANTUM, i + 1, 0, QUANTUM);
+
+	clean_context(&ctx);
+}
+
+static void test_out_of_order(void)
+{
+	struct context ctx;
+	uint32_t i;
+
+	setup_context(&ctx, 3, SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC);
+	spa_assert_se(use_buffers(&ctx) == 0);
+	spa_assert_se(update(&ctx, QUANTUM) == 3);
+
+	/* buffer 0 is partially filled when buffer 1 arrives */
+	render(&ctx, 0, 1, 0, 10);
+	render(&ctx, 1, 2, 0, QUANTUM);
+	queue(&ctx, 1, QUANTUM);
+
+	/* buffer 1 goes where buffer 0 renders, buffer 0 moves out of
+	 * the way with the data it already has */
+	spa_assert_se(write_buffer(&ctx, 1));
+	check_ring(&ctx, 0, 2, 0, QUANTUM);
+	spa_assert_se(!in_region(&ctx, 0, 0));
+	spa_assert_se(ctx.buffers[0]->datas[0].maxsize == MAX_FRAMES * STRIDE);
+	spa_assert_se(in_region(&ctx, 2, 2 * QUANTUM));
+
+	/* buffer 0 is completed in its own memory and copied */
+	render(&ctx, 0, 1, 10, QUANTUM - 10);
+	queue(&ctx, 0, QUANTUM);
+	spa_assert_se(write_buffer(&ctx, 0));
+	check_ring(&ctx, QUANTUM, 1, 0, QUANTUM);
+
+	/* buffer 2 was not touched and is in place */
+	render(&ctx, 2, 3, 0, QUANTUM);
+	queue(&ctx, 2, QUANTUM);
+	spa_assert_se(!write_buffer(&ctx, 2));
+	for (i = 0; i < 3; i++)
+		check_ring(&ctx, i * QUANTUM, (uint32_t[]) { 2, 1, 3 }[i], 0, QUANTUM);
+
+	clean_context(&ctx);
+}
+
+static void test_short_buffer(void)
+{
+	struct context ctx;
+
+	setup_context(&ctx, 2, SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC);
+	spa_assert_se(use_buffers(&ctx) == 0);
+	spa_assert_se(update(&ctx, QUANTUM) == 2);
+
+	/* a buffer with less data than its region leaves a gap, the next
+	 * buffer is moved back over it */
+	render(&ctx, 0, 1, 0, 20);
+	queue(&ctx, 0, 20);
+	render(&ctx, 1, 2, 0, QUANTUM);
+	queue(&ctx, 1, QUANTUM);
+
+	spa_assert_se(!write_buffer(&ctx, 0));
+	spa_assert_se(write_buffer(&ctx, 1));
+
+	check_ring(&ctx, 0, 1, 0, 20);
+	check_ring(&ctx, 20, 2, 0, QUANTUM);
+
+	clean_context(&ctx);
+}
+
+static void test_release(void)
+{
+	struct context ctx;
+	uint32_t i;
+
+	setup_context(&ctx, 2, SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC);
+	spa_assert_se(use_buffers(&ctx) == 0);
+	spa_assert_se(update(&ctx, QUANTUM) == 2);
+
+	render(&ctx, 0, 1, 0, 5);
+
+	/* the ring position moves, what was rendered is kept */
+	pcm_direct_release_all(&ctx.direct, true);
+	for (i = 0; i < 2; i++) {
+		spa_assert_se(!in_region(&ctx, i, i * QUANTUM));
+		spa_assert_se(ctx.buffers[i]->datas[0].maxsize == MAX_FRAMES * STRIDE);
+	}
+	render(&ctx, 0, 1, 5, QUANTUM - 5);
+	queue(&ctx, 0, QUANTUM);
+	spa_assert_se(write_buffer(&ctx, 0));
+	check_ring(&ctx, 0, 1, 0, QUANTUM);
+
+	/* clearing the buffers restores the memory */
+	spa_assert_se(update(&ctx, QUANTUM) == 2);
+	spa_assert_se(in_region(&ctx, 1, QUANTUM));
+	pcm_direct_use_buffers(&ctx.direct, NULL, 0, 0, 0);
+	spa_assert_se(!in_region(&ctx, 1, QUANTUM));
+	spa_assert_se(ctx.buffers[1]->datas[0].maxsize == MAX_FRAMES * STRIDE);
+
+	clean_context(&ctx);
+}
+
+static void test_fresh(void)
+{
+	struct context ctx;
+
+	setup_context(&ctx, 2, SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC);
+	spa_assert_se(use_buffers(&ctx) == 0);
+
+	/* buffer 0 was with the producer, what it has goes along */
+	render(&ctx, 0, 1, 0, 7);
+	spa_assert_se(update(&ctx, QUANTUM) == 2);
+	spa_assert_se(in_region(&ctx, 0, 0));
+	check_ring(&ctx, 0, 1, 0, 7);
+
+	render(&ctx, 0, 1, 7, QUANTUM - 7);
+	queue(&ctx, 0, QUANTUM);
+	spa_assert_se(!write_buffer(&ctx, 0));
+
+	/* a recycled buffer has nothing to keep, its region is not touched */
+	memset(&ctx.ring[0][2 * QUANTUM], 0xaa, QUANTUM * STRIDE);
+	spa_assert_se(update(&ctx, QUANTUM) == 2);
+	spa_assert_se(in_region(&ctx, 0, 2 * QUANTUM));
+	spa_assert_se(ctx.ring[0][2 * QUANTUM] == (int32_t)0xaaaaaaaa);
+
+	clean_context(&ctx);
+}
+
+static void test_resize(void)
+{
+	struct context ctx;
+	uint32_t i;
+
+	setup_context(&ctx, 2, SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC);
+	spa_assert_se(use_buffers(&ctx) == 0);
+	spa_assert_se(update(&ctx, QUANTUM) == 2);
+
+	render(&ctx, 1, 2, 0, 3);
+
+	/* a new quantum moves all regions */
+	spa_assert_se(update(&ctx, 2 * QUANTUM) == 2);
+	for (i = 0; i < 2; i++) {
+		spa_assert_se(in_region(&ctx, i, i * 2 * QUANTUM));
+		spa_assert_se(ctx.buffers[i]->datas[0].maxsize == 2 * QUANTUM * STRIDE);
+	}
+	check_ring(&ctx, 2 * QUANTUM, 2, 0, 3);
+
+	/* too big for the buffers */
+	spa_assert_se(update(&ctx, 2 * MAX_FRAMES) == 0);
+	spa_assert_se(ctx.buffers[1]->datas[0].maxsize == MAX_FRAMES * STRIDE);
+	check_ring(&ctx, 2 * QUANTUM, 2, 0, 0);
+	render(&ctx, 1, 2, 3, 1);
+	spa_assert_se(((int32_t*)ctx.buffers[1]->datas[0].data)[2] == sample(2, 0, 2));
+
+	clean_context(&ctx);
+}
+
+static void test_no_room(void)
+{
+	struct context ctx;
+
+	setup_context(&ctx, 2, SPA_DATA_FLAG_READWRITE | SPA_DATA_FLAG_DYNAMIC);
+	spa_assert_se(use_buffers(&ctx) == 0);
+
+	/* only one region fits before the end of the ring */
+	ctx.appl = RING_FRAMES - QUANTUM - 10;
+	spa_assert_se(update(&ctx, QUANTUM) == 1);
+	spa_assert_se(in_region(&ctx, 0, ctx.appl));
+
+	render(&ctx, 0, 1, 0, QUANTUM);
+	queue(&ctx, 0, QUANTUM);
+	render(&ctx, 1, 2, 0, 10);
+	queue(&ctx, 1, 10);
+	spa_assert_se(!write_buffer(&ctx, 0));
+	spa_assert_se(write_buffer(&ctx, 1));
+	check_ring(&ctx, RING_FRAMES - QUANTUM - 10, 1, 0, QUANTUM);
+	check_ring(&ctx, RING_FRAMES - 10, 2, 0, 10);
+
+	/* after the wrap around there is room again */
+	ctx.appl = 0;
+	spa_assert_se(update(&ctx, QUANTUM) == 2);
+	spa_assert_se(in_region(&ctx, 0, 0));
+	spa_assert_se(in_region(&ctx, 1, QUANTUM));
+
+	clean_context(&ctx);
+}
+
+static void test_not_dynamic(void)
+{
+	struct context ctx;
+
+	/* we can't move the data of these buffers */
+	setup_context(&ctx, 2, SPA_DATA_FLAG_READWRITE);
+	spa_assert_se(use_buffers(&ctx) == -ENOTSUP);
+	spa_assert_se(update(&ctx, QUANTUM) == 0);
+	spa_assert_se(!in_region(&ctx, 0, 0));
+
+	clean_context(&ctx);
+}
+
+int main(int argc, char *argv[])
+{
+	test_queue_before_commit();
+	test_out_of_order();
+	test_short_buffer();
+	test_release();
+	test_fresh();
+	test_resize();
+	test_no_room();
+	test_not_dynamic();
+
+	return 0;
+}
@@ -463,9 +463,12 @@ static int negotiate_buffers(struct impl *this)
 		       this->buffers, this->n_buffers)) < 0)
 		return res;
 
+	/* the buffers are only shared between the converter and the
+	 * follower, the follower can move the data around */
 	if ((res = spa_node_port_use_buffers(this->follower,
 		       this->direction, 0,
-		       follower_alloc ? SPA_NODE_BUFFERS_FLAG_ALLOC : 0,
+		       follower_alloc ? SPA_NODE_BUFFERS_FLAG_ALLOC :
+				SPA_NODE_BUFFERS_FLAG_MOVE_DATA,
 		       this->buffers, this->n_buffers)) < 0)
 		return res;
 
@@ -1550,6 +1553,9 @@ impl_node_port_use_buffers(void *object,
 	spa_log_debug(this->log, "%p: %d %d:%d", this,
 			n_buffers, direction, port_id);
 
+	/* these buffers are not ours, they can be shared with other nodes */
+	SPA_FLAG_CLEAR(flags, SPA_NODE_BUFFERS_FLAG_MOVE_DATA);
+
 	if ((res = spa_node_port_use_buffers(this->target,
 					direction, port_id, flags, buffers, n_buffers)) < 0)
 		return res;
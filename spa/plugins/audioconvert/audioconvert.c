@@ -6,6 +6,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/cpu.h>
@@ -46,6 +47,7 @@ static struct spa_log_topic log_topic = SPA_LOG_TOPIC(0, "spa.audioconvert");
 #define MAX_BUFFERS	32
 #define MAX_DATAS	SPA_AUDIO_MAX_CHANNELS
 #define MAX_PORTS	(SPA_AUDIO_MAX_CHANNELS+1)
+#define TILE_SAMPLES	256
 
 #define DEFAULT_MUTE		false
 #define DEFAULT_VOLUME		VOLUME_NORM
@@ -186,12 +188,30 @@ struct dir {
 	unsigned int control:1;
 };
 
+/* scratch memory shared by all converters that process on the same data
+ * loop. The loop only runs one of them at a time and the buffers are not
+ * kept between process calls. */
+struct scratch_arena {
+	struct spa_list link;
+	struct spa_loop *data_loop;
+	int ref;
+
+	uint32_t size;
+	uint32_t n_ports;
+	void *data;
+
+	float *empty;
+	float *scratch;
+	float *tmp_datas[2][MAX_PORTS];
+};
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_node node;
 
 	struct spa_log *log;
 	struct spa_cpu *cpu;
+	struct spa_loop *data_loop;
 
 	uint32_t cpu_flags;
 	uint32_t max_align;
@@ -238,12 +258,7 @@ struct impl {
 	unsigned int rate_adjust:1;
 	unsigned int port_ignore_latency:1;
 
-	uint32_t scratch_size;
-	uint32_t scratch_ports;
-	float *empty;
-	float *scratch;
-	float *tmp[2];
-	float *tmp_datas[2][MAX_PORTS];
+	struct scratch_arena *arena;
 
 	struct wav_file *wav_file;
 };
@@ -1756,58 +1771,118 @@ static int setup_out_convert(struct impl *this)
 	return 0;
 }
 
-static void free_tmp(struct impl *this)
+static pthread_mutex_t arenas_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct spa_list arenas = { &arenas, &arenas };
+
+static struct scratch_arena *arena_acquire(struct spa_loop *data_loop)
+{
+	struct scratch_arena *a;
+
+	pthread_mutex_lock(&arenas_lock);
+	if (data_loop != NULL) {
+		spa_list_for_each(a, &arenas, link) {
+			if (a->data_loop == data_loop) {
+				a->ref++;
+				goto done;
+			}
+		}
+	}
+	if ((a = calloc(1, sizeof(*a))) == NULL)
+		goto done;
+	a->data_loop = data_loop;
+	a->ref = 1;
+	/* without a data loop we can't share */
+	if (data_loop != NULL)
+		spa_list_append(&arenas, &a->link);
+done:
+	pthread_mutex_unlock(&arenas_lock);
+	return a;
+}
+
+static void arena_release(struct scratch_arena *a)
+{
+	pthread_mutex_lock(&arenas_lock);
+	if (--a->ref == 0) {
+		if (a->data_loop != NULL)
+			spa_list_remove(&a->link);
+		free(a->data);
+		free(a);
+	}
+	pthread_mutex_unlock(&arenas_lock);
+}
+
+static int do_arena_swap(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
 {
+	struct scratch_arena *a = user_data;
+	struct scratch_arena *n = *(struct scratch_arena **)data;
+	void *old = a->data;
 	uint32_t i;
 
-	spa_log_debug(this->log, "free tmp %d", this->scratch_size);
-
-	free(this->empty);
-	this->empty = NULL;
-	this->scratch_size = 0;
-	this->scratch_ports = 0;
-	free(this->scratch);
-	this->scratch = NULL;
-	free(this->tmp[0]);
-	this->tmp[0] = NULL;
-	free(this->tmp[1]);
-	this->tmp[1] = NULL;
+	/* another converter grew the arena in the meantime, keep the
+	 * current memory, the caller checks the size again */
+	if (n->size < a->size || n->n_ports < a->n_ports)
+		return 0;
+
+	a->size = n->size;
+	a->n_ports = n->n_ports;
+	a->data = n->data;
+	a->empty = n->empty;
+	a->scratch = n->scratch;
 	for (i = 0; i < MAX_PORTS; i++) {
-		this->tmp_datas[0][i] = NULL;
-		this->tmp_datas[1][i] = NULL;
+		a->tmp_datas[0][i] = n->tmp_datas[0][i];
+		a->tmp_datas[1][i] = n->tmp_datas[1][i];
 	}
+	n->data = old;
+	return 0;
 }
 
 static int ensure_tmp(struct impl *this, uint32_t maxsize, uint32_t maxports)
 {
-	if (maxsize > this->scratch_size || maxports > this->scratch_ports) {
-		float *empty, *scratch, *tmp[2];
-		uint32_t i;
+	struct scratch_arena *a = this->arena, n;
+	uint32_t i, stride;
+	void *d;
+	int res;
 
-		spa_log_debug(this->log, "resize tmp %d -> %d", this->scratch_size, maxsize);
+	/* the arena only grows and is only changed from the data loop.
+	 * Converters on other loops don't need to wait for this one so we
+	 * don't lock, we check again after the swap instead. */
+	while (maxsize > a->size || maxports > a->n_ports) {
+		spa_zero(n);
+		n.size = SPA_MAX(maxsize, a->size);
+		n.n_ports = SPA_MAX(maxports, a->n_ports);
 
-		if ((empty = realloc(this->empty, maxsize + MAX_ALIGN)) != NULL)
-			this->empty = empty;
-		if ((scratch = realloc(this->scratch, maxsize + MAX_ALIGN)) != NULL)
-			this->scratch = scratch;
-		if ((tmp[0] = realloc(this->tmp[0], (maxsize + MAX_ALIGN) * maxports)) != NULL)
-			this->tmp[0] = tmp[0];
-		if ((tmp[1] = realloc(this->tmp[1], (maxsize + MAX_ALIGN) * maxports)) != NULL)
-			this->tmp[1] = tmp[1];
+		spa_log_debug(this->log, "%p: resize arena %p %dx%d -> %dx%d", this, a,
+				a->size, a->n_ports, n.size, n.n_ports);
 
-		if (empty == NULL || scratch == NULL || tmp[0] == NULL || tmp[1] == NULL) {
-			free_tmp(this);
-			return -ENOMEM;
+		/* empty, scratch and two tmp blocks of n_ports */
+		stride = SPA_ROUND_UP_N(n.size, MAX_ALIGN);
+		if ((n.data = calloc(1, MAX_ALIGN + stride * (2 + 2 * n.n_ports))) == NULL)
+			return -errno;
+
+		d = SPA_PTR_ALIGN(n.data, MAX_ALIGN, void);
+		n.empty = d;
+		n.scratch = SPA_PTROFF(d, stride, float);
+		for (i = 0; i < n.n_ports; i++) {
+			n.tmp_datas[0][i] = SPA_PTROFF(d, stride * (2 + i), float);
+			n.tmp_datas[1][i] = SPA_PTROFF(d, stride * (2 + n.n_ports + i), float);
 		}
-		memset(this->empty, 0, maxsize + MAX_ALIGN);
-		this->scratch_size = maxsize;
-		this->scratch_ports = maxports;
 
-		for (i = 0; i < maxports; i++) {
-			this->tmp_datas[0][i] = SPA_PTROFF(tmp[0], maxsize * i, void);
-			this->tmp_datas[0][i] = SPA_PTR_ALIGN(this->tmp_datas[0][i], MAX_ALIGN, void);
-			this->tmp_datas[1][i] = SPA_PTROFF(tmp[1], maxsize * i, void);
-			this->tmp_datas[1][i] = SPA_PTR_ALIGN(this->tmp_datas[1][i], MAX_ALIGN, void);
+		/* other converters might be processing with the old memory, swap it
+		 * from the data loop so that they all see the new layout */
+		d = &n;
+		if (a->data_loop != NULL)
+			res = spa_loop_invoke(a->data_loop, do_arena_swap, 0, &d, sizeof(d), true, a);
+		else
+			res = do_arena_swap(NULL, false, 0, &d, sizeof(d), a);
+
+		/* this is the old memory or our block when it was not used */
+		free(n.data);
+
+		if (res < 0) {
+			spa_log_error(this->log, "%p: can't resize arena %p: %s",
+					this, a, spa_strerror(res));
+			return res;
 		}
 	}
 	return 0;
@@ -2729,6 +2804,33 @@ static int channelmix_process_apply_sequence(struct impl *this,
 	return end ? 1 : 0;
 }
 
+/* run the channelmix and the output conversion on small tiles so that the
+ * mixed samples are still in the cache when they are converted */
+static void channelmix_convert_tiled(struct impl *this, void *SPA_RESTRICT dst[],
+		const uint32_t dst_stride[], uint32_t n_dst, const void *SPA_RESTRICT src[],
+		float *SPA_RESTRICT tile[], uint32_t n_samples)
+{
+	struct dir *dir = &this->dir[SPA_DIRECTION_OUTPUT];
+	const void *s[MAX_PORTS], *t[MAX_PORTS];
+	void *d[MAX_PORTS];
+	uint32_t i, offs, chunk;
+
+	for (i = 0; i < dir->conv.n_channels; i++)
+		t[dir->need_remap ? dir->remap[i] : i] = tile[i];
+
+	for (offs = 0; offs < n_samples; offs += chunk) {
+		chunk = SPA_MIN(n_samples - offs, (uint32_t)TILE_SAMPLES);
+
+		for (i = 0; i < this->mix.src_chan; i++)
+			s[i] = SPA_PTROFF(src[i], offs * sizeof(float), void);
+		channelmix_process(&this->mix, (void**)tile, s, chunk);
+
+		for (i = 0; i < n_dst; i++)
+			d[i] = SPA_PTROFF(dst[i], offs * dst_stride[i], void);
+		convert_process(&dir->conv, d, t, chunk);
+	}
+}
+
 static inline uint32_t resample_get_in_size(struct impl *this, bool passthrough, uint32_t out_size)
 {
 	uint32_t match_size = passthrough ? out_size : resample_in_len(&this->resample, out_size);
@@ -2793,6 +2895,8 @@ static int impl_node_process(void *object)
 	const void *src_datas[MAX_PORTS], **in_datas;
 	void *dst_datas[MAX_PORTS], *remap_src_datas[MAX_PORTS], *remap_dst_datas[MAX_PORTS];
 	void **out_datas, **dst_remap;
+	uint32_t dst_strides[MAX_PORTS];
+	float volumes[MAX_PORTS];
 	uint32_t i, j, n_src_datas = 0, n_dst_datas = 0, n_mon_datas = 0, remap;
 	uint32_t n_samples, max_in, n_out, max_out, quant_samples;
 	struct port *port, *ctrlport = NULL;
@@ -2801,6 +2905,7 @@ static int impl_node_process(void *object)
 	struct dir *dir;
 	int tmp = 0, res = 0, suppressed;
 	bool in_passthrough, mix_passthrough, resample_passthrough, out_passthrough;
+	bool mix_simple, fuse_in, fuse_out, tile_out;
 	bool in_avail = false, flush_in = false, flush_out = false;
 	bool draining = false, in_empty = this->out_offset == 0;
 	struct spa_io_buffers *io, *ctrlio = NULL;
@@ -2883,10 +2988,10 @@ static int impl_node_process(void *object)
 							i * port->blocks + j);
 				} else {
 					remap = n_src_datas++;
-					src_datas[remap] = SPA_PTR_ALIGN(this->empty, MAX_ALIGN, void);
+					src_datas[remap] = this->arena->empty;
 					spa_log_trace_fp(this->log, "%p: empty input %d->%d", this,
 							i * port->blocks + j, remap);
-					max_in = SPA_MIN(max_in, this->scratch_size / port->stride);
+					max_in = SPA_MIN(max_in, this->arena->size / port->stride);
 				}
 			}
 		} else {
@@ -2984,10 +3089,11 @@ static int impl_node_process(void *object)
 					spa_log_trace_fp(this->log, "%p: empty control %d", this, j);
 				} else {
 					remap = n_dst_datas++;
-					dst_datas[remap] = SPA_PTR_ALIGN(this->scratch, MAX_ALIGN, void);
+					dst_datas[remap] = this->arena->scratch;
+					dst_strides[remap] = port->stride;
 					spa_log_trace_fp(this->log, "%p: empty output %d->%d", this,
 						i * port->blocks + j, remap);
-					max_out = SPA_MIN(max_out, this->scratch_size / port->stride);
+					max_out = SPA_MIN(max_out, this->arena->size / port->stride);
 				}
 			}
 		} else {
@@ -3028,6 +3134,7 @@ static int impl_node_process(void *object)
 					remap = n_dst_datas++;
 					dst_datas[remap] = SPA_PTROFF(bd->data,
 							this->out_offset * port->stride, void);
+					dst_strides[remap] = port->stride;
 					max_out = SPA_MIN(max_out, bd->maxsize / port->stride);
 
 					spa_log_trace_fp(this->log, "%p: output %d offs:%d %d->%d", this,
@@ -3068,6 +3175,19 @@ static int impl_node_process(void *object)
 	if (in_passthrough && mix_passthrough && resample_passthrough)
 		out_passthrough = false;
 
+	/* plan the fused paths. A mix that only applies a volume per channel is
+	 * folded into the input or the output conversion. Other mixes are done
+	 * in tiles together with the output conversion when nothing is between
+	 * them. */
+	mix_simple = !mix_passthrough &&
+		(ctrlport == NULL || ctrlport->ctrl == NULL) && (this->vol_ramp_sequence == NULL);
+	fuse_in = mix_simple && this->mix.per_channel && !in_passthrough &&
+		this->dir[SPA_DIRECTION_INPUT].conv.process_volume != NULL;
+	fuse_out = mix_simple && this->mix.per_channel && !fuse_in &&
+		resample_passthrough && !out_passthrough && dir->conv.process_volume != NULL;
+	tile_out = mix_simple && !fuse_in && !fuse_out &&
+		resample_passthrough && !out_passthrough;
+
 	if (out_passthrough && dir->need_remap) {
 		for (i = 0; i < dir->conv.n_channels; i++) {
 			remap_dst_datas[i] = dst_datas[dir->remap[i]];
@@ -3083,10 +3203,13 @@ static int impl_node_process(void *object)
 
 	dir = &this->dir[SPA_DIRECTION_INPUT];
 	if (!in_passthrough) {
-		if (mix_passthrough && resample_passthrough && out_passthrough)
+		if ((mix_passthrough || fuse_in) && resample_passthrough && out_passthrough) {
 			out_datas = (void **)dst_remap;
-		else
-			out_datas = (void **)this->tmp_datas[(tmp++) & 1];
+			if (fuse_in)
+				n_samples = SPA_MIN(n_samples, n_out);
+		} else {
+			out_datas = (void **)this->arena->tmp_datas[(tmp++) & 1];
+		}
 
 		if (dir->need_remap) {
 			for (i = 0; i < dir->conv.n_channels; i++) {
@@ -3098,8 +3221,18 @@ static int impl_node_process(void *object)
 				remap_src_datas[i] = out_datas[i];
 		}
 
-		spa_log_trace_fp(this->log, "%p: input convert %d", this, n_samples);
-		convert_process(&dir->conv, remap_src_datas, src_datas, n_samples);
+		if (fuse_in) {
+			for (i = 0; i < dir->conv.n_channels; i++) {
+				remap = dir->need_remap ? dir->remap[i] : i;
+				volumes[i] = this->mix.matrix[remap][remap];
+			}
+			spa_log_trace_fp(this->log, "%p: input convert volume %d", this, n_samples);
+			convert_process_volume(&dir->conv, remap_src_datas, src_datas,
+					volumes, n_samples);
+		} else {
+			spa_log_trace_fp(this->log, "%p: input convert %d", this, n_samples);
+			convert_process(&dir->conv, remap_src_datas, src_datas, n_samples);
+		}
 	} else {
 		if (dir->need_remap) {
 			for (i = 0; i < dir->conv.n_channels; i++) {
@@ -3112,13 +3245,16 @@ static int impl_node_process(void *object)
 		}
 	}
 
-	if (!mix_passthrough) {
+	if (fuse_out || tile_out) {
+		/* done with the output conversion */
+		n_samples = SPA_MIN(n_samples, n_out);
+	} else if (!mix_passthrough && !fuse_in) {
 		in_datas = (const void**)out_datas;
 		if (resample_passthrough && out_passthrough) {
 			out_datas = (void **)dst_remap;
 			n_samples = SPA_MIN(n_samples, n_out);
 		} else {
-			out_datas = (void **)this->tmp_datas[(tmp++) & 1];
+			out_datas = (void **)this->arena->tmp_datas[(tmp++) & 1];
 		}
 		spa_log_trace_fp(this->log, "%p: channelmix %d %d %d", this, n_samples,
 				resample_passthrough, out_passthrough);
@@ -3146,7 +3282,7 @@ static int impl_node_process(void *object)
 		if (out_passthrough)
 			out_datas = (void **)dst_remap;
 		else
-			out_datas = (void **)this->tmp_datas[(tmp++) & 1];
+			out_datas = (void **)this->arena->tmp_datas[(tmp++) & 1];
 
 		in_len = n_samples;
 		out_len = n_out;
@@ -3161,7 +3297,11 @@ static int impl_node_process(void *object)
 	}
 	this->out_offset += n_samples;
 
-	if (!out_passthrough) {
+	if (tile_out) {
+		spa_log_trace_fp(this->log, "%p: channelmix output convert %d", this, n_samples);
+		channelmix_convert_tiled(this, dst_datas, dst_strides, n_dst_datas,
+				(const void**)out_datas, this->arena->tmp_datas[(tmp++) & 1], n_samples);
+	} else if (!out_passthrough) {
 		dir = &this->dir[SPA_DIRECTION_OUTPUT];
 		if (dir->need_remap) {
 			for (i = 0; i < dir->conv.n_channels; i++) {
@@ -3172,8 +3312,15 @@ static int impl_node_process(void *object)
 		} else {
 			in_datas = (const void**)out_datas;
 		}
-		spa_log_trace_fp(this->log, "%p: output convert %d", this, n_samples);
-		convert_process(&dir->conv, dst_datas, in_datas, n_samples);
+		if (fuse_out) {
+			for (i = 0; i < dir->conv.n_channels; i++)
+				volumes[dir->need_remap ? dir->remap[i] : i] = this->mix.matrix[i][i];
+			spa_log_trace_fp(this->log, "%p: output convert volume %d", this, n_samples);
+			convert_process_volume(&dir->conv, dst_datas, in_datas, volumes, n_samples);
+		} else {
+			spa_log_trace_fp(this->log, "%p: output convert %d", this, n_samples);
+			convert_process(&dir->conv, dst_datas, in_datas, n_samples);
+		}
 	}
 	if (this->direction == SPA_DIRECTION_OUTPUT)
 		handle_wav(this, (const void**)dst_datas, n_samples);
@@ -3307,7 +3454,8 @@ static int impl_clear(struct spa_handle *handle)
 	free_dir(&this->dir[SPA_DIRECTION_INPUT]);
 	free_dir(&this->dir[SPA_DIRECTION_OUTPUT]);
 
-	free_tmp(this);
+	if (this->arena)
+		arena_release(this->arena);
 
 	if (this->resample.free)
 		resample_free(&this->resample);
@@ -3378,6 +3526,10 @@ impl_init(const struct spa_handle_factory *factory,
 		this->cpu_flags = spa_cpu_get_flags(this->cpu);
 		this->max_align = SPA_MIN(MAX_ALIGN, spa_cpu_get_max_align(this->cpu));
 	}
+	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
+	if ((this->arena = arena_acquire(this->data_loop)) == NULL)
+		return -errno;
+
 	props_reset(&this->props);
 
 	this->rate_limit.interval = 2 * SPA_NSEC_PER_SEC;
@@ -38,7 +38,7 @@ static uint8_t samp_out[MAX_SAMPLES * MAX_CHANNELS * 4];
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int channel_counts[] = { 1, 2, 4, 6, 8, 11 };
 
-#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 70
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 86
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -261,6 +261,90 @@ static void test_deinterleave(void)
 	run_test("test_32_to_32d", "c", true, false, conv_32_to_32d_c);
 }
 
+static float volumes[MAX_CHANNELS];
+
+static void apply_volumes(struct convert *conv, void * SPA_RESTRICT data[], uint32_t n_samples)
+{
+	uint32_t i, j;
+	for (i = 0; i < conv->n_channels; i++) {
+		float *d = data[i];
+		for (j = 0; j < n_samples; j++)
+			d[j] *= volumes[i];
+	}
+}
+
+/* the fused kernels and the convert + volume passes they replace */
+#define MAKE_VOLUME_TEST(name,arch)						\
+static void name##_volume_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_samples)		\
+{										\
+	conv_##name##_volume_##arch(conv, dst, src, volumes, n_samples);	\
+}
+
+#define MAKE_VOLUME_IN_2PASS(name,arch)						\
+static void name##_2pass_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_samples)		\
+{										\
+	conv_##name##_##arch(conv, dst, src, n_samples);			\
+	apply_volumes(conv, dst, n_samples);					\
+}
+
+#define MAKE_VOLUME_OUT_2PASS(name,arch)					\
+static void name##_2pass_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t n_samples)		\
+{										\
+	apply_volumes(conv, (void **)src, n_samples);				\
+	conv_##name##_##arch(conv, dst, src, n_samples);			\
+}
+
+MAKE_VOLUME_TEST(s16_to_f32d, c);
+MAKE_VOLUME_TEST(s32_to_f32d, c);
+MAKE_VOLUME_TEST(f32d_to_s16, c);
+MAKE_VOLUME_TEST(f32d_to_s32, c);
+MAKE_VOLUME_IN_2PASS(s16_to_f32d, c);
+MAKE_VOLUME_IN_2PASS(s32_to_f32d, c);
+MAKE_VOLUME_OUT_2PASS(f32d_to_s16, c);
+MAKE_VOLUME_OUT_2PASS(f32d_to_s32, c);
+#if defined (HAVE_SSE2)
+MAKE_VOLUME_TEST(s16_to_f32d, sse2);
+MAKE_VOLUME_TEST(s32_to_f32d, sse2);
+MAKE_VOLUME_TEST(f32d_to_s16, sse2);
+MAKE_VOLUME_TEST(f32d_to_s32, sse2);
+MAKE_VOLUME_IN_2PASS(s16_to_f32d, sse2);
+MAKE_VOLUME_IN_2PASS(s32_to_f32d, sse2);
+MAKE_VOLUME_OUT_2PASS(f32d_to_s16, sse2);
+MAKE_VOLUME_OUT_2PASS(f32d_to_s32, sse2);
+#endif
+
+static void test_volume(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < MAX_CHANNELS; i++)
+		volumes[i] = 0.5f + i * 0.05f;
+
+	run_test("test_s16_f32d_volume", "c", true, false, s16_to_f32d_volume_c);
+	run_test("test_s16_f32d_volume", "c-2pass", true, false, s16_to_f32d_2pass_c);
+	run_test("test_s32_f32d_volume", "c", true, false, s32_to_f32d_volume_c);
+	run_test("test_s32_f32d_volume", "c-2pass", true, false, s32_to_f32d_2pass_c);
+	run_test("test_f32d_s16_volume", "c", false, true, f32d_to_s16_volume_c);
+	run_test("test_f32d_s16_volume", "c-2pass", false, true, f32d_to_s16_2pass_c);
+	run_test("test_f32d_s32_volume", "c", false, true, f32d_to_s32_volume_c);
+	run_test("test_f32d_s32_volume", "c-2pass", false, true, f32d_to_s32_2pass_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_s16_f32d_volume", "sse2", true, false, s16_to_f32d_volume_sse2);
+		run_test("test_s16_f32d_volume", "sse2-2pass", true, false, s16_to_f32d_2pass_sse2);
+		run_test("test_s32_f32d_volume", "sse2", true, false, s32_to_f32d_volume_sse2);
+		run_test("test_s32_f32d_volume", "sse2-2pass", true, false, s32_to_f32d_2pass_sse2);
+		run_test("test_f32d_s16_volume", "sse2", false, true, f32d_to_s16_volume_sse2);
+		run_test("test_f32d_s16_volume", "sse2-2pass", false, true, f32d_to_s16_2pass_sse2);
+		run_test("test_f32d_s32_volume", "sse2", false, true, f32d_to_s32_volume_sse2);
+		run_test("test_f32d_s32_volume", "sse2-2pass", false, true, f32d_to_s32_2pass_sse2);
+	}
+#endif
+}
+
 static int compare_func(const void *_a, const void *_b)
 {
 	const struct stats *a = _a, *b = _b;
@@ -291,6 +375,7 @@ int main(int argc, char *argv[])
 	test_s24_32_f32();
 	test_interleave();
 	test_deinterleave();
+	test_volume();
 
 	qsort(results, n_results, sizeof(struct stats), compare_func);
 
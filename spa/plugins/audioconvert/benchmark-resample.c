@@ -22,6 +22,7 @@
 static uint32_t cpu_flags;
 
 struct stats {
+	uint32_t quality;
 	uint32_t in_rate;
 	uint32_t out_rate;
 	uint32_t n_samples;
@@ -37,12 +38,35 @@ static float samp_out[MAX_SAMPLES * MAX_CHANNELS];
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int in_rates[] = { 44100, 44100, 48000, 96000, 22050, 96000 };
 static const int out_rates[] = { 44100, 48000, 44100, 48000, 48000, 44100 };
+static const int qualities[] = { 0, RESAMPLE_DEFAULT_QUALITY, 10, 14 };
 
+struct impl_info {
+	const char *name;
+	uint32_t cpu_flags;
+	uint32_t force_flags;	/* added to select the implementation */
+};
+
+static const struct impl_info impls[] = {
+	{ "c", 0 },
+#if defined (HAVE_SSE)
+	{ "sse", SPA_CPU_FLAG_SSE },
+#endif
+#if defined (HAVE_SSSE3)
+	{ "ssse3", SPA_CPU_FLAG_SSSE3, SPA_CPU_FLAG_SLOW_UNALIGNED },
+#endif
+#if defined (HAVE_AVX) && defined(HAVE_FMA)
+	{ "avx", SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3 },
+#endif
+#if defined (HAVE_AVX512)
+	{ "avx512", SPA_CPU_FLAG_AVX512 },
+#endif
+};
 
-#define MAX_RESAMPLER	5
+#define MAX_RESAMPLER	SPA_N_ELEMENTS(impls)
 #define MAX_SIZES	SPA_N_ELEMENTS(sample_sizes)
 #define MAX_RATES	SPA_N_ELEMENTS(in_rates)
-#define MAX_RESULTS	MAX_RESAMPLER * MAX_SIZES * MAX_RATES
+#define MAX_QUALITIES	SPA_N_ELEMENTS(qualities)
+#define MAX_RESULTS	MAX_RESAMPLER * MAX_SIZES * MAX_RATES * MAX_QUALITIES
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -77,6 +101,7 @@ static void run_test1(const char *name, const char *impl, struct resample *r, in
 	spa_assert(n_results < MAX_RESULTS);
 
 	results[n_results++] = (struct stats) {
+		.quality = r->quality,
 		.in_rate = r->i_rate,
 		.out_rate = r->o_rate,
 		.n_samples = n_samples,
@@ -99,6 +124,7 @@ static int compare_func(const void *_a, const void *_b)
 	const struct stats *a = _a, *b = _b;
 	int diff;
 
+	if ((diff = a->quality - b->quality) != 0) return diff;
 	if ((diff = a->in_rate - b->in_rate) != 0) return diff;
 	if ((diff = a->out_rate - b->out_rate) != 0) return diff;
 	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
@@ -110,74 +136,36 @@ static int compare_func(const void *_a, const void *_b)
 int main(int argc, char *argv[])
 {
 	struct resample r;
-	uint32_t i;
+	uint32_t i, j;
 
 	cpu_flags = get_cpu_flags();
 	printf("got get CPU flags %d\n", cpu_flags);
 
-	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
-		spa_zero(r);
-		r.channels = 2;
-		r.cpu_flags = 0;
-		r.i_rate = in_rates[i];
-		r.o_rate = out_rates[i];
-		r.quality = RESAMPLE_DEFAULT_QUALITY;
-		resample_native_init(&r);
-		run_test("native", "c", &r);
-		resample_free(&r);
-	}
-#if defined (HAVE_SSE)
-	if (cpu_flags & SPA_CPU_FLAG_SSE) {
-		for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
-			spa_zero(r);
-			r.channels = 2;
-			r.cpu_flags = SPA_CPU_FLAG_SSE;
-			r.i_rate = in_rates[i];
-			r.o_rate = out_rates[i];
-			r.quality = RESAMPLE_DEFAULT_QUALITY;
-			resample_native_init(&r);
-			run_test("native", "sse", &r);
-			resample_free(&r);
-		}
-	}
-#endif
-#if defined (HAVE_SSSE3)
-	if (cpu_flags & SPA_CPU_FLAG_SSSE3) {
-		for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
-			spa_zero(r);
-			r.channels = 2;
-			r.cpu_flags = SPA_CPU_FLAG_SSSE3 | SPA_CPU_FLAG_SLOW_UNALIGNED;
-			r.i_rate = in_rates[i];
-			r.o_rate = out_rates[i];
-			r.quality = RESAMPLE_DEFAULT_QUALITY;
-			resample_native_init(&r);
-			run_test("native", "ssse3", &r);
-			resample_free(&r);
+	SPA_FOR_EACH_ELEMENT_VAR(impls, impl) {
+		if (!SPA_FLAG_IS_SET(cpu_flags, impl->cpu_flags))
+			continue;
+
+		for (j = 0; j < SPA_N_ELEMENTS(qualities); j++) {
+			for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
+				spa_zero(r);
+				r.channels = 2;
+				r.cpu_flags = impl->cpu_flags | impl->force_flags;
+				r.i_rate = in_rates[i];
+				r.o_rate = out_rates[i];
+				r.quality = qualities[j];
+				resample_native_init(&r);
+				run_test("native", impl->name, &r);
+				resample_free(&r);
+			}
 		}
 	}
-#endif
-#if defined (HAVE_AVX) && defined(HAVE_FMA)
-	if (SPA_FLAG_IS_SET(cpu_flags, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3)) {
-		for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
-			spa_zero(r);
-			r.channels = 2;
-			r.cpu_flags = SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3;
-			r.i_rate = in_rates[i];
-			r.o_rate = out_rates[i];
-			r.quality = RESAMPLE_DEFAULT_QUALITY;
-			resample_native_init(&r);
-			run_test("native", "avx", &r);
-			resample_free(&r);
-		}
-	}
-#endif
 
 	qsort(results, n_results, sizeof(struct stats), compare_func);
 
 	for (i = 0; i < n_results; i++) {
 		struct stats *s = &results[i];
-		fprintf(stderr, "%-12."PRIu64" \t%-16.16s %s \t%d->%d samples %d, channels %d\n",
-				s->perf, s->name, s->impl, s->in_rate, s->out_rate,
+		fprintf(stderr, "%-12."PRIu64" \t%-16.16s %s \tq %d %d->%d samples %d, channels %d\n",
+				s->perf, s->name, s->impl, s->quality, s->in_rate, s->out_rate,
 				s->n_samples, s->n_channels);
 	}
 	return 0;
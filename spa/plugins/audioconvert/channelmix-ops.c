@@ -774,6 +774,10 @@ int channelmix_init(struct channelmix *mix)
 	mix->cpu_flags = info->cpu_flags;
 	mix->delay = mix->rear_delay * mix->freq / 1000.0f;
 	mix->func_name = info->name;
+	mix->per_channel = info->process == channelmix_copy_c;
+#if defined (HAVE_SSE)
+	mix->per_channel |= info->process == channelmix_copy_sse;
+#endif
 
 	spa_log_debug(mix->log, "selected %s delay:%d options:%08x", info->name, mix->delay,
 			mix->options);
@@ -43,6 +43,7 @@ struct channelmix {
 
 	struct spa_log *log;
 	const char *func_name;
+	unsigned int per_channel:1;	/**< process only uses the matrix diagonal */
 
 #define CHANNELMIX_FLAG_ZERO		(1<<0)		/**< all zero components */
 #define CHANNELMIX_FLAG_IDENTITY	(1<<1)		/**< identity matrix */
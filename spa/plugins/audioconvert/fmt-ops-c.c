@@ -90,6 +90,34 @@ void conv_ ##sname## d_to_ ##dname## _c(struct convert *conv,			\
 	}									\
 }
 
+#define MAKE_I_TO_D_VOLUME(sname,stype,dname,dtype,func)			\
+void conv_ ##sname## _to_ ##dname## d_volume_c(struct convert *conv,		\
+		void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],	\
+		const float *volumes, uint32_t n_samples)			\
+{										\
+	const stype *s = src[0];						\
+	dtype **d = (dtype**)dst;						\
+	uint32_t i, j, n_channels = conv->n_channels;				\
+	for (j = 0; j < n_samples; j++) {					\
+		for (i = 0; i < n_channels; i++)				\
+			d[i][j] = func (*s++) * volumes[i];			\
+	}									\
+}
+
+#define MAKE_D_TO_I_VOLUME(sname,stype,dname,dtype,func)			\
+void conv_ ##sname## d_to_ ##dname## _volume_c(struct convert *conv,		\
+		void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],	\
+		const float *volumes, uint32_t n_samples)			\
+{										\
+	const stype **s = (const stype **)src;					\
+	dtype *d = dst[0];							\
+	uint32_t i, j, n_channels = conv->n_channels;				\
+	for (j = 0; j < n_samples; j++) {					\
+		for (i = 0; i < n_channels; i++)				\
+			*d++ = func (s[i][j] * volumes[i]);			\
+	}									\
+}
+
 /* to f32 */
 MAKE_D_TO_D(u8, uint8_t, f32, float, U8_TO_F32);
 MAKE_I_TO_I(u8, uint8_t, f32, float, U8_TO_F32);
@@ -202,6 +230,12 @@ MAKE_I_TO_D(f32, float, f64, double, (double));
 MAKE_D_TO_I(f32, float, f64, double, (double));
 MAKE_D_TO_I(f32, float, f64s, uint64_t, F64_TO_F64S);
 
+/* with volume */
+MAKE_I_TO_D_VOLUME(s16, int16_t, f32, float, S16_TO_F32);
+MAKE_I_TO_D_VOLUME(s32, int32_t, f32, float, S32_TO_F32);
+MAKE_D_TO_I_VOLUME(f32, float, s16, int16_t, F32_TO_S16);
+MAKE_D_TO_I_VOLUME(f32, float, s32, int32_t, F32_TO_S32);
+
 
 static inline int32_t
 lcnoise(uint32_t *state)
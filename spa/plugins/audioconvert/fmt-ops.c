@@ -350,6 +350,49 @@ static const struct conv_info *find_conv_info(uint32_t src_fmt, uint32_t dst_fmt
 	return NULL;
 }
 
+typedef void (*convert_volume_func_t) (struct convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], const float *volumes, uint32_t n_samples);
+
+struct conv_volume_info {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+
+	convert_volume_func_t process;
+	const char *name;
+
+	uint32_t cpu_flags;
+};
+
+#define MAKE(fmt1,fmt2,func,...) \
+	{  SPA_AUDIO_FORMAT_ ##fmt1, SPA_AUDIO_FORMAT_ ##fmt2, func, #func , __VA_ARGS__ }
+
+static struct conv_volume_info conv_volume_table[] =
+{
+#if defined (HAVE_SSE2)
+	MAKE(S16, F32P, conv_s16_to_f32d_volume_sse2, SPA_CPU_FLAG_SSE2),
+	MAKE(S32, F32P, conv_s32_to_f32d_volume_sse2, SPA_CPU_FLAG_SSE2),
+	MAKE(F32P, S16, conv_f32d_to_s16_volume_sse2, SPA_CPU_FLAG_SSE2),
+	MAKE(F32P, S32, conv_f32d_to_s32_volume_sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(S16, F32P, conv_s16_to_f32d_volume_c),
+	MAKE(S32, F32P, conv_s32_to_f32d_volume_c),
+	MAKE(F32P, S16, conv_f32d_to_s16_volume_c),
+	MAKE(F32P, S32, conv_f32d_to_s32_volume_c),
+};
+#undef MAKE
+
+static const struct conv_volume_info *find_conv_volume_info(uint32_t src_fmt, uint32_t dst_fmt,
+		uint32_t cpu_flags)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(conv_volume_table, c) {
+		if (c->src_fmt == src_fmt &&
+		    c->dst_fmt == dst_fmt &&
+		    MATCH_CPU_FLAGS(c->cpu_flags, cpu_flags))
+			return c;
+	}
+	return NULL;
+}
+
 typedef void (*noise_func_t) (struct convert *conv, float * noise, uint32_t n_samples);
 
 struct noise_info {
@@ -393,6 +436,7 @@ static const struct noise_info *find_noise_info(uint32_t method,
 static void impl_convert_free(struct convert *conv)
 {
 	conv->process = NULL;
+	conv->process_volume = NULL;
 	free(conv->data);
 	conv->data = NULL;
 }
@@ -464,6 +508,7 @@ static const struct dither_info *find_dither_info(uint32_t method, uint32_t rate
 int convert_init(struct convert *conv)
 {
 	const struct conv_info *info;
+	const struct conv_volume_info *vinfo;
 	const struct dither_info *dinfo;
 	const struct noise_info *ninfo;
 	uint32_t i, conv_flags, data_size[3];
@@ -533,12 +578,18 @@ int convert_init(struct convert *conv)
 	for (i = 0; i < RANDOM_SIZE; i++)
 		conv->random[i] = random();
 
+	/* the fused volume kernels don't do noise or shaping */
+	vinfo = conv_flags == 0 ?
+		find_conv_volume_info(conv->src_fmt, conv->dst_fmt, conv->cpu_flags) : NULL;
+
 	conv->is_passthrough = conv->src_fmt == conv->dst_fmt;
 	conv->cpu_flags = info->cpu_flags;
 	conv->update_noise = ninfo->noise;
 	conv->process = info->process;
 	conv->free = impl_convert_free;
 	conv->func_name = info->name;
+	conv->process_volume = vinfo ? vinfo->process : NULL;
+	conv->volume_func_name = vinfo ? vinfo->name : NULL;
 
 	return 0;
 }
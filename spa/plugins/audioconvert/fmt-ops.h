@@ -210,6 +210,7 @@ struct convert {
 	uint32_t rate;
 	uint32_t cpu_flags;
 	const char *func_name;
+	const char *volume_func_name;
 
 	unsigned int is_passthrough:1;
 
@@ -231,6 +232,11 @@ struct convert {
 	void (*update_noise) (struct convert *conv, float *noise, uint32_t n_samples);
 	void (*process) (struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
 			uint32_t n_samples);
+	/* convert and apply a volume per channel in one pass, NULL when
+	 * not available for the formats or when dithering */
+	void (*process_volume) (struct convert *conv, void * SPA_RESTRICT dst[],
+			const void * SPA_RESTRICT src[], const float *volumes,
+			uint32_t n_samples);
 	void (*free) (struct convert *conv);
 
 	void *data;
@@ -268,6 +274,7 @@ static inline uint32_t dither_method_from_label(const char *label)
 
 #define convert_update_noise(conv,...)	(conv)->update_noise(conv, __VA_ARGS__)
 #define convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
+#define convert_process_volume(conv,...)	(conv)->process_volume(conv, __VA_ARGS__)
 #define convert_free(conv)		(conv)->free(conv)
 
 #define DEFINE_NOISE_FUNCTION(name,arch)				\
@@ -466,3 +473,21 @@ DEFINE_FUNCTION(f32d_to_s16, avx2);
 #endif
 
 #undef DEFINE_FUNCTION
+
+#define DEFINE_VOLUME_FUNCTION(name,arch)					\
+void conv_##name##_volume_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], const float *volumes,		\
+		uint32_t n_samples)
+
+DEFINE_VOLUME_FUNCTION(s16_to_f32d, c);
+DEFINE_VOLUME_FUNCTION(s32_to_f32d, c);
+DEFINE_VOLUME_FUNCTION(f32d_to_s16, c);
+DEFINE_VOLUME_FUNCTION(f32d_to_s32, c);
+#if defined(HAVE_SSE2)
+DEFINE_VOLUME_FUNCTION(s16_to_f32d, sse2);
+DEFINE_VOLUME_FUNCTION(s32_to_f32d, sse2);
+DEFINE_VOLUME_FUNCTION(f32d_to_s16, sse2);
+DEFINE_VOLUME_FUNCTION(f32d_to_s32, sse2);
+#endif
+
+#undef DEFINE_VOLUME_FUNCTION
@@ -0,0 +1,149 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "resample-native-impl.h"
+
+#include <immintrin.h>
+
+static inline float hsum256(__m256 v)
+{
+	__m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+	x = _mm_add_ss(x, _mm_movehdup_ps(x));
+	return _mm_cvtss_f32(x);
+}
+
+static inline __m256 fold512(__m512 v)
+{
+	__m256 h = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1));
+	return _mm256_add_ps(_mm512_castps512_ps256(v), h);
+}
+
+/* n_taps is a multiple of 8 and the taps are 64 bytes aligned */
+static inline void inner_product_avx512(float *d, const float * SPA_RESTRICT s,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	__m512 sz[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() };
+	__m256 sy = _mm256_setzero_ps();
+	uint32_t i = 0;
+	uint32_t n_taps32 = n_taps & ~0x1f, n_taps16 = n_taps & ~0xf;
+
+	if (n_taps32 == 0) {
+		/* short filters are faster with 256 bits loads and
+		 * a short reduction */
+		__m256 sy1 = _mm256_setzero_ps();
+		for (; i + 16 <= n_taps; i += 16) {
+			sy = _mm256_fmadd_ps(_mm256_loadu_ps(s + i + 0),
+					_mm256_load_ps(taps + i + 0), sy);
+			sy1 = _mm256_fmadd_ps(_mm256_loadu_ps(s + i + 8),
+					_mm256_load_ps(taps + i + 8), sy1);
+		}
+		if (i < n_taps)
+			sy = _mm256_fmadd_ps(_mm256_loadu_ps(s + i),
+					_mm256_load_ps(taps + i), sy);
+		*d = hsum256(_mm256_add_ps(sy, sy1));
+		return;
+	}
+	for (; i < n_taps32; i += 32) {
+		sz[0] = _mm512_fmadd_ps(_mm512_loadu_ps(s + i + 0),
+				_mm512_load_ps(taps + i + 0), sz[0]);
+		sz[1] = _mm512_fmadd_ps(_mm512_loadu_ps(s + i + 16),
+				_mm512_load_ps(taps + i + 16), sz[1]);
+	}
+	for (; i < n_taps16; i += 16) {
+		sz[0] = _mm512_fmadd_ps(_mm512_loadu_ps(s + i),
+				_mm512_load_ps(taps + i), sz[0]);
+	}
+	if (i < n_taps)
+		sy = _mm256_mul_ps(_mm256_loadu_ps(s + i), _mm256_load_ps(taps + i));
+
+	sy = _mm256_add_ps(sy, fold512(_mm512_add_ps(sz[0], sz[1])));
+	*d = hsum256(sy);
+}
+
+static inline void inner_product_ip_avx512(float *d, const float * SPA_RESTRICT s,
+	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
+	uint32_t n_taps)
+{
+	__m512 sz[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() }, tz;
+	__m256 sy[2], ty;
+	uint32_t i = 0, n_taps16 = n_taps & ~0xf;
+
+	for (; i < n_taps16; i += 16) {
+		tz = _mm512_loadu_ps(s + i);
+		sz[0] = _mm512_fmadd_ps(tz, _mm512_load_ps(t0 + i), sz[0]);
+		sz[1] = _mm512_fmadd_ps(tz, _mm512_load_ps(t1 + i), sz[1]);
+	}
+	sy[0] = fold512(sz[0]);
+	sy[1] = fold512(sz[1]);
+	if (i < n_taps) {
+		ty = _mm256_loadu_ps(s + i);
+		sy[0] = _mm256_fmadd_ps(ty, _mm256_load_ps(t0 + i), sy[0]);
+		sy[1] = _mm256_fmadd_ps(ty, _mm256_load_ps(t1 + i), sy[1]);
+	}
+	sy[1] = _mm256_mul_ps(_mm256_sub_ps(sy[1], sy[0]), _mm256_set1_ps(x));
+	*d = hsum256(_mm256_add_ps(sy[0], sy[1]));
+}
+
+/* The full and inter resamplers below run the channels in the inner loop so
+ * that the phase is computed once per output sample and the filter rows stay
+ * in cache for all channels. */
+DEFINE_RESAMPLER(full,avx512)
+{
+	struct native_data *data = r->data;
+	uint32_t n_taps = data->n_taps, stride = data->filter_stride_os;
+	uint32_t index, phase, n_phases = data->out_rate;
+	uint32_t c, o, olen = *out_len, ilen = *in_len;
+	uint32_t inc = data->inc, frac = data->frac;
+	const float **s = (const float **)src;
+	float **d = (float **)dst;
+
+	if (r->channels == 0)
+		return;
+
+	index = ioffs;
+	phase = data->phase;
+
+	for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {
+		const float *taps = &data->filter[phase * stride];
+		for (c = 0; c < r->channels; c++)
+			inner_product_avx512(&d[c][o], &s[c][index], taps, n_taps);
+		INC(index, phase, n_phases);
+	}
+	*in_len = index;
+	*out_len = o;
+	data->phase = phase;
+}
+
+DEFINE_RESAMPLER(inter,avx512)
+{
+	struct native_data *data = r->data;
+	uint32_t index, phase, stride = data->filter_stride;
+	uint32_t n_phases = data->n_phases, out_rate = data->out_rate;
+	uint32_t n_taps = data->n_taps;
+	uint32_t c, o, olen = *out_len, ilen = *in_len;
+	uint32_t inc = data->inc, frac = data->frac;
+	const float **s = (const float **)src;
+	float **d = (float **)dst;
+
+	if (r->channels == 0)
+		return;
+
+	index = ioffs;
+	phase = data->phase;
+
+	for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {
+		float ph = (float)phase * n_phases / out_rate;
+		uint32_t offset = floorf(ph);
+		const float *t0 = &data->filter[(offset + 0) * stride];
+		const float *t1 = &data->filter[(offset + 1) * stride];
+		for (c = 0; c < r->channels; c++)
+			inner_product_ip_avx512(&d[c][o], &s[c][index],
+					t0, t1, ph - offset, n_taps);
+		INC(index, phase, out_rate);
+	}
+	*in_len = index;
+	*out_len = o;
+	data->phase = phase;
+}
@@ -23,6 +23,8 @@ struct resample_info {
 	uint32_t cpu_flags;
 };
 
+struct native_filter;
+
 struct native_data {
 	double rate;
 	uint32_t n_taps;
@@ -38,6 +40,7 @@ struct native_data {
 	float **history;
 	resample_func_t func;
 	float *filter;
+	struct native_filter *shared;
 	float *hist_mem;
 	const struct resample_info *info;
 };
@@ -169,3 +172,7 @@ DEFINE_RESAMPLER(inter,ssse3);
 DEFINE_RESAMPLER(full,avx);
 DEFINE_RESAMPLER(inter,avx);
 #endif
+#if defined (HAVE_AVX512)
+DEFINE_RESAMPLER(full,avx512);
+DEFINE_RESAMPLER(inter,avx512);
+#endif
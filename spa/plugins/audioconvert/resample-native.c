@@ -3,8 +3,10 @@
 /* SPDX-License-Identifier: MIT */
 
 #include <errno.h>
+#include <pthread.h>
 
 #include <spa/param/audio/format.h>
+#include <spa/utils/list.h>
 
 #include "resample-native-impl.h"
 
@@ -79,6 +81,65 @@ static int build_filter(float *taps, uint32_t stride, uint32_t n_taps, uint32_t
 	return 0;
 }
 
+/* The filter taps only depend on the rates and the quality. They are
+ * shared between all resamplers that use the same filter. */
+struct native_filter {
+	struct spa_list link;
+	int ref;
+
+	int quality;
+	uint32_t in_rate;
+	uint32_t out_rate;
+
+	float *taps;
+};
+
+static struct spa_list filter_list = SPA_LIST_INIT(&filter_list);
+static pthread_mutex_t filter_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct native_filter *filter_acquire(int quality, uint32_t in_rate, uint32_t out_rate,
+		uint32_t stride, uint32_t n_taps, uint32_t n_phases, double cutoff)
+{
+	struct native_filter *f;
+	size_t filter_size = stride * sizeof(float) * (n_phases + 1);
+
+	pthread_mutex_lock(&filter_lock);
+	spa_list_for_each(f, &filter_list, link) {
+		if (f->quality == quality &&
+		    f->in_rate == in_rate &&
+		    f->out_rate == out_rate) {
+			f->ref++;
+			goto done;
+		}
+	}
+	f = calloc(1, sizeof(*f) + filter_size + 64);
+	if (f == NULL)
+		goto done;
+
+	f->ref = 1;
+	f->quality = quality;
+	f->in_rate = in_rate;
+	f->out_rate = out_rate;
+	f->taps = SPA_PTROFF_ALIGN(f, sizeof(*f), 64, float);
+
+	build_filter(f->taps, stride, n_taps, n_phases, cutoff);
+
+	spa_list_append(&filter_list, &f->link);
+done:
+	pthread_mutex_unlock(&filter_lock);
+	return f;
+}
+
+static void filter_release(struct native_filter *f)
+{
+	pthread_mutex_lock(&filter_lock);
+	if (--f->ref == 0) {
+		spa_list_remove(&f->link);
+		free(f);
+	}
+	pthread_mutex_unlock(&filter_lock);
+}
+
 MAKE_RESAMPLER_COPY(c);
 
 #define MAKE(fmt,copy,full,inter,...) \
@@ -90,6 +151,9 @@ static struct resample_info resample_table[] =
 #if defined (HAVE_NEON)
 	MAKE(F32, copy_c, full_neon, inter_neon, SPA_CPU_FLAG_NEON),
 #endif
+#if defined (HAVE_AVX512)
+	MAKE(F32, copy_c, full_avx512, inter_avx512, SPA_CPU_FLAG_AVX512),
+#endif
 #if defined(HAVE_AVX) && defined(HAVE_FMA)
 	MAKE(F32, copy_c, full_avx, inter_avx, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3),
 #endif
@@ -116,7 +180,11 @@ static const struct resample_info *find_resample_info(uint32_t format, uint32_t
 
 static void impl_native_free(struct resample *r)
 {
+	struct native_data *d = r->data;
+
 	spa_log_debug(r->log, "native %p: free", r);
+	if (d != NULL && d->shared != NULL)
+		filter_release(d->shared);
 	free(r->data);
 	r->data = NULL;
 }
@@ -302,7 +370,7 @@ int resample_native_init(struct resample *r)
 	struct native_data *d;
 	const struct quality *q;
 	double scale;
-	uint32_t c, n_taps, n_phases, filter_size, in_rate, out_rate, gcd, filter_stride;
+	uint32_t c, n_taps, n_phases, in_rate, out_rate, gcd, filter_stride;
 	uint32_t history_stride, history_size, oversample;
 
 	r->quality = SPA_CLAMP(r->quality, 0, (int) SPA_N_ELEMENTS(window_qualities) - 1);
@@ -333,12 +401,10 @@ int resample_native_init(struct resample *r)
 	n_phases *= oversample;
 
 	filter_stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64);
-	filter_size = filter_stride * (n_phases + 1);
 	history_stride = SPA_ROUND_UP_N(2 * n_taps * sizeof(float), 64);
 	history_size = r->channels * history_stride;
 
 	d = calloc(1, sizeof(struct native_data) +
-			filter_size +
 			history_size +
 			(r->channels * sizeof(float*)) +
 			64);
@@ -351,15 +417,18 @@ int resample_native_init(struct resample *r)
 	d->n_phases = n_phases;
 	d->in_rate = in_rate;
 	d->out_rate = out_rate;
-	d->filter = SPA_PTROFF_ALIGN(d, sizeof(struct native_data), 64, float);
-	d->hist_mem = SPA_PTROFF_ALIGN(d->filter, filter_size, 64, float);
+	d->hist_mem = SPA_PTROFF_ALIGN(d, sizeof(struct native_data), 64, float);
 	d->history = SPA_PTROFF(d->hist_mem, history_size, float*);
 	d->filter_stride = filter_stride / sizeof(float);
 	d->filter_stride_os = d->filter_stride * oversample;
 	for (c = 0; c < r->channels; c++)
 		d->history[c] = SPA_PTROFF(d->hist_mem, c * history_stride, float);
 
-	build_filter(d->filter, d->filter_stride, n_taps, n_phases, scale);
+	d->shared = filter_acquire(r->quality, in_rate, out_rate,
+			d->filter_stride, n_taps, n_phases, scale);
+	if (SPA_UNLIKELY(d->shared == NULL))
+		return -errno;
+	d->filter = d->shared->taps;
 
 	d->info = find_resample_info(SPA_AUDIO_FORMAT_F32, r->cpu_flags);
 	if (SPA_UNLIKELY(d->info == NULL)) {
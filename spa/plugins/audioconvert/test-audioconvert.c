@@ -12,6 +12,7 @@
 #include <spa/utils/names.h>
 #include <spa/utils/string.h>
 #include <spa/support/plugin.h>
+#include <spa/support/loop.h>
 #include <spa/param/param.h>
 #include <spa/param/audio/format.h>
 #include <spa/param/audio/format-utils.h>
@@ -25,6 +26,23 @@ SPA_LOG_IMPL(logger);
 
 extern const struct spa_handle_factory test_source_factory;
 
+/* a data loop that is never entered, invoke runs the function inline */
+static uint32_t n_invokes;
+
+static int loop_invoke(void *object, spa_invoke_func_t func, uint32_t seq,
+		const void *data, size_t size, bool block, void *user_data)
+{
+	n_invokes++;
+	return func ? func(object, false, seq, data, size, user_data) : 0;
+}
+
+static const struct spa_loop_methods loop_methods = {
+	SPA_VERSION_LOOP_METHODS,
+	.invoke = loop_invoke,
+};
+
+static struct spa_loop data_loop;
+
 #define MAX_PORTS (SPA_AUDIO_MAX_CHANNELS+1)
 
 struct context {
@@ -52,13 +70,16 @@ static int setup_context(struct context *ctx)
 {
 	size_t size;
 	int res;
-	struct spa_support support[1];
+	struct spa_support support[2];
 	struct spa_dict_item items[6];
 	const struct spa_handle_factory *factory;
 	void *iface;
 
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
 	support[0] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_Log, &logger);
+	data_loop.iface = SPA_INTERFACE_INIT(SPA_TYPE_INTERFACE_DataLoop,
+			SPA_VERSION_LOOP, &loop_methods, &data_loop);
+	support[1] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_DataLoop, &data_loop);
 
 	/* make convert */
 	factory = find_factory(SPA_NAME_AUDIO_CONVERT);
@@ -79,7 +100,7 @@ static int setup_context(struct context *ctx)
 	res = spa_handle_factory_init(factory,
 			ctx->convert_handle,
 			&SPA_DICT_INIT(items, 6),
-			support, 1);
+			support, 2);
 	spa_assert_se(res >= 0);
 
 	res = spa_handle_get_interface(ctx->convert_handle,
@@ -1116,6 +1137,130 @@ static int test_convert_remap_conv(struct context *ctx)
 	return 0;
 }
 
+static const int16_t data_s16_stereo[] = { 16384, 16384, 16384, 16384,
+					   16384, 16384, 16384, 16384 };
+static const int16_t data_s16_stereo_volume[] = { 8192, 8192, 8192, 8192,
+						  8192, 8192, 8192, 8192 };
+static const float data_f32p_0p5[] = { 0.5f, 0.5f, 0.5f, 0.5f };
+static const float data_f32p_0p25[] = { 0.25f, 0.25f, 0.25f, 0.25f };
+
+struct data conv_s16_48000_stereo = {
+	.mode = SPA_PARAM_PORT_CONFIG_MODE_convert,
+	.info = SPA_AUDIO_INFO_RAW_INIT(
+		.format = SPA_AUDIO_FORMAT_S16,
+		.rate = 48000,
+		.channels = 2,
+		.position = {
+			SPA_AUDIO_CHANNEL_FL,
+			SPA_AUDIO_CHANNEL_FR,
+		}),
+	.ports = 1,
+	.planes = 1,
+	.data = { data_s16_stereo, },
+	.size = sizeof(int16_t) * 8
+};
+
+struct data conv_s16_48000_stereo_volume = {
+	.mode = SPA_PARAM_PORT_CONFIG_MODE_convert,
+	.info = SPA_AUDIO_INFO_RAW_INIT(
+		.format = SPA_AUDIO_FORMAT_S16,
+		.rate = 48000,
+		.channels = 2,
+		.position = {
+			SPA_AUDIO_CHANNEL_FL,
+			SPA_AUDIO_CHANNEL_FR,
+		}),
+	.ports = 1,
+	.planes = 1,
+	.data = { data_s16_stereo_volume, },
+	.size = sizeof(int16_t) * 8
+};
+
+struct data dsp_stereo = {
+	.mode = SPA_PARAM_PORT_CONFIG_MODE_dsp,
+	.info = SPA_AUDIO_INFO_RAW_INIT(
+		.format = SPA_AUDIO_FORMAT_F32,
+		.rate = 48000,
+		.channels = 2,
+		.position = {
+			SPA_AUDIO_CHANNEL_FL,
+			SPA_AUDIO_CHANNEL_FR,
+		}),
+	.ports = 2,
+	.planes = 1,
+	.data = { data_f32p_0p5, data_f32p_0p5, },
+	.size = sizeof(float) * 4
+};
+
+struct data dsp_stereo_volume = {
+	.mode = SPA_PARAM_PORT_CONFIG_MODE_dsp,
+	.info = SPA_AUDIO_INFO_RAW_INIT(
+		.format = SPA_AUDIO_FORMAT_F32,
+		.rate = 48000,
+		.channels = 2,
+		.position = {
+			SPA_AUDIO_CHANNEL_FL,
+			SPA_AUDIO_CHANNEL_FR,
+		}),
+	.ports = 2,
+	.planes = 1,
+	.data = { data_f32p_0p25, data_f32p_0p25, },
+	.size = sizeof(float) * 4
+};
+
+static int set_channel_volumes(struct context *ctx, uint32_t n_volumes, const float *volumes)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_Props, SPA_PARAM_Props,
+		SPA_PROP_channelVolumes, SPA_POD_Array(sizeof(float),
+			SPA_TYPE_Float, n_volumes, volumes));
+	return spa_node_set_param(ctx->convert_node, SPA_PARAM_Props, 0, param);
+}
+
+/* a volume per channel is applied in the input or output conversion */
+static int test_convert_volume(struct context *ctx)
+{
+	static const float volumes[] = { 0.5f, 0.5f };
+	static const float unity[] = { 1.0f, 1.0f };
+
+	spa_assert_se(set_channel_volumes(ctx, 2, volumes) >= 0);
+	run_convert(ctx, &conv_s16_48000_stereo, &dsp_stereo_volume);
+	run_convert(ctx, &dsp_stereo, &conv_s16_48000_stereo_volume);
+	spa_assert_se(set_channel_volumes(ctx, 2, unity) >= 0);
+	run_convert(ctx, &conv_s16_48000_stereo, &dsp_stereo);
+	run_convert(ctx, &dsp_stereo, &conv_s16_48000_stereo);
+
+	return 0;
+}
+
+/* converters on the same data loop share their scratch memory */
+static int test_shared_scratch(struct context *ctx)
+{
+	struct context ctx2;
+	uint32_t invokes;
+
+	spa_zero(ctx2);
+	setup_context(&ctx2);
+
+	invokes = n_invokes;
+	run_convert(&ctx2, &conv_s16_48000_stereo, &dsp_stereo);
+	run_convert(ctx, &dsp_stereo, &conv_s16_48000_stereo);
+	run_convert(&ctx2, &dsp_stereo, &conv_s16_48000_stereo);
+	/* the arena is already big enough for both */
+	spa_assert_se(n_invokes == invokes);
+
+	clean_context(&ctx2);
+
+	run_convert(ctx, &conv_s16_48000_stereo, &dsp_stereo);
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	struct context ctx;
@@ -1139,6 +1284,8 @@ int main(int argc, char *argv[])
 
 	test_convert_remap_dsp(&ctx);
 	test_convert_remap_conv(&ctx);
+	test_convert_volume(&ctx);
+	test_shared_scratch(&ctx);
 
 	clean_context(&ctx);
 
@@ -741,6 +741,100 @@ static void test_noise(void)
 	run_test_noise(SPA_AUDIO_FORMAT_S32, 2, 0);
 }
 
+static float vol_planar[2][N_CHANNELS][N_SAMPLES] __attribute__ ((aligned (16)));
+
+static int32_t get_sample(uint32_t fmt, const void *d, uint32_t i)
+{
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_S16:
+		return ((const int16_t *)d)[i];
+	case SPA_AUDIO_FORMAT_S32:
+		return ((const int32_t *)d)[i];
+	}
+	return 0;
+}
+
+static void run_test_volume(uint32_t src_fmt, uint32_t dst_fmt, uint32_t flags)
+{
+	struct convert conv;
+	const void *ip[N_CHANNELS], *rp[N_CHANNELS];
+	void *op[N_CHANNELS], *tp[N_CHANNELS];
+	float volumes[N_CHANNELS];
+	uint32_t i, j;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.n_channels = N_CHANNELS;
+	conv.rate = 44100;
+	conv.cpu_flags = flags;
+	spa_assert_se(convert_init(&conv) == 0);
+	spa_assert_se(conv.process_volume != NULL);
+	fprintf(stderr, "test volume %s:\n", conv.volume_func_name);
+
+	for (i = 0; i < N_CHANNELS; i++)
+		volumes[i] = i * 0.15f;
+
+	if (dst_fmt == SPA_AUDIO_FORMAT_F32P) {
+		/* interleaved input, compare with convert + volume */
+		for (i = 0; i < N_SAMPLES * N_CHANNELS; i++) {
+			int32_t v = (int32_t)(i * 7919) - 0x4000;
+			if (src_fmt == SPA_AUDIO_FORMAT_S16)
+				((int16_t *)temp_in)[i] = v;
+			else
+				((int32_t *)temp_in)[i] = (uint32_t)v << 16;
+		}
+		ip[0] = temp_in;
+		for (i = 0; i < N_CHANNELS; i++) {
+			op[i] = vol_planar[0][i];
+			tp[i] = vol_planar[1][i];
+		}
+		convert_process(&conv, tp, ip, N_SAMPLES);
+		convert_process_volume(&conv, op, ip, volumes, N_SAMPLES);
+
+		for (i = 0; i < N_CHANNELS; i++) {
+			for (j = 0; j < N_SAMPLES; j++) {
+				float ref = vol_planar[1][i][j] * volumes[i];
+				spa_assert_se(fabsf(vol_planar[0][i][j] - ref) <= 1e-6f);
+			}
+		}
+	} else {
+		/* planar input, compare with volume + convert */
+		for (i = 0; i < N_CHANNELS; i++) {
+			for (j = 0; j < N_SAMPLES; j++) {
+				vol_planar[0][i][j] = sinf(j * 0.05f + i) * 1.1f;
+				vol_planar[1][i][j] = vol_planar[0][i][j] * volumes[i];
+			}
+			ip[i] = vol_planar[0][i];
+			rp[i] = vol_planar[1][i];
+		}
+		op[0] = temp_out;
+		tp[0] = temp_in;
+		convert_process(&conv, tp, rp, N_SAMPLES);
+		convert_process_volume(&conv, op, ip, volumes, N_SAMPLES);
+
+		for (i = 0; i < N_SAMPLES * N_CHANNELS; i++) {
+			int32_t a = get_sample(dst_fmt, temp_out, i);
+			int32_t b = get_sample(dst_fmt, temp_in, i);
+			spa_assert_se(SPA_ABS((int64_t)a - b) <=
+					(dst_fmt == SPA_AUDIO_FORMAT_S32 ? 256 : 1));
+		}
+	}
+	convert_free(&conv);
+}
+
+static void test_volume(void)
+{
+	run_test_volume(SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0);
+	run_test_volume(SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, cpu_flags);
+	run_test_volume(SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 0);
+	run_test_volume(SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, cpu_flags);
+	run_test_volume(SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0);
+	run_test_volume(SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, cpu_flags);
+	run_test_volume(SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0);
+	run_test_volume(SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, cpu_flags);
+}
+
 int main(int argc, char *argv[])
 {
 	cpu_flags = get_cpu_flags();
@@ -782,5 +876,7 @@ int main(int argc, char *argv[])
 
 	test_noise();
 
+	test_volume();
+
 	return 0;
 }
@@ -15,6 +15,7 @@
 SPA_LOG_IMPL(logger);
 
 #include "resample.h"
+#include "resample-native-impl.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
@@ -146,12 +147,53 @@ static void test_in_len(void)
 	resample_free(&r);
 }
 
+static void test_filter_cache(void)
+{
+	struct resample r[3];
+	struct native_data *d[3];
+	uint32_t i;
+	float *filter;
+
+	for (i = 0; i < 3; i++) {
+		spa_zero(r[i]);
+		r[i].log = &logger.log;
+		r[i].channels = 2;
+		r[i].i_rate = 44100;
+		r[i].o_rate = 48000;
+		r[i].quality = i == 2 ? 2 : RESAMPLE_DEFAULT_QUALITY;
+		spa_assert_se(resample_native_init(&r[i]) == 0);
+		d[i] = r[i].data;
+	}
+	/* same rates and quality share the filter */
+	spa_assert_se(d[0]->filter == d[1]->filter);
+	spa_assert_se(d[0]->filter != d[2]->filter);
+
+	/* the filter stays alive as long as one user has it */
+	filter = d[1]->filter;
+	resample_free(&r[0]);
+	spa_assert_se(d[1]->filter == filter);
+
+	resample_free(&r[1]);
+	resample_free(&r[2]);
+
+	spa_zero(r[0]);
+	r[0].log = &logger.log;
+	r[0].channels = 1;
+	r[0].i_rate = 44100;
+	r[0].o_rate = 48000;
+	r[0].quality = RESAMPLE_DEFAULT_QUALITY;
+	spa_assert_se(resample_native_init(&r[0]) == 0);
+	feed_1(&r[0]);
+	resample_free(&r[0]);
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
 
 	test_native();
 	test_in_len();
+	test_filter_cache();
 
 	return 0;
 }
@@ -18,6 +18,9 @@ static uint32_t cpu_flags;
 
 typedef void (*mix_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
 		const void * SPA_RESTRICT src[], uint32_t n_src, uint32_t n_samples);
+typedef void (*mix_gain_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], const float gain[], const float ramp[],
+		uint32_t n_src, uint32_t n_samples);
 struct stats {
 	uint32_t n_samples;
 	uint32_t n_src;
@@ -91,6 +94,61 @@ static void run_test(const char *name, const char *impl, mix_func_t func)
 	}
 }
 
+static void run_test1_gain(const char *name, const char *impl, mix_gain_func_t func,
+		const float *ramp, int n_src, int n_samples)
+{
+	int i, j;
+	const void *ip[n_src];
+	float gain[n_src];
+	void *op;
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct mix_ops mix;
+
+	mix.n_channels = 1;
+
+	for (j = 0; j < n_src; j++) {
+		ip[j] = SPA_PTR_ALIGN(&samp_in[j * n_samples * 4], 32, void);
+		gain[j] = 0.5f;
+	}
+	op = SPA_PTR_ALIGN(samp_out, 32, void);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		func(&mix, op, ip, gain, ramp, n_src, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.n_src = n_src,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test_gain(const char *name, const char *impl, mix_gain_func_t func, bool ramp)
+{
+	static const float ramps[MAX_SRC] = { 0.0001f, -0.0001f, 0.0002f, -0.0002f,
+		0.0003f, -0.0003f, 0.0004f, -0.0004f, 0.0005f, -0.0005f, 0.0006f };
+	size_t i, j;
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(src_counts); j++) {
+			run_test1_gain(name, impl, func, ramp ? ramps : NULL, src_counts[j],
+				(sample_sizes[i] + (src_counts[j] -1)) / src_counts[j]);
+		}
+	}
+}
+
 static void test_s8(void)
 {
 	run_test("test_s8", "c", mix_s8_c);
@@ -150,6 +208,24 @@ static void test_f32(void)
 #endif
 }
 
+static void test_f32_gain(void)
+{
+	run_test_gain("test_f32_gain", "c", mix_gain_f32_c, false);
+	run_test_gain("test_f32_gain_ramp", "c", mix_gain_f32_c, true);
+#if defined (HAVE_SSE)
+	if (cpu_flags & SPA_CPU_FLAG_SSE) {
+		run_test_gain("test_f32_gain", "sse", mix_gain_f32_sse, false);
+		run_test_gain("test_f32_gain_ramp", "sse", mix_gain_f32_sse, true);
+	}
+#endif
+#if defined (HAVE_AVX)
+	if (SPA_FLAG_IS_SET(cpu_flags, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3)) {
+		run_test_gain("test_f32_gain", "avx", mix_gain_f32_avx, false);
+		run_test_gain("test_f32_gain_ramp", "avx", mix_gain_f32_avx, true);
+	}
+#endif
+}
+
 static void test_f64(void)
 {
 	run_test("test_f64", "c", mix_f64_c);
@@ -189,6 +265,7 @@ int main(int argc, char *argv[])
 	test_s24_32();
 	test_u24_32();
 	test_f32();
+	test_f32_gain();
 	test_f64();
 
 	qsort(results, n_results, sizeof(struct stats), compare_func);
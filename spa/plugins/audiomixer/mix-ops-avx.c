@@ -66,3 +66,93 @@ mix_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 		}
 	}
 }
+
+void
+mix_gain_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const float gain[], const float ramp[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	const float **s = (const float **)src;
+	float *d = dst;
+	__m256 in[4], g[4];
+	const __m256 offs = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+	n_samples *= ops->n_channels;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(float));
+		return;
+	}
+
+	if (SPA_LIKELY(SPA_IS_ALIGNED(dst, 32))) {
+		unrolled = n_samples & ~31;
+		for (i = 0; i < n_src; i++) {
+			if (SPA_UNLIKELY(!SPA_IS_ALIGNED(src[i], 32))) {
+				unrolled = 0;
+				break;
+			}
+		}
+	} else
+		unrolled = 0;
+
+	if (ramp == NULL) {
+		for (n = 0; n < unrolled; n += 32) {
+			g[0] = _mm256_set1_ps(gain[0]);
+			in[0] = _mm256_mul_ps(_mm256_load_ps(&s[0][n +  0]), g[0]);
+			in[1] = _mm256_mul_ps(_mm256_load_ps(&s[0][n +  8]), g[0]);
+			in[2] = _mm256_mul_ps(_mm256_load_ps(&s[0][n + 16]), g[0]);
+			in[3] = _mm256_mul_ps(_mm256_load_ps(&s[0][n + 24]), g[0]);
+			for (i = 1; i < n_src; i++) {
+				g[0] = _mm256_set1_ps(gain[i]);
+				in[0] = _mm256_fmadd_ps(_mm256_load_ps(&s[i][n +  0]), g[0], in[0]);
+				in[1] = _mm256_fmadd_ps(_mm256_load_ps(&s[i][n +  8]), g[0], in[1]);
+				in[2] = _mm256_fmadd_ps(_mm256_load_ps(&s[i][n + 16]), g[0], in[2]);
+				in[3] = _mm256_fmadd_ps(_mm256_load_ps(&s[i][n + 24]), g[0], in[3]);
+			}
+			_mm256_store_ps(&d[n +  0], in[0]);
+			_mm256_store_ps(&d[n +  8], in[1]);
+			_mm256_store_ps(&d[n + 16], in[2]);
+			_mm256_store_ps(&d[n + 24], in[3]);
+		}
+		for (; n < n_samples; n++) {
+			__m128 t;
+			t = _mm_mul_ss(_mm_load_ss(&s[0][n]), _mm_load_ss(&gain[0]));
+			for (i = 1; i < n_src; i++)
+				t = _mm_fmadd_ss(_mm_load_ss(&s[i][n]), _mm_load_ss(&gain[i]), t);
+			_mm_store_ss(&d[n], t);
+		}
+	} else {
+		for (n = 0; n < unrolled; n += 32) {
+			for (i = 0; i < n_src; i++) {
+				__m256 r = _mm256_set1_ps(ramp[i]);
+				__m256 r8 = _mm256_set1_ps(ramp[i] * 8.0f);
+
+				g[0] = _mm256_fmadd_ps(r, offs, _mm256_set1_ps(gain[i] + ramp[i] * n));
+				g[1] = _mm256_add_ps(g[0], r8);
+				g[2] = _mm256_add_ps(g[1], r8);
+				g[3] = _mm256_add_ps(g[2], r8);
+				if (i == 0) {
+					in[0] = _mm256_mul_ps(_mm256_load_ps(&s[i][n +  0]), g[0]);
+					in[1] = _mm256_mul_ps(_mm256_load_ps(&s[i][n +  8]), g[1]);
+					in[2] = _mm256_mul_ps(_mm256_load_ps(&s[i][n + 16]), g[2]);
+					in[3] = _mm256_mul_ps(_mm256_load_ps(&s[i][n + 24]), g[3]);
+				} else {
+					in[0] = _mm256_fmadd_ps(_mm256_load_ps(&s[i][n +  0]), g[0], in[0]);
+					in[1] = _mm256_fmadd_ps(_mm256_load_ps(&s[i][n +  8]), g[1], in[1]);
+					in[2] = _mm256_fmadd_ps(_mm256_load_ps(&s[i][n + 16]), g[2], in[2]);
+					in[3] = _mm256_fmadd_ps(_mm256_load_ps(&s[i][n + 24]), g[3], in[3]);
+				}
+			}
+			_mm256_store_ps(&d[n +  0], in[0]);
+			_mm256_store_ps(&d[n +  8], in[1]);
+			_mm256_store_ps(&d[n + 16], in[2]);
+			_mm256_store_ps(&d[n + 24], in[3]);
+		}
+		for (; n < n_samples; n++) {
+			float ac = s[0][n] * (gain[0] + ramp[0] * n);
+			for (i = 1; i < n_src; i++)
+				ac += s[i][n] * (gain[i] + ramp[i] * n);
+			d[n] = ac;
+		}
+	}
+}
@@ -46,3 +46,32 @@ MAKE_FUNC(s24_32, int32_t, int32_t, S24_32_ACCUM, S24_32_CLAMP, true);
 MAKE_FUNC(u24_32, uint32_t, int32_t, U24_32_ACCUM, U24_32_CLAMP, false);
 MAKE_FUNC(f32, float, float, F32_ACCUM, F32_CLAMP, true);
 MAKE_FUNC(f64, double, double, F64_ACCUM, F64_CLAMP, true);
+
+void mix_gain_f32_c(struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], const float gain[],
+		const float ramp[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n;
+	float *d = dst;
+	const float **s = (const float **)src;
+
+	n_samples *= ops->n_channels;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(float));
+	} else if (ramp == NULL) {
+		for (n = 0; n < n_samples; n++) {
+			float ac = s[0][n] * gain[0];
+			for (i = 1; i < n_src; i++)
+				ac += s[i][n] * gain[i];
+			d[n] = ac;
+		}
+	} else {
+		for (n = 0; n < n_samples; n++) {
+			float ac = s[0][n] * (gain[0] + ramp[0] * n);
+			for (i = 1; i < n_src; i++)
+				ac += s[i][n] * (gain[i] + ramp[i] * n);
+			d[n] = ac;
+		}
+	}
+}
@@ -65,3 +65,98 @@ mix_f32_sse(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 		}
 	}
 }
+
+void
+mix_gain_f32_sse(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const float gain[], const float ramp[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t n, i, unrolled;
+	__m128 in[4], g[4];
+	const float **s = (const float **)src;
+	float *d = dst;
+	const __m128 offs[4] = {
+		_mm_setr_ps( 0.0f,  1.0f,  2.0f,  3.0f),
+		_mm_setr_ps( 4.0f,  5.0f,  6.0f,  7.0f),
+		_mm_setr_ps( 8.0f,  9.0f, 10.0f, 11.0f),
+		_mm_setr_ps(12.0f, 13.0f, 14.0f, 15.0f) };
+
+	n_samples *= ops->n_channels;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(float));
+		return;
+	}
+
+	if (SPA_LIKELY(SPA_IS_ALIGNED(dst, 16))) {
+		unrolled = n_samples & ~15;
+		for (i = 0; i < n_src; i++) {
+			if (SPA_UNLIKELY(!SPA_IS_ALIGNED(src[i], 16))) {
+				unrolled = 0;
+				break;
+			}
+		}
+	} else
+		unrolled = 0;
+
+	if (ramp == NULL) {
+		for (n = 0; n < unrolled; n += 16) {
+			g[0] = _mm_set1_ps(gain[0]);
+			in[0] = _mm_mul_ps(_mm_load_ps(&s[0][n+ 0]), g[0]);
+			in[1] = _mm_mul_ps(_mm_load_ps(&s[0][n+ 4]), g[0]);
+			in[2] = _mm_mul_ps(_mm_load_ps(&s[0][n+ 8]), g[0]);
+			in[3] = _mm_mul_ps(_mm_load_ps(&s[0][n+12]), g[0]);
+
+			for (i = 1; i < n_src; i++) {
+				g[0] = _mm_set1_ps(gain[i]);
+				in[0] = _mm_add_ps(in[0], _mm_mul_ps(_mm_load_ps(&s[i][n+ 0]), g[0]));
+				in[1] = _mm_add_ps(in[1], _mm_mul_ps(_mm_load_ps(&s[i][n+ 4]), g[0]));
+				in[2] = _mm_add_ps(in[2], _mm_mul_ps(_mm_load_ps(&s[i][n+ 8]), g[0]));
+				in[3] = _mm_add_ps(in[3], _mm_mul_ps(_mm_load_ps(&s[i][n+12]), g[0]));
+			}
+			_mm_store_ps(&d[n+ 0], in[0]);
+			_mm_store_ps(&d[n+ 4], in[1]);
+			_mm_store_ps(&d[n+ 8], in[2]);
+			_mm_store_ps(&d[n+12], in[3]);
+		}
+		for (; n < n_samples; n++) {
+			in[0] = _mm_mul_ss(_mm_load_ss(&s[0][n]), _mm_load_ss(&gain[0]));
+			for (i = 1; i < n_src; i++)
+				in[0] = _mm_add_ss(in[0],
+						_mm_mul_ss(_mm_load_ss(&s[i][n]), _mm_load_ss(&gain[i])));
+			_mm_store_ss(&d[n], in[0]);
+		}
+	} else {
+		for (n = 0; n < unrolled; n += 16) {
+			for (i = 0; i < n_src; i++) {
+				__m128 r = _mm_set1_ps(ramp[i]);
+				__m128 b = _mm_set1_ps(gain[i] + ramp[i] * n);
+
+				g[0] = _mm_add_ps(b, _mm_mul_ps(r, offs[0]));
+				g[1] = _mm_add_ps(b, _mm_mul_ps(r, offs[1]));
+				g[2] = _mm_add_ps(b, _mm_mul_ps(r, offs[2]));
+				g[3] = _mm_add_ps(b, _mm_mul_ps(r, offs[3]));
+				if (i == 0) {
+					in[0] = _mm_mul_ps(_mm_load_ps(&s[i][n+ 0]), g[0]);
+					in[1] = _mm_mul_ps(_mm_load_ps(&s[i][n+ 4]), g[1]);
+					in[2] = _mm_mul_ps(_mm_load_ps(&s[i][n+ 8]), g[2]);
+					in[3] = _mm_mul_ps(_mm_load_ps(&s[i][n+12]), g[3]);
+				} else {
+					in[0] = _mm_add_ps(in[0], _mm_mul_ps(_mm_load_ps(&s[i][n+ 0]), g[0]));
+					in[1] = _mm_add_ps(in[1], _mm_mul_ps(_mm_load_ps(&s[i][n+ 4]), g[1]));
+					in[2] = _mm_add_ps(in[2], _mm_mul_ps(_mm_load_ps(&s[i][n+ 8]), g[2]));
+					in[3] = _mm_add_ps(in[3], _mm_mul_ps(_mm_load_ps(&s[i][n+12]), g[3]));
+				}
+			}
+			_mm_store_ps(&d[n+ 0], in[0]);
+			_mm_store_ps(&d[n+ 4], in[1]);
+			_mm_store_ps(&d[n+ 8], in[2]);
+			_mm_store_ps(&d[n+12], in[3]);
+		}
+		for (; n < n_samples; n++) {
+			float ac = s[0][n] * (gain[0] + ramp[0] * n);
+			for (i = 1; i < n_src; i++)
+				ac += s[i][n] * (gain[i] + ramp[i] * n);
+			d[n] = ac;
+		}
+	}
+}
@@ -14,6 +14,9 @@
 
 typedef void (*mix_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
 		const void * SPA_RESTRICT src[], uint32_t n_src, uint32_t n_samples);
+typedef void (*mix_gain_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], const float gain[], const float ramp[],
+		uint32_t n_src, uint32_t n_samples);
 
 struct mix_info {
 	uint32_t fmt;
@@ -21,21 +24,26 @@ struct mix_info {
 	uint32_t cpu_flags;
 	uint32_t stride;
 	mix_func_t process;
+	mix_gain_func_t process_gain;
 };
 
 static struct mix_info mix_table[] =
 {
 	/* f32 */
-#if defined(HAVE_AVX)
-	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
-	{ SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
+#if defined(HAVE_AVX) && defined(HAVE_FMA)
+	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3, 4, mix_f32_avx, mix_gain_f32_avx },
+	{ SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3, 4, mix_f32_avx, mix_gain_f32_avx },
+#endif
+#if defined(HAVE_AVX) && defined(HAVE_SSE)
+	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX, 4, mix_f32_avx, mix_gain_f32_sse },
+	{ SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX, 4, mix_f32_avx, mix_gain_f32_sse },
 #endif
 #if defined (HAVE_SSE)
-	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_SSE, 4, mix_f32_sse },
-	{ SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE, 4, mix_f32_sse },
+	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_SSE, 4, mix_f32_sse, mix_gain_f32_sse },
+	{ SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE, 4, mix_f32_sse, mix_gain_f32_sse },
 #endif
-	{ SPA_AUDIO_FORMAT_F32, 0, 0, 4, mix_f32_c },
-	{ SPA_AUDIO_FORMAT_F32P, 0, 0, 4, mix_f32_c },
+	{ SPA_AUDIO_FORMAT_F32, 0, 0, 4, mix_f32_c, mix_gain_f32_c },
+	{ SPA_AUDIO_FORMAT_F32P, 0, 0, 4, mix_f32_c, mix_gain_f32_c },
 
 	/* f64 */
 #if defined (HAVE_SSE2)
@@ -110,6 +118,7 @@ int mix_ops_init(struct mix_ops *ops)
 	ops->cpu_flags = info->cpu_flags;
 	ops->clear = impl_mix_ops_clear;
 	ops->process = info->process;
+	ops->process_gain = info->process_gain;
 	ops->free = impl_mix_ops_free;
 
 	return 0;
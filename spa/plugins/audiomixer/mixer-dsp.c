@@ -34,8 +34,8 @@ static struct spa_log_topic log_topic = SPA_LOG_TOPIC(0, "spa.mixer-dsp");
 #define PORT_DEFAULT_MUTE	false
 
 struct port_props {
-	double volume;
-	int32_t mute;
+	float volume;
+	bool mute;
 };
 
 static void port_props_reset(struct port_props *props)
@@ -60,6 +60,8 @@ struct port {
 	uint32_t id;
 
 	struct port_props props;
+	/* gain applied in the last cycle, only used from the data thread */
+	float gain;
 
 	struct spa_io_buffers *io;
 
@@ -105,6 +107,8 @@ struct impl {
 
 	struct buffer *mix_buffers[MAX_PORTS];
 	const void *mix_datas[MAX_PORTS];
+	float mix_gain[MAX_PORTS];
+	float mix_ramp[MAX_PORTS];
 
 	int n_formats;
 	struct spa_audio_info format;
@@ -238,6 +242,7 @@ static int impl_node_add_port(void *object, enum spa_direction direction, uint32
 	port->id = port_id;
 
 	port_props_reset(&port->props);
+	port->gain = PORT_DEFAULT_VOLUME;
 
 	spa_list_init(&port->queue);
 	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
@@ -252,8 +257,9 @@ static int impl_node_add_port(void *object, enum spa_direction direction, uint32
 	port->params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
 	port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
 	port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->params[5] = SPA_PARAM_INFO(SPA_PARAM_Props, SPA_PARAM_INFO_READWRITE);
 	port->info.params = port->params;
-	port->info.n_params = 5;
+	port->info.n_params = 6;
 
 	this->port_count++;
 	if (this->last_port <= port_id)
@@ -415,6 +421,21 @@ next:
 			return 0;
 		}
 		break;
+
+	case SPA_PARAM_Props:
+		if (direction != SPA_DIRECTION_INPUT)
+			return -ENOENT;
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_Props, id,
+				SPA_PROP_volume, SPA_POD_Float(port->props.volume),
+				SPA_PROP_mute,   SPA_POD_Bool(port->props.mute));
+			break;
+		default:
+			return 0;
+		}
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -535,6 +556,32 @@ static int port_set_format(void *object,
 }
 
 
+static int port_set_props(struct impl *this, struct port *port,
+		const struct spa_pod *param)
+{
+	struct port_props *p = &port->props;
+
+	if (port->direction != SPA_DIRECTION_INPUT)
+		return -ENOENT;
+
+	if (param == NULL) {
+		port_props_reset(p);
+	} else {
+		spa_pod_parse_object(param,
+			SPA_TYPE_OBJECT_Props, NULL,
+			SPA_PROP_volume, SPA_POD_OPT_Float(&p->volume),
+			SPA_PROP_mute,   SPA_POD_OPT_Bool(&p->mute));
+	}
+	spa_log_debug(this->log, "%p: port %d volume:%f mute:%d", this,
+			port->id, p->volume, p->mute);
+
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	port->params[5].user++;
+	emit_port_info(this, port, false);
+
+	return 0;
+}
+
 static int
 impl_node_port_set_param(void *object,
 			 enum spa_direction direction, uint32_t port_id,
@@ -546,11 +593,14 @@ impl_node_port_set_param(void *object,
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
 
-	if (id == SPA_PARAM_Format) {
+	switch (id) {
+	case SPA_PARAM_Format:
 		return port_set_format(this, direction, port_id, flags, param);
-	}
-	else
+	case SPA_PARAM_Props:
+		return port_set_props(this, GET_PORT(this, direction, port_id), param);
+	default:
 		return -ENOENT;
+	}
 }
 
 static int
@@ -681,6 +731,8 @@ static int impl_node_process(void *object)
 	struct buffer **buffers;
 	struct buffer *outb;
 	const void **datas;
+	float *gain, *ramp;
+	bool unity = true, ramping = false;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
@@ -702,6 +754,8 @@ static int impl_node_process(void *object)
 
 	buffers = this->mix_buffers;
 	datas = this->mix_datas;
+	gain = this->mix_gain;
+	ramp = this->mix_ramp;
 	n_buffers = 0;
 
 	maxsize = UINT32_MAX;
@@ -739,9 +793,25 @@ static int impl_node_process(void *object)
 				bd->chunk->flags);
 
 		if (!SPA_FLAG_IS_SET(bd->chunk->flags, SPA_CHUNK_FLAG_EMPTY)) {
+			float target = inport->props.mute ? 0.0f : inport->props.volume;
+
+			/* fully muted, nothing to mix */
+			if (target == 0.0f && inport->gain == 0.0f)
+				goto done;
+
+			/* the ramp is computed when the number of samples is known */
+			gain[n_buffers] = inport->gain;
+			ramp[n_buffers] = target;
+			if (target != inport->gain)
+				ramping = true;
+			if (target != 1.0f || inport->gain != 1.0f)
+				unity = false;
+			inport->gain = target;
+
 			datas[n_buffers] = SPA_PTROFF(bd->data, offs, void);
 			buffers[n_buffers++] = inb;
 		}
+done:
 		inio->status = SPA_STATUS_NEED_DATA;
 	}
 
@@ -753,9 +823,13 @@ static int impl_node_process(void *object)
 		return -EPIPE;
 	}
 
-	if (n_buffers == 1) {
+	if (this->ops.process_gain == NULL)
+		unity = true;
+
+	if (n_buffers == 1 && unity) {
 		*outb->buffer = *buffers[0]->buffer;
 	} else {
+		uint32_t n_samples;
 		struct spa_data *d = outb->buf.datas;
 
 		*outb->buffer = outb->buf;
@@ -769,8 +843,21 @@ static int impl_node_process(void *object)
 
 		spa_log_trace_fp(this->log, "%p: %d mix %d", this, n_buffers, maxsize);
 
-		mix_ops_process(&this->ops, d[0].data,
-				datas, n_buffers, maxsize / sizeof(float));
+		n_samples = maxsize / sizeof(float);
+
+		if (unity) {
+			mix_ops_process(&this->ops, d[0].data,
+					datas, n_buffers, n_samples);
+		} else {
+			/* ramp linearly to the new gain over this cycle */
+			for (i = 0; i < n_buffers && ramping; i++)
+				ramp[i] = n_samples > 0 ?
+					(ramp[i] - gain[i]) / n_samples : 0.0f;
+
+			mix_ops_process_gain(&this->ops, d[0].data,
+					datas, gain, ramping ? ramp : NULL,
+					n_buffers, n_samples);
+		}
 	}
 
 	outio->buffer_id = outb->id;
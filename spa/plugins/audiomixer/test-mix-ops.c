@@ -10,6 +10,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <math.h>
 
 #include <spa/debug/mem.h>
 
@@ -229,6 +230,80 @@ static void test_f32(void)
 #endif
 }
 
+static int run_test_gain(const char *name, const void *src[], const float gain[],
+		const float ramp[], uint32_t n_src, const float *dst,
+		uint32_t n_samples, mix_gain_func_t mix)
+{
+	struct mix_ops ops;
+	float *out = (float*)samp_out;
+	uint32_t i;
+
+	ops.fmt = SPA_AUDIO_FORMAT_F32;
+	ops.n_channels = 1;
+	ops.cpu_flags = cpu_flags;
+	mix_ops_init(&ops);
+
+	fprintf(stderr, "%s\n", name);
+
+	mix(&ops, (void *)samp_out, src, gain, ramp, n_src, n_samples);
+	for (i = 0; i < n_samples; i++) {
+		if (fabsf(out[i] - dst[i]) > 1e-6f) {
+			fprintf(stderr, "%d: %f != %f\n", i, out[i], dst[i]);
+			spa_assert_not_reached();
+		}
+	}
+	return 0;
+}
+
+static void test_f32_gain(void)
+{
+	float out[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float in_1[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float in_2[] = { 1.0f, -1.0f, 0.5f, -0.5f };
+	float in_3[] = { 0.5f, -0.5f, -0.5f, 0.5f };
+	float in_4[] = { -0.5f, 1.0f, 0.5f, -0.5f };
+	float out_4[] = { 0.75f, -1.0f, 0.0f, 0.0f };
+	float out_4r[] = { 0.0f, -0.25f, 0.25f, -0.375f };
+	float gain[] = { 1.0f, 0.5f, 0.0f, -0.5f };
+	float gain_r[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float ramp[] = { 0.0f, 0.25f, 0.0f, 0.0f };
+	const void *src[6] = { in_1, in_2, in_3, in_4 };
+	static float big[4][N_SAMPLES] SPA_ALIGNED(MIX_OPS_MAX_ALIGN);
+	static float big_out[N_SAMPLES] SPA_ALIGNED(MIX_OPS_MAX_ALIGN);
+	const void *big_src[4] = { big[0], big[1], big[2], big[3] };
+	float big_gain[] = { 0.8f, 0.3f, 1.0f, 0.0f };
+	float big_ramp[] = { -0.0005f, 0.0003f, 0.0f, 0.0009f };
+	uint32_t i, j;
+
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < N_SAMPLES; j++)
+			big[i][j] = ((j * 7 + i * 13) % 64) / 32.0f - 1.0f;
+
+	run_test_gain("test_f32_gain_0", NULL, NULL, NULL, 0, out, SPA_N_ELEMENTS(out), mix_gain_f32_c);
+	run_test_gain("test_f32_gain_4", src, gain, NULL, 4, out_4, SPA_N_ELEMENTS(out_4), mix_gain_f32_c);
+	run_test_gain("test_f32_gain_4_ramp", src, gain_r, ramp, 4, out_4r, SPA_N_ELEMENTS(out_4r), mix_gain_f32_c);
+
+	/* reference for the SIMD versions */
+	mix_gain_f32_c(&(struct mix_ops) { .n_channels = 1 }, big_out, big_src,
+			big_gain, big_ramp, 4, N_SAMPLES);
+#if defined(HAVE_SSE)
+	if (cpu_flags & SPA_CPU_FLAG_SSE) {
+		run_test_gain("test_f32_gain_0_sse", NULL, NULL, NULL, 0, out, SPA_N_ELEMENTS(out), mix_gain_f32_sse);
+		run_test_gain("test_f32_gain_4_sse", src, gain, NULL, 4, out_4, SPA_N_ELEMENTS(out_4), mix_gain_f32_sse);
+		run_test_gain("test_f32_gain_4_ramp_sse", src, gain_r, ramp, 4, out_4r, SPA_N_ELEMENTS(out_4r), mix_gain_f32_sse);
+		run_test_gain("test_f32_gain_big_sse", big_src, big_gain, big_ramp, 4, big_out, N_SAMPLES, mix_gain_f32_sse);
+	}
+#endif
+#if defined(HAVE_AVX)
+	if (SPA_FLAG_IS_SET(cpu_flags, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3)) {
+		run_test_gain("test_f32_gain_0_avx", NULL, NULL, NULL, 0, out, SPA_N_ELEMENTS(out), mix_gain_f32_avx);
+		run_test_gain("test_f32_gain_4_avx", src, gain, NULL, 4, out_4, SPA_N_ELEMENTS(out_4), mix_gain_f32_avx);
+		run_test_gain("test_f32_gain_4_ramp_avx", src, gain_r, ramp, 4, out_4r, SPA_N_ELEMENTS(out_4r), mix_gain_f32_avx);
+		run_test_gain("test_f32_gain_big_avx", big_src, big_gain, big_ramp, 4, big_out, N_SAMPLES, mix_gain_f32_avx);
+	}
+#endif
+}
+
 static void test_f64(void)
 {
 	double out[] = { 0.0, 0.0, 0.0, 0.0 };
@@ -267,6 +342,7 @@ int main(int argc, char *argv[])
 	test_s24_32();
 	test_u24_32();
 	test_f32();
+	test_f32_gain();
 	test_f64();
 
 	return 0;
@@ -14,34 +14,53 @@
 #include <spa/support/system.h>
 #include <spa/support/log.h>
 #include <spa/support/plugin.h>
+#include <spa/utils/atomic.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
 #include <spa/utils/ratelimit.h>
 #include <spa/utils/result.h>
 #include <spa/utils/type.h>
-#include <spa/utils/ringbuffer.h>
 #include <spa/utils/string.h>
 
 static struct spa_log_topic log_topic = SPA_LOG_TOPIC(0, "spa.loop");
 #undef SPA_LOG_TOPIC_DEFAULT
 #define SPA_LOG_TOPIC_DEFAULT &log_topic
 
-#define MAX_ALIGN	8
 #define ITEM_ALIGN	8
 #define DATAS_SIZE	(4096*8)
+#define MAX_DATAS_SIZE	(1024*1024)
+#define MAX_QUEUE_SIZE	(16*MAX_DATAS_SIZE)
 #define MAX_EP		32
 
 /** \cond */
 
+#define ITEM_FREE	0
+#define ITEM_READY	1
+#define ITEM_END	2
+
 struct invoke_item {
-	size_t item_size;
+	uint32_t state;
+	uint32_t item_size;
 	spa_invoke_func_t func;
 	uint32_t seq;
 	void *data;
 	size_t size;
 	bool block;
 	void *user_data;
-	int res;
+	int *res;
+};
+
+/* A segment of the invoke queue. Producers reserve space in the tail segment
+ * with a CAS on reserved and link a new segment when it is full. Only the
+ * loop thread reads from the head segment. */
+struct invoke_queue {
+	struct invoke_queue *next;
+	struct invoke_queue *free_next;
+	uint32_t size;
+	uint32_t reserved;
+	uint32_t read;
+	uint32_t padding;
+	uint8_t data[];
 };
 
 static int loop_signal_event(void *object, struct spa_source *source);
@@ -67,11 +86,26 @@ struct impl {
 	int ack_fd;
 	struct spa_ratelimit rate_limit;
 
-	struct spa_ringbuffer buffer;
-	uint8_t *buffer_data;
-	uint8_t buffer_mem[DATAS_SIZE + MAX_ALIGN];
+	struct invoke_queue *queue_head;	/* only used by the loop thread */
+	struct invoke_queue *queue_tail;
+	struct invoke_queue *queue_spare;
+	struct invoke_queue *queue_free;
+	uint32_t queue_size;	/* bytes in the linked segments */
+	uint32_t n_producers;
+	uint32_t flush_depth;
+	/* blocking invokes share ack_fd and are serialized, the lock is only
+	 * taken after the before hook */
+	pthread_mutex_t lock;
+
+	/* all timers share one timerfd, armed for the earliest deadline */
+	struct spa_source timer;
+	struct source_impl **timers;	/* min-heap on deadline */
+	uint32_t n_timers;
+	uint32_t max_timers;
+	uint64_t timer_deadline;	/* armed in the timerfd, 0 when disarmed */
+	struct spa_list timer_pending;
+	struct source_impl *timer_updates;	/* updates from other threads */
 
-	uint32_t flush_count;
 	unsigned int polling:1;
 };
 
@@ -91,11 +125,26 @@ struct source_impl {
 
 	struct spa_source *fallback;
 
+	/* timer sources */
+	uint64_t deadline;
+	uint64_t interval;
+	uint64_t expirations;
+	uint32_t heap_index;
+	struct spa_list pending_link;
+	/* update from another thread, applied by the loop thread */
+	struct source_impl *update_next;
+	uint64_t update_deadline;
+	uint64_t update_interval;
+	uint32_t update_state;
+	bool destroyed;
+
 	bool close;
 	bool enabled;
 };
 /** \endcond */
 
+static void timer_flush_updates(struct impl *impl);
+
 static inline uint64_t get_time_ns(struct spa_system *system)
 {
 	struct timespec ts;
@@ -153,48 +202,204 @@ static int loop_remove_source(void *object, struct spa_source *source)
 	return res;
 }
 
-static void flush_items(struct impl *impl)
+static struct invoke_queue *queue_new(uint32_t size)
 {
-	uint32_t index, flush_count;
-	int32_t avail;
-	int res;
+	struct invoke_queue *q;
+
+	if ((q = calloc(1, sizeof(struct invoke_queue) + size)) == NULL)
+		return NULL;
+	q->size = size;
+	return q;
+}
+
+static void queue_free_all(struct invoke_queue *q)
+{
+	struct invoke_queue *next;
+
+	for (; q; q = next) {
+		next = q->next;
+		free(q);
+	}
+}
+
+/* the segments that are linked in the queue can't be larger than
+ * MAX_QUEUE_SIZE, this fails when the loop doesn't keep up */
+static bool queue_add_size(struct impl *impl, uint32_t size)
+{
+	uint32_t used;
+
+	do {
+		used = SPA_ATOMIC_LOAD(impl->queue_size);
+		if (used + size > MAX_QUEUE_SIZE)
+			return false;
+	} while (!SPA_ATOMIC_CAS(impl->queue_size, used, used + size));
+	return true;
+}
+
+static void queue_remove_size(struct impl *impl, uint32_t size)
+{
+	uint32_t used;
+
+	do {
+		used = SPA_ATOMIC_LOAD(impl->queue_size);
+	} while (!SPA_ATOMIC_CAS(impl->queue_size, used, used - size));
+}
+
+static void queue_keep_spare(struct impl *impl, struct invoke_queue *q)
+{
+	if (!SPA_ATOMIC_CAS(impl->queue_spare, NULL, q))
+		free(q);
+}
+
+/* called by a producer when q is full. Returns the segment after q, linking
+ * a new one when nobody did that yet. Returns NULL with errno set to EPIPE
+ * when the queue is full or ENOMEM. */
+static struct invoke_queue *queue_grow(struct impl *impl, struct invoke_queue *q, uint32_t need)
+{
+	struct invoke_queue *next;
+	uint32_t size;
+
+	if ((next = SPA_ATOMIC_LOAD(q->next)) != NULL)
+		return next;
+
+	/* the loop is still busy with older segments, make the next one bigger */
+	size = DATAS_SIZE;
+	if (SPA_ATOMIC_LOAD(impl->queue_head) != q)
+		size = SPA_MIN(q->size * 2, (uint32_t)MAX_DATAS_SIZE);
+	size = SPA_MAX(size, need);
+
+	next = SPA_ATOMIC_XCHG(impl->queue_spare, NULL);
+	if (next != NULL && next->size < size) {
+		free(next);
+		next = NULL;
+	}
+	if (next == NULL && (next = queue_new(size)) == NULL)
+		return NULL;
+
+	if (!queue_add_size(impl, next->size)) {
+		queue_keep_spare(impl, next);
+		errno = EPIPE;
+		return NULL;
+	}
+	if (!SPA_ATOMIC_CAS(q->next, NULL, next)) {
+		/* someone else linked a segment, keep ours for later */
+		queue_remove_size(impl, next->size);
+		queue_keep_spare(impl, next);
+		next = SPA_ATOMIC_LOAD(q->next);
+	}
+	return next;
+}
+
+/* reserve item_size bytes for a new item, can be called from any thread */
+static struct invoke_item *queue_reserve(struct impl *impl, uint32_t item_size)
+{
+	struct invoke_queue *q, *next;
+	struct invoke_item *item;
+	uint32_t offset;
+
+	q = SPA_ATOMIC_LOAD(impl->queue_tail);
+	while (true) {
+		offset = SPA_ATOMIC_LOAD(q->reserved);
+		if (offset + item_size <= q->size) {
+			if (!SPA_ATOMIC_CAS(q->reserved, offset, offset + item_size))
+				continue;
+			return SPA_PTROFF(q->data, offset, struct invoke_item);
+		}
+		if (offset < q->size) {
+			/* seal the segment. When there is room for an item, mark
+			 * the end so that the loop knows to skip to the next
+			 * segment instead of waiting for an item here. */
+			if (!SPA_ATOMIC_CAS(q->reserved, offset, q->size))
+				continue;
+			if (offset + sizeof(struct invoke_item) <= q->size) {
+				item = SPA_PTROFF(q->data, offset, struct invoke_item);
+				SPA_ATOMIC_STORE(item->state, ITEM_END);
+			}
+		}
+		if ((next = queue_grow(impl, q, item_size)) == NULL)
+			return NULL;
+
+		SPA_ATOMIC_CAS(impl->queue_tail, q, next);
+		q = next;
+	}
+}
+
+/* get the next ready item, only called from the loop thread */
+static struct invoke_item *queue_peek(struct impl *impl)
+{
+	struct invoke_queue *q = impl->queue_head, *next;
+	struct invoke_item *item;
+	uint32_t state;
+
+	while (true) {
+		if (q->read + sizeof(struct invoke_item) <= q->size) {
+			item = SPA_PTROFF(q->data, q->read, struct invoke_item);
+			state = SPA_ATOMIC_LOAD(item->state);
+			if (state == ITEM_READY)
+				return item;
+			if (state == ITEM_FREE)
+				return NULL;
+		}
+		if ((next = SPA_ATOMIC_LOAD(q->next)) == NULL)
+			return NULL;
+
+		/* move the producers along and retire the segment, it is freed
+		 * when no producer can still be looking at it */
+		SPA_ATOMIC_CAS(impl->queue_tail, q, next);
+		SPA_ATOMIC_STORE(impl->queue_head, next);
+		queue_remove_size(impl, q->size);
+		q->free_next = impl->queue_free;
+		impl->queue_free = q;
+		q = next;
+	}
+}
+
+static void queue_reclaim(struct impl *impl)
+{
+	struct invoke_queue *q, *next;
 
-	flush_count = ++impl->flush_count;
-	avail = spa_ringbuffer_get_read_index(&impl->buffer, &index);
-	while (avail > 0) {
-		struct invoke_item *item;
-		bool block;
-		spa_invoke_func_t func;
+	if (impl->queue_free == NULL || SPA_ATOMIC_LOAD(impl->n_producers) != 0)
+		return;
 
-		item = SPA_PTROFF(impl->buffer_data, index & (DATAS_SIZE - 1), struct invoke_item);
-		block = item->block;
-		func = item->func;
+	for (q = impl->queue_free; q; q = next) {
+		next = q->free_next;
+		if (SPA_ATOMIC_LOAD(impl->queue_spare) == NULL) {
+			memset(q->data, 0, q->size);
+			q->next = q->free_next = NULL;
+			q->reserved = q->read = 0;
+			if (SPA_ATOMIC_CAS(impl->queue_spare, NULL, q))
+				continue;
+		}
+		free(q);
+	}
+	impl->queue_free = NULL;
+}
 
+static void flush_items(struct impl *impl)
+{
+	struct invoke_item *item;
+	int res;
+
+	impl->flush_depth++;
+	while ((item = queue_peek(impl)) != NULL) {
 		spa_log_trace_fp(impl->log, "%p: flush item %p", impl, item);
-		/* first we remove the function from the item so that recursive
-		 * calls don't call the callback again. We can't update the
-		 * read index before we call the function because then the item
-		 * might get overwritten. */
-		item->func = NULL;
-		if (func)
-			item->res = func(&impl->loop, true, item->seq, item->data,
-				item->size, item->user_data);
-
-		/* if this function did a recursive invoke, it now flushed the
-		 * ringbuffer and we can exit */
-		if (flush_count != impl->flush_count)
-			break;
+		/* first we move past the item so that recursive calls don't
+		 * call the callback again. The item stays valid until the
+		 * outermost flush reclaims the segments. */
+		impl->queue_head->read += item->item_size;
 
-		index += item->item_size;
-		avail -= item->item_size;
-		spa_ringbuffer_read_update(&impl->buffer, index);
+		res = item->func ? item->func(&impl->loop, true, item->seq, item->data,
+				item->size, item->user_data) : 0;
 
-		if (block) {
+		if (item->block) {
+			*item->res = res;
 			if ((res = spa_system_eventfd_write(impl->system, impl->ack_fd, 1)) < 0)
 				spa_log_warn(impl->log, "%p: failed to write event fd:%d: %s",
 						impl, impl->ack_fd, spa_strerror(res));
 		}
 	}
+	if (--impl->flush_depth == 0)
+		queue_reclaim(impl);
 }
 
 static int
@@ -206,7 +411,7 @@ loop_invoke_inthread(struct impl *impl,
 		bool block,
 		void *user_data)
 {
-	/* we should probably have a second ringbuffer for the in-thread pending
+	/* we should probably have a second queue for the in-thread pending
 	 * callbacks. A recursive callback when flushing will insert itself
 	 * before this one. */
 	flush_items(impl);
@@ -214,101 +419,103 @@ loop_invoke_inthread(struct impl *impl,
 }
 
 static int
-loop_invoke(void *object,
-	    spa_invoke_func_t func,
-	    uint32_t seq,
-	    const void *data,
-	    size_t size,
-	    bool block,
-	    void *user_data)
+queue_push(struct impl *impl,
+	   spa_invoke_func_t func,
+	   uint32_t seq,
+	   const void *data,
+	   size_t size,
+	   bool block,
+	   void *user_data,
+	   int *res)
 {
-	struct impl *impl = object;
 	struct invoke_item *item;
-	int res;
-	int32_t filled;
-	uint32_t avail, idx, offset, l0;
+	uint32_t item_size;
+	int err = 0;
 
-	/* the ringbuffer can only be written to from one thread, if we are
-	 * in the same thread as the loop, don't write into the ringbuffer
-	 * but try to emit the calback right away after flushing what we have */
-	if (impl->thread == 0 || pthread_equal(impl->thread, pthread_self()))
-		return loop_invoke_inthread(impl, func, seq, data, size, block, user_data);
+	item_size = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, ITEM_ALIGN);
 
-	filled = spa_ringbuffer_get_write_index(&impl->buffer, &idx);
-	if (filled < 0 || filled > DATAS_SIZE) {
-		spa_log_warn(impl->log, "%p: queue xrun %d", impl, filled);
-		return -EPIPE;
-	}
-	avail = DATAS_SIZE - filled;
-	if (avail < sizeof(struct invoke_item)) {
-		spa_log_warn(impl->log, "%p: queue full %d", impl, avail);
-		return -EPIPE;
-	}
-	offset = idx & (DATAS_SIZE - 1);
-
-	/* l0 is remaining size in ringbuffer, this should always be larger than
-	 * invoke_item, see below */
-	l0 = DATAS_SIZE - offset;
-
-	item = SPA_PTROFF(impl->buffer_data, offset, struct invoke_item);
-	item->func = func;
-	item->seq = seq;
-	item->size = size;
-	item->block = block;
-	item->user_data = user_data;
-	item->res = 0;
-	item->item_size = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, ITEM_ALIGN);
+	/* any thread can add items, the loop only frees retired segments when
+	 * no producer is active */
+	SPA_ATOMIC_INC(impl->n_producers);
+	if ((item = queue_reserve(impl, item_size)) == NULL) {
+		err = -errno;
+	} else {
+		item->item_size = item_size;
+		item->func = func;
+		item->seq = seq;
+		item->size = size;
+		item->block = block;
+		item->user_data = user_data;
+		item->res = res;
+		item->data = SPA_PTROFF(item, sizeof(struct invoke_item), void);
+		if (data && size > 0)
+			memcpy(item->data, data, size);
 
-	spa_log_trace_fp(impl->log, "%p: add item %p filled:%d", impl, item, filled);
+		spa_log_trace_fp(impl->log, "%p: add item %p", impl, item);
 
-	if (l0 >= item->item_size) {
-		/* item + size fit in current ringbuffer idx */
-		item->data = SPA_PTROFF(item, sizeof(struct invoke_item), void);
-		if (l0 < sizeof(struct invoke_item) + item->item_size) {
-			/* not enough space for next invoke_item, fill up till the end
-			 * so that the next item will be at the start */
-			item->item_size = l0;
-		}
-	} else {
-		/* item does not fit, place the invoke_item at idx and start the
-		 * data at the start of the ringbuffer */
-		item->data = impl->buffer_data;
-		item->item_size = SPA_ROUND_UP_N(l0 + size, ITEM_ALIGN);
+		SPA_ATOMIC_STORE(item->state, ITEM_READY);
 	}
-	if (avail < item->item_size) {
+	SPA_ATOMIC_DEC(impl->n_producers);
+
+	if (item == NULL) {
 		int suppressed;
 		uint64_t nsec = get_time_ns(impl->system);
 		if ((suppressed = spa_ratelimit_test(&impl->rate_limit, nsec)) >= 0) {
-			spa_log_warn(impl->log, "%p: queue full %d, need %zd (%d suppressed)",
-					impl, avail, item->item_size, suppressed);
+			spa_log_warn(impl->log, "%p: can't grow queue, need %u: %s (%d suppressed)",
+					impl, item_size, spa_strerror(err), suppressed);
 		}
-		return -EPIPE;
+		return err;
 	}
-	if (data && size > 0)
-		memcpy(item->data, data, size);
-
-	spa_ringbuffer_write_update(&impl->buffer, idx + item->item_size);
 
 	loop_signal_event(impl, impl->wakeup);
+	return 0;
+}
+
+static int
+loop_invoke(void *object,
+	    spa_invoke_func_t func,
+	    uint32_t seq,
+	    const void *data,
+	    size_t size,
+	    bool block,
+	    void *user_data)
+{
+	struct impl *impl = object;
+	int res = 0;
+
+	/* if we are in the same thread as the loop, don't write into the queue
+	 * but try to emit the calback right away after flushing what we have */
+	if (impl->thread == 0 || pthread_equal(impl->thread, pthread_self()))
+		return loop_invoke_inthread(impl, func, seq, data, size, block, user_data);
+
+	if (size > MAX_DATAS_SIZE)
+		return -EINVAL;
 
 	if (block) {
 		uint64_t count = 1;
+		int r;
 
+		/* the hook can release a lock that the loop needs to dispatch
+		 * the items, like the pw_thread_loop lock. Release it before we
+		 * wait for the other blocking invokes or we deadlock with them. */
 		spa_loop_control_hook_before(&impl->hooks_list);
 
-		if ((res = spa_system_eventfd_read(impl->system, impl->ack_fd, &count)) < 0)
+		pthread_mutex_lock(&impl->lock);
+		if ((r = queue_push(impl, func, seq, data, size, block, user_data, &res)) < 0) {
+			res = r;
+		} else if ((r = spa_system_eventfd_read(impl->system, impl->ack_fd, &count)) < 0) {
 			spa_log_warn(impl->log, "%p: failed to read event fd:%d: %s",
-					impl, impl->ack_fd, spa_strerror(res));
+					impl, impl->ack_fd, spa_strerror(r));
+		}
+		pthread_mutex_unlock(&impl->lock);
 
 		spa_loop_control_hook_after(&impl->hooks_list);
-
-		res = item->res;
 	}
 	else {
+		if ((res = queue_push(impl, func, seq, data, size, block, user_data, NULL)) < 0)
+			return res;
 		if (seq != SPA_ID_INVALID)
 			res = SPA_RESULT_RETURN_ASYNC(seq);
-		else
-			res = 0;
 	}
 	return res;
 }
@@ -316,6 +523,7 @@ loop_invoke(void *object,
 static void wakeup_func(void *data, uint64_t count)
 {
 	struct impl *impl = data;
+	timer_flush_updates(impl);
 	flush_items(impl);
 }
 
@@ -715,19 +923,166 @@ static int loop_signal_event(void *object, struct spa_source *source)
 	return res;
 }
 
-static void source_timer_func(struct spa_source *source)
+static inline void timer_heap_swap(struct impl *impl, uint32_t a, uint32_t b)
 {
-	struct source_impl *s = SPA_CONTAINER_OF(source, struct source_impl, source);
-	uint64_t expirations = 0;
+	struct source_impl *t = impl->timers[a];
+	impl->timers[a] = impl->timers[b];
+	impl->timers[b] = t;
+	impl->timers[a]->heap_index = a;
+	impl->timers[b]->heap_index = b;
+}
+
+static void timer_heap_up(struct impl *impl, uint32_t idx)
+{
+	while (idx > 0) {
+		uint32_t parent = (idx - 1) / 2;
+		if (impl->timers[parent]->deadline <= impl->timers[idx]->deadline)
+			break;
+		timer_heap_swap(impl, idx, parent);
+		idx = parent;
+	}
+}
+
+static void timer_heap_down(struct impl *impl, uint32_t idx)
+{
+	while (true) {
+		uint32_t l = idx * 2 + 1, r = l + 1, min = idx;
+		if (l < impl->n_timers && impl->timers[l]->deadline < impl->timers[min]->deadline)
+			min = l;
+		if (r < impl->n_timers && impl->timers[r]->deadline < impl->timers[min]->deadline)
+			min = r;
+		if (min == idx)
+			break;
+		timer_heap_swap(impl, idx, min);
+		idx = min;
+	}
+}
+
+/* only the loop thread adds to the heap, it also grows the heap so that
+ * timer_dispatch() never sees the heap move */
+static int timer_heap_add(struct impl *impl, struct source_impl *s)
+{
+	if (s->heap_index != SPA_ID_INVALID) {
+		timer_heap_up(impl, s->heap_index);
+		timer_heap_down(impl, s->heap_index);
+		return 0;
+	}
+	if (impl->n_timers >= impl->max_timers) {
+		uint32_t max = SPA_MAX(impl->max_timers * 2, 32u);
+		struct source_impl **timers;
+
+		if ((timers = reallocarray(impl->timers, max, sizeof(*timers))) == NULL)
+			return -errno;
+		impl->timers = timers;
+		impl->max_timers = max;
+	}
+	s->heap_index = impl->n_timers++;
+	impl->timers[s->heap_index] = s;
+	timer_heap_up(impl, s->heap_index);
+	return 0;
+}
+
+static void timer_heap_remove(struct impl *impl, struct source_impl *s)
+{
+	uint32_t idx = s->heap_index, last;
+
+	if (idx == SPA_ID_INVALID)
+		return;
+
+	s->heap_index = SPA_ID_INVALID;
+	last = --impl->n_timers;
+	if (idx != last) {
+		impl->timers[idx] = impl->timers[last];
+		impl->timers[idx]->heap_index = idx;
+		timer_heap_up(impl, idx);
+		timer_heap_down(impl, idx);
+	}
+}
+
+static void timer_unpend(struct source_impl *s)
+{
+	if (s->expirations > 0) {
+		spa_list_remove(&s->pending_link);
+		s->expirations = 0;
+	}
+}
+
+/* arm the timerfd for the earliest deadline. When the earliest timer is
+ * removed or moved later we keep the old deadline, we just wake up once
+ * for nothing and then arm for the next one. */
+static int timer_arm(struct impl *impl)
+{
+	struct itimerspec its;
+	uint64_t deadline;
+	int res;
+
+	if (impl->n_timers == 0)
+		return 0;
+
+	deadline = impl->timers[0]->deadline;
+	if (impl->timer_deadline != 0 && impl->timer_deadline <= deadline)
+		return 0;
+
+	spa_zero(its);
+	its.it_value.tv_sec = deadline / SPA_NSEC_PER_SEC;
+	its.it_value.tv_nsec = deadline % SPA_NSEC_PER_SEC;
+	if (SPA_UNLIKELY((res = spa_system_timerfd_settime(impl->system, impl->timer.fd,
+				SPA_FD_TIMER_ABSTIME, &its, NULL)) < 0))
+		return res;
+
+	impl->timer_deadline = deadline;
+	return 0;
+}
+
+static void timer_dispatch(struct spa_source *source)
+{
+	struct impl *impl = source->data;
+	struct source_impl *s;
+	uint64_t expirations = 0, now;
 	int res;
 
-	if (SPA_UNLIKELY((res = spa_system_timerfd_read(s->impl->system,
+	if (SPA_UNLIKELY((res = spa_system_timerfd_read(impl->system,
 				source->fd, &expirations)) < 0)) {
 		if (res != -EAGAIN)
-			spa_log_warn(s->impl->log, "%p: failed to read timer fd:%d: %s",
-					source, source->fd, spa_strerror(res));
+			spa_log_warn(impl->log, "%p: failed to read timer fd:%d: %s",
+					impl, source->fd, spa_strerror(res));
 		return;
 	}
+	impl->timer_deadline = 0;
+
+	/* first collect all expired timers and reschedule the periodic ones,
+	 * the callbacks can then freely update or destroy any timer */
+	now = get_time_ns(impl->system);
+	while (impl->n_timers > 0 && (s = impl->timers[0])->deadline <= now) {
+		expirations = 1;
+		if (s->interval > 0) {
+			expirations += (now - s->deadline) / s->interval;
+			s->deadline += expirations * s->interval;
+			timer_heap_down(impl, 0);
+		} else {
+			timer_heap_remove(impl, s);
+		}
+		timer_unpend(s);
+		s->expirations = expirations;
+		spa_list_append(&impl->timer_pending, &s->pending_link);
+	}
+	if ((res = timer_arm(impl)) < 0)
+		spa_log_warn(impl->log, "%p: failed to arm timer fd:%d: %s",
+				impl, source->fd, spa_strerror(res));
+
+	spa_list_consume(s, &impl->timer_pending, pending_link)
+		s->source.func(&s->source);
+}
+
+static void source_timer_func(struct spa_source *source)
+{
+	struct source_impl *s = SPA_CONTAINER_OF(source, struct source_impl, source);
+	uint64_t expirations = s->expirations;
+
+	timer_unpend(s);
+	/* destroyed from another thread, the loop frees it in the next flush */
+	if (SPA_UNLIKELY(SPA_ATOMIC_LOAD(s->destroyed)))
+		return;
 	s->func.timer(source->data, expirations);
 }
 
@@ -736,67 +1091,165 @@ static struct spa_source *loop_add_timer(void *object,
 {
 	struct impl *impl = object;
 	struct source_impl *source;
-	int res;
 
 	source = calloc(1, sizeof(struct source_impl));
 	if (source == NULL)
-		goto error_exit;
-
-	if ((res = spa_system_timerfd_create(impl->system, CLOCK_MONOTONIC,
-			SPA_FD_CLOEXEC | SPA_FD_NONBLOCK)) < 0)
-		goto error_exit_free;
+		return NULL;
 
+	/* timers don't have their own fd, they are dispatched from the
+	 * shared timerfd. They are only added to the heap by the loop thread
+	 * when they are armed. */
+	source->source.loop = &impl->loop;
 	source->source.func = source_timer_func;
 	source->source.data = data;
-	source->source.fd = res;
+	source->source.fd = -1;
 	source->source.mask = SPA_IO_IN;
 	source->impl = impl;
-	source->close = true;
 	source->func.timer = func;
-
-	if ((res = loop_add_source(impl, &source->source)) < 0)
-		goto error_exit_close;
+	source->heap_index = SPA_ID_INVALID;
 
 	spa_list_insert(&impl->source_list, &source->link);
 
 	return &source->source;
+}
 
-error_exit_close:
-	spa_system_close(impl->system, source->source.fd);
-error_exit_free:
-	free(source);
-	errno = -res;
-error_exit:
-	return NULL;
+static int timer_update(struct impl *impl, struct source_impl *s,
+		uint64_t deadline, uint64_t interval)
+{
+	int res;
+
+	/* like the timerfd, rearming drops the pending expirations */
+	timer_unpend(s);
+
+	if (deadline == 0) {
+		timer_heap_remove(impl, s);
+		return 0;
+	}
+	s->deadline = deadline;
+	s->interval = interval;
+	if ((res = timer_heap_add(impl, s)) < 0)
+		return res;
+
+	return timer_arm(impl);
+}
+
+#define UPDATE_IDLE	0
+#define UPDATE_BUSY	1
+#define UPDATE_QUEUED	2
+
+/* the writer or the loop thread own the update values in the BUSY state,
+ * it is only held for a couple of stores */
+static uint32_t timer_update_lock(struct source_impl *s)
+{
+	uint32_t state;
+
+	while (true) {
+		state = SPA_ATOMIC_LOAD(s->update_state);
+		if (state != UPDATE_BUSY &&
+		    SPA_ATOMIC_CAS(s->update_state, state, UPDATE_BUSY))
+			return state;
+		SPA_CPU_PAUSE();
+	}
+}
+
+/* called from the loop thread, the source is already removed from the
+ * source list */
+static void timer_free(struct impl *impl, struct source_impl *s)
+{
+	timer_unpend(s);
+	timer_heap_remove(impl, s);
+
+	if (!impl->polling)
+		free_source(s);
+	else
+		spa_list_insert(&impl->destroy_list, &s->link);
+}
+
+static void timer_flush_updates(struct impl *impl)
+{
+	struct source_impl *s, *next;
+	uint64_t deadline, interval;
+	bool destroyed;
+	int res;
+
+	s = SPA_ATOMIC_XCHG(impl->timer_updates, NULL);
+	for (; s != NULL; s = next) {
+		next = s->update_next;
+
+		if (timer_update_lock(s) != UPDATE_QUEUED) {
+			SPA_ATOMIC_STORE(s->update_state, UPDATE_IDLE);
+			continue;
+		}
+		deadline = s->update_deadline;
+		interval = s->update_interval;
+		destroyed = s->destroyed;
+		SPA_ATOMIC_STORE(s->update_state, UPDATE_IDLE);
+
+		if (destroyed) {
+			timer_free(impl, s);
+			continue;
+		}
+		if ((res = timer_update(impl, s, deadline, interval)) < 0)
+			spa_log_warn(impl->log, "%p: failed to update timer: %s",
+					impl, spa_strerror(res));
+	}
+}
+
+/* the timer heap belongs to the loop thread. Other threads store the new
+ * deadline in the source, or mark it destroyed, queue it once and wake up
+ * the loop, they never wait for the loop thread. */
+static int timer_queue_update(struct impl *impl, struct source_impl *s,
+		uint64_t deadline, uint64_t interval, bool destroy)
+{
+	struct source_impl *head;
+	uint32_t state;
+
+	state = timer_update_lock(s);
+	s->update_deadline = deadline;
+	s->update_interval = interval;
+	if (destroy)
+		SPA_ATOMIC_STORE(s->destroyed, true);
+	SPA_ATOMIC_STORE(s->update_state, UPDATE_QUEUED);
+
+	if (state == UPDATE_QUEUED)
+		return 0;
+
+	do {
+		head = SPA_ATOMIC_LOAD(impl->timer_updates);
+		s->update_next = head;
+	} while (!SPA_ATOMIC_CAS(impl->timer_updates, head, s));
+
+	return loop_signal_event(impl, impl->wakeup);
 }
 
 static int
 loop_update_timer(void *object, struct spa_source *source,
 		  struct timespec *value, struct timespec *interval, bool absolute)
 {
+	struct impl *impl = object;
 	struct source_impl *s = SPA_CONTAINER_OF(source, struct source_impl, source);
-	struct itimerspec its;
-	int flags = 0, res;
+	struct timespec val = { 0, 0 };
+	uint64_t deadline, period;
 
 	spa_assert(s->impl == object);
 	spa_assert(source->func == source_timer_func);
 
-	spa_zero(its);
 	if (SPA_LIKELY(value)) {
-		its.it_value = *value;
+		val = *value;
 	} else if (interval) {
-		its.it_value = *interval;
+		val = *interval;
 		absolute = true;
 	}
-	if (SPA_UNLIKELY(interval))
-		its.it_interval = *interval;
-	if (SPA_LIKELY(absolute))
-		flags |= SPA_FD_TIMER_ABSTIME;
 
-	if (SPA_UNLIKELY((res = spa_system_timerfd_settime(s->impl->system, source->fd, flags, &its, NULL)) < 0))
-		return res;
+	deadline = SPA_TIMESPEC_TO_NSEC(&val);
+	if (deadline != 0 && !absolute)
+		deadline += get_time_ns(impl->system);
+	period = interval ? SPA_TIMESPEC_TO_NSEC(interval) : 0;
 
-	return 0;
+	if (impl->thread != 0 && !pthread_equal(impl->thread, pthread_self()))
+		return timer_queue_update(impl, s, deadline, period, false);
+
+	return timer_update(impl, s, deadline, period);
 }
 
 static void source_signal_func(struct spa_source *source)
@@ -865,6 +1318,20 @@ static void loop_destroy_source(void *object, struct spa_source *source)
 
 	if (s->fallback)
 		loop_destroy_source(s->impl, s->fallback);
+	else if (source->func == source_timer_func) {
+		struct impl *impl = s->impl;
+
+		/* the loop thread removes it from the heap and frees it */
+		if (impl->thread != 0 && !pthread_equal(impl->thread, pthread_self())) {
+			timer_queue_update(impl, s, 0, 0, true);
+			return;
+		}
+		/* don't leave a freed source in the update list */
+		if (SPA_ATOMIC_LOAD(s->update_state) != UPDATE_IDLE)
+			timer_flush_updates(impl);
+		timer_free(impl, s);
+		return;
+	}
 	else
 		remove_from_poll(s->impl, source);
 
@@ -946,6 +1413,7 @@ static int impl_clear(struct spa_handle *handle)
 {
 	struct impl *impl;
 	struct source_impl *source;
+	struct invoke_queue *q, *next;
 
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
 
@@ -957,10 +1425,24 @@ static int impl_clear(struct spa_handle *handle)
 
 	spa_list_consume(source, &impl->source_list, link)
 		loop_destroy_source(impl, &source->source);
+	/* free the timers that were destroyed from other threads */
+	timer_flush_updates(impl);
+
+	remove_from_poll(impl, &impl->timer);
+	spa_system_close(impl->system, impl->timer.fd);
+	free(impl->timers);
 
 	spa_system_close(impl->system, impl->ack_fd);
 	spa_system_close(impl->system, impl->poll_fd);
 
+	queue_free_all(impl->queue_head);
+	for (q = impl->queue_free; q; q = next) {
+		next = q->free_next;
+		free(q);
+	}
+	free(impl->queue_spare);
+	pthread_mutex_destroy(&impl->lock);
+
 	return 0;
 }
 
@@ -1030,15 +1512,21 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_list_init(&impl->source_list);
 	spa_list_init(&impl->destroy_list);
 	spa_hook_list_init(&impl->hooks_list);
+	spa_list_init(&impl->timer_pending);
 
-	impl->buffer_data = SPA_PTR_ALIGN(impl->buffer_mem, MAX_ALIGN, uint8_t);
-	spa_ringbuffer_init(&impl->buffer);
+	if ((impl->queue_head = queue_new(DATAS_SIZE)) == NULL) {
+		res = -errno;
+		goto error_exit_free_poll;
+	}
+	impl->queue_tail = impl->queue_head;
+	impl->queue_size = DATAS_SIZE;
+	pthread_mutex_init(&impl->lock, NULL);
 
 	impl->wakeup = loop_add_event(impl, wakeup_func, impl);
 	if (impl->wakeup == NULL) {
 		res = -errno;
 		spa_log_error(impl->log, "%p: can't create wakeup event: %m", impl);
-		goto error_exit_free_poll;
+		goto error_exit_free_queue;
 	}
 	if ((res = spa_system_eventfd_create(impl->system,
 			SPA_FD_EVENT_SEMAPHORE | SPA_FD_CLOEXEC)) < 0) {
@@ -1048,12 +1536,35 @@ impl_init(const struct spa_handle_factory *factory,
 	}
 	impl->ack_fd = res;
 
+	if ((res = spa_system_timerfd_create(impl->system, CLOCK_MONOTONIC,
+			SPA_FD_CLOEXEC | SPA_FD_NONBLOCK)) < 0) {
+		spa_log_error(impl->log, "%p: can't create timer fd: %s",
+				impl, spa_strerror(res));
+		goto error_exit_free_ack;
+	}
+	impl->timer.func = timer_dispatch;
+	impl->timer.data = impl;
+	impl->timer.fd = res;
+	impl->timer.mask = SPA_IO_IN;
+	if ((res = loop_add_source(impl, &impl->timer)) < 0) {
+		spa_log_error(impl->log, "%p: can't add timer fd: %s",
+				impl, spa_strerror(res));
+		goto error_exit_free_timer;
+	}
+
 	spa_log_debug(impl->log, "%p: initialized", impl);
 
 	return 0;
 
+error_exit_free_timer:
+	spa_system_close(impl->system, impl->timer.fd);
+error_exit_free_ack:
+	spa_system_close(impl->system, impl->ack_fd);
 error_exit_free_wakeup:
 	loop_destroy_source(impl, impl->wakeup);
+error_exit_free_queue:
+	pthread_mutex_destroy(&impl->lock);
+	queue_free_all(impl->queue_head);
 error_exit_free_poll:
 	spa_system_close(impl->system, impl->poll_fd);
 error_exit:
@@ -58,6 +58,20 @@ struct buffer {
 	void *ptr;
 };
 
+/* an imported dmabuf, kept on the same v4l2 buffer index across
+ * renegotiation so that the driver can keep it mapped */
+struct pool_entry {
+	dev_t dev;
+	ino_t ino;
+};
+
+struct latency_stats {
+	uint64_t min;
+	uint64_t max;
+	uint64_t total;
+	uint32_t count;
+};
+
 #define MAX_CONTROLS	64
 
 struct control {
@@ -73,6 +87,8 @@ struct port {
 	bool alloc_buffers;
 	bool probed_expbuf;
 	bool have_expbuf;
+	bool have_dmabuf;
+	bool import_dmabuf;
 
 	bool next_fmtdesc;
 	struct v4l2_fmtdesc fmtdesc;
@@ -97,6 +113,13 @@ struct port {
 	struct buffer buffers[MAX_BUFFERS];
 	uint32_t n_buffers;
 	struct spa_list queue;
+	/* v4l2 buffer index to buffer id */
+	uint32_t index_map[MAX_BUFFERS];
+
+	struct pool_entry pool[MAX_BUFFERS];
+	uint32_t n_pool;
+
+	struct latency_stats stats;
 
 	struct spa_source source;
 
@@ -565,12 +588,22 @@ static int impl_node_port_enum_params(void *object, int seq,
 		if (result.index > 0)
 			return 0;
 
-		param = spa_pod_builder_add_object(&b,
-			SPA_TYPE_OBJECT_ParamBuffers, id,
-			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(4, 1, MAX_BUFFERS),
-			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
-			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(port->fmt.fmt.pix.sizeimage),
-			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(port->fmt.fmt.pix.bytesperline));
+		if (port->import_dmabuf && port->have_dmabuf) {
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamBuffers, id,
+				SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(4, 1, MAX_BUFFERS),
+				SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+				SPA_PARAM_BUFFERS_size,    SPA_POD_Int(port->fmt.fmt.pix.sizeimage),
+				SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(port->fmt.fmt.pix.bytesperline),
+				SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(1<<SPA_DATA_DmaBuf));
+		} else {
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamBuffers, id,
+				SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(4, 1, MAX_BUFFERS),
+				SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+				SPA_PARAM_BUFFERS_size,    SPA_POD_Int(port->fmt.fmt.pix.sizeimage),
+				SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(port->fmt.fmt.pix.bytesperline));
+		}
 		break;
 
 	case SPA_PARAM_Meta:
@@ -640,19 +673,18 @@ static int port_set_format(struct impl *this, struct port *port,
 	struct spa_video_info info;
 	int res;
 
-	if (port->have_format) {
-		spa_v4l2_stream_off(this);
-		spa_v4l2_clear_buffers(this);
-	}
 	if (format == NULL) {
 		if (!port->have_format)
 			return 0;
 
+		spa_v4l2_stream_off(this);
+		spa_v4l2_clear_buffers(this);
 		port->have_format = false;
 		port->dev.have_format = false;
 		spa_v4l2_close(&port->dev);
 		goto done;
 	} else {
+		spa_zero(info);
 		if ((res = spa_format_parse(format, &info.media_type, &info.media_subtype)) < 0)
 			return res;
 
@@ -681,6 +713,17 @@ static int port_set_format(struct impl *this, struct port *port,
 		}
 	}
 
+	if (port->have_format) {
+		spa_v4l2_stream_off(this);
+		/* keep the imported buffers when the format does not change */
+		if (!SPA_FLAG_IS_SET(flags, SPA_NODE_PARAM_FLAG_TEST_ONLY) &&
+		    memcmp(&info, &port->current_format, sizeof(info)) == 0) {
+			spa_log_debug(this->log, "%p: format unchanged", this);
+			goto done;
+		}
+		spa_v4l2_clear_buffers(this);
+	}
+
 	if (port->have_format && !SPA_FLAG_IS_SET(flags, SPA_NODE_PARAM_FLAG_TEST_ONLY)) {
 		port->have_format = false;
 	}
@@ -770,7 +813,11 @@ static int impl_node_port_use_buffers(void *object,
 
 	if (port->n_buffers) {
 		spa_v4l2_stream_off(this);
-		if ((res = spa_v4l2_clear_buffers(this)) < 0)
+		if (port->memtype == V4L2_MEMORY_DMABUF)
+			res = spa_v4l2_detach_buffers(this);
+		else
+			res = spa_v4l2_clear_buffers(this);
+		if (res < 0)
 			return res;
 	}
 	if (n_buffers > 0 && !port->have_format)
@@ -1026,6 +1073,9 @@ impl_init(const struct spa_handle_factory *factory,
 	port->dev.log = this->log;
 	port->dev.fd = -1;
 
+	if (info && (str = spa_dict_lookup(info, SPA_KEY_API_V4L2_IMPORT_DMABUF)))
+		port->import_dmabuf = spa_atob(str);
+
 	if (info && (str = spa_dict_lookup(info, SPA_KEY_API_V4L2_PATH))) {
 		strncpy(this->props.device, str, 63);
 		if ((res = spa_v4l2_open(&port->dev, this->props.device)) < 0)
@@ -10,6 +10,7 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <poll.h>
+#include <time.h>
 
 #include <spa/utils/result.h>
 
@@ -128,7 +129,7 @@ static int spa_v4l2_clear_buffers(struct impl *this)
 	struct v4l2_requestbuffers reqbuf;
 	uint32_t i;
 
-	if (port->n_buffers == 0)
+	if (port->n_buffers == 0 && port->n_pool == 0)
 		return 0;
 
 	for (i = 0; i < port->n_buffers; i++) {
@@ -161,6 +162,31 @@ static int spa_v4l2_clear_buffers(struct impl *this)
 		spa_log_warn(this->log, "VIDIOC_REQBUFS: %m");
 	}
 	port->n_buffers = 0;
+	port->n_pool = 0;
+
+	return 0;
+}
+
+/* Forget the buffers but keep the imported dmabufs allocated in the
+ * driver so that they can be reused without remapping */
+static int spa_v4l2_detach_buffers(struct impl *this)
+{
+	struct port *port = &this->out_ports[0];
+	enum v4l2_buf_type type;
+
+	if (port->n_buffers == 0)
+		return 0;
+
+	/* return all queued buffers to us */
+	type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (xioctl(port->dev.fd, VIDIOC_STREAMOFF, &type) < 0) {
+		spa_log_warn(this->log, "VIDIOC_STREAMOFF: %m");
+		return spa_v4l2_clear_buffers(this);
+	}
+	spa_log_debug(this->log, "detach %d buffers, keep %d in pool",
+			port->n_buffers, port->n_pool);
+	port->n_buffers = 0;
+	spa_list_init(&port->queue);
 
 	return 0;
 }
@@ -906,6 +932,18 @@ static int probe_expbuf(struct impl *this)
 		spa_log_error(this->log, "'%s' VIDIOC_REQBUFS: %m", this->props.device);
 		return -errno;
 	}
+
+	/* drivers that can import dmabufs accept a request for 0 of them */
+	reqbuf.memory = V4L2_MEMORY_DMABUF;
+	reqbuf.count = 0;
+	port->have_dmabuf = xioctl(dev->fd, VIDIOC_REQBUFS, &reqbuf) == 0;
+	if (!port->have_dmabuf)
+		spa_log_info(this->log, "'%s' DMABUF import not supported: %m", this->props.device);
+
+	/* let the consumer allocate the buffers when we want to import them */
+	if (port->import_dmabuf && port->have_dmabuf)
+		port->alloc_buffers = false;
+
 	return 0;
 }
 
@@ -1354,6 +1392,30 @@ done:
 	return res;
 }
 
+static void update_latency_stats(struct impl *this, struct port *port, uint64_t latency)
+{
+	struct latency_stats *s = &port->stats;
+	uint32_t fps;
+
+	if (s->count == 0 || latency < s->min)
+		s->min = latency;
+	if (s->count == 0 || latency > s->max)
+		s->max = latency;
+	s->total += latency;
+	s->count++;
+
+	spa_log_trace(this->log, "v4l2 %p: capture latency %"PRIu64" ns", this, latency);
+
+	/* summarize about once per second */
+	fps = port->rate.num ? port->rate.denom / port->rate.num : 0;
+	if (s->count >= SPA_MAX(fps, 1u)) {
+		spa_log_debug(this->log, "'%s' capture latency min:%"PRIu64" avg:%"PRIu64
+				" max:%"PRIu64" ns over %u frames", this->props.device,
+				s->min, s->total / s->count, s->max, s->count);
+		spa_zero(*s);
+	}
+}
+
 static int mmap_read(struct impl *this)
 {
 	struct port *port = &this->out_ports[0];
@@ -1370,9 +1432,20 @@ static int mmap_read(struct impl *this)
 	if (xioctl(dev->fd, VIDIOC_DQBUF, &buf) < 0)
 		return -errno;
 
+	if (buf.index >= MAX_BUFFERS)
+		return -EIO;
+
 	pts = SPA_TIMEVAL_TO_NSEC(&buf.timestamp);
 	spa_log_trace(this->log, "v4l2 %p: have output %d", this, buf.index);
 
+	/* the time from the capture of the first byte to now */
+	if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (SPA_TIMESPEC_TO_NSEC(&now) >= pts)
+			update_latency_stats(this, port, SPA_TIMESPEC_TO_NSEC(&now) - pts);
+	}
+
 	if (this->clock) {
 		/* FIXME, we should follow the driver clock and target_ values.
 		 * for now we ignore and use our own. */
@@ -1388,7 +1461,7 @@ static int mmap_read(struct impl *this)
 		this->clock->next_nsec = pts + 1000000000LL / port->rate.denom;
 	}
 
-	b = &port->buffers[buf.index];
+	b = &port->buffers[port->index_map[buf.index]];
 	if (b->h) {
 		b->h->flags = 0;
 		if (buf.flags & V4L2_BUF_FLAG_ERROR)
@@ -1459,45 +1532,112 @@ static void v4l2_on_fd_events(struct spa_source *source)
 	spa_node_call_ready(&this->callbacks, SPA_STATUS_HAVE_DATA);
 }
 
+static int get_pool_entry(int fd, struct pool_entry *e)
+{
+	struct stat st;
+
+	if (fstat(fd, &st) < 0)
+		return errno ? -errno : -EIO;
+	e->dev = st.st_dev;
+	e->ino = st.st_ino;
+	return 0;
+}
+
+/* find the v4l2 index that each dmabuf had in the previous set of buffers */
+static bool match_pool(struct impl *this, struct spa_buffer **buffers, uint32_t n_buffers,
+		uint32_t *index)
+{
+	struct port *port = &this->out_ports[0];
+	uint32_t i, j, used = 0;
+	struct pool_entry e = { 0 };
+
+	if (port->memtype != V4L2_MEMORY_DMABUF || port->n_pool != n_buffers)
+		return false;
+
+	for (i = 0; i < n_buffers; i++) {
+		if (get_pool_entry(buffers[i]->datas[0].fd, &e) < 0)
+			return false;
+		for (j = 0; j < port->n_pool; j++) {
+			if (!SPA_FLAG_IS_SET(used, 1u << j) &&
+			    port->pool[j].dev == e.dev && port->pool[j].ino == e.ino)
+				break;
+		}
+		if (j == port->n_pool)
+			return false;
+		SPA_FLAG_SET(used, 1u << j);
+		index[i] = j;
+	}
+	return true;
+}
+
 static int spa_v4l2_use_buffers(struct impl *this, struct spa_buffer **buffers, uint32_t n_buffers)
 {
 	struct port *port = &this->out_ports[0];
 	struct spa_v4l2_device *dev = &port->dev;
 	struct v4l2_requestbuffers reqbuf;
-	unsigned int i;
+	enum v4l2_memory memtype = port->memtype;
+	uint32_t i, index[MAX_BUFFERS];
 	struct spa_data *d;
+	bool reuse = false;
 
 	if (n_buffers > 0) {
 		d = buffers[0]->datas;
 
 		if (d[0].type == SPA_DATA_MemFd ||
 		    (d[0].type == SPA_DATA_MemPtr && d[0].data != NULL)) {
-			port->memtype = V4L2_MEMORY_USERPTR;
+			memtype = V4L2_MEMORY_USERPTR;
 		} else if (d[0].type == SPA_DATA_DmaBuf) {
-			port->memtype = V4L2_MEMORY_DMABUF;
+			memtype = V4L2_MEMORY_DMABUF;
 		} else {
 			spa_log_error(this->log, "can't use buffers of type %d", d[0].type);
 			return -EINVAL;
 		}
 	}
+	for (i = 0; i < n_buffers; i++) {
+		if (buffers[i]->n_datas < 1) {
+			spa_log_error(this->log, "invalid memory on buffer %p", buffers[i]);
+			return -EINVAL;
+		}
+		d = buffers[i]->datas;
+		if (d[0].type != buffers[0]->datas[0].type) {
+			spa_log_error(this->log, "buffer %d has type %d, expected %d", i,
+					d[0].type, buffers[0]->datas[0].type);
+			return -EINVAL;
+		}
+		if (d[0].maxsize < port->fmt.fmt.pix.sizeimage) {
+			spa_log_error(this->log, "buffer %d too small %d < %d", i,
+					d[0].maxsize, port->fmt.fmt.pix.sizeimage);
+			return -EINVAL;
+		}
+	}
 
-	spa_zero(reqbuf);
-	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	reqbuf.memory = port->memtype;
-	reqbuf.count = n_buffers;
+	if (memtype == V4L2_MEMORY_DMABUF)
+		reuse = match_pool(this, buffers, n_buffers, index);
 
-	if (xioctl(dev->fd, VIDIOC_REQBUFS, &reqbuf) < 0) {
-		spa_log_error(this->log, "'%s' VIDIOC_REQBUFS %m", this->props.device);
-		return -errno;
-	}
-	spa_log_debug(this->log, "got %d buffers", reqbuf.count);
-	if (reqbuf.count < n_buffers) {
-		spa_log_error(this->log, "'%s' can't allocate enough buffers %d < %d",
-				this->props.device, reqbuf.count, n_buffers);
-		return -ENOMEM;
+	if (!reuse) {
+		spa_v4l2_clear_buffers(this);
+		port->memtype = memtype;
+
+		spa_zero(reqbuf);
+		reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		reqbuf.memory = port->memtype;
+		reqbuf.count = n_buffers;
+
+		if (xioctl(dev->fd, VIDIOC_REQBUFS, &reqbuf) < 0) {
+			spa_log_error(this->log, "'%s' VIDIOC_REQBUFS %m", this->props.device);
+			return -errno;
+		}
+		spa_log_debug(this->log, "got %d buffers", reqbuf.count);
+		if (reqbuf.count < n_buffers) {
+			spa_log_error(this->log, "'%s' can't allocate enough buffers %d < %d",
+					this->props.device, reqbuf.count, n_buffers);
+			return -ENOMEM;
+		}
+		for (i = 0; i < n_buffers; i++)
+			index[i] = i;
 	}
 
-	for (i = 0; i < reqbuf.count; i++) {
+	for (i = 0; i < n_buffers; i++) {
 		struct buffer *b;
 
 		b = &port->buffers[i];
@@ -1505,19 +1645,16 @@ static int spa_v4l2_use_buffers(struct impl *this, struct spa_buffer **buffers,
 		b->outbuf = buffers[i];
 		b->flags = BUFFER_FLAG_OUTSTANDING;
 		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+		port->index_map[index[i]] = i;
 
 		spa_log_debug(this->log, "import buffer %p", buffers[i]);
 
-		if (buffers[i]->n_datas < 1) {
-			spa_log_error(this->log, "invalid memory on buffer %p", buffers[i]);
-			return -EINVAL;
-		}
 		d = buffers[i]->datas;
 
 		spa_zero(b->v4l2_buffer);
 		b->v4l2_buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 		b->v4l2_buffer.memory = port->memtype;
-		b->v4l2_buffer.index = i;
+		b->v4l2_buffer.index = index[i];
 
 		if (port->memtype == V4L2_MEMORY_USERPTR) {
 			if (d[0].data == NULL) {
@@ -1542,6 +1679,9 @@ static int spa_v4l2_use_buffers(struct impl *this, struct spa_buffer **buffers,
 		}
 		else if (port->memtype == V4L2_MEMORY_DMABUF) {
 			b->v4l2_buffer.m.fd = d[0].fd;
+			b->v4l2_buffer.length = d[0].maxsize;
+			if (!reuse && get_pool_entry(d[0].fd, &port->pool[i]) < 0)
+				spa_log_warn(this->log, "can't stat dmabuf %"PRIi64": %m", d[0].fd);
 		}
 		else {
 			spa_log_error(this->log, "invalid port memory %d",
@@ -1551,7 +1691,12 @@ static int spa_v4l2_use_buffers(struct impl *this, struct spa_buffer **buffers,
 
 		spa_v4l2_buffer_recycle(this, i);
 	}
-	port->n_buffers = reqbuf.count;
+	port->n_buffers = n_buffers;
+	port->n_pool = port->memtype == V4L2_MEMORY_DMABUF ? n_buffers : 0;
+
+	spa_log_info(this->log, "%s: have %u buffers using %s%s", dev->path, n_buffers,
+			port->memtype == V4L2_MEMORY_DMABUF ? "DMABUF" : "USERPTR",
+			reuse ? " (reused)" : "");
 
 	return 0;
 }
@@ -1600,6 +1745,7 @@ mmap_init(struct impl *this,
 		b->outbuf = buffers[i];
 		b->flags = BUFFER_FLAG_OUTSTANDING;
 		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+		port->index_map[i] = i;
 
 		spa_zero(b->v4l2_buffer);
 		b->v4l2_buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -1713,6 +1859,8 @@ spa_v4l2_alloc_buffers(struct impl *this,
 	if (port->n_buffers > 0)
 		return -EIO;
 
+	spa_v4l2_clear_buffers(this);
+
 	if (dev->cap.capabilities & V4L2_CAP_STREAMING) {
 		if ((res = mmap_init(this, buffers, n_buffers)) < 0)
 			if ((res = userptr_init(this)) < 0)
@@ -0,0 +1,181 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "test-helper.h"
+#include "video-ops.h"
+
+static uint32_t cpu_flags;
+
+struct stats {
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_COUNT 20
+
+static const struct {
+	uint32_t width, height;
+} sizes[] = { { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sizes) * 40
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+struct frame {
+	struct video_layout layout;
+	void *data;
+	struct video_frame f;
+};
+
+static void frame_init(struct frame *fr, uint32_t format, uint32_t width, uint32_t height)
+{
+	uint32_t i;
+
+	spa_assert_se(video_layout_init(format, width, height, 0, &fr->layout) == 0);
+	spa_assert_se(posix_memalign(&fr->data, VIDEO_OPS_MAX_ALIGN, fr->layout.size) == 0);
+	memset(fr->data, 0x80, fr->layout.size);
+	for (i = 0; i < fr->layout.n_planes; i++) {
+		fr->f.data[i] = SPA_PTROFF(fr->data, fr->layout.offset[i], void);
+		fr->f.stride[i] = fr->layout.stride[i];
+	}
+}
+
+static void run_test1(const char *name, uint32_t flags, uint32_t src_fmt,
+		uint32_t src_width, uint32_t src_height, uint32_t dst_fmt,
+		uint32_t dst_width, uint32_t dst_height)
+{
+	int i;
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct convert conv;
+	struct frame src, dst;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = src_width;
+	conv.src_height = src_height;
+	conv.dst_width = dst_width;
+	conv.dst_height = dst_height;
+	conv.cpu_flags = flags;
+	spa_assert_se(convert_init(&conv) == 0);
+
+	frame_init(&src, src_fmt, src_width, src_height);
+	frame_init(&dst, dst_fmt, dst_width, dst_height);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		convert_process(&conv, &dst.f, &src.f);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.src_width = src_width,
+		.src_height = src_height,
+		.dst_width = dst_width,
+		.dst_height = dst_height,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = conv.kernel_name
+	};
+	convert_free(&conv);
+	free(src.data);
+	free(dst.data);
+}
+
+/* run with the C kernels and with the best kernels for this cpu */
+static void run_test(const char *name, uint32_t src_fmt, uint32_t dst_fmt, bool scale)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(sizes, s) {
+		uint32_t dw = scale ? s->width * 2 / 3 : s->width;
+		uint32_t dh = scale ? s->height * 2 / 3 : s->height;
+
+		run_test1(name, 0, src_fmt, s->width, s->height, dst_fmt, dw, dh);
+		if (cpu_flags != 0)
+			run_test1(name, cpu_flags, src_fmt, s->width, s->height, dst_fmt, dw, dh);
+	}
+}
+
+static void test_yuv_rgb(void)
+{
+	run_test("test_i420_bgrx", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_BGRx, false);
+	run_test("test_nv12_rgba", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_RGBA, false);
+	run_test("test_yuy2_bgrx", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_BGRx, false);
+}
+
+static void test_rgb_yuv(void)
+{
+	run_test("test_bgrx_i420", SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_I420, false);
+	run_test("test_rgba_nv12", SPA_VIDEO_FORMAT_RGBA, SPA_VIDEO_FORMAT_NV12, false);
+	run_test("test_bgrx_yuy2", SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_YUY2, false);
+}
+
+static void test_yuv_yuv(void)
+{
+	run_test("test_yuy2_i420", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, false);
+	run_test("test_nv12_i420", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_I420, false);
+}
+
+static void test_scale(void)
+{
+	run_test("test_bgrx_bgrx_scale", SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_BGRx, true);
+	run_test("test_i420_i420_scale", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_I420, true);
+	run_test("test_nv12_bgrx_scale", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_BGRx, true);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->src_width - b->src_width) != 0) return diff;
+	if ((diff = a->src_height - b->src_height) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	test_yuv_rgb();
+	test_rgb_yuv();
+	test_yuv_yuv();
+	test_scale();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t %dx%d -> %dx%d\n",
+				s->perf, s->name, s->impl, s->src_width, s->src_height,
+				s->dst_width, s->dst_height);
+	}
+	return 0;
+}
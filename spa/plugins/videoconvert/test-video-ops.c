@@ -0,0 +1,419 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <spa/debug/mem.h>
+
+#include "test-helper.h"
+#include "video-ops.c"
+
+#define MAX_WIDTH	333u
+
+static uint32_t cpu_flags;
+
+struct frame {
+	struct video_layout layout;
+	uint8_t *data;
+	struct video_frame f;
+};
+
+static void frame_init(struct frame *fr, uint32_t format, uint32_t width, uint32_t height)
+{
+	uint32_t i;
+
+	spa_assert_se(video_layout_init(format, width, height, 0, &fr->layout) == 0);
+	fr->data = calloc(1, fr->layout.size);
+	spa_assert_se(fr->data != NULL);
+	for (i = 0; i < fr->layout.n_planes; i++) {
+		fr->f.data[i] = fr->data + fr->layout.offset[i];
+		fr->f.stride[i] = fr->layout.stride[i];
+	}
+}
+
+static void frame_clear(struct frame *fr)
+{
+	free(fr->data);
+}
+
+static void convert_frame(struct frame *dst, uint32_t dst_fmt, uint32_t dst_width,
+		uint32_t dst_height, struct frame *src, uint32_t src_fmt,
+		uint32_t src_width, uint32_t src_height, uint32_t flags)
+{
+	struct convert conv;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = src_width;
+	conv.src_height = src_height;
+	conv.dst_width = dst_width;
+	conv.dst_height = dst_height;
+	conv.color_matrix = SPA_VIDEO_COLOR_MATRIX_BT601;
+	conv.color_range = SPA_VIDEO_COLOR_RANGE_16_235;
+	conv.cpu_flags = flags;
+	spa_assert_se(convert_init(&conv) == 0);
+	convert_process(&conv, &dst->f, &src->f);
+	convert_free(&conv);
+}
+
+static void compare_mem(const char *name, uint32_t width, const void *m1,
+		const void *m2, size_t size)
+{
+	int res = memcmp(m1, m2, size);
+	if (res != 0) {
+		fprintf(stderr, "%s %d %zd:\n", name, width, size);
+		spa_debug_mem(0, m1, size);
+		spa_debug_mem(0, m2, size);
+	}
+	spa_assert_se(res == 0);
+}
+
+static void fill_random(uint8_t *data, size_t size)
+{
+	size_t i;
+	for (i = 0; i < size; i++)
+		data[i] = random();
+}
+
+static void test_layout(void)
+{
+	struct video_layout l;
+
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_I420, 640, 480, 0, &l) == 0);
+	spa_assert_se(l.n_planes == 3);
+	spa_assert_se(l.stride[0] == 640);
+	spa_assert_se(l.stride[1] == 320);
+	spa_assert_se(l.offset[1] == 640 * 480);
+	spa_assert_se(l.offset[2] == 640 * 480 + 320 * 240);
+	spa_assert_se(l.height[0] == 480);
+	spa_assert_se(l.height[1] == 240);
+	spa_assert_se(l.height[2] == 240);
+	spa_assert_se(l.size == 640 * 480 * 3 / 2);
+
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_NV12, 33, 17, 0, &l) == 0);
+	spa_assert_se(l.n_planes == 2);
+	spa_assert_se(l.stride[0] == 36);
+	spa_assert_se(l.stride[1] == 36);
+	spa_assert_se(l.height[1] == 9);
+	spa_assert_se(l.size == 36 * 17 + 36 * 9);
+
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_YUY2, 33, 2, 0, &l) == 0);
+	spa_assert_se(l.stride[0] == 68);
+
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_BGRx, 10, 10, 32, &l) == -EINVAL);
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_BGRx, 0, 10, 0, &l) == -EINVAL);
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_ENCODED, 10, 10, 0, &l) == -ENOTSUP);
+
+	/* a stride from the peer that makes the size wrap around */
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_YUY2, 1920, 1080, 3976822, &l) == -EINVAL);
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_I420, 1920, 1080, 2652524, &l) == -EINVAL);
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_NV12, 16, 1, UINT32_MAX, &l) == -EINVAL);
+	spa_assert_se(video_layout_init(SPA_VIDEO_FORMAT_YUY2, 1920, 1080, 3976821, &l) == 0);
+	spa_assert_se(l.size == 3976821u * 1080u);
+}
+
+/* the SIMD kernels must give the same result as the C kernels */
+static void test_kernels(const struct kernel_info *k)
+{
+	static uint8_t y[2][MAX_WIDTH + 64], u[MAX_WIDTH + 64], v[MAX_WIDTH + 64];
+	static uint8_t rgba[2][(MAX_WIDTH + 64) * 4], out[2][(MAX_WIDTH + 64) * 4];
+	static const uint32_t widths[] = { 1, 2, 7, 15, 16, 17, 31, 32, 33, 64, 100, MAX_WIDTH };
+	struct convert conv;
+	uint32_t i, j, w;
+
+	spa_zero(conv);
+	conv.color_range = SPA_VIDEO_COLOR_RANGE_16_235;
+	matrix_init(&conv, 480);
+
+	fprintf(stderr, "test kernels %s\n", k->name);
+
+	SPA_FOR_EACH_ELEMENT_VAR(widths, wp) {
+		w = *wp;
+
+		for (i = 0; i < 2; i++) {
+			fill_random(y[0], sizeof(y[0]));
+			fill_random(u, sizeof(u));
+			fill_random(v, sizeof(v));
+			conv_yuv_to_rgba_c(&conv, out[0], y[0], u, v, w, i);
+			k->yuv_to_rgba(&conv, out[1], y[0], u, v, w, i);
+			compare_mem("yuv_to_rgba", w, out[0], out[1], w * 4);
+		}
+		for (i = 0; i < 4; i++) {
+			bool swap = i & 1, two = i & 2;
+			uint8_t y0[MAX_WIDTH], y1[MAX_WIDTH], u0[MAX_WIDTH], v0[MAX_WIDTH];
+
+			fill_random(rgba[0], sizeof(rgba[0]));
+			fill_random(rgba[1], sizeof(rgba[1]));
+			conv_rgba_to_yuv_c(&conv, y[0], two ? y[1] : NULL, u, v,
+					rgba[0], two ? rgba[1] : NULL, w, swap);
+			k->rgba_to_yuv(&conv, y0, two ? y1 : NULL, u0, v0,
+					rgba[0], two ? rgba[1] : NULL, w, swap);
+			compare_mem("rgba_to_yuv y0", w, y[0], y0, w);
+			if (two)
+				compare_mem("rgba_to_yuv y1", w, y[1], y1, w);
+			compare_mem("rgba_to_yuv u", w, u, u0, (w + 1) / 2);
+			compare_mem("rgba_to_yuv v", w, v, v0, (w + 1) / 2);
+		}
+		for (i = 0; i < 2; i++) {
+			uint8_t y0[MAX_WIDTH + 1], u0[MAX_WIDTH], v0[MAX_WIDTH];
+
+			fill_random(rgba[0], sizeof(rgba[0]));
+			conv_split_yuyv_c(y[0], u, v, rgba[0], w, i);
+			k->split_yuyv(y0, u0, v0, rgba[0], w, i);
+			compare_mem("split_yuyv y", w, y[0], y0, w);
+			compare_mem("split_yuyv u", w, u, u0, (w + 1) / 2);
+			compare_mem("split_yuyv v", w, v, v0, (w + 1) / 2);
+
+			conv_merge_yuyv_c(out[0], y[0], u, v, w, i);
+			k->merge_yuyv(out[1], y[0], u, v, w, i);
+			compare_mem("merge_yuyv", w, out[0], out[1], SPA_ROUND_UP_N(w, 2) * 2);
+			compare_mem("merge_yuyv roundtrip", w, out[0], rgba[0], SPA_ROUND_UP_N(w, 2) * 2);
+		}
+
+		fill_random(rgba[0], sizeof(rgba[0]));
+		conv_split_uv_c(u, v, rgba[0], w);
+		k->split_uv(y[0], y[1], rgba[0], w);
+		compare_mem("split_uv u", w, u, y[0], w);
+		compare_mem("split_uv v", w, v, y[1], w);
+		k->merge_uv(out[0], u, v, w);
+		compare_mem("merge_uv", w, out[0], rgba[0], w * 2);
+
+		fill_random(rgba[0], sizeof(rgba[0]));
+		fill_random(rgba[1], sizeof(rgba[1]));
+		for (j = 0; j < 256; j += 51) {
+			conv_scale_v_c(out[0], rgba[0], rgba[1], w * 4, j);
+			k->scale_v(out[1], rgba[0], rgba[1], w * 4, j);
+			compare_mem("scale_v", w, out[0], out[1], w * 4);
+		}
+	}
+
+	/* scale 333 pixels to other widths */
+	conv.x_offset = calloc(MAX_WIDTH * 2, sizeof(uint32_t));
+	conv.x_weight = calloc(MAX_WIDTH * 2, sizeof(uint16_t));
+	SPA_FOR_EACH_ELEMENT_VAR(widths, wp) {
+		uint32_t weight, dst_width = *wp * 2;
+
+		for (i = 0; i < dst_width; i++) {
+			conv.x_offset[i] = scale_pos(i, MAX_WIDTH, dst_width, &weight);
+			conv.x_weight[i] = weight;
+		}
+		fill_random(rgba[0], sizeof(rgba[0]));
+		conv_scale_h_c(&conv, (uint32_t*)out[0], (const uint32_t*)rgba[0], SPA_MIN(dst_width, MAX_WIDTH));
+		k->scale_h(&conv, (uint32_t*)out[1], (const uint32_t*)rgba[0], SPA_MIN(dst_width, MAX_WIDTH));
+		compare_mem("scale_h", dst_width, out[0], out[1], SPA_MIN(dst_width, MAX_WIDTH) * 4);
+	}
+	free(conv.x_offset);
+	free(conv.x_weight);
+}
+
+static void test_all_kernels(void)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(kernel_table, k) {
+		if (MATCH_CPU_FLAGS(k->cpu_flags, cpu_flags))
+			test_kernels(k);
+	}
+}
+
+static void check_rgba(const uint8_t *p, int r, int g, int b)
+{
+	if (abs(p[0] - r) > 1 || abs(p[1] - g) > 1 || abs(p[2] - b) > 1) {
+		fprintf(stderr, "got %d %d %d expected %d %d %d\n", p[0], p[1], p[2], r, g, b);
+		spa_assert_not_reached();
+	}
+}
+
+/* BT601 limited range values */
+static const struct {
+	uint8_t r, g, b;
+	uint8_t y, u, v;
+} colors[] = {
+	{ 255, 255, 255, 235, 128, 128 },
+	{   0,   0,   0,  16, 128, 128 },
+	{ 255,   0,   0,  81,  90, 240 },
+	{   0, 255,   0, 145,  54,  34 },
+	{   0,   0, 255,  41, 240, 110 },
+	{ 128, 128, 128, 126, 128, 128 },
+};
+
+static void test_colors(void)
+{
+	struct frame yuv, rgba;
+	uint32_t i, j;
+
+	for (i = 0; i < SPA_N_ELEMENTS(colors); i++) {
+		frame_init(&yuv, SPA_VIDEO_FORMAT_I420, 64, 4);
+		frame_init(&rgba, SPA_VIDEO_FORMAT_RGBA, 64, 4);
+
+		memset(yuv.f.data[0], colors[i].y, 64 * 4);
+		memset(yuv.f.data[1], colors[i].u, 32 * 2);
+		memset(yuv.f.data[2], colors[i].v, 32 * 2);
+		convert_frame(&rgba, SPA_VIDEO_FORMAT_RGBA, 64, 4,
+				&yuv, SPA_VIDEO_FORMAT_I420, 64, 4, cpu_flags);
+		for (j = 0; j < 64 * 4; j++)
+			check_rgba(&rgba.data[j * 4], colors[i].r, colors[i].g, colors[i].b);
+
+		memset(yuv.data, 0, yuv.layout.size);
+		convert_frame(&yuv, SPA_VIDEO_FORMAT_I420, 64, 4,
+				&rgba, SPA_VIDEO_FORMAT_RGBA, 64, 4, cpu_flags);
+		for (j = 0; j < 64 * 4; j++)
+			spa_assert_se(abs(yuv.data[j] - colors[i].y) <= 1);
+		for (j = 0; j < 32 * 2; j++) {
+			spa_assert_se(abs(((uint8_t*)yuv.f.data[1])[j] - colors[i].u) <= 1);
+			spa_assert_se(abs(((uint8_t*)yuv.f.data[2])[j] - colors[i].v) <= 1);
+		}
+		frame_clear(&yuv);
+		frame_clear(&rgba);
+	}
+}
+
+static const uint32_t formats[] = {
+	SPA_VIDEO_FORMAT_RGBA, SPA_VIDEO_FORMAT_BGRA, SPA_VIDEO_FORMAT_ARGB,
+	SPA_VIDEO_FORMAT_ABGR, SPA_VIDEO_FORMAT_RGBx, SPA_VIDEO_FORMAT_BGRx,
+	SPA_VIDEO_FORMAT_xRGB, SPA_VIDEO_FORMAT_xBGR, SPA_VIDEO_FORMAT_RGB,
+	SPA_VIDEO_FORMAT_BGR, SPA_VIDEO_FORMAT_DSP_F32, SPA_VIDEO_FORMAT_GRAY8,
+	SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_YV12, SPA_VIDEO_FORMAT_NV12,
+	SPA_VIDEO_FORMAT_NV21, SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_YVYU,
+	SPA_VIDEO_FORMAT_UYVY,
+};
+
+/* convert a gray frame between all formats and sizes, the color must stay
+ * the same */
+static void test_all_formats(void)
+{
+	struct frame src, mid, dst;
+	uint32_t i, j, k, n;
+	static const struct {
+		uint32_t width, height;
+	} sizes[] = { { 37, 11 }, { 37, 11 }, { 80, 20 }, { 19, 7 } };
+
+	for (i = 0; i < SPA_N_ELEMENTS(formats); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(formats); j++) {
+			for (k = 1; k < SPA_N_ELEMENTS(sizes); k++) {
+				uint32_t sw = sizes[0].width, sh = sizes[0].height;
+				uint32_t dw = sizes[k].width, dh = sizes[k].height;
+
+				frame_init(&src, SPA_VIDEO_FORMAT_RGBA, sw, sh);
+				frame_init(&mid, formats[i], sw, sh);
+				frame_init(&dst, formats[j], dw, dh);
+				memset(src.data, 0xa0, src.layout.size);
+
+				convert_frame(&mid, formats[i], sw, sh,
+						&src, SPA_VIDEO_FORMAT_RGBA, sw, sh, cpu_flags);
+				convert_frame(&dst, formats[j], dw, dh,
+						&mid, formats[i], sw, sh, cpu_flags);
+
+				frame_clear(&src);
+				frame_init(&src, SPA_VIDEO_FORMAT_RGBA, dw, dh);
+				convert_frame(&src, SPA_VIDEO_FORMAT_RGBA, dw, dh,
+						&dst, formats[j], dw, dh, cpu_flags);
+
+				for (n = 0; n < dw * dh; n++) {
+					const uint8_t *p = &src.data[n * 4];
+					if (abs(p[0] - 0xa0) > 2 || abs(p[1] - 0xa0) > 2 ||
+					    abs(p[2] - 0xa0) > 2) {
+						fprintf(stderr, "%d -> %d %dx%d: %d %d %d\n",
+								formats[i], formats[j], dw, dh,
+								p[0], p[1], p[2]);
+						spa_assert_not_reached();
+					}
+				}
+				frame_clear(&src);
+				frame_clear(&mid);
+				frame_clear(&dst);
+			}
+		}
+	}
+}
+
+/* the SIMD and C paths must produce the same frames */
+static void test_simd_frames(void)
+{
+	struct frame src, dst[2];
+	uint32_t i, j;
+
+	for (i = 0; i < SPA_N_ELEMENTS(formats); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(formats); j++) {
+			frame_init(&src, formats[i], 97, 9);
+			frame_init(&dst[0], formats[j], 131, 13);
+			frame_init(&dst[1], formats[j], 131, 13);
+			fill_random(src.data, src.layout.size);
+			if (formats[i] == SPA_VIDEO_FORMAT_DSP_F32) {
+				float *f = (float*)src.data;
+				uint32_t n;
+				for (n = 0; n < src.layout.size / sizeof(float); n++)
+					f[n] = (random() % 1000) / 999.0f;
+			}
+			convert_frame(&dst[0], formats[j], 131, 13,
+					&src, formats[i], 97, 9, 0);
+			convert_frame(&dst[1], formats[j], 131, 13,
+					&src, formats[i], 97, 9, cpu_flags);
+			compare_mem("frame", j, dst[0].data, dst[1].data, dst[0].layout.size);
+
+			convert_frame(&dst[0], formats[j], 97, 9,
+					&src, formats[i], 97, 9, 0);
+			convert_frame(&dst[1], formats[j], 97, 9,
+					&src, formats[i], 97, 9, cpu_flags);
+			compare_mem("frame", j, dst[0].data, dst[1].data, dst[0].layout.size);
+
+			frame_clear(&src);
+			frame_clear(&dst[0]);
+			frame_clear(&dst[1]);
+		}
+	}
+}
+
+static void test_scale(void)
+{
+	struct frame src, dst;
+
+	/* a 2 pixel ramp scaled to 4 pixels */
+	frame_init(&src, SPA_VIDEO_FORMAT_GRAY8, 2, 1);
+	frame_init(&dst, SPA_VIDEO_FORMAT_GRAY8, 4, 1);
+	src.data[0] = 0;
+	src.data[1] = 200;
+	convert_frame(&dst, SPA_VIDEO_FORMAT_GRAY8, 4, 1,
+			&src, SPA_VIDEO_FORMAT_GRAY8, 2, 1, cpu_flags);
+	spa_assert_se(dst.data[0] == 0);
+	spa_assert_se(dst.data[1] == 50);
+	spa_assert_se(dst.data[2] == 150);
+	spa_assert_se(dst.data[3] == 200);
+	frame_clear(&src);
+	frame_clear(&dst);
+
+	/* and vertically */
+	frame_init(&src, SPA_VIDEO_FORMAT_GRAY8, 1, 2);
+	frame_init(&dst, SPA_VIDEO_FORMAT_GRAY8, 1, 4);
+	src.data[0] = 0;
+	src.data[4] = 200;
+	convert_frame(&dst, SPA_VIDEO_FORMAT_GRAY8, 1, 4,
+			&src, SPA_VIDEO_FORMAT_GRAY8, 1, 2, cpu_flags);
+	spa_assert_se(dst.data[0] == 0);
+	spa_assert_se(dst.data[4] == 50);
+	spa_assert_se(dst.data[8] == 150);
+	spa_assert_se(dst.data[12] == 200);
+	frame_clear(&src);
+	frame_clear(&dst);
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_flags = get_cpu_flags();
+	printf("got CPU flags %d\n", cpu_flags);
+
+	test_layout();
+	test_all_kernels();
+	test_colors();
+	test_all_formats();
+	test_simd_frames();
+	test_scale();
+
+	return 0;
+}
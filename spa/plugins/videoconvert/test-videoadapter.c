@@ -0,0 +1,288 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <spa/utils/names.h>
+#include <spa/utils/string.h>
+#include <spa/support/plugin.h>
+#include <spa/param/param.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/pod/filter.h>
+#include <spa/support/log-impl.h>
+
+SPA_LOG_IMPL(logger);
+
+/* a source that only has a fixed list of formats */
+struct follower {
+	struct spa_node node;
+	struct spa_hook_list hooks;
+	const uint32_t *subtypes;
+	uint32_t n_subtypes;
+};
+
+struct context {
+	struct follower follower;
+
+	struct spa_handle *adapter_handle;
+	struct spa_node *adapter_node;
+};
+
+static int follower_add_listener(void *object, struct spa_hook *listener,
+		const struct spa_node_events *events, void *data)
+{
+	struct follower *this = object;
+	struct spa_hook_list save;
+	struct spa_node_info info = SPA_NODE_INFO_INIT();
+	struct spa_port_info port_info = SPA_PORT_INFO_INIT();
+	struct spa_param_info params[1];
+
+	spa_hook_list_isolate(&this->hooks, &save, listener, events, data);
+
+	info.max_output_ports = 1;
+	info.change_mask = SPA_NODE_CHANGE_MASK_FLAGS;
+	spa_node_emit_info(&this->hooks, &info);
+
+	params[0] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port_info.change_mask = SPA_PORT_CHANGE_MASK_PARAMS;
+	port_info.params = params;
+	port_info.n_params = 1;
+	spa_node_emit_port_info(&this->hooks, SPA_DIRECTION_OUTPUT, 0, &port_info);
+
+	spa_hook_list_join(&this->hooks, &save);
+	return 0;
+}
+
+static int follower_set_callbacks(void *object,
+		const struct spa_node_callbacks *callbacks, void *data)
+{
+	return 0;
+}
+
+static int follower_enum_params(void *object, int seq, uint32_t id,
+		uint32_t start, uint32_t num, const struct spa_pod *filter)
+{
+	return 0;
+}
+
+static int follower_port_enum_params(void *object, int seq,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t start, uint32_t num,
+		const struct spa_pod *filter)
+{
+	struct follower *this = object;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+
+	if (id != SPA_PARAM_EnumFormat)
+		return -ENOENT;
+
+	result.id = id;
+	result.next = start;
+next:
+	result.index = result.next++;
+	if (result.index >= this->n_subtypes)
+		return 0;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	if (this->subtypes[result.index] == SPA_MEDIA_SUBTYPE_raw) {
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+			SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+			SPA_FORMAT_VIDEO_format,   SPA_POD_Id(SPA_VIDEO_FORMAT_YUY2),
+			SPA_FORMAT_VIDEO_size,     SPA_POD_Rectangle(&SPA_RECTANGLE(640, 480)),
+			SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&SPA_FRACTION(30, 1)));
+	} else {
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+			SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_video),
+			SPA_FORMAT_mediaSubtype,   SPA_POD_Id(this->subtypes[result.index]),
+			SPA_FORMAT_VIDEO_size,     SPA_POD_Rectangle(&SPA_RECTANGLE(640, 480)),
+			SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&SPA_FRACTION(30, 1)));
+	}
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int follower_send_command(void *object, const struct spa_command *command)
+{
+	return 0;
+}
+
+static int follower_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static int follower_port_set_param(void *object,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t flags, const struct spa_pod *param)
+{
+	return 0;
+}
+
+static int follower_port_set_io(void *object,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static const struct spa_node_methods follower_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = follower_add_listener,
+	.set_callbacks = follower_set_callbacks,
+	.enum_params = follower_enum_params,
+	.port_enum_params = follower_port_enum_params,
+	.send_command = follower_send_command,
+	.set_io = follower_set_io,
+	.port_set_param = follower_port_set_param,
+	.port_set_io = follower_port_set_io,
+};
+
+static const struct spa_handle_factory *find_factory(const char *name)
+{
+	uint32_t index = 0;
+	const struct spa_handle_factory *factory;
+
+	while (spa_handle_factory_enum(&factory, &index) == 1) {
+		if (spa_streq(factory->name, name))
+			return factory;
+	}
+	return NULL;
+}
+
+static int setup_context(struct context *ctx, const uint32_t *subtypes, uint32_t n_subtypes)
+{
+	size_t size;
+	int res;
+	struct spa_support support[1];
+	struct spa_dict_item items[1];
+	const struct spa_handle_factory *factory;
+	char value[32];
+	void *iface;
+
+	logger.log.level = SPA_LOG_LEVEL_TRACE;
+	support[0] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_Log, &logger.log);
+
+	/* make follower */
+	spa_zero(ctx->follower);
+	ctx->follower.node.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE,
+			&follower_methods, &ctx->follower);
+	spa_hook_list_init(&ctx->follower.hooks);
+	ctx->follower.subtypes = subtypes;
+	ctx->follower.n_subtypes = n_subtypes;
+
+	/* make adapter */
+	factory = find_factory(SPA_NAME_VIDEO_ADAPT);
+	spa_assert_se(factory != NULL);
+
+	size = spa_handle_factory_get_size(factory, NULL);
+
+	ctx->adapter_handle = calloc(1, size);
+	spa_assert_se(ctx->adapter_handle != NULL);
+
+	snprintf(value, sizeof(value), "pointer:%p", &ctx->follower.node);
+	items[0] = SPA_DICT_ITEM_INIT("video.adapt.follower", value);
+
+	res = spa_handle_factory_init(factory,
+			ctx->adapter_handle,
+			&SPA_DICT_INIT(items, 1),
+			support, 1);
+	spa_assert_se(res >= 0);
+
+	res = spa_handle_get_interface(ctx->adapter_handle,
+			SPA_TYPE_INTERFACE_Node, &iface);
+	spa_assert_se(res >= 0);
+	ctx->adapter_node = iface;
+
+	return 0;
+}
+
+static int clean_context(struct context *ctx)
+{
+	spa_handle_clear(ctx->adapter_handle);
+	free(ctx->adapter_handle);
+	return 0;
+}
+
+static int set_port_config(struct context *ctx, enum spa_param_port_config_mode mode)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_ParamPortConfig, SPA_PARAM_PortConfig,
+		SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(SPA_DIRECTION_OUTPUT),
+		SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(mode));
+
+	return spa_node_set_param(ctx->adapter_node, SPA_PARAM_PortConfig, 0, param);
+}
+
+static int test_encoded_follower(void)
+{
+	static const uint32_t subtypes[] = {
+		SPA_MEDIA_SUBTYPE_mjpg,
+		SPA_MEDIA_SUBTYPE_h264,
+	};
+	struct context ctx;
+
+	setup_context(&ctx, subtypes, SPA_N_ELEMENTS(subtypes));
+
+	/* we can't convert, stay in passthrough */
+	spa_assert_se(set_port_config(&ctx, SPA_PARAM_PORT_CONFIG_MODE_convert) == -ENOTSUP);
+	spa_assert_se(set_port_config(&ctx, SPA_PARAM_PORT_CONFIG_MODE_dsp) == -ENOTSUP);
+	spa_assert_se(set_port_config(&ctx, SPA_PARAM_PORT_CONFIG_MODE_passthrough) == 0);
+
+	clean_context(&ctx);
+
+	return 0;
+}
+
+static int test_raw_follower(void)
+{
+	static const uint32_t subtypes[] = {
+		SPA_MEDIA_SUBTYPE_mjpg,
+		SPA_MEDIA_SUBTYPE_raw,
+	};
+	struct context ctx;
+
+	setup_context(&ctx, subtypes, SPA_N_ELEMENTS(subtypes));
+
+	/* the raw format is not the first one */
+	spa_assert_se(set_port_config(&ctx, SPA_PARAM_PORT_CONFIG_MODE_convert) == 0);
+	spa_assert_se(set_port_config(&ctx, SPA_PARAM_PORT_CONFIG_MODE_passthrough) == 0);
+
+	clean_context(&ctx);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	test_encoded_follower();
+	test_raw_follower();
+
+	return 0;
+}
@@ -0,0 +1,348 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "video-ops.h"
+
+#include <immintrin.h>
+// GCC: workaround for missing AVX intrinsic: "_mm256_setr_m128()"
+//      (see https://stackoverflow.com/questions/32630458/setting-m256i-to-the-value-of-two-m128i-values)
+#ifndef _mm256_setr_m128i
+#  ifndef _mm256_set_m128i
+#    define _mm256_set_m128i(v0, v1)  _mm256_insertf128_si256(_mm256_castsi128_si256(v1), (v0), 1)
+#  endif
+#  define _mm256_setr_m128i(v0, v1) _mm256_set_m128i((v1), (v0))
+#endif
+
+/* packus of two vectors of 16 bits, with the lanes back in order */
+#define _MM256_PACKUS_EPI16(a,b)	\
+	_mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8)
+
+static inline void
+yuv_to_rgb_16_avx2(const struct video_matrix *m, __m256i y, __m256i u, __m256i v,
+		__m256i *r, __m256i *g, __m256i *b)
+{
+	const __m256i yoff = _mm256_set1_epi16(m->y_offset);
+	const __m256i coff = _mm256_set1_epi16(128);
+	const __m256i round = _mm256_set1_epi16(4);
+
+	y = _mm256_mulhi_epi16(_mm256_slli_epi16(_mm256_sub_epi16(y, yoff), 6),
+			_mm256_set1_epi16(m->y_gain));
+	u = _mm256_slli_epi16(_mm256_sub_epi16(u, coff), 6);
+	v = _mm256_slli_epi16(_mm256_sub_epi16(v, coff), 6);
+	y = _mm256_add_epi16(y, round);
+
+	*r = _mm256_add_epi16(y, _mm256_mulhi_epi16(v, _mm256_set1_epi16(m->r_v)));
+	*g = _mm256_add_epi16(y, _mm256_add_epi16(
+			_mm256_mulhi_epi16(u, _mm256_set1_epi16(m->g_u)),
+			_mm256_mulhi_epi16(v, _mm256_set1_epi16(m->g_v))));
+	*b = _mm256_add_epi16(y, _mm256_mulhi_epi16(u, _mm256_set1_epi16(m->b_u)));
+	*r = _mm256_srai_epi16(*r, 3);
+	*g = _mm256_srai_epi16(*g, 3);
+	*b = _mm256_srai_epi16(*b, 3);
+}
+
+DEFINE_YUV_TO_RGBA(avx2)
+{
+	const struct video_matrix *m = &conv->matrix;
+	const __m256i alpha = _mm256_set1_epi8(-1);
+	uint32_t n, unrolled = width & ~31;
+	__m256i yy, r[2], g[2], b[2], R, G, B, rg, ba, p0, p1, p2, p3;
+	__m128i uu, vv, ul, uh, vl, vh;
+
+	for (n = 0; n < unrolled; n += 32) {
+		yy = _mm256_loadu_si256((const __m256i*)&y[n]);
+		uu = _mm_loadu_si128((const __m128i*)&u[n / 2]);
+		vv = _mm_loadu_si128((const __m128i*)&v[n / 2]);
+		ul = _mm_unpacklo_epi8(uu, uu);
+		uh = _mm_unpackhi_epi8(uu, uu);
+		vl = _mm_unpacklo_epi8(vv, vv);
+		vh = _mm_unpackhi_epi8(vv, vv);
+
+		yuv_to_rgb_16_avx2(m,
+				_mm256_cvtepu8_epi16(_mm256_castsi256_si128(yy)),
+				_mm256_cvtepu8_epi16(ul), _mm256_cvtepu8_epi16(vl),
+				&r[0], &g[0], &b[0]);
+		yuv_to_rgb_16_avx2(m,
+				_mm256_cvtepu8_epi16(_mm256_extracti128_si256(yy, 1)),
+				_mm256_cvtepu8_epi16(uh), _mm256_cvtepu8_epi16(vh),
+				&r[1], &g[1], &b[1]);
+
+		R = _MM256_PACKUS_EPI16(r[0], r[1]);
+		G = _MM256_PACKUS_EPI16(g[0], g[1]);
+		B = _MM256_PACKUS_EPI16(b[0], b[1]);
+		if (swap)
+			SPA_SWAP(R, B);
+
+		/* pixels 0-7 and 16-23 */
+		rg = _mm256_unpacklo_epi8(R, G);
+		ba = _mm256_unpacklo_epi8(B, alpha);
+		p0 = _mm256_unpacklo_epi16(rg, ba);
+		p1 = _mm256_unpackhi_epi16(rg, ba);
+		/* pixels 8-15 and 24-31 */
+		rg = _mm256_unpackhi_epi8(R, G);
+		ba = _mm256_unpackhi_epi8(B, alpha);
+		p2 = _mm256_unpacklo_epi16(rg, ba);
+		p3 = _mm256_unpackhi_epi16(rg, ba);
+
+		_mm256_storeu_si256((__m256i*)&dst[n * 4 +  0], _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256((__m256i*)&dst[n * 4 + 32], _mm256_permute2x128_si256(p2, p3, 0x20));
+		_mm256_storeu_si256((__m256i*)&dst[n * 4 + 64], _mm256_permute2x128_si256(p0, p1, 0x31));
+		_mm256_storeu_si256((__m256i*)&dst[n * 4 + 96], _mm256_permute2x128_si256(p2, p3, 0x31));
+	}
+	if (n < width)
+		conv_yuv_to_rgba_c(conv, &dst[n * 4], &y[n], &u[n / 2], &v[n / 2],
+				width - n, swap);
+}
+
+/* deinterleave 16 pixels of RGBA in 16 bits components */
+static inline void
+load_rgb_16_avx2(const uint8_t *s, __m256i *r, __m256i *g, __m256i *b, bool swap)
+{
+	const __m256i mask = _mm256_set1_epi32(0xff);
+	__m256i a0 = _mm256_loadu_si256((const __m256i*)&s[0]);
+	__m256i a1 = _mm256_loadu_si256((const __m256i*)&s[32]);
+
+	*r = _mm256_packs_epi32(_mm256_and_si256(a0, mask), _mm256_and_si256(a1, mask));
+	*g = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a0, 8), mask),
+			_mm256_and_si256(_mm256_srli_epi32(a1, 8), mask));
+	*b = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(a0, 16), mask),
+			_mm256_and_si256(_mm256_srli_epi32(a1, 16), mask));
+	*r = _mm256_permute4x64_epi64(*r, 0xd8);
+	*g = _mm256_permute4x64_epi64(*g, 0xd8);
+	*b = _mm256_permute4x64_epi64(*b, 0xd8);
+	if (swap)
+		SPA_SWAP(*r, *b);
+}
+
+static inline __m128i
+rgb_to_y_16_avx2(const struct video_matrix *m, __m256i r, __m256i g, __m256i b)
+{
+	__m256i y;
+
+	y = _mm256_add_epi16(
+		_mm256_add_epi16(
+			_mm256_mulhi_epi16(_mm256_slli_epi16(r, 6), _mm256_set1_epi16(m->y_r)),
+			_mm256_mulhi_epi16(_mm256_slli_epi16(g, 6), _mm256_set1_epi16(m->y_g))),
+		_mm256_mulhi_epi16(_mm256_slli_epi16(b, 6), _mm256_set1_epi16(m->y_b)));
+	y = _mm256_add_epi16(y, _mm256_set1_epi16((m->y_offset << 5) + 16));
+	y = _mm256_srai_epi16(y, 5);
+	y = _mm256_permute4x64_epi64(_mm256_packus_epi16(y, y), 0x08);
+	return _mm256_castsi256_si128(y);
+}
+
+/* the 8 pair sums of 32 bits as 16 bits values */
+static inline __m128i pack_sums_avx2(__m256i s)
+{
+	s = _mm256_permute4x64_epi64(_mm256_packs_epi32(s, s), 0x08);
+	return _mm256_castsi256_si128(s);
+}
+
+static inline __m128i
+rgb_to_c_8_avx2(__m128i r, __m128i g, __m128i b, int16_t cr, int16_t cg, int16_t cb)
+{
+	__m128i c;
+
+	c = _mm_add_epi16(
+		_mm_add_epi16(
+			_mm_mulhi_epi16(r, _mm_set1_epi16(cr)),
+			_mm_mulhi_epi16(g, _mm_set1_epi16(cg))),
+		_mm_mulhi_epi16(b, _mm_set1_epi16(cb)));
+	c = _mm_add_epi16(c, _mm_set1_epi16((128 << 5) + 16));
+	c = _mm_srai_epi16(c, 5);
+	return _mm_packus_epi16(c, c);
+}
+
+DEFINE_RGBA_TO_YUV(avx2)
+{
+	const struct video_matrix *m = &conv->matrix;
+	const __m256i ones = _mm256_set1_epi16(1);
+	const __m128i shift = _mm_cvtsi32_si128(s1 ? 4 : 5);
+	uint32_t n, unrolled = width & ~15;
+	__m256i r, g, b, rs, gs, bs;
+	__m128i R, G, B;
+
+	for (n = 0; n < unrolled; n += 16) {
+		load_rgb_16_avx2(&s0[n * 4], &r, &g, &b, swap);
+		_mm_storeu_si128((__m128i*)&y0[n], rgb_to_y_16_avx2(m, r, g, b));
+		rs = _mm256_madd_epi16(r, ones);
+		gs = _mm256_madd_epi16(g, ones);
+		bs = _mm256_madd_epi16(b, ones);
+
+		if (s1) {
+			load_rgb_16_avx2(&s1[n * 4], &r, &g, &b, swap);
+			_mm_storeu_si128((__m128i*)&y1[n], rgb_to_y_16_avx2(m, r, g, b));
+			rs = _mm256_add_epi32(rs, _mm256_madd_epi16(r, ones));
+			gs = _mm256_add_epi32(gs, _mm256_madd_epi16(g, ones));
+			bs = _mm256_add_epi32(bs, _mm256_madd_epi16(b, ones));
+		}
+		R = _mm_sll_epi16(pack_sums_avx2(rs), shift);
+		G = _mm_sll_epi16(pack_sums_avx2(gs), shift);
+		B = _mm_sll_epi16(pack_sums_avx2(bs), shift);
+
+		_mm_storel_epi64((__m128i*)&u[n / 2],
+				rgb_to_c_8_avx2(R, G, B, m->u_r, m->u_g, m->u_b));
+		_mm_storel_epi64((__m128i*)&v[n / 2],
+				rgb_to_c_8_avx2(R, G, B, m->v_r, m->v_g, m->v_b));
+	}
+	if (n < width)
+		conv_rgba_to_yuv_c(conv, &y0[n], y1 ? &y1[n] : NULL, &u[n / 2], &v[n / 2],
+				&s0[n * 4], s1 ? &s1[n * 4] : NULL, width - n, swap);
+}
+
+DEFINE_SPLIT_YUYV(avx2)
+{
+	const __m256i mask = _mm256_set1_epi16(0xff);
+	const __m256i zero = _mm256_setzero_si256();
+	uint32_t n, unrolled = width & ~31;
+	__m256i a0, a1, l, c;
+
+	for (n = 0; n < unrolled; n += 32) {
+		a0 = _mm256_loadu_si256((const __m256i*)&src[n * 2 +  0]);
+		a1 = _mm256_loadu_si256((const __m256i*)&src[n * 2 + 32]);
+		if (y_first) {
+			l = _MM256_PACKUS_EPI16(_mm256_and_si256(a0, mask), _mm256_and_si256(a1, mask));
+			c = _MM256_PACKUS_EPI16(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(a1, 8));
+		} else {
+			l = _MM256_PACKUS_EPI16(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(a1, 8));
+			c = _MM256_PACKUS_EPI16(_mm256_and_si256(a0, mask), _mm256_and_si256(a1, mask));
+		}
+		_mm256_storeu_si256((__m256i*)&y[n], l);
+		a0 = _mm256_permute4x64_epi64(_mm256_packus_epi16(
+					_mm256_and_si256(c, mask), zero), 0x08);
+		a1 = _mm256_permute4x64_epi64(_mm256_packus_epi16(
+					_mm256_srli_epi16(c, 8), zero), 0x08);
+		_mm_storeu_si128((__m128i*)&u[n / 2], _mm256_castsi256_si128(a0));
+		_mm_storeu_si128((__m128i*)&v[n / 2], _mm256_castsi256_si128(a1));
+	}
+	if (n < width)
+		conv_split_yuyv_c(&y[n], &u[n / 2], &v[n / 2], &src[n * 2], width - n, y_first);
+}
+
+DEFINE_MERGE_YUYV(avx2)
+{
+	uint32_t n, unrolled = width & ~31;
+	__m256i l, c, lo, hi;
+	__m128i uu, vv;
+
+	for (n = 0; n < unrolled; n += 32) {
+		l = _mm256_loadu_si256((const __m256i*)&y[n]);
+		uu = _mm_loadu_si128((const __m128i*)&u[n / 2]);
+		vv = _mm_loadu_si128((const __m128i*)&v[n / 2]);
+		c = _mm256_setr_m128i(_mm_unpacklo_epi8(uu, vv), _mm_unpackhi_epi8(uu, vv));
+		if (y_first) {
+			lo = _mm256_unpacklo_epi8(l, c);
+			hi = _mm256_unpackhi_epi8(l, c);
+		} else {
+			lo = _mm256_unpacklo_epi8(c, l);
+			hi = _mm256_unpackhi_epi8(c, l);
+		}
+		_mm256_storeu_si256((__m256i*)&dst[n * 2 +  0], _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*)&dst[n * 2 + 32], _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	if (n < width)
+		conv_merge_yuyv_c(&dst[n * 2], &y[n], &u[n / 2], &v[n / 2], width - n, y_first);
+}
+
+DEFINE_SPLIT_UV(avx2)
+{
+	const __m256i mask = _mm256_set1_epi16(0xff);
+	uint32_t n, unrolled = n_pairs & ~31;
+	__m256i a0, a1;
+
+	for (n = 0; n < unrolled; n += 32) {
+		a0 = _mm256_loadu_si256((const __m256i*)&src[n * 2 +  0]);
+		a1 = _mm256_loadu_si256((const __m256i*)&src[n * 2 + 32]);
+		_mm256_storeu_si256((__m256i*)&u[n],
+				_MM256_PACKUS_EPI16(_mm256_and_si256(a0, mask), _mm256_and_si256(a1, mask)));
+		_mm256_storeu_si256((__m256i*)&v[n],
+				_MM256_PACKUS_EPI16(_mm256_srli_epi16(a0, 8), _mm256_srli_epi16(a1, 8)));
+	}
+	if (n < n_pairs)
+		conv_split_uv_c(&u[n], &v[n], &src[n * 2], n_pairs - n);
+}
+
+DEFINE_MERGE_UV(avx2)
+{
+	uint32_t n, unrolled = n_pairs & ~31;
+	__m256i a, b, lo, hi;
+
+	for (n = 0; n < unrolled; n += 32) {
+		a = _mm256_loadu_si256((const __m256i*)&u[n]);
+		b = _mm256_loadu_si256((const __m256i*)&v[n]);
+		lo = _mm256_unpacklo_epi8(a, b);
+		hi = _mm256_unpackhi_epi8(a, b);
+		_mm256_storeu_si256((__m256i*)&dst[n * 2 +  0], _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i*)&dst[n * 2 + 32], _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	if (n < n_pairs)
+		conv_merge_uv_c(&dst[n * 2], &u[n], &v[n], n_pairs - n);
+}
+
+/* two pixels with their right neighbour, weighted and summed in the low
+ * half of each lane */
+static inline __m256i
+scale_pixels_avx2(const uint32_t *src, const uint32_t *offset, const uint16_t *weight)
+{
+	uint32_t w0 = weight[0], w1 = weight[1];
+	__m256i p, m;
+
+	p = _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(
+				_mm_loadl_epi64((const __m128i*)&src[offset[0]]),
+				_mm_loadl_epi64((const __m128i*)&src[offset[1]])));
+	m = _mm256_mullo_epi16(p, _mm256_set_epi16(
+				w1, w1, w1, w1, 256 - w1, 256 - w1, 256 - w1, 256 - w1,
+				w0, w0, w0, w0, 256 - w0, 256 - w0, 256 - w0, 256 - w0));
+	return _mm256_add_epi16(m, _mm256_bsrli_epi128(m, 8));
+}
+
+DEFINE_SCALE_H(avx2)
+{
+	const __m256i round = _mm256_set1_epi16(128);
+	uint32_t n, unrolled = width & ~3;
+	__m256i a, b;
+
+	for (n = 0; n < unrolled; n += 4) {
+		a = scale_pixels_avx2(src, &conv->x_offset[n + 0], &conv->x_weight[n + 0]);
+		b = scale_pixels_avx2(src, &conv->x_offset[n + 2], &conv->x_weight[n + 2]);
+		/* pixels 0 and 2 in the low lane, 1 and 3 in the high lane */
+		a = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xd8);
+		a = _mm256_srli_epi16(_mm256_add_epi16(a, round), 8);
+		a = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, a), 0x08);
+		_mm_storeu_si128((__m128i*)&dst[n], _mm256_castsi256_si128(a));
+	}
+	for (; n < width; n++) {
+		const uint8_t *p = (const uint8_t *)&src[conv->x_offset[n]];
+		uint8_t *d = (uint8_t *)&dst[n];
+		uint32_t i, w1 = conv->x_weight[n], w0 = 256 - w1;
+
+		for (i = 0; i < 4; i++)
+			d[i] = (p[i] * w0 + p[i + 4] * w1 + 128) >> 8;
+	}
+}
+
+DEFINE_SCALE_V(avx2)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i round = _mm256_set1_epi16(128);
+	const __m256i w0 = _mm256_set1_epi16(256 - weight);
+	const __m256i w1 = _mm256_set1_epi16(weight);
+	uint32_t n, unrolled = n_bytes & ~31;
+	__m256i a, b, lo, hi;
+
+	for (n = 0; n < unrolled; n += 32) {
+		a = _mm256_loadu_si256((const __m256i*)&s0[n]);
+		b = _mm256_loadu_si256((const __m256i*)&s1[n]);
+		lo = _mm256_add_epi16(
+			_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), w0),
+			_mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), w1));
+		hi = _mm256_add_epi16(
+			_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), w0),
+			_mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), w1));
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+		_mm256_storeu_si256((__m256i*)&dst[n], _mm256_packus_epi16(lo, hi));
+	}
+	if (n < n_bytes)
+		conv_scale_v_c(&dst[n], &s0[n], &s1[n], n_bytes - n, weight);
+}
@@ -0,0 +1,143 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "video-ops.h"
+
+static inline uint8_t clamp_u8(int32_t v)
+{
+	return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+DEFINE_YUV_TO_RGBA(c)
+{
+	const struct video_matrix *m = &conv->matrix;
+	uint32_t n, ri = swap ? 2 : 0, bi = swap ? 0 : 2;
+
+	for (n = 0; n < width; n++) {
+		int32_t yy = MULHI((y[n] - m->y_offset) * 64, m->y_gain);
+		int32_t uu = (u[n >> 1] - 128) * 64;
+		int32_t vv = (v[n >> 1] - 128) * 64;
+
+		dst[ri] = clamp_u8((yy + MULHI(vv, m->r_v) + 4) >> 3);
+		dst[1]  = clamp_u8((yy + MULHI(uu, m->g_u) + MULHI(vv, m->g_v) + 4) >> 3);
+		dst[bi] = clamp_u8((yy + MULHI(uu, m->b_u) + 4) >> 3);
+		dst[3]  = 0xff;
+		dst += 4;
+	}
+}
+
+static inline uint8_t rgb_to_y(const struct video_matrix *m, const uint8_t *p,
+		uint32_t ri, uint32_t bi)
+{
+	return clamp_u8((MULHI(p[ri] << 6, m->y_r) +
+			MULHI(p[1] << 6, m->y_g) +
+			MULHI(p[bi] << 6, m->y_b) +
+			(m->y_offset << 5) + 16) >> 5);
+}
+
+DEFINE_RGBA_TO_YUV(c)
+{
+	const struct video_matrix *m = &conv->matrix;
+	uint32_t n, ri = swap ? 2 : 0, bi = swap ? 0 : 2;
+
+	for (n = 0; n < width; n++) {
+		y0[n] = rgb_to_y(m, &s0[n * 4], ri, bi);
+		if (y1)
+			y1[n] = rgb_to_y(m, &s1[n * 4], ri, bi);
+	}
+	/* the chroma of the average of 2 or 4 pixels, scaled to Q6 */
+	for (n = 0; n < width; n += 2) {
+		uint32_t next = n + 1 < width ? 4 : 0, shift = 5;
+		const uint8_t *p = &s0[n * 4];
+		int32_t r, g, b;
+
+		r = p[ri] + p[ri + next];
+		g = p[1] + p[1 + next];
+		b = p[bi] + p[bi + next];
+		if (s1) {
+			p = &s1[n * 4];
+			r += p[ri] + p[ri + next];
+			g += p[1] + p[1 + next];
+			b += p[bi] + p[bi + next];
+			shift = 4;
+		}
+		r <<= shift;
+		g <<= shift;
+		b <<= shift;
+		u[n >> 1] = clamp_u8((MULHI(r, m->u_r) + MULHI(g, m->u_g) +
+				MULHI(b, m->u_b) + (128 << 5) + 16) >> 5);
+		v[n >> 1] = clamp_u8((MULHI(r, m->v_r) + MULHI(g, m->v_g) +
+				MULHI(b, m->v_b) + (128 << 5) + 16) >> 5);
+	}
+}
+
+DEFINE_SPLIT_YUYV(c)
+{
+	uint32_t n, n_pairs = (width + 1) / 2;
+	uint32_t yo = y_first ? 0 : 1, co = y_first ? 1 : 0;
+
+	for (n = 0; n < n_pairs; n++) {
+		y[2 * n + 0] = src[4 * n + yo];
+		y[2 * n + 1] = src[4 * n + 2 + yo];
+		u[n] = src[4 * n + co];
+		v[n] = src[4 * n + 2 + co];
+	}
+}
+
+DEFINE_MERGE_YUYV(c)
+{
+	uint32_t n, n_pairs = (width + 1) / 2;
+	uint32_t yo = y_first ? 0 : 1, co = y_first ? 1 : 0;
+
+	for (n = 0; n < n_pairs; n++) {
+		dst[4 * n + yo] = y[2 * n + 0];
+		dst[4 * n + 2 + yo] = y[2 * n + 1];
+		dst[4 * n + co] = u[n];
+		dst[4 * n + 2 + co] = v[n];
+	}
+}
+
+DEFINE_SPLIT_UV(c)
+{
+	uint32_t n;
+
+	for (n = 0; n < n_pairs; n++) {
+		u[n] = src[2 * n + 0];
+		v[n] = src[2 * n + 1];
+	}
+}
+
+DEFINE_MERGE_UV(c)
+{
+	uint32_t n;
+
+	for (n = 0; n < n_pairs; n++) {
+		dst[2 * n + 0] = u[n];
+		dst[2 * n + 1] = v[n];
+	}
+}
+
+DEFINE_SCALE_H(c)
+{
+	const uint8_t *s = (const uint8_t *)src;
+	uint8_t *d = (uint8_t *)dst;
+	uint32_t n, i;
+
+	for (n = 0; n < width; n++) {
+		const uint8_t *p = &s[conv->x_offset[n] * 4];
+		uint32_t w1 = conv->x_weight[n], w0 = 256 - w1;
+
+		for (i = 0; i < 4; i++)
+			d[i] = (p[i] * w0 + p[i + 4] * w1 + 128) >> 8;
+		d += 4;
+	}
+}
+
+DEFINE_SCALE_V(c)
+{
+	uint32_t n, w0 = 256 - weight;
+
+	for (n = 0; n < n_bytes; n++)
+		dst[n] = (s0[n] * w0 + s1[n] * weight + 128) >> 8;
+}
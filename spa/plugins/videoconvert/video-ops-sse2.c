@@ -0,0 +1,300 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "video-ops.h"
+
+#include <emmintrin.h>
+
+static inline void
+yuv_to_rgb_8_sse2(const struct video_matrix *m, __m128i y, __m128i u, __m128i v,
+		__m128i *r, __m128i *g, __m128i *b)
+{
+	const __m128i yoff = _mm_set1_epi16(m->y_offset);
+	const __m128i coff = _mm_set1_epi16(128);
+	const __m128i round = _mm_set1_epi16(4);
+
+	y = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(y, yoff), 6),
+			_mm_set1_epi16(m->y_gain));
+	u = _mm_slli_epi16(_mm_sub_epi16(u, coff), 6);
+	v = _mm_slli_epi16(_mm_sub_epi16(v, coff), 6);
+	y = _mm_add_epi16(y, round);
+
+	*r = _mm_add_epi16(y, _mm_mulhi_epi16(v, _mm_set1_epi16(m->r_v)));
+	*g = _mm_add_epi16(y, _mm_add_epi16(
+			_mm_mulhi_epi16(u, _mm_set1_epi16(m->g_u)),
+			_mm_mulhi_epi16(v, _mm_set1_epi16(m->g_v))));
+	*b = _mm_add_epi16(y, _mm_mulhi_epi16(u, _mm_set1_epi16(m->b_u)));
+	*r = _mm_srai_epi16(*r, 3);
+	*g = _mm_srai_epi16(*g, 3);
+	*b = _mm_srai_epi16(*b, 3);
+}
+
+DEFINE_YUV_TO_RGBA(sse2)
+{
+	const struct video_matrix *m = &conv->matrix;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi8(-1);
+	uint32_t n, unrolled = width & ~15;
+	__m128i yy, uu, vv, r[2], g[2], b[2], R, G, B, rg, ba;
+
+	for (n = 0; n < unrolled; n += 16) {
+		yy = _mm_loadu_si128((const __m128i*)&y[n]);
+		uu = _mm_loadl_epi64((const __m128i*)&u[n / 2]);
+		vv = _mm_loadl_epi64((const __m128i*)&v[n / 2]);
+		uu = _mm_unpacklo_epi8(uu, uu);
+		vv = _mm_unpacklo_epi8(vv, vv);
+
+		yuv_to_rgb_8_sse2(m, _mm_unpacklo_epi8(yy, zero),
+				_mm_unpacklo_epi8(uu, zero), _mm_unpacklo_epi8(vv, zero),
+				&r[0], &g[0], &b[0]);
+		yuv_to_rgb_8_sse2(m, _mm_unpackhi_epi8(yy, zero),
+				_mm_unpackhi_epi8(uu, zero), _mm_unpackhi_epi8(vv, zero),
+				&r[1], &g[1], &b[1]);
+
+		R = _mm_packus_epi16(r[0], r[1]);
+		G = _mm_packus_epi16(g[0], g[1]);
+		B = _mm_packus_epi16(b[0], b[1]);
+		if (swap)
+			SPA_SWAP(R, B);
+
+		rg = _mm_unpacklo_epi8(R, G);
+		ba = _mm_unpacklo_epi8(B, alpha);
+		_mm_storeu_si128((__m128i*)&dst[n * 4 +  0], _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128((__m128i*)&dst[n * 4 + 16], _mm_unpackhi_epi16(rg, ba));
+		rg = _mm_unpackhi_epi8(R, G);
+		ba = _mm_unpackhi_epi8(B, alpha);
+		_mm_storeu_si128((__m128i*)&dst[n * 4 + 32], _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128((__m128i*)&dst[n * 4 + 48], _mm_unpackhi_epi16(rg, ba));
+	}
+	if (n < width)
+		conv_yuv_to_rgba_c(conv, &dst[n * 4], &y[n], &u[n / 2], &v[n / 2],
+				width - n, swap);
+}
+
+/* deinterleave 8 pixels of RGBA in 16 bits components */
+static inline void
+load_rgb_8_sse2(const uint8_t *s, __m128i *r, __m128i *g, __m128i *b, bool swap)
+{
+	const __m128i mask = _mm_set1_epi32(0xff);
+	__m128i a0 = _mm_loadu_si128((const __m128i*)&s[0]);
+	__m128i a1 = _mm_loadu_si128((const __m128i*)&s[16]);
+
+	*r = _mm_packs_epi32(_mm_and_si128(a0, mask), _mm_and_si128(a1, mask));
+	*g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a0, 8), mask),
+			_mm_and_si128(_mm_srli_epi32(a1, 8), mask));
+	*b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a0, 16), mask),
+			_mm_and_si128(_mm_srli_epi32(a1, 16), mask));
+	if (swap)
+		SPA_SWAP(*r, *b);
+}
+
+static inline __m128i
+rgb_to_y_8_sse2(const struct video_matrix *m, __m128i r, __m128i g, __m128i b)
+{
+	__m128i y;
+
+	y = _mm_add_epi16(
+		_mm_add_epi16(
+			_mm_mulhi_epi16(_mm_slli_epi16(r, 6), _mm_set1_epi16(m->y_r)),
+			_mm_mulhi_epi16(_mm_slli_epi16(g, 6), _mm_set1_epi16(m->y_g))),
+		_mm_mulhi_epi16(_mm_slli_epi16(b, 6), _mm_set1_epi16(m->y_b)));
+	y = _mm_add_epi16(y, _mm_set1_epi16((m->y_offset << 5) + 16));
+	return _mm_srai_epi16(y, 5);
+}
+
+static inline __m128i
+rgb_to_c_8_sse2(__m128i r, __m128i g, __m128i b, int16_t cr, int16_t cg, int16_t cb)
+{
+	__m128i c;
+
+	c = _mm_add_epi16(
+		_mm_add_epi16(
+			_mm_mulhi_epi16(r, _mm_set1_epi16(cr)),
+			_mm_mulhi_epi16(g, _mm_set1_epi16(cg))),
+		_mm_mulhi_epi16(b, _mm_set1_epi16(cb)));
+	c = _mm_add_epi16(c, _mm_set1_epi16((128 << 5) + 16));
+	return _mm_srai_epi16(c, 5);
+}
+
+DEFINE_RGBA_TO_YUV(sse2)
+{
+	const struct video_matrix *m = &conv->matrix;
+	const __m128i ones = _mm_set1_epi16(1);
+	const __m128i shift = _mm_cvtsi32_si128(s1 ? 4 : 5);
+	uint32_t n, i, unrolled = width & ~15;
+	__m128i r, g, b, Y[2], rs[2], gs[2], bs[2], R, G, B;
+
+	for (n = 0; n < unrolled; n += 16) {
+		for (i = 0; i < 2; i++) {
+			load_rgb_8_sse2(&s0[(n + i * 8) * 4], &r, &g, &b, swap);
+			Y[i] = rgb_to_y_8_sse2(m, r, g, b);
+			rs[i] = _mm_madd_epi16(r, ones);
+			gs[i] = _mm_madd_epi16(g, ones);
+			bs[i] = _mm_madd_epi16(b, ones);
+		}
+		_mm_storeu_si128((__m128i*)&y0[n], _mm_packus_epi16(Y[0], Y[1]));
+
+		if (s1) {
+			for (i = 0; i < 2; i++) {
+				load_rgb_8_sse2(&s1[(n + i * 8) * 4], &r, &g, &b, swap);
+				Y[i] = rgb_to_y_8_sse2(m, r, g, b);
+				rs[i] = _mm_add_epi32(rs[i], _mm_madd_epi16(r, ones));
+				gs[i] = _mm_add_epi32(gs[i], _mm_madd_epi16(g, ones));
+				bs[i] = _mm_add_epi32(bs[i], _mm_madd_epi16(b, ones));
+			}
+			_mm_storeu_si128((__m128i*)&y1[n], _mm_packus_epi16(Y[0], Y[1]));
+		}
+		R = _mm_sll_epi16(_mm_packs_epi32(rs[0], rs[1]), shift);
+		G = _mm_sll_epi16(_mm_packs_epi32(gs[0], gs[1]), shift);
+		B = _mm_sll_epi16(_mm_packs_epi32(bs[0], bs[1]), shift);
+
+		r = rgb_to_c_8_sse2(R, G, B, m->u_r, m->u_g, m->u_b);
+		_mm_storel_epi64((__m128i*)&u[n / 2], _mm_packus_epi16(r, r));
+		r = rgb_to_c_8_sse2(R, G, B, m->v_r, m->v_g, m->v_b);
+		_mm_storel_epi64((__m128i*)&v[n / 2], _mm_packus_epi16(r, r));
+	}
+	if (n < width)
+		conv_rgba_to_yuv_c(conv, &y0[n], y1 ? &y1[n] : NULL, &u[n / 2], &v[n / 2],
+				&s0[n * 4], s1 ? &s1[n * 4] : NULL, width - n, swap);
+}
+
+DEFINE_SPLIT_YUYV(sse2)
+{
+	const __m128i mask = _mm_set1_epi16(0xff);
+	const __m128i zero = _mm_setzero_si128();
+	uint32_t n, unrolled = width & ~15;
+	__m128i a0, a1, l, c;
+
+	for (n = 0; n < unrolled; n += 16) {
+		a0 = _mm_loadu_si128((const __m128i*)&src[n * 2 +  0]);
+		a1 = _mm_loadu_si128((const __m128i*)&src[n * 2 + 16]);
+		if (y_first) {
+			l = _mm_packus_epi16(_mm_and_si128(a0, mask), _mm_and_si128(a1, mask));
+			c = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8));
+		} else {
+			l = _mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8));
+			c = _mm_packus_epi16(_mm_and_si128(a0, mask), _mm_and_si128(a1, mask));
+		}
+		_mm_storeu_si128((__m128i*)&y[n], l);
+		_mm_storel_epi64((__m128i*)&u[n / 2],
+				_mm_packus_epi16(_mm_and_si128(c, mask), zero));
+		_mm_storel_epi64((__m128i*)&v[n / 2],
+				_mm_packus_epi16(_mm_srli_epi16(c, 8), zero));
+	}
+	if (n < width)
+		conv_split_yuyv_c(&y[n], &u[n / 2], &v[n / 2], &src[n * 2], width - n, y_first);
+}
+
+DEFINE_MERGE_YUYV(sse2)
+{
+	uint32_t n, unrolled = width & ~15;
+	__m128i l, c;
+
+	for (n = 0; n < unrolled; n += 16) {
+		l = _mm_loadu_si128((const __m128i*)&y[n]);
+		c = _mm_unpacklo_epi8(
+				_mm_loadl_epi64((const __m128i*)&u[n / 2]),
+				_mm_loadl_epi64((const __m128i*)&v[n / 2]));
+		if (y_first) {
+			_mm_storeu_si128((__m128i*)&dst[n * 2 +  0], _mm_unpacklo_epi8(l, c));
+			_mm_storeu_si128((__m128i*)&dst[n * 2 + 16], _mm_unpackhi_epi8(l, c));
+		} else {
+			_mm_storeu_si128((__m128i*)&dst[n * 2 +  0], _mm_unpacklo_epi8(c, l));
+			_mm_storeu_si128((__m128i*)&dst[n * 2 + 16], _mm_unpackhi_epi8(c, l));
+		}
+	}
+	if (n < width)
+		conv_merge_yuyv_c(&dst[n * 2], &y[n], &u[n / 2], &v[n / 2], width - n, y_first);
+}
+
+DEFINE_SPLIT_UV(sse2)
+{
+	const __m128i mask = _mm_set1_epi16(0xff);
+	uint32_t n, unrolled = n_pairs & ~15;
+	__m128i a0, a1;
+
+	for (n = 0; n < unrolled; n += 16) {
+		a0 = _mm_loadu_si128((const __m128i*)&src[n * 2 +  0]);
+		a1 = _mm_loadu_si128((const __m128i*)&src[n * 2 + 16]);
+		_mm_storeu_si128((__m128i*)&u[n],
+				_mm_packus_epi16(_mm_and_si128(a0, mask), _mm_and_si128(a1, mask)));
+		_mm_storeu_si128((__m128i*)&v[n],
+				_mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8)));
+	}
+	if (n < n_pairs)
+		conv_split_uv_c(&u[n], &v[n], &src[n * 2], n_pairs - n);
+}
+
+DEFINE_MERGE_UV(sse2)
+{
+	uint32_t n, unrolled = n_pairs & ~15;
+	__m128i a, b;
+
+	for (n = 0; n < unrolled; n += 16) {
+		a = _mm_loadu_si128((const __m128i*)&u[n]);
+		b = _mm_loadu_si128((const __m128i*)&v[n]);
+		_mm_storeu_si128((__m128i*)&dst[n * 2 +  0], _mm_unpacklo_epi8(a, b));
+		_mm_storeu_si128((__m128i*)&dst[n * 2 + 16], _mm_unpackhi_epi8(a, b));
+	}
+	if (n < n_pairs)
+		conv_merge_uv_c(&dst[n * 2], &u[n], &v[n], n_pairs - n);
+}
+
+/* one pixel and its right neighbour, weighted */
+static inline __m128i
+scale_pixel_sse2(const uint32_t *src, uint32_t offset, uint32_t w)
+{
+	__m128i p, m;
+
+	p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)&src[offset]),
+			_mm_setzero_si128());
+	m = _mm_mullo_epi16(p, _mm_set_epi16(w, w, w, w,
+				256 - w, 256 - w, 256 - w, 256 - w));
+	return _mm_add_epi16(m, _mm_srli_si128(m, 8));
+}
+
+DEFINE_SCALE_H(sse2)
+{
+	const __m128i round = _mm_set1_epi16(128);
+	uint32_t n, unrolled = width & ~1;
+	__m128i a, b;
+
+	for (n = 0; n < unrolled; n += 2) {
+		a = scale_pixel_sse2(src, conv->x_offset[n + 0], conv->x_weight[n + 0]);
+		b = scale_pixel_sse2(src, conv->x_offset[n + 1], conv->x_weight[n + 1]);
+		a = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(a, b), round), 8);
+		_mm_storel_epi64((__m128i*)&dst[n], _mm_packus_epi16(a, a));
+	}
+	for (; n < width; n++) {
+		a = scale_pixel_sse2(src, conv->x_offset[n], conv->x_weight[n]);
+		a = _mm_srli_epi16(_mm_add_epi16(a, round), 8);
+		dst[n] = _mm_cvtsi128_si32(_mm_packus_epi16(a, a));
+	}
+}
+
+DEFINE_SCALE_V(sse2)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i w0 = _mm_set1_epi16(256 - weight);
+	const __m128i w1 = _mm_set1_epi16(weight);
+	uint32_t n, unrolled = n_bytes & ~15;
+	__m128i a, b, lo, hi;
+
+	for (n = 0; n < unrolled; n += 16) {
+		a = _mm_loadu_si128((const __m128i*)&s0[n]);
+		b = _mm_loadu_si128((const __m128i*)&s1[n]);
+		lo = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+		hi = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i*)&dst[n], _mm_packus_epi16(lo, hi));
+	}
+	if (n < n_bytes)
+		conv_scale_v_c(&dst[n], &s0[n], &s1[n], n_bytes - n, weight);
+}
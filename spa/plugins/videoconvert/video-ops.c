@@ -0,0 +1,715 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+#include <spa/param/video/raw.h>
+
+#include "video-ops.h"
+
+#define KIND_RGBA	0	/* 4 bytes per pixel, offs are the offsets of R, G, B and A */
+#define KIND_RGB	1	/* 3 bytes per pixel, offs are the offsets of R, G and B */
+#define KIND_RGBA_F32	2	/* 4 floats per pixel */
+#define KIND_GRAY	3	/* only luma */
+#define KIND_PLANAR	4	/* 4:2:0 in 3 planes, offs are the planes of Y, U and V */
+#define KIND_SEMI	5	/* 4:2:0 with the chroma pairs in the second plane */
+#define KIND_PACKED	6	/* 4:2:2 packed in pairs of pixels */
+
+struct format_info {
+	uint32_t format;
+	uint32_t kind;
+	uint8_t offs[4];
+#define FORMAT_YUV	(1<<0)
+#define FORMAT_ALPHA	(1<<1)
+#define FORMAT_SWAP	(1<<2)		/* V before U */
+#define FORMAT_Y_FIRST	(1<<3)		/* Y before the chroma in packed pairs */
+	uint32_t flags;
+};
+
+#define MAKE(fmt,kind,o0,o1,o2,o3,flags) \
+	{ SPA_VIDEO_FORMAT_ ##fmt, KIND_ ##kind, { o0, o1, o2, o3 }, flags }
+
+static const struct format_info format_table[] =
+{
+	MAKE(RGBA, RGBA, 0, 1, 2, 3, FORMAT_ALPHA),
+	MAKE(BGRA, RGBA, 2, 1, 0, 3, FORMAT_ALPHA),
+	MAKE(ARGB, RGBA, 1, 2, 3, 0, FORMAT_ALPHA),
+	MAKE(ABGR, RGBA, 3, 2, 1, 0, FORMAT_ALPHA),
+	MAKE(RGBx, RGBA, 0, 1, 2, 3, 0),
+	MAKE(BGRx, RGBA, 2, 1, 0, 3, 0),
+	MAKE(xRGB, RGBA, 1, 2, 3, 0, 0),
+	MAKE(xBGR, RGBA, 3, 2, 1, 0, 0),
+	MAKE(RGB, RGB, 0, 1, 2, 0, 0),
+	MAKE(BGR, RGB, 2, 1, 0, 0, 0),
+	MAKE(RGBA_F32, RGBA_F32, 0, 1, 2, 3, FORMAT_ALPHA),
+
+	MAKE(GRAY8, GRAY, 0, 0, 0, 0, FORMAT_YUV),
+	MAKE(I420, PLANAR, 0, 1, 2, 0, FORMAT_YUV),
+	MAKE(YV12, PLANAR, 0, 2, 1, 0, FORMAT_YUV),
+	MAKE(NV12, SEMI, 0, 0, 0, 0, FORMAT_YUV),
+	MAKE(NV21, SEMI, 0, 0, 0, 0, FORMAT_YUV | FORMAT_SWAP),
+	MAKE(YUY2, PACKED, 0, 0, 0, 0, FORMAT_YUV | FORMAT_Y_FIRST),
+	MAKE(YVYU, PACKED, 0, 0, 0, 0, FORMAT_YUV | FORMAT_Y_FIRST | FORMAT_SWAP),
+	MAKE(UYVY, PACKED, 0, 0, 0, 0, FORMAT_YUV),
+};
+#undef MAKE
+
+static const struct format_info *find_format_info(uint32_t format)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(format_table, f) {
+		if (f->format == format)
+			return f;
+	}
+	return NULL;
+}
+
+bool video_format_is_supported(uint32_t format)
+{
+	return find_format_info(format) != NULL;
+}
+
+static uint32_t get_n_planes(const struct format_info *f)
+{
+	switch (f->kind) {
+	case KIND_PLANAR:
+		return 3;
+	case KIND_SEMI:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+/* the bytes in a line of a plane */
+static uint32_t get_line_size(const struct format_info *f, uint32_t plane, uint32_t width)
+{
+	switch (f->kind) {
+	case KIND_RGBA:
+		return width * 4;
+	case KIND_RGB:
+		return width * 3;
+	case KIND_RGBA_F32:
+		return width * 4 * sizeof(float);
+	case KIND_PLANAR:
+		return plane == 0 ? width : (width + 1) / 2;
+	case KIND_SEMI:
+		return plane == 0 ? width : SPA_ROUND_UP_N(width, 2);
+	case KIND_PACKED:
+		return SPA_ROUND_UP_N(width, 2) * 2;
+	default:
+		return width;
+	}
+}
+
+int video_layout_init(uint32_t format, uint32_t width, uint32_t height,
+		uint32_t stride, struct video_layout *layout)
+{
+	const struct format_info *f;
+	uint32_t min_stride, c_height = (height + 1) / 2;
+	uint64_t offset[VIDEO_MAX_PLANES] = { 0 }, size;
+
+	if ((f = find_format_info(format)) == NULL)
+		return -ENOTSUP;
+	if (width == 0 || height == 0 ||
+	    width > VIDEO_MAX_SIZE || height > VIDEO_MAX_SIZE)
+		return -EINVAL;
+
+	min_stride = get_line_size(f, 0, width);
+	if (stride == 0)
+		stride = SPA_ROUND_UP_N(min_stride, 4);
+	else if (stride < min_stride)
+		return -EINVAL;
+
+	spa_zero(*layout);
+	layout->n_planes = get_n_planes(f);
+	layout->stride[0] = stride;
+	layout->height[0] = height;
+
+	/* the stride can come from the peer, don't let the plane offsets
+	 * and size wrap around */
+	switch (f->kind) {
+	case KIND_PLANAR:
+		layout->stride[1] = layout->stride[2] = SPA_ROUND_UP_N((uint64_t)stride, 2) / 2;
+		layout->height[1] = layout->height[2] = c_height;
+		offset[1] = (uint64_t)stride * height;
+		offset[2] = offset[1] + (uint64_t)layout->stride[1] * c_height;
+		size = offset[2] + (uint64_t)layout->stride[2] * c_height;
+		break;
+	case KIND_SEMI:
+		if (stride > UINT32_MAX - 1)
+			return -EINVAL;
+		layout->stride[1] = SPA_ROUND_UP_N(stride, 2);
+		layout->height[1] = c_height;
+		offset[1] = (uint64_t)stride * height;
+		size = offset[1] + (uint64_t)layout->stride[1] * c_height;
+		break;
+	default:
+		size = (uint64_t)stride * height;
+		break;
+	}
+	if (size > UINT32_MAX)
+		return -EINVAL;
+
+	layout->offset[1] = offset[1];
+	layout->offset[2] = offset[2];
+	layout->size = size;
+	return 0;
+}
+
+struct kernel_info {
+	uint32_t cpu_flags;
+	const char *name;
+
+	yuv_to_rgba_func_t yuv_to_rgba;
+	rgba_to_yuv_func_t rgba_to_yuv;
+	split_yuyv_func_t split_yuyv;
+	merge_yuyv_func_t merge_yuyv;
+	split_uv_func_t split_uv;
+	merge_uv_func_t merge_uv;
+	scale_h_func_t scale_h;
+	scale_v_func_t scale_v;
+};
+
+#define MAKE(arch,flags)						\
+	{ flags, #arch, conv_yuv_to_rgba_##arch, conv_rgba_to_yuv_##arch,	\
+	  conv_split_yuyv_##arch, conv_merge_yuyv_##arch,			\
+	  conv_split_uv_##arch, conv_merge_uv_##arch,			\
+	  conv_scale_h_##arch, conv_scale_v_##arch }
+
+static const struct kernel_info kernel_table[] =
+{
+#if defined (HAVE_AVX2)
+	MAKE(avx2, SPA_CPU_FLAG_AVX2),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(sse2, SPA_CPU_FLAG_SSE2),
+#endif
+	MAKE(c, 0),
+};
+#undef MAKE
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct kernel_info *find_kernel_info(uint32_t cpu_flags)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(kernel_table, k) {
+		if (MATCH_CPU_FLAGS(k->cpu_flags, cpu_flags))
+			return k;
+	}
+	return NULL;
+}
+
+#define Q13(v)	((int16_t)lrint((v) * 8192.0))
+#define Q15(v)	((int16_t)lrint((v) * 32768.0))
+
+static void matrix_init(struct convert *conv, uint32_t height)
+{
+	struct video_matrix *m = &conv->matrix;
+	double kr, kb, kg, ys, cs;
+	bool full;
+
+	switch (conv->color_matrix) {
+	case SPA_VIDEO_COLOR_MATRIX_FCC:
+		kr = 0.30; kb = 0.11;
+		break;
+	case SPA_VIDEO_COLOR_MATRIX_BT709:
+		kr = 0.2126; kb = 0.0722;
+		break;
+	case SPA_VIDEO_COLOR_MATRIX_BT601:
+		kr = 0.299; kb = 0.114;
+		break;
+	case SPA_VIDEO_COLOR_MATRIX_SMPTE240M:
+		kr = 0.212; kb = 0.087;
+		break;
+	case SPA_VIDEO_COLOR_MATRIX_BT2020:
+		kr = 0.2627; kb = 0.0593;
+		break;
+	default:
+		/* BT601 for SD and BT709 for HD */
+		if (height > 576) {
+			kr = 0.2126; kb = 0.0722;
+		} else {
+			kr = 0.299; kb = 0.114;
+		}
+		break;
+	}
+	kg = 1.0 - kr - kb;
+
+	full = conv->color_range == SPA_VIDEO_COLOR_RANGE_0_255;
+	ys = full ? 1.0 : 255.0 / 219.0;
+	cs = full ? 1.0 : 255.0 / 224.0;
+
+	m->y_offset = full ? 0 : 16;
+	m->y_gain = Q13(ys);
+	m->r_v = Q13(2.0 * (1.0 - kr) * cs);
+	m->g_u = Q13(-2.0 * kb * (1.0 - kb) / kg * cs);
+	m->g_v = Q13(-2.0 * kr * (1.0 - kr) / kg * cs);
+	m->b_u = Q13(2.0 * (1.0 - kb) * cs);
+
+	m->y_r = Q15(kr / ys);
+	m->y_g = Q15(kg / ys);
+	m->y_b = Q15(kb / ys);
+	m->u_r = Q15(-kr / (2.0 * (1.0 - kb)) / cs);
+	m->u_g = Q15(-kg / (2.0 * (1.0 - kb)) / cs);
+	m->u_b = Q15(0.5 / cs);
+	m->v_r = Q15(0.5 / cs);
+	m->v_g = Q15(-kg / (2.0 * (1.0 - kr)) / cs);
+	m->v_b = Q15(-kb / (2.0 * (1.0 - kr)) / cs);
+}
+
+/* The frames are converted line by line. The source lines are unpacked to
+ * 4 bytes pixels, RGBA or YUVA when both formats are YUV, scaled and packed
+ * again. When there is no scaling, the YUV kernels read and write the frames
+ * directly when the RGB side is RGBA or BGRA. */
+struct state {
+	const struct format_info *src;
+	const struct format_info *dst;
+
+	unsigned int yuv:1;		/* the lines are YUVA */
+	unsigned int direct_src:1;	/* pack from the source lines */
+	unsigned int direct_dst:1;	/* unpack into the destination lines */
+	unsigned int swap_src:1;
+	unsigned int swap_dst:1;
+	uint32_t pack_lines;
+
+	yuv_to_rgba_func_t unpack_yuv;
+	rgba_to_yuv_func_t pack_yuv;
+
+	uint8_t *tmp;			/* unpacked source line and padding */
+	uint8_t *cache[2];		/* scaled source lines, by parity */
+	int32_t cache_line[2];
+	uint8_t *out[2];		/* vertically scaled lines */
+	uint8_t *sy, *su, *sv;		/* planes of a source line */
+	int32_t uv_line;
+	uint8_t *dy, *du, *dv;		/* planes of a destination line */
+	uint8_t *gray;			/* neutral chroma */
+};
+
+#define LINE(f,p,l)	SPA_PTROFF((f)->data[p], (size_t)(l) * (f)->stride[p], uint8_t)
+
+/* YUVA lines, used when there is no color conversion */
+static void yuv_to_yuva(struct convert *conv, uint8_t * SPA_RESTRICT dst,
+		const uint8_t *y, const uint8_t *u, const uint8_t *v,
+		uint32_t width, bool swap)
+{
+	uint32_t n;
+
+	for (n = 0; n < width; n++) {
+		dst[0] = y[n];
+		dst[1] = u[n >> 1];
+		dst[2] = v[n >> 1];
+		dst[3] = 0xff;
+		dst += 4;
+	}
+}
+
+static void yuva_to_yuv(struct convert *conv, uint8_t *y0, uint8_t *y1,
+		uint8_t *u, uint8_t *v, const uint8_t *s0, const uint8_t *s1,
+		uint32_t width, bool swap)
+{
+	uint32_t n;
+
+	for (n = 0; n < width; n++) {
+		y0[n] = s0[n * 4];
+		if (y1)
+			y1[n] = s1[n * 4];
+	}
+	for (n = 0; n < width; n += 2) {
+		uint32_t next = n + 1 < width ? 4 : 0;
+		const uint8_t *p = &s0[n * 4];
+
+		if (s1) {
+			const uint8_t *q = &s1[n * 4];
+			u[n >> 1] = (p[1] + p[1 + next] + q[1] + q[1 + next] + 2) >> 2;
+			v[n >> 1] = (p[2] + p[2 + next] + q[2] + q[2 + next] + 2) >> 2;
+		} else {
+			u[n >> 1] = (p[1] + p[1 + next] + 1) >> 1;
+			v[n >> 1] = (p[2] + p[2 + next] + 1) >> 1;
+		}
+	}
+}
+
+static inline uint8_t float_to_u8(float v)
+{
+	return (uint8_t)(SPA_CLAMPF(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static void unpack_rgb(const struct format_info *f, uint8_t *d, const uint8_t *s,
+		uint32_t width)
+{
+	const float *sf = (const float *)s;
+	uint32_t n;
+
+	switch (f->kind) {
+	case KIND_RGBA:
+		for (n = 0; n < width; n++, d += 4, s += 4) {
+			d[0] = s[f->offs[0]];
+			d[1] = s[f->offs[1]];
+			d[2] = s[f->offs[2]];
+			d[3] = f->flags & FORMAT_ALPHA ? s[f->offs[3]] : 0xff;
+		}
+		break;
+	case KIND_RGB:
+		for (n = 0; n < width; n++, d += 4, s += 3) {
+			d[0] = s[f->offs[0]];
+			d[1] = s[f->offs[1]];
+			d[2] = s[f->offs[2]];
+			d[3] = 0xff;
+		}
+		break;
+	case KIND_RGBA_F32:
+		for (n = 0; n < width * 4; n++)
+			d[n] = float_to_u8(sf[n]);
+		break;
+	}
+}
+
+static void pack_rgb(const struct format_info *f, uint8_t *d, const uint8_t *s,
+		uint32_t width)
+{
+	float *df = (float *)d;
+	uint32_t n;
+
+	switch (f->kind) {
+	case KIND_RGBA:
+		for (n = 0; n < width; n++, d += 4, s += 4) {
+			d[f->offs[0]] = s[0];
+			d[f->offs[1]] = s[1];
+			d[f->offs[2]] = s[2];
+			d[f->offs[3]] = f->flags & FORMAT_ALPHA ? s[3] : 0xff;
+		}
+		break;
+	case KIND_RGB:
+		for (n = 0; n < width; n++, d += 3, s += 4) {
+			d[f->offs[0]] = s[0];
+			d[f->offs[1]] = s[1];
+			d[f->offs[2]] = s[2];
+		}
+		break;
+	case KIND_RGBA_F32:
+		for (n = 0; n < width * 4; n++)
+			df[n] = s[n] * (1.0f / 255.0f);
+		break;
+	}
+}
+
+static void get_yuv_line(struct convert *conv, struct state *s,
+		const struct video_frame *frame, uint32_t line,
+		const uint8_t **y, const uint8_t **u, const uint8_t **v)
+{
+	const struct format_info *f = s->src;
+	bool swap = f->flags & FORMAT_SWAP;
+	uint32_t width = conv->src_width;
+
+	switch (f->kind) {
+	case KIND_GRAY:
+		*y = LINE(frame, 0, line);
+		*u = *v = s->gray;
+		return;
+	case KIND_PLANAR:
+		*y = LINE(frame, 0, line);
+		*u = LINE(frame, f->offs[1], line >> 1);
+		*v = LINE(frame, f->offs[2], line >> 1);
+		return;
+	case KIND_SEMI:
+		*y = LINE(frame, 0, line);
+		/* the chroma line is shared by two lines */
+		if (s->uv_line != (int32_t)(line >> 1)) {
+			conv->split_uv(swap ? s->sv : s->su, swap ? s->su : s->sv,
+					LINE(frame, 1, line >> 1), (width + 1) / 2);
+			s->uv_line = line >> 1;
+		}
+		break;
+	case KIND_PACKED:
+		conv->split_yuyv(s->sy, swap ? s->sv : s->su, swap ? s->su : s->sv,
+				LINE(frame, 0, line), width, f->flags & FORMAT_Y_FIRST);
+		*y = s->sy;
+		break;
+	default:
+		*y = LINE(frame, 0, line);
+		break;
+	}
+	*u = s->su;
+	*v = s->sv;
+}
+
+static void unpack_line(struct convert *conv, struct state *s,
+		const struct video_frame *frame, uint32_t line, uint8_t *d)
+{
+	const uint8_t *y, *u, *v;
+
+	if (!(s->src->flags & FORMAT_YUV)) {
+		unpack_rgb(s->src, d, LINE(frame, 0, line), conv->src_width);
+	} else {
+		get_yuv_line(conv, s, frame, line, &y, &u, &v);
+		s->unpack_yuv(conv, d, y, u, v, conv->src_width, s->swap_dst);
+	}
+}
+
+static void pack_lines(struct convert *conv, struct state *s,
+		const struct video_frame *frame, uint32_t line,
+		const uint8_t *rows[2], uint32_t n_lines)
+{
+	const struct format_info *f = s->dst;
+	bool swap = f->flags & FORMAT_SWAP;
+	uint32_t i, width = conv->dst_width;
+	const uint8_t *s1 = n_lines > 1 ? rows[1] : NULL;
+	uint8_t *y1 = n_lines > 1 ? LINE(frame, 0, line + 1) : NULL;
+
+	switch (f->kind) {
+	case KIND_GRAY:
+		s->pack_yuv(conv, LINE(frame, 0, line), NULL, s->du, s->dv,
+				rows[0], NULL, width, s->swap_src);
+		break;
+	case KIND_PLANAR:
+		s->pack_yuv(conv, LINE(frame, 0, line), y1,
+				LINE(frame, f->offs[1], line >> 1),
+				LINE(frame, f->offs[2], line >> 1),
+				rows[0], s1, width, s->swap_src);
+		break;
+	case KIND_SEMI:
+		s->pack_yuv(conv, LINE(frame, 0, line), y1, s->du, s->dv,
+				rows[0], s1, width, s->swap_src);
+		conv->merge_uv(LINE(frame, 1, line >> 1),
+				swap ? s->dv : s->du, swap ? s->du : s->dv,
+				(width + 1) / 2);
+		break;
+	case KIND_PACKED:
+		s->pack_yuv(conv, s->dy, NULL, s->du, s->dv,
+				rows[0], NULL, width, s->swap_src);
+		conv->merge_yuyv(LINE(frame, 0, line), s->dy,
+				swap ? s->dv : s->du, swap ? s->du : s->dv,
+				width, f->flags & FORMAT_Y_FIRST);
+		break;
+	default:
+		for (i = 0; i < n_lines; i++)
+			pack_rgb(f, LINE(frame, 0, line + i), rows[i], width);
+		break;
+	}
+}
+
+/* the source position of the center of a destination pixel, in Q8 */
+static uint32_t scale_pos(uint32_t i, uint32_t src_size, uint32_t dst_size,
+		uint32_t *weight)
+{
+	int64_t pos = (int64_t)(2 * i + 1) * src_size * 256 / (2 * dst_size) - 128;
+	uint32_t index;
+
+	pos = SPA_MAX(pos, 0);
+	index = pos >> 8;
+	*weight = pos & 0xff;
+	if (index >= src_size - 1) {
+		index = src_size - 1;
+		*weight = 0;
+	}
+	return index;
+}
+
+static const uint8_t *get_src_line(struct convert *conv, struct state *s,
+		const struct video_frame *src, uint32_t line)
+{
+	uint32_t slot = line & 1, width = conv->src_width;
+
+	if (s->cache_line[slot] == (int32_t)line)
+		return s->cache[slot];
+
+	if (width == conv->dst_width) {
+		unpack_line(conv, s, src, line, s->cache[slot]);
+	} else {
+		unpack_line(conv, s, src, line, s->tmp);
+		/* the filter reads one pixel past the end */
+		memcpy(&s->tmp[width * 4], &s->tmp[(width - 1) * 4], 4);
+		conv->scale_h(conv, (uint32_t *)s->cache[slot],
+				(const uint32_t *)s->tmp, conv->dst_width);
+	}
+	s->cache_line[slot] = line;
+	return s->cache[slot];
+}
+
+static const uint8_t *get_line(struct convert *conv, struct state *s,
+		const struct video_frame *src, uint32_t line, uint32_t index)
+{
+	const uint8_t *s0, *s1;
+	uint32_t src_line, weight;
+
+	if (s->direct_src)
+		return LINE(src, 0, line);
+	if (conv->src_height == conv->dst_height)
+		return get_src_line(conv, s, src, line);
+
+	src_line = scale_pos(line, conv->src_height, conv->dst_height, &weight);
+	s0 = get_src_line(conv, s, src, src_line);
+	if (weight == 0) {
+		memcpy(s->out[index], s0, conv->dst_width * 4);
+	} else {
+		s1 = get_src_line(conv, s, src, src_line + 1);
+		conv->scale_v(s->out[index], s0, s1, conv->dst_width * 4, weight);
+	}
+	return s->out[index];
+}
+
+static void impl_convert_process(struct convert *conv, const struct video_frame *dst,
+		const struct video_frame *src)
+{
+	struct state *s = conv->data;
+	const uint8_t *rows[2];
+	uint32_t line, i, n_lines;
+
+	s->cache_line[0] = s->cache_line[1] = -1;
+	s->uv_line = -1;
+
+	for (line = 0; line < conv->dst_height; line += n_lines) {
+		n_lines = SPA_MIN(s->pack_lines, conv->dst_height - line);
+
+		if (s->direct_dst) {
+			unpack_line(conv, s, src, line, LINE(dst, 0, line));
+			continue;
+		}
+		for (i = 0; i < n_lines; i++)
+			rows[i] = get_line(conv, s, src, line + i, i);
+		pack_lines(conv, s, dst, line, rows, n_lines);
+	}
+}
+
+static void impl_convert_copy(struct convert *conv, const struct video_frame *dst,
+		const struct video_frame *src)
+{
+	struct state *s = conv->data;
+	uint32_t i, line, n_planes = get_n_planes(s->src);
+
+	for (i = 0; i < n_planes; i++) {
+		uint32_t size = get_line_size(s->src, i, conv->src_width);
+		uint32_t height = i == 0 ? conv->src_height : (conv->src_height + 1) / 2;
+
+		if (src->stride[i] == dst->stride[i] && src->stride[i] == size) {
+			memcpy(dst->data[i], src->data[i], size * height);
+			continue;
+		}
+		for (line = 0; line < height; line++)
+			memcpy(LINE(dst, i, line), LINE(src, i, line), size);
+	}
+}
+
+static void impl_convert_free(struct convert *conv)
+{
+	free(conv->data);
+	conv->data = NULL;
+}
+
+static bool is_rgba(const struct format_info *f)
+{
+	return f->kind == KIND_RGBA && f->offs[1] == 1 && f->offs[3] == 3;
+}
+
+int convert_init(struct convert *conv)
+{
+	const struct format_info *src, *dst;
+	const struct kernel_info *k;
+	struct state *s;
+	uint32_t i, width, line_size, plane_size, data_size;
+	uint8_t *p;
+
+	if ((src = find_format_info(conv->src_fmt)) == NULL ||
+	    (dst = find_format_info(conv->dst_fmt)) == NULL)
+		return -ENOTSUP;
+	if (conv->src_width == 0 || conv->src_width > VIDEO_MAX_SIZE ||
+	    conv->src_height == 0 || conv->src_height > VIDEO_MAX_SIZE ||
+	    conv->dst_width == 0 || conv->dst_width > VIDEO_MAX_SIZE ||
+	    conv->dst_height == 0 || conv->dst_height > VIDEO_MAX_SIZE)
+		return -EINVAL;
+	if ((k = find_kernel_info(conv->cpu_flags)) == NULL)
+		return -ENOTSUP;
+
+	width = SPA_MAX(conv->src_width, conv->dst_width);
+	line_size = SPA_ROUND_UP_N((width + 1) * 4, VIDEO_OPS_MAX_ALIGN);
+	plane_size = SPA_ROUND_UP_N(width + VIDEO_OPS_MAX_ALIGN, VIDEO_OPS_MAX_ALIGN);
+	data_size = SPA_ROUND_UP_N(sizeof(struct state), VIDEO_OPS_MAX_ALIGN) +
+		5 * line_size + 7 * plane_size +
+		SPA_ROUND_UP_N(conv->dst_width * sizeof(uint32_t), VIDEO_OPS_MAX_ALIGN) +
+		SPA_ROUND_UP_N(conv->dst_width * sizeof(uint16_t), VIDEO_OPS_MAX_ALIGN);
+
+	conv->data = calloc(VIDEO_OPS_MAX_ALIGN + data_size, 1);
+	if (conv->data == NULL)
+		return -errno;
+
+	s = conv->data;
+	p = SPA_PTR_ALIGN(SPA_PTROFF(s, sizeof(struct state), void), VIDEO_OPS_MAX_ALIGN, uint8_t);
+	s->tmp = p; p += line_size;
+	s->cache[0] = p; p += line_size;
+	s->cache[1] = p; p += line_size;
+	s->out[0] = p; p += line_size;
+	s->out[1] = p; p += line_size;
+	s->sy = p; p += plane_size;
+	s->su = p; p += plane_size;
+	s->sv = p; p += plane_size;
+	s->dy = p; p += plane_size;
+	s->du = p; p += plane_size;
+	s->dv = p; p += plane_size;
+	s->gray = p; p += plane_size;
+	memset(s->gray, 128, plane_size);
+	conv->x_offset = (uint32_t *)p;
+	p += SPA_ROUND_UP_N(conv->dst_width * sizeof(uint32_t), VIDEO_OPS_MAX_ALIGN);
+	conv->x_weight = (uint16_t *)p;
+
+	for (i = 0; i < conv->dst_width; i++) {
+		uint32_t weight;
+		conv->x_offset[i] = scale_pos(i, conv->src_width, conv->dst_width, &weight);
+		conv->x_weight[i] = weight;
+	}
+
+	s->src = src;
+	s->dst = dst;
+	s->yuv = (src->flags & FORMAT_YUV) && (dst->flags & FORMAT_YUV);
+	s->unpack_yuv = s->yuv ? yuv_to_yuva : k->yuv_to_rgba;
+	s->pack_yuv = s->yuv ? yuva_to_yuv : k->rgba_to_yuv;
+	s->pack_lines = dst->kind == KIND_PLANAR || dst->kind == KIND_SEMI ? 2 : 1;
+
+	conv->scale = conv->src_width != conv->dst_width ||
+		conv->src_height != conv->dst_height;
+	conv->is_passthrough = conv->src_fmt == conv->dst_fmt && !conv->scale;
+
+	if (!conv->scale && (src->flags & FORMAT_YUV) && is_rgba(dst)) {
+		s->direct_dst = true;
+		s->swap_dst = dst->offs[0] == 2;
+	} else if (!conv->scale && is_rgba(src) && (dst->flags & FORMAT_YUV)) {
+		s->direct_src = true;
+		s->swap_src = src->offs[0] == 2;
+	}
+
+	matrix_init(conv, (src->flags & FORMAT_YUV) ? conv->src_height : conv->dst_height);
+
+	conv->yuv_to_rgba = k->yuv_to_rgba;
+	conv->rgba_to_yuv = k->rgba_to_yuv;
+	conv->split_yuyv = k->split_yuyv;
+	conv->merge_yuyv = k->merge_yuyv;
+	conv->split_uv = k->split_uv;
+	conv->merge_uv = k->merge_uv;
+	conv->scale_h = k->scale_h;
+	conv->scale_v = k->scale_v;
+	conv->kernel_name = k->name;
+	conv->cpu_flags = k->cpu_flags;
+
+	if (conv->is_passthrough) {
+		conv->process = impl_convert_copy;
+		conv->func_name = "copy";
+	} else {
+		conv->process = impl_convert_process;
+		if (s->direct_dst)
+			conv->func_name = "yuv_to_rgba";
+		else if (s->direct_src)
+			conv->func_name = "rgba_to_yuv";
+		else if (conv->scale)
+			conv->func_name = "scale";
+		else
+			conv->func_name = "convert";
+	}
+	conv->free = impl_convert_free;
+
+	return 0;
+}
@@ -0,0 +1,163 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <spa/utils/defs.h>
+#include <spa/param/video/raw.h>
+
+#define VIDEO_OPS_MAX_ALIGN	32
+#define VIDEO_MAX_PLANES	4
+#define VIDEO_MAX_SIZE		16384
+
+struct video_frame {
+	void *data[VIDEO_MAX_PLANES];
+	uint32_t stride[VIDEO_MAX_PLANES];
+};
+
+struct video_layout {
+	uint32_t n_planes;
+	uint32_t stride[VIDEO_MAX_PLANES];
+	uint32_t offset[VIDEO_MAX_PLANES];
+	uint32_t height[VIDEO_MAX_PLANES];
+	uint32_t size;
+};
+
+/* fixed point color matrix */
+struct video_matrix {
+	/* Y'CbCr to R'G'B' in Q13, the luma is scaled after subtracting
+	 * y_offset, the chroma after subtracting 128 */
+	int16_t y_offset;
+	int16_t y_gain;
+	int16_t r_v, g_u, g_v, b_u;
+	/* R'G'B' to Y'CbCr in Q15 */
+	int16_t y_r, y_g, y_b;
+	int16_t u_r, u_g, u_b;
+	int16_t v_r, v_g, v_b;
+};
+
+/* mulhi of two Q numbers, like the SIMD instructions */
+#define MULHI(a,b)	((int16_t)(((int32_t)(a) * (int32_t)(b)) >> 16))
+
+struct convert;
+
+/* YUV 4:2:x lines to RGBA, BGRA when swap is set */
+typedef void (*yuv_to_rgba_func_t) (struct convert *conv, uint8_t * SPA_RESTRICT dst,
+		const uint8_t *y, const uint8_t *u, const uint8_t *v,
+		uint32_t width, bool swap);
+/* one or two RGBA lines to YUV, the chroma is the average of the pixels of
+ * both lines when s1 is not NULL */
+typedef void (*rgba_to_yuv_func_t) (struct convert *conv, uint8_t *y0, uint8_t *y1,
+		uint8_t *u, uint8_t *v, const uint8_t *s0, const uint8_t *s1,
+		uint32_t width, bool swap);
+typedef void (*split_yuyv_func_t) (uint8_t *y, uint8_t *u, uint8_t *v,
+		const uint8_t * SPA_RESTRICT src, uint32_t width, bool y_first);
+typedef void (*merge_yuyv_func_t) (uint8_t * SPA_RESTRICT dst, const uint8_t *y,
+		const uint8_t *u, const uint8_t *v, uint32_t width, bool y_first);
+typedef void (*split_uv_func_t) (uint8_t *u, uint8_t *v, const uint8_t * SPA_RESTRICT src,
+		uint32_t n_pairs);
+typedef void (*merge_uv_func_t) (uint8_t * SPA_RESTRICT dst, const uint8_t *u,
+		const uint8_t *v, uint32_t n_pairs);
+/* bilinear scaling of a line of 4 bytes pixels, the source needs one extra
+ * pixel at the end */
+typedef void (*scale_h_func_t) (struct convert *conv, uint32_t * SPA_RESTRICT dst,
+		const uint32_t * SPA_RESTRICT src, uint32_t width);
+/* blend two lines with a Q8 weight of the second line */
+typedef void (*scale_v_func_t) (uint8_t * SPA_RESTRICT dst, const uint8_t *s0,
+		const uint8_t *s1, uint32_t n_bytes, uint32_t weight);
+
+struct convert {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint32_t color_matrix;
+	uint32_t color_range;
+	uint32_t cpu_flags;
+	const char *func_name;
+
+	unsigned int is_passthrough:1;
+	unsigned int scale:1;
+
+	struct video_matrix matrix;
+
+	void (*process) (struct convert *conv, const struct video_frame *dst,
+			const struct video_frame *src);
+	void (*free) (struct convert *conv);
+
+	/* the line kernels, selected for the cpu */
+	yuv_to_rgba_func_t yuv_to_rgba;
+	rgba_to_yuv_func_t rgba_to_yuv;
+	split_yuyv_func_t split_yuyv;
+	merge_yuyv_func_t merge_yuyv;
+	split_uv_func_t split_uv;
+	merge_uv_func_t merge_uv;
+	scale_h_func_t scale_h;
+	scale_v_func_t scale_v;
+	const char *kernel_name;
+
+	void *data;
+	/* horizontal scaling, source pixel and Q8 weight of the next pixel */
+	uint32_t *x_offset;
+	uint16_t *x_weight;
+};
+
+int convert_init(struct convert *conv);
+
+int video_layout_init(uint32_t format, uint32_t width, uint32_t height,
+		uint32_t stride, struct video_layout *layout);
+bool video_format_is_supported(uint32_t format);
+
+#define convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
+#define convert_free(conv)		(conv)->free(conv)
+
+#define DEFINE_YUV_TO_RGBA(arch)						\
+void conv_yuv_to_rgba_##arch(struct convert *conv, uint8_t * SPA_RESTRICT dst,	\
+		const uint8_t *y, const uint8_t *u, const uint8_t *v,		\
+		uint32_t width, bool swap)
+#define DEFINE_RGBA_TO_YUV(arch)						\
+void conv_rgba_to_yuv_##arch(struct convert *conv, uint8_t *y0, uint8_t *y1,	\
+		uint8_t *u, uint8_t *v, const uint8_t *s0, const uint8_t *s1,	\
+		uint32_t width, bool swap)
+#define DEFINE_SPLIT_YUYV(arch)							\
+void conv_split_yuyv_##arch(uint8_t *y, uint8_t *u, uint8_t *v,		\
+		const uint8_t * SPA_RESTRICT src, uint32_t width, bool y_first)
+#define DEFINE_MERGE_YUYV(arch)							\
+void conv_merge_yuyv_##arch(uint8_t * SPA_RESTRICT dst, const uint8_t *y,	\
+		const uint8_t *u, const uint8_t *v, uint32_t width, bool y_first)
+#define DEFINE_SPLIT_UV(arch)							\
+void conv_split_uv_##arch(uint8_t *u, uint8_t *v,				\
+		const uint8_t * SPA_RESTRICT src, uint32_t n_pairs)
+#define DEFINE_MERGE_UV(arch)							\
+void conv_merge_uv_##arch(uint8_t * SPA_RESTRICT dst, const uint8_t *u,	\
+		const uint8_t *v, uint32_t n_pairs)
+#define DEFINE_SCALE_H(arch)							\
+void conv_scale_h_##arch(struct convert *conv, uint32_t * SPA_RESTRICT dst,	\
+		const uint32_t * SPA_RESTRICT src, uint32_t width)
+#define DEFINE_SCALE_V(arch)							\
+void conv_scale_v_##arch(uint8_t * SPA_RESTRICT dst, const uint8_t *s0,	\
+		const uint8_t *s1, uint32_t n_bytes, uint32_t weight)
+
+#define DEFINE_KERNELS(arch)		\
+	DEFINE_YUV_TO_RGBA(arch);	\
+	DEFINE_RGBA_TO_YUV(arch);	\
+	DEFINE_SPLIT_YUYV(arch);	\
+	DEFINE_MERGE_YUYV(arch);	\
+	DEFINE_SPLIT_UV(arch);		\
+	DEFINE_MERGE_UV(arch);		\
+	DEFINE_SCALE_H(arch);		\
+	DEFINE_SCALE_V(arch)
+
+DEFINE_KERNELS(c);
+#if defined(HAVE_SSE2)
+DEFINE_KERNELS(sse2);
+#endif
+#if defined(HAVE_AVX2)
+DEFINE_KERNELS(avx2);
+#endif
+
+#undef DEFINE_KERNELS
@@ -492,6 +492,61 @@ extern const struct spa_handle_factory spa_videoconvert_factory;
 
 static const struct spa_node_events follower_node_events;
 
+/* find the first format of the follower that the converter can handle */
+static int find_convert_format(struct impl *this, struct spa_pod_builder *b,
+		struct spa_pod **format)
+{
+	struct spa_pod_builder_state st;
+	struct spa_pod *f;
+	uint32_t fstate, cstate;
+	int res;
+
+	spa_pod_builder_get_state(b, &st);
+	for (fstate = 0;;) {
+		spa_pod_builder_reset(b, &st);
+		if ((res = spa_node_port_enum_params_sync(this->follower,
+					this->direction, 0,
+					SPA_PARAM_EnumFormat, &fstate,
+					NULL, &f, b)) != 1) {
+			if (res == 0 || res == -ENOENT)
+				return 0;
+			debug_params(this, this->follower, this->direction, 0,
+					SPA_PARAM_EnumFormat, NULL, "follower format", res);
+			return res;
+		}
+		cstate = 0;
+		if ((res = spa_node_port_enum_params_sync(this->convert,
+					SPA_DIRECTION_REVERSE(this->direction), 0,
+					SPA_PARAM_EnumFormat, &cstate,
+					f, format, b)) == 1)
+			return 1;
+
+		debug_params(this, this->convert,
+				SPA_DIRECTION_REVERSE(this->direction), 0,
+				SPA_PARAM_EnumFormat, f, "convert format", res);
+	}
+}
+
+/* the converter only handles some raw formats, check that the follower
+ * can produce or consume one of them before we go into convert mode */
+static bool follower_can_convert(struct impl *this)
+{
+	struct spa_pod *format;
+	uint8_t buffer[4096];
+	struct spa_pod_builder b = { 0 };
+	int res;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	spa_node_send_command(this->follower,
+			&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_ParamBegin));
+	res = find_convert_format(this, &b, &format);
+	spa_node_send_command(this->follower,
+			&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_ParamEnd));
+
+	return res == 1;
+}
+
 static int reconfigure_mode(struct impl *this, bool passthrough,
                 enum spa_direction direction, struct spa_pod *format)
 {
@@ -614,6 +669,11 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 		case SPA_PARAM_PORT_CONFIG_MODE_dsp:
 			if (this->convert == NULL)
 				return -ENOTSUP;
+			if (!follower_can_convert(this)) {
+				spa_log_info(this->log, "%p: follower has no format to convert",
+						this);
+				return -ENOTSUP;
+			}
 			if ((res = reconfigure_mode(this, false, dir, NULL)) < 0)
 				return res;
 			break;
@@ -706,7 +766,6 @@ static struct spa_pod *merge_objects(struct impl *this, struct spa_pod_builder *
 
 static int negotiate_format(struct impl *this)
 {
-	uint32_t state;
 	struct spa_pod *format, *def;
 	uint8_t buffer[4096];
 	struct spa_pod_builder b = { 0 };
@@ -725,35 +784,11 @@ static int negotiate_format(struct impl *this)
 	spa_node_send_command(this->follower,
 			&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_ParamBegin));
 
-	state = 0;
-	format = NULL;
-	if ((res = spa_node_port_enum_params_sync(this->follower,
-				this->direction, 0,
-				SPA_PARAM_EnumFormat, &state,
-				format, &format, &b)) < 0) {
-		if (res == -ENOENT)
-			format = NULL;
-		else {
-			debug_params(this, this->follower, this->direction, 0,
-					SPA_PARAM_EnumFormat, format, "follower format", res);
-			goto done;
-		}
-	}
-	if (this->convert) {
-		state = 0;
-		if ((res = spa_node_port_enum_params_sync(this->convert,
-					SPA_DIRECTION_REVERSE(this->direction), 0,
-					SPA_PARAM_EnumFormat, &state,
-					format, &format, &b)) != 1) {
-			debug_params(this, this->convert,
-					SPA_DIRECTION_REVERSE(this->direction), 0,
-					SPA_PARAM_EnumFormat, format, "convert format", res);
+	/* we are in convert mode, pick a follower format the converter
+	 * can handle, not just the first one */
+	if ((res = find_convert_format(this, &b, &format)) <= 0) {
+		if (res == 0)
 			res = -ENOTSUP;
-			goto done;
-		}
-	}
-	if (format == NULL) {
-		res = -ENOTSUP;
 		goto done;
 	}
 
@@ -1524,9 +1559,7 @@ impl_get_size(const struct spa_handle_factory *factory,
 {
 	size_t size = 0;
 
-#if 0
 	size += spa_handle_factory_get_size(&spa_videoconvert_factory, params);
-#endif
 	size += sizeof(struct impl);
 
 	return size;
@@ -1540,9 +1573,7 @@ impl_init(const struct spa_handle_factory *factory,
 	  uint32_t n_support)
 {
 	struct impl *this;
-#if 0
 	void *iface;
-#endif
 	const char *str;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
@@ -1576,7 +1607,6 @@ impl_init(const struct spa_handle_factory *factory,
 			SPA_VERSION_NODE,
 			&impl_node, this);
 
-#if 0
 	this->hnd_convert = SPA_PTROFF(this, sizeof(struct impl), struct spa_handle);
 	spa_handle_factory_init(&spa_videoconvert_factory,
 				this->hnd_convert,
@@ -1584,7 +1614,6 @@ impl_init(const struct spa_handle_factory *factory,
 
 	spa_handle_get_interface(this->hnd_convert, SPA_TYPE_INTERFACE_Node, &iface);
 	this->convert = iface;
-#endif
 	this->target = this->convert;
 
 	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS |
@@ -0,0 +1,1560 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/cpu.h>
+#include <spa/support/log.h>
+#include <spa/utils/result.h>
+#include <spa/utils/list.h>
+#include <spa/utils/names.h>
+#include <spa/utils/string.h>
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/node/utils.h>
+#include <spa/node/keys.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/param/param.h>
+#include <spa/param/latency-utils.h>
+#include <spa/param/tag-utils.h>
+#include <spa/pod/filter.h>
+#include <spa/pod/dynamic.h>
+#include <spa/debug/types.h>
+
+#include "video-ops.h"
+
+#undef SPA_LOG_TOPIC_DEFAULT
+#define SPA_LOG_TOPIC_DEFAULT &log_topic
+static struct spa_log_topic log_topic = SPA_LOG_TOPIC(0, "spa.videoconvert");
+
+#define DEFAULT_WIDTH		320
+#define DEFAULT_HEIGHT		240
+#define DEFAULT_FRAMERATE	25
+
+#define MAX_ALIGN	VIDEO_OPS_MAX_ALIGN
+#define MAX_BUFFERS	32
+#define MAX_PORTS	1
+
+static const uint32_t video_formats[] = {
+	SPA_VIDEO_FORMAT_I420,
+	SPA_VIDEO_FORMAT_YV12,
+	SPA_VIDEO_FORMAT_NV12,
+	SPA_VIDEO_FORMAT_NV21,
+	SPA_VIDEO_FORMAT_YUY2,
+	SPA_VIDEO_FORMAT_YVYU,
+	SPA_VIDEO_FORMAT_UYVY,
+	SPA_VIDEO_FORMAT_RGBA,
+	SPA_VIDEO_FORMAT_BGRA,
+	SPA_VIDEO_FORMAT_ARGB,
+	SPA_VIDEO_FORMAT_ABGR,
+	SPA_VIDEO_FORMAT_RGBx,
+	SPA_VIDEO_FORMAT_BGRx,
+	SPA_VIDEO_FORMAT_xRGB,
+	SPA_VIDEO_FORMAT_xBGR,
+	SPA_VIDEO_FORMAT_RGB,
+	SPA_VIDEO_FORMAT_BGR,
+	SPA_VIDEO_FORMAT_GRAY8,
+};
+
+struct buffer {
+	uint32_t id;
+#define BUFFER_FLAG_QUEUED	(1<<0)
+	uint32_t flags;
+	struct spa_list link;
+	struct spa_buffer *buf;
+	struct spa_meta_header *h;
+};
+
+struct port {
+	uint32_t direction;
+	uint32_t id;
+
+	struct spa_io_buffers *io;
+
+	uint64_t info_all;
+	struct spa_port_info info;
+#define IDX_EnumFormat	0
+#define IDX_Meta	1
+#define IDX_IO		2
+#define IDX_Format	3
+#define IDX_Buffers	4
+#define IDX_Latency	5
+#define IDX_Tag		6
+#define N_PORT_PARAMS	7
+	struct spa_param_info params[N_PORT_PARAMS];
+
+	struct buffer buffers[MAX_BUFFERS];
+	uint32_t n_buffers;
+
+	struct spa_latency_info latency[2];
+	unsigned int have_latency:1;
+
+	struct spa_video_info format;
+	unsigned int have_format:1;
+	unsigned int is_dsp:1;
+
+	uint32_t video_format;
+	struct spa_rectangle size;
+	struct video_layout layout;
+
+	struct spa_list queue;
+};
+
+struct dir {
+	struct port *ports[MAX_PORTS];
+	uint32_t n_ports;
+
+	enum spa_direction direction;
+	enum spa_param_port_config_mode mode;
+
+	struct spa_video_info format;
+	unsigned int have_format:1;
+
+	struct spa_pod *tag;
+};
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_node node;
+
+	struct spa_log *log;
+	struct spa_cpu *cpu;
+
+	uint32_t cpu_flags;
+	uint32_t max_align;
+
+	struct spa_io_position *io_position;
+
+	uint64_t info_all;
+	struct spa_node_info info;
+#define IDX_EnumPortConfig	0
+#define IDX_PortConfig		1
+#define N_NODE_PARAMS		2
+	struct spa_param_info params[N_NODE_PARAMS];
+
+	struct spa_hook_list hooks;
+
+	struct dir dir[2];
+
+	struct convert conv;
+
+	unsigned int started:1;
+	unsigned int setup:1;
+};
+
+#define CHECK_PORT(this,d,p)		((p) < this->dir[d].n_ports)
+#define GET_PORT(this,d,p)		(this->dir[d].ports[p])
+#define GET_IN_PORT(this,p)		GET_PORT(this,SPA_DIRECTION_INPUT,p)
+#define GET_OUT_PORT(this,p)		GET_PORT(this,SPA_DIRECTION_OUTPUT,p)
+
+#define PORT_IS_DSP(this,d,p)		(GET_PORT(this,d,p)->is_dsp)
+
+static void emit_node_info(struct impl *this, bool full)
+{
+	uint64_t old = full ? this->info.change_mask : 0;
+
+	spa_log_debug(this->log, "%p: info full:%d change:%08"PRIx64,
+			this, full, this->info.change_mask);
+
+	if (full)
+		this->info.change_mask = this->info_all;
+	if (this->info.change_mask) {
+		if (this->info.change_mask & SPA_NODE_CHANGE_MASK_PARAMS) {
+			SPA_FOR_EACH_ELEMENT_VAR(this->params, p) {
+				if (p->user > 0) {
+					p->flags ^= SPA_PARAM_INFO_SERIAL;
+					p->user = 0;
+				}
+			}
+		}
+		spa_node_emit_info(&this->hooks, &this->info);
+		this->info.change_mask = old;
+	}
+}
+
+static void emit_port_info(struct impl *this, struct port *port, bool full)
+{
+	uint64_t old = full ? port->info.change_mask : 0;
+
+	spa_log_debug(this->log, "%p: port info %d:%d", this,
+			port->direction, port->id);
+
+	if (full)
+		port->info.change_mask = port->info_all;
+	if (port->info.change_mask) {
+		struct spa_dict_item items[1];
+		uint32_t n_items = 0;
+
+		if (port->is_dsp)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_FORMAT_DSP, "32 bit float RGBA video");
+		port->info.props = &SPA_DICT_INIT(items, n_items);
+
+		if (port->info.change_mask & SPA_PORT_CHANGE_MASK_PARAMS) {
+			SPA_FOR_EACH_ELEMENT_VAR(port->params, p) {
+				if (p->user > 0) {
+					p->flags ^= SPA_PARAM_INFO_SERIAL;
+					p->user = 0;
+				}
+			}
+		}
+		spa_node_emit_port_info(&this->hooks, port->direction, port->id, &port->info);
+		port->info.change_mask = old;
+	}
+}
+
+static int init_port(struct impl *this, enum spa_direction direction, uint32_t port_id,
+		bool is_dsp)
+{
+	struct port *port = GET_PORT(this, direction, port_id);
+
+	if (port == NULL) {
+		port = calloc(1, sizeof(struct port));
+		if (port == NULL)
+			return -errno;
+		this->dir[direction].ports[port_id] = port;
+	}
+	port->direction = direction;
+	port->id = port_id;
+	port->latency[SPA_DIRECTION_INPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_INPUT);
+	port->latency[SPA_DIRECTION_OUTPUT] = SPA_LATENCY_INFO(SPA_DIRECTION_OUTPUT);
+
+	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
+			SPA_PORT_CHANGE_MASK_PROPS |
+			SPA_PORT_CHANGE_MASK_PARAMS;
+	port->info = SPA_PORT_INFO_INIT();
+	port->info.flags = SPA_PORT_FLAG_NO_REF |
+		SPA_PORT_FLAG_DYNAMIC_DATA;
+	port->params[IDX_EnumFormat] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port->params[IDX_Meta] = SPA_PARAM_INFO(SPA_PARAM_Meta, SPA_PARAM_INFO_READ);
+	port->params[IDX_IO] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[IDX_Buffers] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->params[IDX_Latency] = SPA_PARAM_INFO(SPA_PARAM_Latency, SPA_PARAM_INFO_READWRITE);
+	port->params[IDX_Tag] = SPA_PARAM_INFO(SPA_PARAM_Tag, SPA_PARAM_INFO_READWRITE);
+	port->info.params = port->params;
+	port->info.n_params = N_PORT_PARAMS;
+
+	port->n_buffers = 0;
+	port->have_format = false;
+	port->is_dsp = is_dsp;
+	spa_list_init(&port->queue);
+
+	spa_log_debug(this->log, "%p: add port %d:%d dsp:%d",
+			this, direction, port_id, is_dsp);
+	emit_port_info(this, port, true);
+
+	return 0;
+}
+
+static int impl_node_enum_params(void *object, int seq,
+				 uint32_t id, uint32_t start, uint32_t num,
+				 const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[4096];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_EnumPortConfig:
+	{
+		struct dir *dir;
+		switch (result.index) {
+		case 0:
+			dir = &this->dir[SPA_DIRECTION_INPUT];
+			break;
+		case 1:
+			dir = &this->dir[SPA_DIRECTION_OUTPUT];
+			break;
+		default:
+			return 0;
+		}
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamPortConfig, id,
+			SPA_PARAM_PORT_CONFIG_direction, SPA_POD_Id(dir->direction),
+			SPA_PARAM_PORT_CONFIG_mode,      SPA_POD_CHOICE_ENUM_Id(4,
+				SPA_PARAM_PORT_CONFIG_MODE_none,
+				SPA_PARAM_PORT_CONFIG_MODE_none,
+				SPA_PARAM_PORT_CONFIG_MODE_dsp,
+				SPA_PARAM_PORT_CONFIG_MODE_convert),
+			SPA_PARAM_PORT_CONFIG_monitor,   SPA_POD_CHOICE_Bool(false),
+			SPA_PARAM_PORT_CONFIG_control,   SPA_POD_CHOICE_Bool(false));
+		break;
+	}
+	case SPA_PARAM_PortConfig:
+	{
+		struct dir *dir;
+		struct spa_pod_frame f[1];
+
+		switch (result.index) {
+		case 0:
+			dir = &this->dir[SPA_DIRECTION_INPUT];
+			break;
+		case 1:
+			dir = &this->dir[SPA_DIRECTION_OUTPUT];
+			break;
+		default:
+			return 0;
+		}
+		spa_pod_builder_push_object(&b, &f[0],
+				SPA_TYPE_OBJECT_ParamPortConfig, id);
+		spa_pod_builder_add(&b,
+			SPA_PARAM_PORT_CONFIG_direction, SPA_POD_Id(dir->direction),
+			SPA_PARAM_PORT_CONFIG_mode,      SPA_POD_Id(dir->mode),
+			SPA_PARAM_PORT_CONFIG_monitor,   SPA_POD_Bool(false),
+			SPA_PARAM_PORT_CONFIG_control,   SPA_POD_Bool(false),
+			0);
+
+		if (dir->have_format) {
+			spa_pod_builder_prop(&b, SPA_PARAM_PORT_CONFIG_format, 0);
+			spa_format_video_raw_build(&b, SPA_PARAM_Format,
+					&dir->format.info.raw);
+		}
+		param = spa_pod_builder_pop(&b, &f[0]);
+		break;
+	}
+	default:
+		return 0;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_log_debug(this->log, "%p: io %d %p/%zd", this, id, data, size);
+
+	switch (id) {
+	case SPA_IO_Position:
+		this->io_position = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static int reconfigure_mode(struct impl *this, enum spa_param_port_config_mode mode,
+		enum spa_direction direction, struct spa_video_info *info)
+{
+	struct dir *dir;
+	uint32_t i;
+	int res;
+
+	dir = &this->dir[direction];
+
+	if (dir->have_format && info && memcmp(&dir->format, info, sizeof(*info)) == 0 &&
+	    dir->mode == mode)
+		return 0;
+
+	spa_log_debug(this->log, "%p: port config direction:%d mode:%d %d",
+			this, direction, mode, dir->mode);
+
+	for (i = 0; i < dir->n_ports; i++)
+		spa_node_emit_port_info(&this->hooks, direction, i, NULL);
+
+	dir->have_format = false;
+	if (info) {
+		dir->format = *info;
+		dir->have_format = true;
+	}
+
+	switch (mode) {
+	case SPA_PARAM_PORT_CONFIG_MODE_dsp:
+		dir->n_ports = 1;
+		if ((res = init_port(this, direction, 0, true)) < 0)
+			return res;
+		break;
+	case SPA_PARAM_PORT_CONFIG_MODE_convert:
+		dir->n_ports = 1;
+		if ((res = init_port(this, direction, 0, false)) < 0)
+			return res;
+		break;
+	case SPA_PARAM_PORT_CONFIG_MODE_none:
+		dir->n_ports = 0;
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	dir->mode = mode;
+	this->setup = false;
+
+	this->info.change_mask |= SPA_NODE_CHANGE_MASK_FLAGS | SPA_NODE_CHANGE_MASK_PARAMS;
+	this->info.flags &= ~SPA_NODE_FLAG_NEED_CONFIGURE;
+	this->params[IDX_PortConfig].user++;
+	return 0;
+}
+
+static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
+			       const struct spa_pod *param)
+{
+	struct impl *this = object;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	if (param == NULL)
+		return 0;
+
+	switch (id) {
+	case SPA_PARAM_PortConfig:
+	{
+		struct spa_video_info info = { 0, }, *infop = NULL;
+		struct spa_pod *format = NULL;
+		enum spa_direction direction;
+		enum spa_param_port_config_mode mode;
+		bool monitor = false, control = false;
+
+		if (spa_pod_parse_object(param,
+				SPA_TYPE_OBJECT_ParamPortConfig, NULL,
+				SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(&direction),
+				SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(&mode),
+				SPA_PARAM_PORT_CONFIG_monitor,		SPA_POD_OPT_Bool(&monitor),
+				SPA_PARAM_PORT_CONFIG_control,		SPA_POD_OPT_Bool(&control),
+				SPA_PARAM_PORT_CONFIG_format,		SPA_POD_OPT_Pod(&format)) < 0)
+			return -EINVAL;
+
+		if (direction > SPA_DIRECTION_OUTPUT)
+			return -EINVAL;
+		if (monitor || control)
+			return -ENOTSUP;
+
+		if (format) {
+			if (!spa_pod_is_object_type(format, SPA_TYPE_OBJECT_Format))
+				return -EINVAL;
+
+			if ((res = spa_format_parse(format, &info.media_type,
+							&info.media_subtype)) < 0)
+				return res;
+
+			if (info.media_type != SPA_MEDIA_TYPE_video ||
+			    info.media_subtype != SPA_MEDIA_SUBTYPE_raw)
+				return -EINVAL;
+
+			if (spa_format_video_raw_parse(format, &info.info.raw) < 0)
+				return -EINVAL;
+
+			if (info.info.raw.size.width == 0 ||
+			    info.info.raw.size.height == 0 ||
+			    info.info.raw.size.width > VIDEO_MAX_SIZE ||
+			    info.info.raw.size.height > VIDEO_MAX_SIZE)
+				return -EINVAL;
+
+			infop = &info;
+		}
+
+		spa_log_debug(this->log, "mode:%d direction:%d", mode, direction);
+
+		if ((res = reconfigure_mode(this, mode, direction, infop)) < 0)
+			return res;
+
+		emit_node_info(this, false);
+		break;
+	}
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+/* the size of a port, DSP ports take the size of the PortConfig format or
+ * of the other side because they are never scaled */
+static int get_port_size(struct impl *this, struct port *port, struct spa_rectangle *size)
+{
+	struct dir *dir = &this->dir[port->direction];
+	struct dir *other = &this->dir[SPA_DIRECTION_REVERSE(port->direction)];
+	struct port *oport;
+
+	if (!port->is_dsp) {
+		if (!port->have_format)
+			return -EIO;
+		*size = port->format.info.raw.size;
+		return 0;
+	}
+	if (dir->have_format) {
+		*size = dir->format.info.raw.size;
+		return 0;
+	}
+	if (other->n_ports > 0) {
+		oport = other->ports[0];
+		if (oport->have_format && !oport->is_dsp) {
+			*size = oport->format.info.raw.size;
+			return 0;
+		}
+	}
+	if (other->have_format) {
+		*size = other->format.info.raw.size;
+		return 0;
+	}
+	return -EIO;
+}
+
+static int update_layout(struct impl *this, struct port *port)
+{
+	int res;
+
+	if ((res = get_port_size(this, port, &port->size)) < 0)
+		return res;
+
+	if ((res = video_layout_init(port->video_format, port->size.width,
+				port->size.height, 0, &port->layout)) < 0) {
+		spa_log_error(this->log, "%p: can't make layout for format:%d %dx%d: %s",
+				this, port->video_format, port->size.width,
+				port->size.height, spa_strerror(res));
+		return res;
+	}
+	return 0;
+}
+
+static int setup_convert(struct impl *this)
+{
+	struct port *in_port, *out_port;
+	const struct spa_video_info_raw *in_info = NULL, *out_info = NULL;
+	int res;
+
+	if (this->setup)
+		return 0;
+
+	if (this->dir[SPA_DIRECTION_INPUT].n_ports == 0 ||
+	    this->dir[SPA_DIRECTION_OUTPUT].n_ports == 0)
+		return -EIO;
+
+	in_port = GET_IN_PORT(this, 0);
+	out_port = GET_OUT_PORT(this, 0);
+
+	if (!in_port->have_format || !out_port->have_format)
+		return -EIO;
+
+	if ((res = update_layout(this, in_port)) < 0 ||
+	    (res = update_layout(this, out_port)) < 0)
+		return res;
+
+	if (!in_port->is_dsp)
+		in_info = &in_port->format.info.raw;
+	if (!out_port->is_dsp)
+		out_info = &out_port->format.info.raw;
+
+	if (this->conv.free)
+		convert_free(&this->conv);
+
+	spa_zero(this->conv);
+	this->conv.src_fmt = in_port->video_format;
+	this->conv.dst_fmt = out_port->video_format;
+	this->conv.src_width = in_port->size.width;
+	this->conv.src_height = in_port->size.height;
+	this->conv.dst_width = out_port->size.width;
+	this->conv.dst_height = out_port->size.height;
+	this->conv.cpu_flags = this->cpu_flags;
+
+	/* the YUV side decides the colorimetry */
+	if (in_info && in_info->color_matrix != SPA_VIDEO_COLOR_MATRIX_UNKNOWN) {
+		this->conv.color_matrix = in_info->color_matrix;
+		this->conv.color_range = in_info->color_range;
+	} else if (out_info) {
+		this->conv.color_matrix = out_info->color_matrix;
+		this->conv.color_range = out_info->color_range;
+	}
+
+	if ((res = convert_init(&this->conv)) < 0) {
+		spa_log_error(this->log, "%p: can't convert %d %dx%d -> %d %dx%d: %s",
+				this, this->conv.src_fmt, this->conv.src_width,
+				this->conv.src_height, this->conv.dst_fmt,
+				this->conv.dst_width, this->conv.dst_height,
+				spa_strerror(res));
+		return res;
+	}
+
+	spa_log_info(this->log, "%p: got converter %s:%s %d %dx%d -> %d %dx%d passthrough:%d",
+			this, this->conv.func_name, this->conv.kernel_name,
+			this->conv.src_fmt, this->conv.src_width, this->conv.src_height,
+			this->conv.dst_fmt, this->conv.dst_width, this->conv.dst_height,
+			this->conv.is_passthrough);
+
+	this->setup = true;
+	return 0;
+}
+
+static int impl_node_send_command(void *object, const struct spa_command *command)
+{
+	struct impl *this = object;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(command != NULL, -EINVAL);
+
+	switch (SPA_NODE_COMMAND_ID(command)) {
+	case SPA_NODE_COMMAND_Start:
+		if (this->started)
+			return 0;
+		if ((res = setup_convert(this)) < 0)
+			return res;
+		this->started = true;
+		break;
+	case SPA_NODE_COMMAND_Suspend:
+		this->setup = false;
+		SPA_FALLTHROUGH;
+	case SPA_NODE_COMMAND_Pause:
+		this->started = false;
+		break;
+	case SPA_NODE_COMMAND_Flush:
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	return 0;
+}
+
+static int
+impl_node_add_listener(void *object,
+		struct spa_hook *listener,
+		const struct spa_node_events *events,
+		void *data)
+{
+	struct impl *this = object;
+	uint32_t i;
+	struct spa_hook_list save;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_log_trace(this->log, "%p: add listener %p", this, listener);
+	spa_hook_list_isolate(&this->hooks, &save, listener, events, data);
+
+	emit_node_info(this, true);
+	for (i = 0; i < this->dir[SPA_DIRECTION_INPUT].n_ports; i++) {
+		emit_port_info(this, GET_IN_PORT(this, i), true);
+	}
+	for (i = 0; i < this->dir[SPA_DIRECTION_OUTPUT].n_ports; i++) {
+		emit_port_info(this, GET_OUT_PORT(this, i), true);
+	}
+	spa_hook_list_join(&this->hooks, &save);
+
+	return 0;
+}
+
+static int
+impl_node_set_callbacks(void *object,
+			const struct spa_node_callbacks *callbacks,
+			void *user_data)
+{
+	return 0;
+}
+
+static int impl_node_add_port(void *object, enum spa_direction direction, uint32_t port_id,
+		const struct spa_dict *props)
+{
+	return -ENOTSUP;
+}
+
+static int
+impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_id)
+{
+	return -ENOTSUP;
+}
+
+static int port_enum_formats(void *object,
+			     enum spa_direction direction, uint32_t port_id,
+			     uint32_t index,
+			     struct spa_pod **param,
+			     struct spa_pod_builder *builder)
+{
+	struct impl *this = object;
+	struct dir *other = &this->dir[SPA_DIRECTION_REVERSE(direction)];
+	const struct spa_video_info_raw *def = NULL;
+	struct port *oport;
+
+	switch (index) {
+	case 0:
+		if (PORT_IS_DSP(this, direction, port_id)) {
+			struct spa_video_info_dsp info = { 0, };
+			info.format = SPA_VIDEO_FORMAT_DSP_F32;
+			*param = spa_format_video_dsp_build(builder,
+				SPA_PARAM_EnumFormat, &info);
+		} else {
+			struct spa_pod_frame f[2];
+			struct spa_rectangle size = SPA_RECTANGLE(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+			struct spa_fraction rate = SPA_FRACTION(DEFAULT_FRAMERATE, 1);
+			uint32_t i, format = video_formats[0];
+
+			/* prefer the format of the other side so that we can
+			 * pass through, we can't convert the framerate */
+			if (other->n_ports > 0) {
+				oport = other->ports[0];
+				if (oport->have_format && !oport->is_dsp)
+					def = &oport->format.info.raw;
+			}
+			if (def == NULL && other->have_format)
+				def = &other->format.info.raw;
+
+			if (def != NULL) {
+				if (video_format_is_supported(def->format) &&
+				    def->format != SPA_VIDEO_FORMAT_DSP_F32)
+					format = def->format;
+				size = def->size;
+				rate = def->framerate;
+			}
+
+			spa_pod_builder_push_object(builder, &f[0],
+					SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+			spa_pod_builder_add(builder,
+				SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_video),
+				SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+				0);
+			spa_pod_builder_prop(builder, SPA_FORMAT_VIDEO_format, 0);
+			spa_pod_builder_push_choice(builder, &f[1], SPA_CHOICE_Enum, 0);
+			spa_pod_builder_id(builder, format);
+			for (i = 0; i < SPA_N_ELEMENTS(video_formats); i++)
+				spa_pod_builder_id(builder, video_formats[i]);
+			spa_pod_builder_pop(builder, &f[1]);
+
+			spa_pod_builder_add(builder,
+				SPA_FORMAT_VIDEO_size,     SPA_POD_CHOICE_RANGE_Rectangle(
+								&size,
+								&SPA_RECTANGLE(1, 1),
+								&SPA_RECTANGLE(VIDEO_MAX_SIZE, VIDEO_MAX_SIZE)),
+				0);
+			if (def != NULL && def->framerate.denom != 0) {
+				spa_pod_builder_add(builder,
+					SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction(&rate),
+					0);
+			} else {
+				spa_pod_builder_add(builder,
+					SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
+								&rate,
+								&SPA_FRACTION(0, 1),
+								&SPA_FRACTION(INT32_MAX, 1)),
+					0);
+			}
+			*param = spa_pod_builder_pop(builder, &f[0]);
+		}
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static int
+impl_node_port_enum_params(void *object, int seq,
+			   enum spa_direction direction, uint32_t port_id,
+			   uint32_t id, uint32_t start, uint32_t num,
+			   const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct port *port;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[4096];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	spa_log_debug(this->log, "%p: enum params port %d.%d %d %u",
+			this, direction, port_id, seq, id);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_EnumFormat:
+		if ((res = port_enum_formats(object, direction, port_id, result.index, &param, &b)) <= 0)
+			return res;
+		break;
+	case SPA_PARAM_Format:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		if (PORT_IS_DSP(this, direction, port_id))
+			param = spa_format_video_dsp_build(&b, id, &port->format.info.dsp);
+		else
+			param = spa_format_video_raw_build(&b, id, &port->format.info.raw);
+		break;
+	case SPA_PARAM_Buffers:
+	{
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		if ((res = update_layout(this, port)) < 0)
+			return res;
+
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, id,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(2, 1, MAX_BUFFERS),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_CHOICE_RANGE_Int(1, 1,
+								port->layout.n_planes),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(port->layout.size),
+			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(port->layout.stride[0]),
+			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(this->max_align));
+		break;
+	}
+	case SPA_PARAM_Meta:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamMeta, id,
+				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+	case SPA_PARAM_IO:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamIO, id,
+				SPA_PARAM_IO_id,   SPA_POD_Id(SPA_IO_Buffers),
+				SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_buffers)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+	case SPA_PARAM_Latency:
+		switch (result.index) {
+		case 0: case 1:
+			param = spa_latency_build(&b, id, &port->latency[result.index]);
+			break;
+		default:
+			return 0;
+		}
+		break;
+	case SPA_PARAM_Tag:
+		switch (result.index) {
+		case 0: case 1:
+			param = this->dir[result.index].tag;
+			if (param == NULL)
+				goto next;
+			break;
+		default:
+			return 0;
+		}
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int clear_buffers(struct impl *this, struct port *port)
+{
+	if (port->n_buffers > 0) {
+		spa_log_debug(this->log, "%p: clear buffers %p", this, port);
+		port->n_buffers = 0;
+		spa_list_init(&port->queue);
+	}
+	return 0;
+}
+
+static int port_set_latency(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   const struct spa_pod *latency)
+{
+	struct impl *this = object;
+	struct port *port, *oport;
+	enum spa_direction other = SPA_DIRECTION_REVERSE(direction);
+	struct spa_latency_info info;
+	bool have_latency;
+	uint32_t i;
+
+	spa_log_debug(this->log, "%p: set latency direction:%d id:%d %p",
+			this, direction, port_id, latency);
+
+	port = GET_PORT(this, direction, port_id);
+
+	if (latency == NULL) {
+		info = SPA_LATENCY_INFO(other);
+		have_latency = false;
+	} else {
+		if (spa_latency_parse(latency, &info) < 0 ||
+		    info.direction != other)
+			return -EINVAL;
+		have_latency = true;
+	}
+	port->latency[other] = info;
+	port->have_latency = have_latency;
+
+	/* we process in place, pass the latency to the other side */
+	for (i = 0; i < this->dir[other].n_ports; i++) {
+		oport = GET_PORT(this, other, i);
+		if (spa_latency_info_compare(&info, &oport->latency[other]) != 0) {
+			oport->latency[other] = info;
+			oport->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+			oport->params[IDX_Latency].user++;
+			emit_port_info(this, oport, false);
+		}
+	}
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	port->params[IDX_Latency].user++;
+	emit_port_info(this, port, false);
+	return 0;
+}
+
+static int port_set_tag(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   const struct spa_pod *tag)
+{
+	struct impl *this = object;
+	struct port *port, *oport;
+	enum spa_direction other = SPA_DIRECTION_REVERSE(direction);
+	uint32_t i;
+
+	spa_log_debug(this->log, "%p: set tag direction:%d id:%d %p",
+			this, direction, port_id, tag);
+
+	port = GET_PORT(this, direction, port_id);
+
+	if (tag != NULL) {
+		struct spa_tag_info info;
+		void *state = NULL;
+		if (spa_tag_parse(tag, &info, &state) < 0 ||
+		    info.direction != other)
+			return -EINVAL;
+	}
+	if (spa_tag_compare(tag, this->dir[other].tag) != 0) {
+		free(this->dir[other].tag);
+		this->dir[other].tag = tag ? spa_pod_copy(tag) : NULL;
+
+		for (i = 0; i < this->dir[other].n_ports; i++) {
+			oport = GET_PORT(this, other, i);
+			oport->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+			oport->params[IDX_Tag].user++;
+			emit_port_info(this, oport, false);
+		}
+	}
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	port->params[IDX_Tag].user++;
+	emit_port_info(this, port, false);
+	return 0;
+}
+
+static int port_set_format(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   const struct spa_pod *format)
+{
+	struct impl *this = object;
+	struct port *port, *oport;
+	struct dir *other = &this->dir[SPA_DIRECTION_REVERSE(direction)];
+	int res;
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_log_debug(this->log, "%p: set format", this);
+
+	if (format == NULL) {
+		port->have_format = false;
+		clear_buffers(this, port);
+	} else {
+		struct spa_video_info info = { 0 };
+
+		if ((res = spa_format_parse(format, &info.media_type, &info.media_subtype)) < 0) {
+			spa_log_error(this->log, "can't parse format %s", spa_strerror(res));
+			return res;
+		}
+		if (PORT_IS_DSP(this, direction, port_id)) {
+			if (info.media_type != SPA_MEDIA_TYPE_video ||
+			    info.media_subtype != SPA_MEDIA_SUBTYPE_dsp) {
+				spa_log_error(this->log, "unexpected types %d/%d",
+						info.media_type, info.media_subtype);
+				return -EINVAL;
+			}
+			if ((res = spa_format_video_dsp_parse(format, &info.info.dsp)) < 0) {
+				spa_log_error(this->log, "can't parse format %s", spa_strerror(res));
+				return res;
+			}
+			if (info.info.dsp.format != SPA_VIDEO_FORMAT_DSP_F32) {
+				spa_log_error(this->log, "unexpected format %d<->%d",
+					info.info.dsp.format, SPA_VIDEO_FORMAT_DSP_F32);
+				return -EINVAL;
+			}
+			port->video_format = info.info.dsp.format;
+		} else {
+			if (info.media_type != SPA_MEDIA_TYPE_video ||
+			    info.media_subtype != SPA_MEDIA_SUBTYPE_raw) {
+				spa_log_error(this->log, "unexpected types %d/%d",
+						info.media_type, info.media_subtype);
+				return -EINVAL;
+			}
+			if ((res = spa_format_video_raw_parse(format, &info.info.raw)) < 0) {
+				spa_log_error(this->log, "can't parse format %s", spa_strerror(res));
+				return res;
+			}
+			if (!video_format_is_supported(info.info.raw.format) ||
+			    info.info.raw.size.width == 0 ||
+			    info.info.raw.size.height == 0 ||
+			    info.info.raw.size.width > VIDEO_MAX_SIZE ||
+			    info.info.raw.size.height > VIDEO_MAX_SIZE) {
+				spa_log_error(this->log, "invalid format:%d size:%dx%d",
+						info.info.raw.format,
+						info.info.raw.size.width,
+						info.info.raw.size.height);
+				return -EINVAL;
+			}
+			port->video_format = info.info.raw.format;
+		}
+		port->format = info;
+		port->have_format = true;
+		this->setup = false;
+
+		spa_log_debug(this->log, "%p: %d format:%d", this,
+				port_id, port->video_format);
+	}
+
+	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+	if (port->have_format) {
+		port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READWRITE);
+		port->params[IDX_Buffers] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
+	} else {
+		port->params[IDX_Format] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+		port->params[IDX_Buffers] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	}
+	emit_port_info(this, port, false);
+
+	/* the formats of the other side now prefer this format and a DSP
+	 * port takes its size from it */
+	if (other->n_ports > 0) {
+		oport = other->ports[0];
+		oport->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+		oport->params[IDX_EnumFormat].user++;
+		if (oport->is_dsp && oport->have_format)
+			oport->params[IDX_Buffers].user++;
+		emit_port_info(this, oport, false);
+	}
+	return 0;
+}
+
+static int
+impl_node_port_set_param(void *object,
+			 enum spa_direction direction, uint32_t port_id,
+			 uint32_t id, uint32_t flags,
+			 const struct spa_pod *param)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_log_debug(this->log, "%p: set param port %d.%d %u",
+			this, direction, port_id, id);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	switch (id) {
+	case SPA_PARAM_Latency:
+		return port_set_latency(this, direction, port_id, flags, param);
+	case SPA_PARAM_Tag:
+		return port_set_tag(this, direction, port_id, flags, param);
+	case SPA_PARAM_Format:
+		return port_set_format(this, direction, port_id, flags, param);
+	default:
+		return -ENOENT;
+	}
+}
+
+static inline void queue_buffer(struct impl *this, struct port *port, uint32_t id)
+{
+	struct buffer *b = &port->buffers[id];
+
+	spa_log_trace_fp(this->log, "%p: queue buffer %d on port %d %d",
+			this, id, port->id, b->flags);
+	if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_QUEUED))
+		return;
+
+	spa_list_append(&port->queue, &b->link);
+	SPA_FLAG_SET(b->flags, BUFFER_FLAG_QUEUED);
+}
+
+static inline struct buffer *dequeue_buffer(struct impl *this, struct port *port)
+{
+	struct buffer *b;
+
+	if (spa_list_is_empty(&port->queue))
+		return NULL;
+
+	b = spa_list_first(&port->queue, struct buffer, link);
+	spa_list_remove(&b->link);
+	SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_QUEUED);
+	spa_log_trace_fp(this->log, "%p: dequeue buffer %d on port %d %u",
+			this, b->id, port->id, b->flags);
+	return b;
+}
+
+static int
+impl_node_port_use_buffers(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   struct spa_buffer **buffers,
+			   uint32_t n_buffers)
+{
+	struct impl *this = object;
+	struct port *port;
+	uint32_t i, j;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_log_debug(this->log, "%p: use buffers %d on port %d:%d",
+			this, n_buffers, direction, port_id);
+
+	clear_buffers(this, port);
+
+	if (n_buffers > 0 && !port->have_format)
+		return -EIO;
+	if (n_buffers > MAX_BUFFERS)
+		return -ENOSPC;
+	if (n_buffers > 0 && (res = update_layout(this, port)) < 0)
+		return res;
+
+	for (i = 0; i < n_buffers; i++) {
+		struct buffer *b;
+		uint32_t n_datas = buffers[i]->n_datas;
+		struct spa_data *d = buffers[i]->datas;
+
+		b = &port->buffers[i];
+		b->id = i;
+		b->flags = 0;
+		b->buf = buffers[i];
+		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+
+		/* either all planes in one block or one block per plane */
+		if (n_datas != 1 && n_datas < port->layout.n_planes) {
+			spa_log_error(this->log, "%p: invalid blocks %d on buffer %d",
+					this, n_datas, i);
+			return -EINVAL;
+		}
+		for (j = 0; j < n_datas; j++) {
+			if (d[j].data == NULL) {
+				spa_log_error(this->log, "%p: invalid memory %d on buffer %d %d %p",
+						this, j, i, d[j].type, d[j].data);
+				return -EINVAL;
+			}
+			if (!SPA_IS_ALIGNED(d[j].data, this->max_align)) {
+				spa_log_warn(this->log, "%p: memory %d on buffer %d not aligned",
+						this, j, i);
+			}
+		}
+		if (n_datas == 1 && d[0].maxsize < port->layout.size) {
+			spa_log_error(this->log, "%p: buffer %d too small %d < %d",
+					this, i, d[0].maxsize, port->layout.size);
+			return -EINVAL;
+		}
+		for (j = 0; n_datas > 1 && j < port->layout.n_planes; j++) {
+			uint64_t size = (uint64_t)port->layout.stride[j] * port->layout.height[j];
+			if (d[j].maxsize < size) {
+				spa_log_error(this->log, "%p: plane %d of buffer %d too small %d < %"PRIu64,
+						this, j, i, d[j].maxsize, size);
+				return -EINVAL;
+			}
+		}
+		if (direction == SPA_DIRECTION_OUTPUT)
+			queue_buffer(this, port, i);
+	}
+	port->n_buffers = n_buffers;
+
+	return 0;
+}
+
+static int
+impl_node_port_set_io(void *object,
+		      enum spa_direction direction, uint32_t port_id,
+		      uint32_t id, void *data, size_t size)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_log_debug(this->log, "%p: set io %d on port %d:%d %p",
+			this, id, direction, port_id, data);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	switch (id) {
+	case SPA_IO_Buffers:
+		port->io = data;
+		break;
+	case SPA_IO_RateMatch:
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, SPA_DIRECTION_OUTPUT, port_id), -EINVAL);
+
+	port = GET_OUT_PORT(this, port_id);
+	queue_buffer(this, port, buffer_id);
+
+	return 0;
+}
+
+/* make a frame for the buffer, the planes are either in separate datas or
+ * packed in the first data with the layout of the port */
+static int get_frame(struct impl *this, struct port *port, struct buffer *b,
+		struct video_frame *frame, bool input)
+{
+	struct spa_data *d = b->buf->datas;
+	const struct video_layout *l = &port->layout;
+	struct video_layout tmp;
+	uint32_t i;
+	int res;
+
+	if (b->buf->n_datas >= l->n_planes && l->n_planes > 1) {
+		for (i = 0; i < l->n_planes; i++) {
+			uint32_t offs = 0, stride = l->stride[i];
+
+			if (input) {
+				offs = d[i].chunk->offset;
+				if (d[i].chunk->stride > 0)
+					stride = d[i].chunk->stride;
+				/* the rows of the plane need to fit in the memory */
+				if (stride < l->stride[i] ||
+				    (uint64_t)offs + (uint64_t)stride * l->height[i] > d[i].maxsize)
+					return -ENOSPC;
+			}
+			frame->data[i] = SPA_PTROFF(d[i].data, offs, void);
+			frame->stride[i] = stride;
+		}
+		return 0;
+	}
+	if (input) {
+		uint32_t offs = SPA_MIN(d[0].chunk->offset, d[0].maxsize);
+		int32_t stride = d[0].chunk->stride;
+
+		if (stride > 0 && (uint32_t)stride != l->stride[0]) {
+			if ((res = video_layout_init(port->video_format, port->size.width,
+						port->size.height, stride, &tmp)) < 0)
+				return res;
+			l = &tmp;
+		}
+		/* all planes need to fit in the memory */
+		if ((uint64_t)offs + l->size > d[0].maxsize)
+			return -ENOSPC;
+
+		for (i = 0; i < l->n_planes; i++) {
+			frame->data[i] = SPA_PTROFF(d[0].data, offs + l->offset[i], void);
+			frame->stride[i] = l->stride[i];
+		}
+	} else {
+		for (i = 0; i < l->n_planes; i++) {
+			frame->data[i] = SPA_PTROFF(d[0].data, l->offset[i], void);
+			frame->stride[i] = l->stride[i];
+		}
+	}
+	return 0;
+}
+
+static void set_chunks(struct port *port, struct buffer *b)
+{
+	struct spa_data *d = b->buf->datas;
+	const struct video_layout *l = &port->layout;
+	uint32_t i;
+
+	if (b->buf->n_datas >= l->n_planes && l->n_planes > 1) {
+		for (i = 0; i < l->n_planes; i++) {
+			uint32_t end = i + 1 < l->n_planes ? l->offset[i + 1] : l->size;
+			d[i].chunk->offset = 0;
+			d[i].chunk->size = end - l->offset[i];
+			d[i].chunk->stride = l->stride[i];
+			d[i].chunk->flags = 0;
+		}
+	} else {
+		d[0].chunk->offset = 0;
+		d[0].chunk->size = l->size;
+		d[0].chunk->stride = l->stride[0];
+		d[0].chunk->flags = 0;
+	}
+}
+
+static int impl_node_process(void *object)
+{
+	struct impl *this = object;
+	struct port *in_port, *out_port;
+	struct spa_io_buffers *inio, *outio;
+	struct buffer *sbuf, *dbuf;
+	struct video_frame src, dst;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	if (SPA_UNLIKELY(!this->setup))
+		return -EIO;
+
+	in_port = GET_IN_PORT(this, 0);
+	out_port = GET_OUT_PORT(this, 0);
+
+	outio = out_port->io;
+	inio = in_port->io;
+	if (SPA_UNLIKELY(outio == NULL || inio == NULL))
+		return -EIO;
+
+	spa_log_trace_fp(this->log, "%p: status %p %d %d -> %p %d %d", this,
+			inio, inio->status, inio->buffer_id,
+			outio, outio->status, outio->buffer_id);
+
+	if (outio->status == SPA_STATUS_HAVE_DATA)
+		return SPA_STATUS_HAVE_DATA;
+
+	/* recycle */
+	if (outio->buffer_id < out_port->n_buffers) {
+		queue_buffer(this, out_port, outio->buffer_id);
+		outio->buffer_id = SPA_ID_INVALID;
+	}
+	if (inio->status != SPA_STATUS_HAVE_DATA)
+		return outio->status = SPA_STATUS_NEED_DATA;
+
+	if (SPA_UNLIKELY(inio->buffer_id >= in_port->n_buffers))
+		return inio->status = -EINVAL;
+
+	if (SPA_UNLIKELY((dbuf = dequeue_buffer(this, out_port)) == NULL)) {
+		spa_log_trace_fp(this->log, "%p: out of buffers", this);
+		return -EPIPE;
+	}
+	sbuf = &in_port->buffers[inio->buffer_id];
+
+	if (SPA_UNLIKELY((res = get_frame(this, in_port, sbuf, &src, true)) < 0 ||
+	    (res = get_frame(this, out_port, dbuf, &dst, false)) < 0)) {
+		spa_log_warn(this->log, "%p: invalid buffer: %s", this, spa_strerror(res));
+		queue_buffer(this, out_port, dbuf->id);
+		inio->status = SPA_STATUS_NEED_DATA;
+		return SPA_STATUS_NEED_DATA;
+	}
+
+	convert_process(&this->conv, &dst, &src);
+
+	set_chunks(out_port, dbuf);
+	if (sbuf->h && dbuf->h)
+		*dbuf->h = *sbuf->h;
+
+	outio->buffer_id = dbuf->id;
+	outio->status = SPA_STATUS_HAVE_DATA;
+	inio->status = SPA_STATUS_NEED_DATA;
+
+	return SPA_STATUS_HAVE_DATA | SPA_STATUS_NEED_DATA;
+}
+
+static const struct spa_node_methods impl_node = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = impl_node_add_listener,
+	.set_callbacks = impl_node_set_callbacks,
+	.enum_params = impl_node_enum_params,
+	.set_param = impl_node_set_param,
+	.set_io = impl_node_set_io,
+	.send_command = impl_node_send_command,
+	.add_port = impl_node_add_port,
+	.remove_port = impl_node_remove_port,
+	.port_enum_params = impl_node_port_enum_params,
+	.port_set_param = impl_node_port_set_param,
+	.port_use_buffers = impl_node_port_use_buffers,
+	.port_set_io = impl_node_port_set_io,
+	.port_reuse_buffer = impl_node_port_reuse_buffer,
+	.process = impl_node_process,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (spa_streq(type, SPA_TYPE_INTERFACE_Node))
+		*interface = &this->node;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static void free_dir(struct dir *dir)
+{
+	uint32_t i;
+	for (i = 0; i < MAX_PORTS; i++)
+		free(dir->ports[i]);
+	free(dir->tag);
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	free_dir(&this->dir[SPA_DIRECTION_INPUT]);
+	free_dir(&this->dir[SPA_DIRECTION_OUTPUT]);
+
+	if (this->conv.free)
+		convert_free(&this->conv);
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	this = (struct impl *) handle;
+
+	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	spa_log_topic_init(this->log, &log_topic);
+
+	this->max_align = MAX_ALIGN;
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	if (this->cpu) {
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
+		this->max_align = SPA_MIN(MAX_ALIGN, spa_cpu_get_max_align(this->cpu));
+	}
+
+	this->dir[SPA_DIRECTION_INPUT].direction = SPA_DIRECTION_INPUT;
+	this->dir[SPA_DIRECTION_OUTPUT].direction = SPA_DIRECTION_OUTPUT;
+
+	this->node.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE,
+			&impl_node, this);
+	spa_hook_list_init(&this->hooks);
+
+	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS |
+			SPA_NODE_CHANGE_MASK_PARAMS;
+	this->info = SPA_NODE_INFO_INIT();
+	this->info.max_input_ports = MAX_PORTS;
+	this->info.max_output_ports = MAX_PORTS;
+	this->info.flags = SPA_NODE_FLAG_RT |
+		SPA_NODE_FLAG_IN_PORT_CONFIG |
+		SPA_NODE_FLAG_OUT_PORT_CONFIG |
+		SPA_NODE_FLAG_NEED_CONFIGURE;
+	this->params[IDX_EnumPortConfig] = SPA_PARAM_INFO(SPA_PARAM_EnumPortConfig, SPA_PARAM_INFO_READ);
+	this->params[IDX_PortConfig] = SPA_PARAM_INFO(SPA_PARAM_PortConfig, SPA_PARAM_INFO_READWRITE);
+	this->info.params = this->params;
+	this->info.n_params = N_NODE_PARAMS;
+
+	reconfigure_mode(this, SPA_PARAM_PORT_CONFIG_MODE_convert, SPA_DIRECTION_INPUT, NULL);
+	reconfigure_mode(this, SPA_PARAM_PORT_CONFIG_MODE_convert, SPA_DIRECTION_OUTPUT, NULL);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_Node,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	switch (*index) {
+	case 0:
+		*info = &impl_interfaces[*index];
+		break;
+	default:
+		return 0;
+	}
+	(*index)++;
+	return 1;
+}
+
+const struct spa_handle_factory spa_videoconvert_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_VIDEO_CONVERT,
+	NULL,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info,
+};
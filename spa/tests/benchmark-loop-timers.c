@@ -0,0 +1,265 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/loop.h>
+#include <spa/support/system.h>
+#include <spa/utils/defs.h>
+#include <spa/utils/names.h>
+#include <spa/utils/result.h>
+#include <spa/utils/string.h>
+#include <spa/utils/type.h>
+
+#define DEFAULT_TIMERS	1000
+#define ROUNDS		100
+#define FIRE_PERIODS	5
+
+struct data {
+	const char *plugin_dir;
+	struct spa_support support[4];
+	uint32_t n_support;
+
+	struct spa_system *system;
+	struct spa_loop_utils *utils;
+	struct spa_loop_control *control;
+
+	uint32_t n_timers;
+	uint32_t n_fired;
+};
+
+struct timer {
+	struct data *data;
+	struct spa_source *source;
+	uint64_t expirations;
+	bool periodic;
+};
+
+static int load_handle(struct data *data, struct spa_handle **handle, const char *lib, const char *name)
+{
+	int res;
+	void *hnd;
+	spa_handle_factory_enum_func_t enum_func;
+	uint32_t i;
+	char *path;
+
+	if ((path = spa_aprintf("%s/%s", data->plugin_dir, lib)) == NULL)
+		return -ENOMEM;
+	if ((hnd = dlopen(path, RTLD_NOW)) == NULL) {
+		printf("can't load %s: %s\n", path, dlerror());
+		free(path);
+		return -ENOENT;
+	}
+	free(path);
+	if ((enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME)) == NULL) {
+		printf("can't find enum function\n");
+		return -ENOENT;
+	}
+
+	for (i = 0;;) {
+		const struct spa_handle_factory *factory;
+
+		if ((res = enum_func(&factory, &i)) <= 0) {
+			if (res != 0)
+				printf("can't enumerate factories: %s\n", spa_strerror(res));
+			break;
+		}
+		if (!spa_streq(factory->name, name))
+			continue;
+
+		*handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+		if ((res = spa_handle_factory_init(factory, *handle,
+						NULL, data->support,
+						data->n_support)) < 0) {
+			printf("can't make factory instance: %d\n", res);
+			return res;
+		}
+		return 0;
+	}
+	return -EBADF;
+}
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void on_timer(void *d, uint64_t expirations)
+{
+	struct timer *t = d;
+	struct data *data = t->data;
+
+	t->expirations += expirations;
+	if (!t->periodic || t->expirations >= FIRE_PERIODS) {
+		if (t->periodic)
+			spa_loop_utils_update_timer(data->utils, t->source, NULL, NULL, false);
+		data->n_fired++;
+	}
+}
+
+static void print_result(const char *name, uint64_t ops, uint64_t t1, uint64_t t2)
+{
+	printf("%-24s %10"PRIu64" ops/sec\n", name,
+			(uint64_t)(ops * SPA_NSEC_PER_SEC / SPA_MAX(t2 - t1, (uint64_t)1)));
+}
+
+/* every timer with its own timerfd in the epoll set, this is how the loop
+ * used to implement timers */
+static void test_timerfd(struct data *data)
+{
+	int *fds, pfd;
+	uint32_t i, r;
+	uint64_t t1, t2;
+
+	fds = calloc(data->n_timers, sizeof(int));
+	spa_assert_se(fds != NULL);
+	spa_assert_se((pfd = spa_system_pollfd_create(data->system, SPA_FD_CLOEXEC)) >= 0);
+
+	t1 = get_time_ns();
+	for (i = 0; i < data->n_timers; i++) {
+		fds[i] = spa_system_timerfd_create(data->system, CLOCK_MONOTONIC,
+				SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
+		if (fds[i] < 0) {
+			printf("can't create timerfd %u: %s\n", i, spa_strerror(fds[i]));
+			data->n_timers = i;
+			break;
+		}
+		spa_system_pollfd_add(data->system, pfd, fds[i], SPA_IO_IN, NULL);
+	}
+	t2 = get_time_ns();
+	print_result("timerfd add", data->n_timers, t1, t2);
+
+	t1 = get_time_ns();
+	for (r = 0; r < ROUNDS; r++) {
+		for (i = 0; i < data->n_timers; i++) {
+			struct itimerspec its = { .it_value.tv_sec = 10 + i };
+			spa_system_timerfd_settime(data->system, fds[i], 0, &its, NULL);
+		}
+		for (i = 0; i < data->n_timers; i++) {
+			struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+			spa_system_timerfd_settime(data->system, fds[i], 0, &its, NULL);
+		}
+	}
+	t2 = get_time_ns();
+	print_result("timerfd arm/cancel", (uint64_t)ROUNDS * data->n_timers * 2, t1, t2);
+
+	for (i = 0; i < data->n_timers; i++) {
+		spa_system_pollfd_del(data->system, pfd, fds[i]);
+		spa_system_close(data->system, fds[i]);
+	}
+	spa_system_close(data->system, pfd);
+	free(fds);
+}
+
+static void test_loop(struct data *data)
+{
+	struct timer *timers;
+	uint32_t i, r;
+	uint64_t t1, t2;
+
+	timers = calloc(data->n_timers, sizeof(struct timer));
+	spa_assert_se(timers != NULL);
+
+	t1 = get_time_ns();
+	for (i = 0; i < data->n_timers; i++) {
+		timers[i].data = data;
+		timers[i].source = spa_loop_utils_add_timer(data->utils, on_timer, &timers[i]);
+		spa_assert_se(timers[i].source != NULL);
+	}
+	t2 = get_time_ns();
+	print_result("loop add", data->n_timers, t1, t2);
+
+	t1 = get_time_ns();
+	for (r = 0; r < ROUNDS; r++) {
+		for (i = 0; i < data->n_timers; i++) {
+			struct timespec value = { .tv_sec = 10 + i };
+			spa_loop_utils_update_timer(data->utils, timers[i].source, &value, NULL, false);
+		}
+		for (i = 0; i < data->n_timers; i++)
+			spa_loop_utils_update_timer(data->utils, timers[i].source, NULL, NULL, false);
+	}
+	t2 = get_time_ns();
+	print_result("loop arm/cancel", (uint64_t)ROUNDS * data->n_timers * 2, t1, t2);
+
+	/* fire all timers within 20ms, every other one periodic, and check
+	 * that they all expire the right number of times */
+	for (i = 0; i < data->n_timers; i++) {
+		struct timespec value = { .tv_nsec = 1000000 + (i * 7919) % 19000000 };
+		struct timespec interval = { .tv_nsec = 1000000 };
+
+		timers[i].periodic = (i & 1);
+		spa_loop_utils_update_timer(data->utils, timers[i].source, &value,
+				timers[i].periodic ? &interval : NULL, false);
+	}
+	t1 = get_time_ns();
+	spa_loop_control_enter(data->control);
+	while (data->n_fired < data->n_timers)
+		spa_loop_control_iterate(data->control, 1000);
+	spa_loop_control_leave(data->control);
+	t2 = get_time_ns();
+	printf("%-24s %10"PRIu64" usec\n", "loop fire", (t2 - t1) / 1000);
+
+	for (i = 0; i < data->n_timers; i++) {
+		if (timers[i].periodic)
+			spa_assert_se(timers[i].expirations >= FIRE_PERIODS);
+		else
+			spa_assert_se(timers[i].expirations == 1);
+		spa_loop_utils_destroy_source(data->utils, timers[i].source);
+	}
+	free(timers);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0 };
+	struct spa_handle *system_handle = NULL, *loop_handle = NULL;
+	const char *str;
+	void *iface;
+
+	data.n_timers = DEFAULT_TIMERS;
+	if (argc > 1)
+		data.n_timers = SPA_MAX(atoi(argv[1]), 1);
+
+	if ((str = getenv("SPA_PLUGIN_DIR")) == NULL) {
+		printf("SPA_PLUGIN_DIR not set\n");
+		return EXIT_FAILURE;
+	}
+	data.plugin_dir = str;
+
+	if (load_handle(&data, &system_handle, "support/libspa-support.so",
+					SPA_NAME_SUPPORT_SYSTEM) < 0)
+		return EXIT_FAILURE;
+	spa_assert_se(spa_handle_get_interface(system_handle, SPA_TYPE_INTERFACE_System, &iface) == 0);
+	data.system = iface;
+	data.support[data.n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_System, data.system);
+
+	if (load_handle(&data, &loop_handle, "support/libspa-support.so",
+					SPA_NAME_SUPPORT_LOOP) < 0)
+		return EXIT_FAILURE;
+	spa_assert_se(spa_handle_get_interface(loop_handle, SPA_TYPE_INTERFACE_LoopUtils, &iface) == 0);
+	data.utils = iface;
+	spa_assert_se(spa_handle_get_interface(loop_handle, SPA_TYPE_INTERFACE_LoopControl, &iface) == 0);
+	data.control = iface;
+
+	printf("timers: %u\n", data.n_timers);
+
+	test_loop(&data);
+	test_timerfd(&data);
+
+	spa_handle_clear(loop_handle);
+	free(loop_handle);
+	spa_handle_clear(system_handle);
+	free(system_handle);
+
+	return 0;
+}
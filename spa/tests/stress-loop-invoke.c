@@ -0,0 +1,349 @@
+/* Spa */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/loop.h>
+#include <spa/support/system.h>
+#include <spa/utils/defs.h>
+#include <spa/utils/names.h>
+#include <spa/utils/result.h>
+#include <spa/utils/string.h>
+#include <spa/utils/type.h>
+
+#define DEFAULT_THREADS	4
+#define DEFAULT_COUNT	200000
+#define MAX_THREADS	64
+#define BLOCK_EVERY	1000
+#define LARGE_EVERY	5000
+#define LARGE_SIZE	(64 * 1024)
+#define LOCKED_COUNT	2000
+
+struct data {
+	const char *plugin_dir;
+	struct spa_support support[4];
+	uint32_t n_support;
+
+	struct spa_system *system;
+	struct spa_loop *loop;
+	struct spa_loop_control *control;
+
+	bool running;
+	/* the loop runs with this lock like a pw_thread_loop */
+	pthread_mutex_t lock;
+	struct spa_hook hook;
+	uint32_t n_threads;
+	uint32_t count;
+
+	/* only touched from the loop thread */
+	uint32_t expected[MAX_THREADS];
+	uint64_t n_items;
+	uint64_t n_large;
+	uint64_t n_errors;
+	uint64_t n_locked;
+};
+
+struct producer {
+	struct data *data;
+	uint32_t id;
+	pthread_t thread;
+};
+
+struct msg {
+	uint32_t id;
+	uint32_t seq;
+};
+
+static int load_handle(struct data *data, struct spa_handle **handle, const char *lib, const char *name)
+{
+	int res;
+	void *hnd;
+	spa_handle_factory_enum_func_t enum_func;
+	uint32_t i;
+	char *path;
+
+	if ((path = spa_aprintf("%s/%s", data->plugin_dir, lib)) == NULL)
+		return -ENOMEM;
+	if ((hnd = dlopen(path, RTLD_NOW)) == NULL) {
+		printf("can't load %s: %s\n", path, dlerror());
+		free(path);
+		return -ENOENT;
+	}
+	free(path);
+	if ((enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME)) == NULL) {
+		printf("can't find enum function\n");
+		return -ENOENT;
+	}
+
+	for (i = 0;;) {
+		const struct spa_handle_factory *factory;
+
+		if ((res = enum_func(&factory, &i)) <= 0) {
+			if (res != 0)
+				printf("can't enumerate factories: %s\n", spa_strerror(res));
+			break;
+		}
+		if (!spa_streq(factory->name, name))
+			continue;
+
+		*handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+		if ((res = spa_handle_factory_init(factory, *handle,
+						NULL, data->support,
+						data->n_support)) < 0) {
+			printf("can't make factory instance: %d\n", res);
+			return res;
+		}
+		return 0;
+	}
+	return -EBADF;
+}
+
+static int do_item(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *d, size_t size, void *user_data)
+{
+	struct data *data = user_data;
+	const struct msg *m = d;
+
+	if (m->seq != data->expected[m->id]) {
+		printf("thread %u: expected %u got %u\n", m->id,
+				data->expected[m->id], m->seq);
+		data->n_errors++;
+	}
+	data->expected[m->id] = m->seq + 1;
+	data->n_items++;
+
+	if (size == LARGE_SIZE) {
+		const uint8_t *p = d;
+		if (p[size - 1] != (uint8_t)m->seq)
+			data->n_errors++;
+		data->n_large++;
+	}
+	return m->seq;
+}
+
+static int do_stop(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *d, size_t size, void *user_data)
+{
+	struct data *data = user_data;
+	data->running = false;
+	return 0;
+}
+
+static int do_locked_item(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *d, size_t size, void *user_data)
+{
+	struct data *data = user_data;
+	const struct msg *m = d;
+	data->n_locked++;
+	return m->seq;
+}
+
+static void loop_before(void *d)
+{
+	struct data *data = d;
+	pthread_mutex_unlock(&data->lock);
+}
+
+static void loop_after(void *d)
+{
+	struct data *data = d;
+	pthread_mutex_lock(&data->lock);
+}
+
+static const struct spa_loop_control_hooks loop_hooks = {
+	SPA_VERSION_LOOP_CONTROL_HOOKS,
+	.before = loop_before,
+	.after = loop_after,
+};
+
+static void *loop_start(void *arg)
+{
+	struct data *data = arg;
+
+	pthread_mutex_lock(&data->lock);
+	spa_loop_control_enter(data->control);
+	while (data->running)
+		spa_loop_control_iterate(data->control, -1);
+	spa_loop_control_leave(data->control);
+	pthread_mutex_unlock(&data->lock);
+
+	return NULL;
+}
+
+static void *producer_start(void *arg)
+{
+	struct producer *p = arg;
+	struct data *data = p->data;
+	uint8_t *large;
+	uint32_t i;
+	int res;
+
+	large = calloc(1, LARGE_SIZE);
+
+	for (i = 0; i < data->count; i++) {
+		struct msg m = { p->id, i };
+
+		if (i % LARGE_EVERY == 0) {
+			memcpy(large, &m, sizeof(m));
+			large[LARGE_SIZE - 1] = (uint8_t)i;
+			res = spa_loop_invoke(data->loop, do_item, 0, large, LARGE_SIZE, false, data);
+		} else if (i % BLOCK_EVERY == 0) {
+			pthread_mutex_lock(&data->lock);
+			res = spa_loop_invoke(data->loop, do_item, 0, &m, sizeof(m), true, data);
+			pthread_mutex_unlock(&data->lock);
+			if (res != (int)i) {
+				printf("thread %u: blocking invoke returned %d, expected %u\n",
+						p->id, res, i);
+				exit(EXIT_FAILURE);
+			}
+		} else {
+			res = spa_loop_invoke(data->loop, do_item, SPA_ID_INVALID, &m, sizeof(m), false, data);
+		}
+		if (res < 0) {
+			printf("thread %u: invoke failed: %s\n", p->id, spa_strerror(res));
+			exit(EXIT_FAILURE);
+		}
+	}
+	free(large);
+
+	return NULL;
+}
+
+/* blocking invokes while holding the loop lock, like the users of a
+ * pw_thread_loop do. The before hook releases the lock while we wait. */
+static void *locked_start(void *arg)
+{
+	struct producer *p = arg;
+	struct data *data = p->data;
+	uint32_t i;
+	int res;
+
+	for (i = 0; i < LOCKED_COUNT; i++) {
+		struct msg m = { p->id, i };
+
+		pthread_mutex_lock(&data->lock);
+		res = spa_loop_invoke(data->loop, do_locked_item, 0, &m, sizeof(m), true, data);
+		pthread_mutex_unlock(&data->lock);
+
+		if (res != (int)i) {
+			printf("thread %u: locked invoke returned %d, expected %u\n",
+					p->id, res, i);
+			exit(EXIT_FAILURE);
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0 };
+	struct producer producers[MAX_THREADS];
+	struct spa_handle *system_handle = NULL, *loop_handle = NULL;
+	pthread_t loop_thread;
+	struct timespec ts;
+	uint64_t t1, t2, total, rate;
+	const char *str;
+	void *iface;
+	uint32_t i;
+	int res;
+
+	data.n_threads = DEFAULT_THREADS;
+	data.count = DEFAULT_COUNT;
+	if (argc > 1)
+		data.n_threads = SPA_CLAMP(atoi(argv[1]), 1, MAX_THREADS);
+	if (argc > 2)
+		data.count = atoi(argv[2]);
+
+	if ((str = getenv("SPA_PLUGIN_DIR")) == NULL) {
+		printf("SPA_PLUGIN_DIR not set\n");
+		return EXIT_FAILURE;
+	}
+	data.plugin_dir = str;
+
+	printf("starting loop invoke stress test\n");
+	printf("threads: %u, invokes per thread: %u\n", data.n_threads, data.count);
+
+	if ((res = load_handle(&data, &system_handle, "support/libspa-support.so",
+					SPA_NAME_SUPPORT_SYSTEM)) < 0)
+		return EXIT_FAILURE;
+	spa_assert_se(spa_handle_get_interface(system_handle, SPA_TYPE_INTERFACE_System, &iface) == 0);
+	data.system = iface;
+	data.support[data.n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_System, data.system);
+
+	if ((res = load_handle(&data, &loop_handle, "support/libspa-support.so",
+					SPA_NAME_SUPPORT_LOOP)) < 0)
+		return EXIT_FAILURE;
+	spa_assert_se(spa_handle_get_interface(loop_handle, SPA_TYPE_INTERFACE_Loop, &iface) == 0);
+	data.loop = iface;
+	spa_assert_se(spa_handle_get_interface(loop_handle, SPA_TYPE_INTERFACE_LoopControl, &iface) == 0);
+	data.control = iface;
+
+	pthread_mutex_init(&data.lock, NULL);
+	spa_loop_control_add_hook(data.control, &data.hook, &loop_hooks, &data);
+
+	data.running = true;
+	pthread_create(&loop_thread, NULL, loop_start, &data);
+
+	/* wait for the loop to be entered so that all invokes are queued */
+	while (spa_loop_control_check(data.control) == 1)
+		usleep(1000);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < data.n_threads; i++) {
+		producers[i].data = &data;
+		producers[i].id = i;
+		pthread_create(&producers[i].thread, NULL, producer_start, &producers[i]);
+	}
+	for (i = 0; i < data.n_threads; i++)
+		pthread_join(producers[i].thread, NULL);
+
+	/* flush everything that is still queued */
+	pthread_mutex_lock(&data.lock);
+	spa_loop_invoke(data.loop, NULL, 0, NULL, 0, true, NULL);
+	pthread_mutex_unlock(&data.lock);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < data.n_threads; i++)
+		pthread_create(&producers[i].thread, NULL, locked_start, &producers[i]);
+	for (i = 0; i < data.n_threads; i++)
+		pthread_join(producers[i].thread, NULL);
+
+	pthread_mutex_lock(&data.lock);
+	spa_loop_invoke(data.loop, do_stop, 0, NULL, 0, true, &data);
+	pthread_mutex_unlock(&data.lock);
+	pthread_join(loop_thread, NULL);
+	spa_hook_remove(&data.hook);
+	pthread_mutex_destroy(&data.lock);
+
+	total = (uint64_t)data.n_threads * data.count;
+	rate = total * SPA_NSEC_PER_SEC / SPA_MAX(t2 - t1, (uint64_t)1);
+	printf("invoked %"PRIu64" (%"PRIu64" large) of %"PRIu64", %"PRIu64" errors, %"PRIu64" invokes/sec\n",
+			data.n_items, data.n_large, total, data.n_errors, rate);
+	printf("invoked %"PRIu64" while holding the loop lock\n", data.n_locked);
+
+	for (i = 0; i < data.n_threads; i++)
+		spa_assert_se(data.expected[i] == data.count);
+	spa_assert_se(data.n_items == total);
+	spa_assert_se(data.n_errors == 0);
+	spa_assert_se(data.n_locked == (uint64_t)data.n_threads * LOCKED_COUNT);
+
+	spa_handle_clear(loop_handle);
+	free(loop_handle);
+	spa_handle_clear(system_handle);
+	free(system_handle);
+
+	return 0;
+}
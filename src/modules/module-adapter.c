@@ -205,6 +205,10 @@ static void *create_object(void *_data,
 		if (factory_name == NULL)
 			goto error_properties;
 
+		/* the follower and the adapter must run on the same data loop */
+		if ((res = pw_context_select_data_loop(d->context, properties)) < 0)
+			goto error_res;
+
 		handle = pw_context_load_spa_handle(d->context,
 				factory_name,
 				&properties->dict);
@@ -18,7 +18,9 @@
 #include <spa/utils/result.h>
 #include <spa/utils/string.h>
 #include <spa/utils/json.h>
+#include <spa/utils/atomic.h>
 #include <spa/support/cpu.h>
+#include <spa/support/thread.h>
 #include <spa/param/latency-utils.h>
 #include <spa/param/tag-utils.h>
 #include <spa/pod/dynamic.h>
@@ -26,6 +28,7 @@
 
 #include <pipewire/utils.h>
 #include <pipewire/impl.h>
+#include <pipewire/thread.h>
 #include <pipewire/extensions/profiler.h>
 
 #define NAME "filter-chain"
@@ -58,6 +61,10 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * - `filter.graph = []`: a description of the filter graph to run, see below
  * - `capture.props = {}`: properties to be passed to the input stream
  * - `playback.props = {}`: properties to be passed to the output stream
+ * - `filter.threads`: the number of extra threads used to run independent
+ *                     nodes of the graph in parallel, such as the instances
+ *                     for each channel. Default 0, run the graph in the
+ *                     stream thread. Since 1.0.4
  *
  * ## Filter graph description
  *
@@ -231,6 +238,42 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * }
  *\endcode
  *
+ * ### Parametric EQ
+ *
+ * The parametric EQ chains many biquads in one node. It is a lot cheaper than
+ * linking the same number of biquad nodes, the complete chain is applied in one
+ * pass and up to 8 channels are processed together.
+ *
+ * It has input ports "In 1" to "In 8" and output ports "Out 1" to "Out 8".
+ * The filters are set in the config section, with the same types as the
+ * biquad labels above. "filters" applies to all channels, "filters1" to
+ * "filters8" can be used to override the filters of one channel. Up to
+ * 64 filters can be used per channel.
+ *
+ *\code{.unparsed}
+ * filter.graph = {
+ *     nodes = [
+ *         {
+ *             type   = builtin
+ *             name   = ...
+ *             label  = param_eq
+ *             config = {
+ *                 filters = [
+ *                     { type = bq_lowshelf, freq = 105, q = 0.7, gain = 5.5 },
+ *                     { type = bq_peaking,  freq = 1000, q = 1.41, gain = -3.0 },
+ *                     { type = bq_raw, b0=.., b1=.., b2=.., a0=.., a1=.., a2=.. }
+ *                 ]
+ *                 filters2 = [ ... ]
+ *             }
+ *             ...
+ *         }
+ *     }
+ *     ...
+ * }
+ *\endcode
+ *
+ * Since 1.0.4
+ *
  * ### Convolver
  *
  * The convolver can be used to apply an impulse response to a signal. It is usually used
@@ -268,7 +311,9 @@ PW_LOG_TOPIC_STATIC(mod_topic, "mod." NAME);
  * - `blocksize` specifies the size of the blocks to use in the FFT. It is a value
  *               between 64 and 256. When not specified, this value is
  *               computed automatically from the number of samples in the file.
- * - `tailsize` specifies the size of the tail blocks to use in the FFT.
+ * - `tailsize` specifies the size of the tail blocks to use in the FFT. The part
+ *               of the IR after twice the tailsize is computed in a background
+ *               thread with partitions that double in size for longer IRs.
  * - `gain`     the overall gain to apply to the IR file.
  * - `delay`    The extra delay (in samples) to add to the IR.
  * - `filename` The IR to load or create. Possible values are:
@@ -601,6 +646,7 @@ static const struct spa_dict_item module_props[] = {
 #include <getopt.h>
 #include <limits.h>
 #include <math.h>
+#include <semaphore.h>
 
 #include <spa/utils/result.h>
 #include <spa/pod/builder.h>
@@ -610,6 +656,9 @@ static const struct spa_dict_item module_props[] = {
 #include <pipewire/pipewire.h>
 
 #define MAX_HNDL 64
+#define MAX_WORKERS 16u
+/* spin this many times for the workers before sleeping on work_done */
+#define MAX_SPIN 1024
 
 #define DEFAULT_RATE	48000
 
@@ -687,6 +736,7 @@ struct node {
 	void *hndl[MAX_HNDL];
 
 	unsigned int n_deps;
+	uint32_t level;
 	unsigned int visited:1;
 	unsigned int disabled:1;
 	unsigned int control_changed:1;
@@ -712,6 +762,13 @@ struct graph_port {
 struct graph_hndl {
 	const struct fc_descriptor *desc;
 	void **hndl;
+	uint32_t level;
+};
+
+/* a range of handles that don't depend on each other */
+struct graph_level {
+	uint32_t start;
+	uint32_t n_hndl;
 };
 
 struct volume {
@@ -743,6 +800,10 @@ struct graph {
 	uint32_t n_hndl;
 	struct graph_hndl *hndl;
 
+	uint32_t n_level;
+	struct graph_level *level;
+	uint32_t max_level_hndl;
+
 	uint32_t n_control;
 	struct port **control_port;
 
@@ -765,6 +826,7 @@ struct impl {
 
 	uint32_t quantum_limit;
 	struct dsp_ops dsp;
+	struct spa_thread_utils *thread_utils;
 
 	struct spa_list plugin_list;
 	struct spa_list plugin_func_list;
@@ -789,8 +851,19 @@ struct impl {
 
 	struct graph graph;
 
+	uint32_t n_workers;
+	struct spa_thread *workers[MAX_WORKERS];
+	sem_t work_wakeup;
+	sem_t work_done;
+	int workers_running;
+	struct {
+		uint32_t next;
+		uint32_t end;
+		uint32_t pending;
+		uint32_t n_samples;
+	} work;
+
 	float *silence_data;
-	float *discard_data;
 };
 
 static int graph_instantiate(struct graph *graph);
@@ -810,12 +883,133 @@ static void capture_process(void *d)
 	pw_stream_trigger_process(impl->playback);
 }
 
+/* Run the handles up to work.end. Called from the stream thread and the
+ * workers, each handle is claimed with a CAS on work.next. */
+static void graph_run_hndls(struct impl *impl)
+{
+	struct graph *graph = &impl->graph;
+	uint32_t idx;
+
+	while (true) {
+		struct graph_hndl *hndl;
+
+		idx = SPA_ATOMIC_LOAD(impl->work.next);
+		if (idx >= SPA_ATOMIC_LOAD(impl->work.end))
+			break;
+		if (!SPA_ATOMIC_CAS(impl->work.next, idx, idx + 1))
+			continue;
+
+		hndl = &graph->hndl[idx];
+		hndl->desc->run(*hndl->hndl, impl->work.n_samples);
+		if (SPA_ATOMIC_DEC(impl->work.pending) == 0)
+			sem_post(&impl->work_done);
+	}
+}
+
+static void graph_run(struct impl *impl, uint32_t n_samples)
+{
+	struct graph *graph = &impl->graph;
+	uint32_t i, j;
+
+	if (impl->n_workers == 0) {
+		for (i = 0; i < graph->n_hndl; i++) {
+			struct graph_hndl *hndl = &graph->hndl[i];
+			hndl->desc->run(*hndl->hndl, n_samples);
+		}
+		return;
+	}
+
+	/* reset end first so that a late worker never sees next < end */
+	SPA_ATOMIC_STORE(impl->work.end, 0);
+	SPA_ATOMIC_STORE(impl->work.next, 0);
+	impl->work.n_samples = n_samples;
+
+	for (i = 0; i < graph->n_level; i++) {
+		struct graph_level *l = &graph->level[i];
+		uint32_t n_wake = SPA_MIN(l->n_hndl - 1, impl->n_workers);
+
+		SPA_ATOMIC_STORE(impl->work.pending, l->n_hndl);
+		SPA_ATOMIC_STORE(impl->work.end, l->start + l->n_hndl);
+
+		for (j = 0; j < n_wake; j++)
+			sem_post(&impl->work_wakeup);
+
+		graph_run_hndls(impl);
+
+		/* the next level depends on this one, wait for the workers. The
+		 * last handle of the level posts work_done, we take it in any
+		 * case to keep the semaphore balanced. */
+		for (j = 0; j < MAX_SPIN && SPA_ATOMIC_LOAD(impl->work.pending) > 0; j++)
+			SPA_CPU_PAUSE();
+		while (sem_wait(&impl->work_done) < 0 && errno == EINTR);
+	}
+}
+
+static void *worker_thread(void *data)
+{
+	struct impl *impl = data;
+
+	while (true) {
+		while (sem_wait(&impl->work_wakeup) < 0 && errno == EINTR);
+
+		if (!SPA_ATOMIC_LOAD(impl->workers_running))
+			break;
+
+		graph_run_hndls(impl);
+	}
+	return NULL;
+}
+
+static int start_workers(struct impl *impl, uint32_t n_workers)
+{
+	struct graph *graph = &impl->graph;
+	struct spa_dict_item items[1];
+	uint32_t i;
+
+	/* one level needs at most max_level_hndl - 1 extra threads */
+	n_workers = SPA_MIN(n_workers, MAX_WORKERS);
+	n_workers = SPA_MIN(n_workers, graph->max_level_hndl > 0 ? graph->max_level_hndl - 1 : 0u);
+	if (n_workers == 0)
+		return 0;
+
+	items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_THREAD_NAME, "filter-chain-worker");
+
+	SPA_ATOMIC_STORE(impl->workers_running, 1);
+	for (i = 0; i < n_workers; i++) {
+		struct spa_thread *thread;
+
+		thread = spa_thread_utils_create(impl->thread_utils,
+				&SPA_DICT_INIT_ARRAY(items), worker_thread, impl);
+		if (thread == NULL) {
+			pw_log_warn("can't create worker thread: %m");
+			break;
+		}
+		spa_thread_utils_acquire_rt(impl->thread_utils, thread, -1);
+		impl->workers[impl->n_workers++] = thread;
+	}
+	pw_log_info("using %u worker threads for %u levels", impl->n_workers,
+			graph->n_level);
+	return 0;
+}
+
+static void stop_workers(struct impl *impl)
+{
+	uint32_t i;
+
+	SPA_ATOMIC_STORE(impl->workers_running, 0);
+	for (i = 0; i < impl->n_workers; i++)
+		sem_post(&impl->work_wakeup);
+	for (i = 0; i < impl->n_workers; i++)
+		spa_thread_utils_join(impl->thread_utils, impl->workers[i], NULL);
+	impl->n_workers = 0;
+}
+
 static void playback_process(void *d)
 {
 	struct impl *impl = d;
 	struct pw_buffer *in, *out;
 	struct graph *graph = &impl->graph;
-	uint32_t i, j, insize = 0, outsize = 0, n_hndl = graph->n_hndl;
+	uint32_t i, j, insize = 0, outsize = 0;
 	int32_t stride = 0;
 	struct graph_port *port;
 	struct spa_data *bd;
@@ -880,10 +1074,7 @@ static void playback_process(void *d)
 	pw_log_trace_fp("%p: stride:%d in:%d out:%d requested:%"PRIu64" (%"PRIu64")", impl,
 			stride, insize, outsize, out->requested, out->requested * stride);
 
-	for (i = 0; i < n_hndl; i++) {
-		struct graph_hndl *hndl = &graph->hndl[i];
-		hndl->desc->run(*hndl->hndl, outsize / sizeof(float));
-	}
+	graph_run(impl, outsize / sizeof(float));
 
 done:
 	if (in != NULL)
@@ -1696,7 +1887,8 @@ static struct plugin *plugin_load(struct impl *impl, const char *type, const cha
 {
 	struct fc_plugin *pl = NULL;
 	struct plugin *hndl;
-	const struct spa_support *support;
+	const struct spa_support *context_support;
+	struct spa_support support[32];
 	uint32_t n_support;
 	fc_plugin_load_func *plugin_func;
 
@@ -1707,7 +1899,12 @@ static struct plugin *plugin_load(struct impl *impl, const char *type, const cha
 			return hndl;
 		}
 	}
-	support = pw_context_get_support(impl->context, &n_support);
+	context_support = pw_context_get_support(impl->context, &n_support);
+	n_support = SPA_MIN(n_support, SPA_N_ELEMENTS(support) - 1);
+	memcpy(support, context_support, n_support * sizeof(support[0]));
+	/* plugins create their worker threads with this */
+	support[n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_ThreadUtils,
+			impl->thread_utils);
 
 	plugin_func = find_plugin_func(impl, type);
 	if (plugin_func == NULL) {
@@ -2310,7 +2507,7 @@ static int graph_instantiate(struct graph *graph)
 	const struct fc_descriptor *d;
 	uint32_t i, j, max_samples = impl->quantum_limit;
 	int res;
-	float *sd = impl->silence_data, *dd = impl->discard_data;
+	float *sd = impl->silence_data;
 
 	if (graph->instantiated)
 		return 0;
@@ -2324,7 +2521,7 @@ static int graph_instantiate(struct graph *graph)
 		desc = node->desc;
 		d = desc->desc;
 		if (d->flags & FC_DESCRIPTOR_SUPPORTS_NULL_DATA)
-			sd = dd = NULL;
+			sd = NULL;
 
 		for (i = 0; i < node->n_hndl; i++) {
 			pw_log_info("instantiate %s %d rate:%lu", d->name, i, impl->rate);
@@ -2348,6 +2545,9 @@ static int graph_instantiate(struct graph *graph)
 					d->connect_port(node->hndl[i], port->p, peer->audio_data[i]);
 				}
 			}
+			/* outputs and notify ports have storage per instance, handles
+			 * of a level run in parallel and must not share a buffer
+			 * they write to */
 			for (j = 0; j < desc->n_output; j++) {
 				port = &node->output_port[j];
 				if ((res = port_ensure_data(port, i, max_samples)) < 0)
@@ -2424,8 +2624,9 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 	struct port *port;
 	struct link *link;
 	struct graph_port *gp;
-	struct graph_hndl *gh;
+	struct graph_hndl *gh, *sorted;
 	uint32_t i, j, n_nodes, n_input, n_output, n_control, n_hndl = 0;
+	uint32_t max_level = 0, n_sorted;
 	int res;
 	struct descriptor *desc;
 	const struct fc_descriptor *d;
@@ -2656,15 +2857,23 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 				gh = &graph->hndl[graph->n_hndl++];
 				gh->hndl = &node->hndl[i];
 				gh->desc = d;
+				gh->level = node->level;
 			}
+			max_level = SPA_MAX(max_level, node->level);
 		}
 		for (i = 0; i < desc->n_output; i++) {
-			spa_list_for_each(link, &node->output_port[i].link_list, output_link)
-				link->input->node->n_deps--;
+			spa_list_for_each(link, &node->output_port[i].link_list, output_link) {
+				struct node *peer = link->input->node;
+				peer->n_deps--;
+				peer->level = SPA_MAX(peer->level, node->level + 1);
+			}
 		}
 		for (i = 0; i < desc->n_notify; i++) {
-			spa_list_for_each(link, &node->notify_port[i].link_list, output_link)
-				link->input->node->n_deps--;
+			spa_list_for_each(link, &node->notify_port[i].link_list, output_link) {
+				struct node *peer = link->input->node;
+				peer->n_deps--;
+				peer->level = SPA_MAX(peer->level, node->level + 1);
+			}
 		}
 
 		/* collect all control ports on the graph */
@@ -2673,6 +2882,35 @@ static int setup_graph(struct graph *graph, struct spa_json *inputs, struct spa_
 			graph->n_control++;
 		}
 	}
+
+	/* group the handles per level, the handles in a level don't depend on
+	 * each other and can run in parallel */
+	graph->n_level = 0;
+	graph->max_level_hndl = 0;
+	graph->level = calloc(max_level + 1, sizeof(struct graph_level));
+	sorted = calloc(SPA_MAX(1u, graph->n_hndl), sizeof(struct graph_hndl));
+	if (graph->level == NULL || sorted == NULL) {
+		free(sorted);
+		res = -errno;
+		goto error;
+	}
+	for (i = 0, n_sorted = 0; i <= max_level; i++) {
+		struct graph_level *l = &graph->level[graph->n_level];
+
+		l->start = n_sorted;
+		for (j = 0; j < graph->n_hndl; j++) {
+			if (graph->hndl[j].level == i)
+				sorted[n_sorted++] = graph->hndl[j];
+		}
+		l->n_hndl = n_sorted - l->start;
+		if (l->n_hndl == 0)
+			continue;
+		graph->max_level_hndl = SPA_MAX(graph->max_level_hndl, l->n_hndl);
+		graph->n_level++;
+	}
+	free(graph->hndl);
+	graph->hndl = sorted;
+
 	res = 0;
 error:
 	return res;
@@ -2799,6 +3037,7 @@ static void graph_free(struct graph *graph)
 	free(graph->input);
 	free(graph->output);
 	free(graph->hndl);
+	free(graph->level);
 	free(graph->control_port);
 }
 
@@ -2853,6 +3092,10 @@ static void impl_destroy(struct impl *impl)
 	if (impl->core && impl->do_disconnect)
 		pw_core_disconnect(impl->core);
 
+	stop_workers(impl);
+	sem_destroy(&impl->work_wakeup);
+	sem_destroy(&impl->work_done);
+
 	pw_properties_free(impl->capture_props);
 	pw_properties_free(impl->playback_props);
 	graph_free(&impl->graph);
@@ -2860,7 +3103,6 @@ static void impl_destroy(struct impl *impl)
 		free_plugin_func(pl);
 
 	free(impl->silence_data);
-	free(impl->discard_data);
 	free(impl);
 }
 
@@ -2946,6 +3188,9 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	if (impl == NULL)
 		return -errno;
 
+	sem_init(&impl->work_wakeup, 0, 0);
+	sem_init(&impl->work_done, 0, 0);
+
 	pw_log_debug("module %p: new %s", impl, args);
 
 	if (args)
@@ -2988,16 +3233,15 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		goto error;
 	}
 
-	impl->discard_data = calloc(impl->quantum_limit, sizeof(float));
-	if (impl->discard_data == NULL) {
-		res = -errno;
-		goto error;
-	}
-
 	cpu_iface = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
 	impl->dsp.cpu_flags = cpu_iface ? spa_cpu_get_flags(cpu_iface) : 0;
 	dsp_ops_init(&impl->dsp);
 
+	/* like the data loops, use the realtime thread utils when available */
+	impl->thread_utils = pw_context_get_object(impl->context, SPA_TYPE_INTERFACE_ThreadUtils);
+	if (impl->thread_utils == NULL)
+		impl->thread_utils = pw_thread_utils_get();
+
 	if (pw_properties_get(props, PW_KEY_NODE_GROUP) == NULL)
 		pw_properties_setf(props, PW_KEY_NODE_GROUP, "filter-chain-%u-%u", pid, id);
 	if (pw_properties_get(props, PW_KEY_NODE_LINK_GROUP) == NULL)
@@ -3068,6 +3312,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		pw_log_error("can't load graph: %s", spa_strerror(res));
 		goto error;
 	}
+	start_workers(impl, pw_properties_get_uint32(props, "filter.threads", 0));
 
 	impl->core = pw_context_get_object(impl->context, PW_TYPE_INTERFACE_Core);
 	if (impl->core == NULL) {
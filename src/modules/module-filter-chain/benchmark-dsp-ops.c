@@ -0,0 +1,215 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "test-helper.h"
+#include "pffft.h"
+#include "dsp-ops.h"
+
+static uint32_t cpu_flags;
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t n_src;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	16384
+#define MAX_SRC		8
+
+#define MAX_COUNT 100
+
+static float samp_in[MAX_SRC][MAX_SAMPLES + 16] SPA_ALIGNED(64);
+static float samp_out[MAX_SAMPLES + 16] SPA_ALIGNED(64);
+static float samp_outn[MAX_SRC][MAX_SAMPLES + 16] SPA_ALIGNED(64);
+
+#define N_BIQUADS	16
+static struct biquad bq[MAX_SRC * N_BIQUADS];
+
+static const int sample_sizes[] = { 128, 513, 1024, 4096 };
+static const int src_counts[] = { 1, 2, 4, 8 };
+static const int fft_sizes[] = { 256, 1024, 4096, 16384 };
+
+#define MAX_RESULTS	256
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+struct impl_info {
+	const char *name;
+	uint32_t cpu_flags;
+};
+
+static const struct impl_info impls[] = {
+	{ "c", 0 },
+#if defined (HAVE_SSE)
+	{ "sse", SPA_CPU_FLAG_SSE },
+#endif
+#if defined (HAVE_AVX)
+	{ "avx", SPA_CPU_FLAG_SSE | SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3 },
+#endif
+#if defined (HAVE_AVX512)
+	{ "avx512", SPA_CPU_FLAG_SSE | SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3 | SPA_CPU_FLAG_AVX512 },
+#endif
+};
+
+enum test_op {
+	OP_SUM,
+	OP_MIX_GAIN,
+	OP_BIQUADN,
+	OP_FFT_RUN,
+	OP_FFT_CMUL,
+	OP_FFT_CMULADD,
+};
+
+static void run_test1(const char *name, const char *impl, struct dsp_ops *ops,
+		enum test_op op, int n_src, int n_samples)
+{
+	int i;
+	const void *ip[MAX_SRC];
+	float *dp[MAX_SRC];
+	float gain[MAX_SRC];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	void *fft = NULL;
+
+	for (i = 0; i < n_src; i++) {
+		ip[i] = samp_in[i];
+		dp[i] = samp_outn[i];
+		gain[i] = 0.5f;
+	}
+	if (op >= OP_FFT_RUN)
+		fft = dsp_ops_fft_new(ops, n_samples, true);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		switch (op) {
+		case OP_SUM:
+			dsp_ops_sum(ops, samp_out, samp_in[0], samp_in[1], n_samples);
+			break;
+		case OP_MIX_GAIN:
+			dsp_ops_mix_gain(ops, samp_out, ip, gain, n_src, n_samples);
+			break;
+		case OP_BIQUADN:
+			dsp_ops_biquadn_run(ops, bq, N_BIQUADS, N_BIQUADS,
+					dp, (const float **)ip, n_src, n_samples);
+			break;
+		case OP_FFT_RUN:
+			dsp_ops_fft_run(ops, fft, 1, samp_in[0], samp_out);
+			break;
+		case OP_FFT_CMUL:
+			dsp_ops_fft_cmul(ops, fft, samp_out, samp_in[0], samp_in[1],
+					n_samples / 2 + 1, 1.0f / n_samples);
+			break;
+		case OP_FFT_CMULADD:
+			dsp_ops_fft_cmuladd(ops, fft, samp_out, samp_out, samp_in[0], samp_in[1],
+					n_samples / 2 + 1, 1.0f / n_samples);
+			break;
+		}
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	if (fft)
+		dsp_ops_fft_free(ops, fft);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.n_src = n_src,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, enum test_op op)
+{
+	SPA_FOR_EACH_ELEMENT_VAR(impls, impl) {
+		struct dsp_ops ops = { 0 };
+
+		if ((impl->cpu_flags & cpu_flags) != impl->cpu_flags)
+			continue;
+
+		ops.cpu_flags = impl->cpu_flags;
+		if (dsp_ops_init(&ops) < 0)
+			continue;
+
+		switch (op) {
+		case OP_SUM:
+			SPA_FOR_EACH_ELEMENT_VAR(sample_sizes, s)
+				run_test1(name, impl->name, &ops, op, 2, *s);
+			break;
+		case OP_MIX_GAIN:
+		case OP_BIQUADN:
+			SPA_FOR_EACH_ELEMENT_VAR(sample_sizes, s) {
+				SPA_FOR_EACH_ELEMENT_VAR(src_counts, c)
+					run_test1(name, impl->name, &ops, op, *c, *s);
+			}
+			break;
+		default:
+			SPA_FOR_EACH_ELEMENT_VAR(fft_sizes, s)
+				run_test1(name, impl->name, &ops, op, 1, *s);
+			break;
+		}
+	}
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->n_src - b->n_src) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i, j;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	pffft_select_cpu(cpu_flags);
+
+	for (i = 0; i < MAX_SRC; i++)
+		for (j = 0; j < MAX_SAMPLES; j++)
+			samp_in[i][j] = (float)((i + j) % 64) / 64.0f - 0.5f;
+	for (i = 0; i < SPA_N_ELEMENTS(bq); i++)
+		biquad_set(&bq[i], BQ_PEAKING, 0.01 + 0.05 * (i % N_BIQUADS), 1.0, 3.0);
+
+	run_test("test_sum", OP_SUM);
+	run_test("test_mix_gain", OP_MIX_GAIN);
+	run_test("test_biquadn", OP_BIQUADN);
+	run_test("test_fft_run", OP_FFT_RUN);
+	run_test("test_fft_cmul", OP_FFT_CMUL);
+	run_test("test_fft_cmuladd", OP_FFT_CMULADD);
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, src %d\n",
+				s->perf, s->name, s->impl, s->n_samples, s->n_src);
+	}
+	return 0;
+}
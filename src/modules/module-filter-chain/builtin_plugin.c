@@ -30,6 +30,17 @@
 
 static struct dsp_ops *dsp_ops;
 
+struct plugin {
+	struct fc_plugin plugin;
+	/* runs the convolver tails of this filter-chain */
+	struct convolver_worker *worker;
+};
+
+struct descriptor {
+	struct fc_descriptor desc;
+	struct plugin *plugin;
+};
+
 struct builtin {
 	unsigned long rate;
 	float *port[64];
@@ -633,6 +644,319 @@ static const struct fc_descriptor bq_raw_desc = {
 	.cleanup = builtin_cleanup,
 };
 
+/** param_eq */
+#define PARAM_EQ_MAX_CHANNELS	8
+#define PARAM_EQ_MAX_FILTERS	64
+
+struct param_eq_impl {
+	unsigned long rate;
+	float *port[PARAM_EQ_MAX_CHANNELS * 2];
+
+	uint32_t n_bq;
+	struct biquad bq[PARAM_EQ_MAX_CHANNELS * PARAM_EQ_MAX_FILTERS];
+};
+
+static int parse_filters(struct param_eq_impl *impl, struct spa_json *arr,
+		struct biquad *bq, uint32_t *n_bq)
+{
+	struct spa_json it;
+	char key[256];
+	const char *val;
+	uint32_t n = 0;
+
+	while (spa_json_enter_object(arr, &it) > 0) {
+		char type[64] = "bq_peaking";
+		float freq = 0.0f, q = 1.0f, gain = 0.0f;
+		float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+		float a0 = 1.0f, a1 = 0.0f, a2 = 0.0f;
+		int t;
+
+		while (spa_json_get_string(&it, key, sizeof(key)) > 0) {
+			float *f = NULL;
+
+			if (spa_streq(key, "type")) {
+				if (spa_json_get_string(&it, type, sizeof(type)) <= 0) {
+					pw_log_error("param_eq:type requires a string");
+					return -EINVAL;
+				}
+				continue;
+			}
+			else if (spa_streq(key, "freq"))
+				f = &freq;
+			else if (spa_streq(key, "q"))
+				f = &q;
+			else if (spa_streq(key, "gain"))
+				f = &gain;
+			else if (spa_streq(key, "b0"))
+				f = &b0;
+			else if (spa_streq(key, "b1"))
+				f = &b1;
+			else if (spa_streq(key, "b2"))
+				f = &b2;
+			else if (spa_streq(key, "a0"))
+				f = &a0;
+			else if (spa_streq(key, "a1"))
+				f = &a1;
+			else if (spa_streq(key, "a2"))
+				f = &a2;
+
+			if (f == NULL) {
+				pw_log_warn("param_eq: ignoring filter key: '%s'", key);
+				if (spa_json_next(&it, &val) < 0)
+					break;
+			} else if (spa_json_get_float(&it, f) <= 0) {
+				pw_log_error("param_eq:%s requires a float", key);
+				return -EINVAL;
+			}
+		}
+		if (n >= PARAM_EQ_MAX_FILTERS) {
+			pw_log_error("param_eq: too many filters, max %d",
+					PARAM_EQ_MAX_FILTERS);
+			return -ENOSPC;
+		}
+		t = bq_type_from_name(type);
+		if (t == BQ_NONE && !spa_streq(type, "bq_raw")) {
+			pw_log_error("param_eq: unknown filter type '%s'", type);
+			return -EINVAL;
+		}
+		if (t == BQ_NONE) {
+			if (a0 != 0.0f)
+				a0 = 1.0f / a0;
+			bq[n] = (struct biquad) {
+				.b0 = b0 * a0, .b1 = b1 * a0, .b2 = b2 * a0,
+				.a1 = a1 * a0, .a2 = a2 * a0 };
+		} else {
+			biquad_set(&bq[n], t, freq * 2 / impl->rate, q, gain);
+		}
+		n++;
+	}
+	*n_bq = n;
+	return 0;
+}
+
+/*
+ * config = {
+ *     filters = [
+ *         { type = bq_lowshelf, freq = 105, q = 0.7, gain = 5.5 },
+ *         { type = bq_peaking, freq = 1000, q = 1.41, gain = -3.0 },
+ *         { type = bq_raw, b0 = .., b1 = .., b2 = .., a0 = .., a1 = .., a2 = .. },
+ *         ...
+ *     ]
+ *     # optional, replaces filters for channel 2
+ *     filters2 = [ ... ]
+ * }
+ */
+static void *param_eq_instantiate(const struct fc_descriptor * Descriptor,
+		unsigned long SampleRate, int index, const char *config)
+{
+	struct param_eq_impl *impl;
+	struct spa_json it[3];
+	const char *val;
+	char key[256];
+	uint32_t i, j, n_bq[PARAM_EQ_MAX_CHANNELS];
+	bool set[PARAM_EQ_MAX_CHANNELS];
+	int res;
+
+	if (config == NULL) {
+		pw_log_error("param_eq: requires a config section");
+		errno = EINVAL;
+		return NULL;
+	}
+
+	impl = calloc(1, sizeof(*impl));
+	if (impl == NULL)
+		return NULL;
+
+	impl->rate = SampleRate;
+	spa_zero(n_bq);
+	spa_zero(set);
+
+	spa_json_init(&it[0], config, strlen(config));
+	if (spa_json_enter_object(&it[0], &it[1]) <= 0) {
+		pw_log_error("param_eq: config section must be an object");
+		res = -EINVAL;
+		goto error;
+	}
+	while (spa_json_get_string(&it[1], key, sizeof(key)) > 0) {
+		int32_t ch = -1;
+
+		if (spa_streq(key, "filters"))
+			ch = 0;
+		else if (!spa_strstartswith(key, "filters") ||
+		    !spa_atoi32(key + strlen("filters"), &ch, 10) ||
+		    ch < 1 || ch > PARAM_EQ_MAX_CHANNELS)
+			ch = -1;
+
+		if (ch < 0) {
+			pw_log_warn("param_eq: ignoring config key: '%s'", key);
+			if (spa_json_next(&it[1], &val) < 0)
+				break;
+			continue;
+		}
+		if (spa_json_enter_array(&it[1], &it[2]) <= 0) {
+			pw_log_error("param_eq:%s requires an array", key);
+			res = -EINVAL;
+			goto error;
+		}
+		if (ch == 0) {
+			/* the defaults, copied to all channels without their own list */
+			struct biquad bq[PARAM_EQ_MAX_FILTERS];
+			uint32_t n;
+
+			if ((res = parse_filters(impl, &it[2], bq, &n)) < 0)
+				goto error;
+			for (i = 0; i < PARAM_EQ_MAX_CHANNELS; i++) {
+				if (set[i])
+					continue;
+				memcpy(&impl->bq[i * PARAM_EQ_MAX_FILTERS], bq, n * sizeof(bq[0]));
+				n_bq[i] = n;
+			}
+		} else {
+			ch--;
+			if ((res = parse_filters(impl, &it[2],
+					&impl->bq[ch * PARAM_EQ_MAX_FILTERS], &n_bq[ch])) < 0)
+				goto error;
+			set[ch] = true;
+		}
+	}
+
+	/* pad shorter cascades with pass-through biquads so that all
+	 * channels can run the same number of stages */
+	for (i = 0; i < PARAM_EQ_MAX_CHANNELS; i++)
+		impl->n_bq = SPA_MAX(impl->n_bq, n_bq[i]);
+	for (i = 0; i < PARAM_EQ_MAX_CHANNELS; i++) {
+		for (j = n_bq[i]; j < impl->n_bq; j++)
+			impl->bq[i * PARAM_EQ_MAX_FILTERS + j] = (struct biquad) { .b0 = 1.0f };
+	}
+	pw_log_info("param_eq: %u filters per channel", impl->n_bq);
+
+	return impl;
+error:
+	free(impl);
+	errno = -res;
+	return NULL;
+}
+
+static void param_eq_connect_port(void *Instance, unsigned long Port, float * DataLocation)
+{
+	struct param_eq_impl *impl = Instance;
+	impl->port[Port] = DataLocation;
+}
+
+static void param_eq_activate(void * Instance)
+{
+	struct param_eq_impl *impl = Instance;
+	uint32_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(impl->bq); i++) {
+		impl->bq[i].x1 = impl->bq[i].x2 = 0.0f;
+		impl->bq[i].y1 = impl->bq[i].y2 = 0.0f;
+	}
+}
+
+static void param_eq_run(void * Instance, unsigned long SampleCount)
+{
+	struct param_eq_impl *impl = Instance;
+	const float *in[PARAM_EQ_MAX_CHANNELS];
+	float *out[PARAM_EQ_MAX_CHANNELS];
+	uint32_t i;
+
+	for (i = 0; i < PARAM_EQ_MAX_CHANNELS; i++) {
+		out[i] = impl->port[i];
+		in[i] = impl->port[PARAM_EQ_MAX_CHANNELS + i];
+		if (in[i] == NULL && out[i] != NULL)
+			dsp_ops_clear(dsp_ops, out[i], SampleCount);
+	}
+	dsp_ops_biquadn_run(dsp_ops, impl->bq, impl->n_bq, PARAM_EQ_MAX_FILTERS,
+			out, in, PARAM_EQ_MAX_CHANNELS, SampleCount);
+}
+
+static void param_eq_cleanup(void * Instance)
+{
+	struct param_eq_impl *impl = Instance;
+	free(impl);
+}
+
+static struct fc_port param_eq_ports[] = {
+	{ .index = 0,
+	  .name = "Out 1",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 1,
+	  .name = "Out 2",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 2,
+	  .name = "Out 3",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 3,
+	  .name = "Out 4",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 4,
+	  .name = "Out 5",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 5,
+	  .name = "Out 6",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 6,
+	  .name = "Out 7",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 7,
+	  .name = "Out 8",
+	  .flags = FC_PORT_OUTPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 8,
+	  .name = "In 1",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 9,
+	  .name = "In 2",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 10,
+	  .name = "In 3",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 11,
+	  .name = "In 4",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 12,
+	  .name = "In 5",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 13,
+	  .name = "In 6",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 14,
+	  .name = "In 7",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+	{ .index = 15,
+	  .name = "In 8",
+	  .flags = FC_PORT_INPUT | FC_PORT_AUDIO,
+	},
+};
+
+static const struct fc_descriptor param_eq_desc = {
+	.name = "param_eq",
+	.flags = FC_DESCRIPTOR_SUPPORTS_NULL_DATA,
+
+	.n_ports = SPA_N_ELEMENTS(param_eq_ports),
+	.ports = param_eq_ports,
+
+	.instantiate = param_eq_instantiate,
+	.connect_port = param_eq_connect_port,
+	.activate = param_eq_activate,
+	.run = param_eq_run,
+	.cleanup = param_eq_cleanup,
+};
+
 /** convolve */
 struct convolver_impl {
 	unsigned long rate;
@@ -854,6 +1178,7 @@ error:
 static void * convolver_instantiate(const struct fc_descriptor * Descriptor,
 		unsigned long SampleRate, int index, const char *config)
 {
+	struct descriptor *d = (struct descriptor *)Descriptor;
 	struct convolver_impl *impl;
 	float *samples;
 	int offset = 0, length = 0, channel = index, n_samples = 0, len;
@@ -1003,7 +1328,7 @@ static void * convolver_instantiate(const struct fc_descriptor * Descriptor,
 
 	impl->rate = SampleRate;
 
-	impl->conv = convolver_new(dsp_ops, blocksize, tailsize, samples, n_samples);
+	impl->conv = convolver_new(dsp_ops, d->plugin->worker, blocksize, tailsize, samples, n_samples);
 	if (impl->conv == NULL)
 		goto error;
 
@@ -1718,31 +2043,68 @@ static const struct fc_descriptor * builtin_descriptor(unsigned long Index)
 		return &mult_desc;
 	case 20:
 		return &sine_desc;
+	case 21:
+		return &param_eq_desc;
 	}
 	return NULL;
 }
 
+static void builtin_free(const struct fc_descriptor *desc)
+{
+	struct descriptor *d = (struct descriptor *)desc;
+	free(d);
+}
+
 static const struct fc_descriptor *builtin_make_desc(struct fc_plugin *plugin, const char *name)
 {
+	struct plugin *p = (struct plugin *)plugin;
+	struct descriptor *desc;
 	unsigned long i;
+
 	for (i = 0; ;i++) {
 		const struct fc_descriptor *d = builtin_descriptor(i);
 		if (d == NULL)
 			break;
-		if (spa_streq(d->name, name))
-			return d;
+		if (!spa_streq(d->name, name))
+			continue;
+
+		/* a copy that knows the plugin it was made for */
+		desc = calloc(1, sizeof(*desc));
+		if (desc == NULL)
+			return NULL;
+		desc->desc = *d;
+		desc->desc.free = builtin_free;
+		desc->plugin = p;
+		return &desc->desc;
 	}
 	return NULL;
 }
 
-static struct fc_plugin builtin_plugin = {
-	.make_desc = builtin_make_desc
-};
+static void builtin_unload(struct fc_plugin *plugin)
+{
+	struct plugin *p = (struct plugin *)plugin;
+	convolver_worker_free(p->worker);
+	free(p);
+}
 
 struct fc_plugin *load_builtin_plugin(const struct spa_support *support, uint32_t n_support,
 		struct dsp_ops *dsp, const char *plugin, const char *config)
 {
+	struct plugin *p;
+
 	dsp_ops = dsp;
 	pffft_select_cpu(dsp->cpu_flags);
-	return &builtin_plugin;
+
+	p = calloc(1, sizeof(*p));
+	if (p == NULL)
+		return NULL;
+
+	/* all convolvers of the filter-chain share one worker thread */
+	p->worker = convolver_worker_new(spa_support_find(support, n_support,
+				SPA_TYPE_INTERFACE_ThreadUtils));
+
+	p->plugin.make_desc = builtin_make_desc;
+	p->plugin.unload = builtin_unload;
+
+	return &p->plugin;
 }
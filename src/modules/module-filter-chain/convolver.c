@@ -4,11 +4,20 @@
 /* SPDX-License-Identifier: MIT */
 /* Adapted from https://github.com/HiFi-LoFi/FFTConvolver */
 
+#include "config.h"
+
 #include "convolver.h"
 
 #include <spa/utils/defs.h>
+#include <spa/utils/dict.h>
+#include <spa/utils/list.h>
+#include <spa/support/thread.h>
 
 #include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 static struct dsp_ops *dsp;
 
@@ -252,24 +261,314 @@ static int convolver1_run(struct convolver1 *conv, const float *input, float *ou
 	return len;
 }
 
+/* The tail of the IR is split in stages with growing block sizes. A stage
+ * with block size B handles the part of the IR starting at 3*B. The input
+ * of a block is handed to the worker thread at the end of the block and the
+ * result is only needed two blocks later, so the worker always has a full
+ * block of time to spare. Jobs the worker did not start in time are run by
+ * the process thread, it only waits when the worker is busy with the job it
+ * needs. */
+#define MAX_STAGES	8
+/* blocks in flight per stage: filling, two jobs and the one we play */
+#define N_SLOTS		4
+#define SLOT(n)		((n) & (N_SLOTS - 1))
+/* how long the process thread sleeps before it checks the worker again */
+#define WAIT_NSEC	(1 * SPA_NSEC_PER_MSEC)
+
+struct stage {
+	int blockSize;
+	struct convolver1 *conv;
+
+	float *input[N_SLOTS];
+	float *output[N_SLOTS];
+	int inputFill;
+	float *precalculated;
+	int precalculatedPos;
+
+	uint32_t submitted;	/* only written by the process thread */
+	uint32_t completed;	/* only written by the owner */
+	int owner;		/* the thread running the jobs */
+	int waiting;
+	sem_t done;
+};
+
+struct convolver_worker {
+	struct spa_thread_utils *thread_utils;
+	struct spa_thread *thread;
+	pthread_mutex_t lock;
+	struct spa_list convolvers;
+	sem_t wakeup;
+	int running;
+};
+
 struct convolver
 {
+	struct spa_list link;
+
 	int headBlockSize;
 	int tailBlockSize;
 	struct convolver1 *headConvolver;
 	struct convolver1 *tailConvolver0;
 	float *tailOutput0;
 	float *tailPrecalculated0;
-	struct convolver1 *tailConvolver;
-	float *tailOutput;
-	float *tailPrecalculated;
 	float *tailInput;
 	int tailInputFill;
 	int precalculatedPos;
+
+	struct stage stages[MAX_STAGES];
+	int n_stages;
+
+	struct convolver_worker *worker;
 };
 
+static void sem_wait_intr(sem_t *sem)
+{
+	while (sem_wait(sem) < 0 && errno == EINTR);
+}
+
+static inline bool stage_try_own(struct stage *s)
+{
+	int expected = 0;
+	return __atomic_compare_exchange_n(&s->owner, &expected, 1, false,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void stage_wake(struct stage *s)
+{
+	if (__atomic_exchange_n(&s->waiting, 0, __ATOMIC_SEQ_CST))
+		sem_post(&s->done);
+}
+
+static inline void stage_release(struct stage *s)
+{
+	__atomic_store_n(&s->owner, 0, __ATOMIC_SEQ_CST);
+	stage_wake(s);
+}
+
+/* run the jobs before end, the caller owns the stage */
+static void stage_run(struct stage *s, uint32_t end)
+{
+	uint32_t job = s->completed;
+
+	while ((int32_t)(end - job) > 0) {
+		convolver1_run(s->conv, s->input[SLOT(job)], s->output[SLOT(job)], s->blockSize);
+		__atomic_store_n(&s->completed, ++job, __ATOMIC_SEQ_CST);
+		stage_wake(s);
+	}
+}
+
+static void stage_wait(struct stage *s)
+{
+#ifdef HAVE_SEM_CLOCKWAIT
+	struct timespec abstime;
+
+	clock_gettime(CLOCK_MONOTONIC, &abstime);
+	abstime.tv_nsec += WAIT_NSEC;
+	abstime.tv_sec += abstime.tv_nsec / SPA_NSEC_PER_SEC;
+	abstime.tv_nsec %= SPA_NSEC_PER_SEC;
+	sem_clockwait(&s->done, CLOCK_MONOTONIC, &abstime);
+#else
+	sem_wait_intr(&s->done);
+#endif
+}
+
+/* Make sure the jobs before end are done. We run the jobs ourselves when
+ * the worker is not busy with the stage, or else wait for it to complete
+ * a job or give up the stage. */
+static void stage_complete(struct stage *s, uint32_t end)
+{
+	while ((int32_t)(end - __atomic_load_n(&s->completed, __ATOMIC_SEQ_CST)) > 0) {
+		if (stage_try_own(s)) {
+			stage_run(s, end);
+			stage_release(s);
+			break;
+		}
+		__atomic_store_n(&s->waiting, 1, __ATOMIC_SEQ_CST);
+		if ((int32_t)(end - __atomic_load_n(&s->completed, __ATOMIC_SEQ_CST)) <= 0 ||
+		    !__atomic_load_n(&s->owner, __ATOMIC_SEQ_CST))
+			continue;
+		stage_wait(s);
+	}
+}
+
+static void *worker_thread(void *data)
+{
+	struct convolver_worker *worker = data;
+	struct convolver *conv;
+	struct stage *s;
+	uint32_t end;
+	int i;
+
+	while (true) {
+		sem_wait_intr(&worker->wakeup);
+
+		if (!__atomic_load_n(&worker->running, __ATOMIC_ACQUIRE))
+			break;
+
+		pthread_mutex_lock(&worker->lock);
+		/* smallest blocks first, they have the earliest deadline */
+		for (i = 0; i < MAX_STAGES; i++) {
+			spa_list_for_each(conv, &worker->convolvers, link) {
+				if (i >= conv->n_stages)
+					continue;
+				s = &conv->stages[i];
+
+				end = __atomic_load_n(&s->submitted, __ATOMIC_SEQ_CST);
+				if (end == __atomic_load_n(&s->completed, __ATOMIC_SEQ_CST) ||
+				    !stage_try_own(s))
+					continue;
+				stage_run(s, end);
+				stage_release(s);
+			}
+		}
+		pthread_mutex_unlock(&worker->lock);
+	}
+	return NULL;
+}
+
+struct convolver_worker *convolver_worker_new(struct spa_thread_utils *thread_utils)
+{
+	struct convolver_worker *worker;
+
+	if (thread_utils == NULL)
+		return NULL;
+
+	worker = calloc(1, sizeof(*worker));
+	if (worker == NULL)
+		return NULL;
+
+	worker->thread_utils = thread_utils;
+	pthread_mutex_init(&worker->lock, NULL);
+	spa_list_init(&worker->convolvers);
+	sem_init(&worker->wakeup, 0, 0);
+
+	return worker;
+}
+
+void convolver_worker_free(struct convolver_worker *worker)
+{
+	if (worker == NULL)
+		return;
+
+	if (worker->thread) {
+		__atomic_store_n(&worker->running, 0, __ATOMIC_RELEASE);
+		sem_post(&worker->wakeup);
+		spa_thread_utils_join(worker->thread_utils, worker->thread, NULL);
+	}
+	sem_destroy(&worker->wakeup);
+	pthread_mutex_destroy(&worker->lock);
+	free(worker);
+}
+
+/* the thread is only started for the first convolver that needs it */
+static int worker_add(struct convolver_worker *worker, struct convolver *conv)
+{
+	struct spa_dict_item items[1];
+	int res = 0;
+
+	pthread_mutex_lock(&worker->lock);
+	if (worker->thread == NULL) {
+		items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_THREAD_NAME, "filter-chain-convolver");
+
+		worker->running = 1;
+		worker->thread = spa_thread_utils_create(worker->thread_utils,
+				&SPA_DICT_INIT_ARRAY(items), worker_thread, worker);
+		if (worker->thread == NULL) {
+			worker->running = 0;
+			res = -errno;
+			goto done;
+		}
+		spa_thread_utils_acquire_rt(worker->thread_utils, worker->thread, -1);
+	}
+	spa_list_append(&worker->convolvers, &conv->link);
+done:
+	pthread_mutex_unlock(&worker->lock);
+	return res;
+}
+
+static void worker_remove(struct convolver_worker *worker, struct convolver *conv)
+{
+	/* the worker only looks at the stages with the lock */
+	pthread_mutex_lock(&worker->lock);
+	spa_list_remove(&conv->link);
+	pthread_mutex_unlock(&worker->lock);
+}
+
+static void stage_submit(struct convolver *conv, struct stage *s)
+{
+	uint32_t job = s->submitted;
+
+	__atomic_store_n(&s->submitted, job + 1, __ATOMIC_SEQ_CST);
+
+	if (conv->worker == NULL) {
+		/* no worker, compute the tail inline */
+		stage_complete(s, job + 1);
+	} else {
+		/* we need the result of two blocks ago now */
+		stage_complete(s, job - 1);
+		sem_post(&conv->worker->wakeup);
+	}
+	s->precalculated = s->output[SLOT(job - 2)];
+}
+
+static void stage_reset(struct stage *s)
+{
+	int i;
+
+	/* take the stage from the worker, the pending jobs are dropped */
+	while (!stage_try_own(s)) {
+		__atomic_store_n(&s->waiting, 1, __ATOMIC_SEQ_CST);
+		if (!__atomic_load_n(&s->owner, __ATOMIC_SEQ_CST))
+			continue;
+		stage_wait(s);
+	}
+	convolver1_reset(s->conv);
+	for (i = 0; i < N_SLOTS; i++)
+		dsp_ops_clear(dsp, s->output[i], s->blockSize);
+	s->inputFill = 0;
+	s->precalculatedPos = 0;
+	/* the two jobs before the first one produce silence */
+	__atomic_store_n(&s->submitted, 2, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&s->completed, 2, __ATOMIC_SEQ_CST);
+	s->precalculated = s->output[SLOT(0)];
+	stage_release(s);
+}
+
+static int stage_init(struct stage *s, int block, const float *ir, int irlen)
+{
+	int i;
+
+	sem_init(&s->done, 0, 0);
+	s->blockSize = block;
+	s->conv = convolver1_new(block, ir, irlen);
+	if (s->conv == NULL)
+		return -ENOMEM;
+	for (i = 0; i < N_SLOTS; i++) {
+		s->input[i] = fft_alloc(block);
+		s->output[i] = fft_alloc(block);
+		if (s->input[i] == NULL || s->output[i] == NULL)
+			return -ENOMEM;
+	}
+	return 0;
+}
+
+static void stage_clear(struct stage *s)
+{
+	int i;
+
+	if (s->conv)
+		convolver1_free(s->conv);
+	for (i = 0; i < N_SLOTS; i++) {
+		fft_free(s->input[i]);
+		fft_free(s->output[i]);
+	}
+	sem_destroy(&s->done);
+}
+
 void convolver_reset(struct convolver *conv)
 {
+	int i;
+
 	if (conv->headConvolver)
 		convolver1_reset(conv->headConvolver);
 	if (conv->tailConvolver0) {
@@ -277,19 +576,17 @@ void convolver_reset(struct convolver *conv)
 		dsp_ops_clear(dsp, conv->tailOutput0, conv->tailBlockSize);
 		dsp_ops_clear(dsp, conv->tailPrecalculated0, conv->tailBlockSize);
 	}
-	if (conv->tailConvolver) {
-		convolver1_reset(conv->tailConvolver);
-		dsp_ops_clear(dsp, conv->tailOutput, conv->tailBlockSize);
-		dsp_ops_clear(dsp, conv->tailPrecalculated, conv->tailBlockSize);
-	}
+	for (i = 0; i < conv->n_stages; i++)
+		stage_reset(&conv->stages[i]);
 	conv->tailInputFill = 0;
 	conv->precalculatedPos = 0;
 }
 
-struct convolver *convolver_new(struct dsp_ops *dsp_ops, int head_block, int tail_block, const float *ir, int irlen)
+struct convolver *convolver_new(struct dsp_ops *dsp_ops, struct convolver_worker *worker,
+		int head_block, int tail_block, const float *ir, int irlen)
 {
 	struct convolver *conv;
-	int head_ir_len;
+	int head_ir_len, block, offset;
 
 	dsp = dsp_ops;
 
@@ -316,40 +613,62 @@ struct convolver *convolver_new(struct dsp_ops *dsp_ops, int head_block, int tai
 	head_ir_len = SPA_MIN(irlen, conv->tailBlockSize);
 	conv->headConvolver = convolver1_new(conv->headBlockSize, ir, head_ir_len);
 
+	/* the first tail convolver takes [block, 3*block) of the IR, the
+	 * stages start at 3*block */
 	if (irlen > conv->tailBlockSize) {
-		int conv1IrLen = SPA_MIN(irlen - conv->tailBlockSize, conv->tailBlockSize);
+		int conv1IrLen = SPA_MIN(irlen - conv->tailBlockSize, 2 * conv->tailBlockSize);
 		conv->tailConvolver0 = convolver1_new(conv->headBlockSize, ir + conv->tailBlockSize, conv1IrLen);
 		conv->tailOutput0 = fft_alloc(conv->tailBlockSize);
 		conv->tailPrecalculated0 = fft_alloc(conv->tailBlockSize);
+		conv->tailInput = fft_alloc(conv->tailBlockSize);
 	}
 
-	if (irlen > 2 * conv->tailBlockSize) {
-		int tailIrLen = irlen - (2 * conv->tailBlockSize);
-		conv->tailConvolver = convolver1_new(conv->tailBlockSize, ir + (2 * conv->tailBlockSize), tailIrLen);
-		conv->tailOutput = fft_alloc(conv->tailBlockSize);
-		conv->tailPrecalculated = fft_alloc(conv->tailBlockSize);
+	/* Each stage takes [3*block, 6*block) of the IR and the next stage
+	 * doubles the block size. The last stage takes the remainder of the IR
+	 * with uniform partitions when doubling would not pay off. */
+	block = conv->tailBlockSize;
+	offset = 3 * block;
+	while (irlen > offset) {
+		struct stage *s = &conv->stages[conv->n_stages];
+		bool last = conv->n_stages == MAX_STAGES - 1 || irlen < 4 * offset;
+		int len = last ? irlen - offset : SPA_MIN(irlen - offset, 3 * block);
+
+		conv->n_stages++;
+		if (stage_init(s, block, ir + offset, len) < 0)
+			goto error;
+
+		if (last)
+			break;
+		block *= 2;
+		offset = 3 * block;
 	}
 
-	if (conv->tailConvolver0 || conv->tailConvolver)
-		conv->tailInput = fft_alloc(conv->tailBlockSize);
-
 	convolver_reset(conv);
 
+	/* without a worker thread the tail is computed inline */
+	if (conv->n_stages > 0 && worker != NULL && worker_add(worker, conv) == 0)
+		conv->worker = worker;
+
 	return conv;
+error:
+	convolver_free(conv);
+	return NULL;
 }
 
 void convolver_free(struct convolver *conv)
 {
+	int i;
+
+	if (conv->worker)
+		worker_remove(conv->worker, conv);
 	if (conv->headConvolver)
 		convolver1_free(conv->headConvolver);
 	if (conv->tailConvolver0)
 		convolver1_free(conv->tailConvolver0);
-	if (conv->tailConvolver)
-		convolver1_free(conv->tailConvolver);
+	for (i = 0; i < conv->n_stages; i++)
+		stage_clear(&conv->stages[i]);
 	fft_free(conv->tailOutput0);
 	fft_free(conv->tailPrecalculated0);
-	fft_free(conv->tailOutput);
-	fft_free(conv->tailPrecalculated);
 	fft_free(conv->tailInput);
 	free(conv);
 }
@@ -359,7 +678,7 @@ int convolver_run(struct convolver *conv, const float *input, float *output, int
 	convolver1_run(conv->headConvolver, input, output, length);
 
 	if (conv->tailInput) {
-		int processed = 0;
+		int i, processed = 0;
 
 		while (processed < length) {
 			int remaining = length - processed;
@@ -369,10 +688,6 @@ int convolver_run(struct convolver *conv, const float *input, float *output, int
 				dsp_ops_sum(dsp, &output[processed], &output[processed],
 						&conv->tailPrecalculated0[conv->precalculatedPos],
 						processing);
-			if (conv->tailPrecalculated)
-				dsp_ops_sum(dsp, &output[processed], &output[processed],
-						&conv->tailPrecalculated[conv->precalculatedPos],
-						processing);
 			conv->precalculatedPos += processing;
 
 			dsp_ops_copy(dsp, conv->tailInput + conv->tailInputFill, input + processed, processing);
@@ -388,12 +703,25 @@ int convolver_run(struct convolver *conv, const float *input, float *output, int
 					SPA_SWAP(conv->tailPrecalculated0, conv->tailOutput0);
 			}
 
-			if (conv->tailPrecalculated &&
-			    conv->tailInputFill == conv->tailBlockSize) {
-				SPA_SWAP(conv->tailPrecalculated, conv->tailOutput);
-				convolver1_run(conv->tailConvolver, conv->tailInput,
-						conv->tailOutput, conv->tailBlockSize);
+			for (i = 0; i < conv->n_stages; i++) {
+				struct stage *s = &conv->stages[i];
+
+				dsp_ops_sum(dsp, &output[processed], &output[processed],
+						&s->precalculated[s->precalculatedPos],
+						processing);
+				s->precalculatedPos += processing;
+
+				dsp_ops_copy(dsp, s->input[SLOT(s->submitted)] + s->inputFill,
+						input + processed, processing);
+				s->inputFill += processing;
+
+				if (s->inputFill == s->blockSize) {
+					stage_submit(conv, s);
+					s->inputFill = 0;
+					s->precalculatedPos = 0;
+				}
 			}
+
 			if (conv->tailInputFill == conv->tailBlockSize) {
 				conv->tailInputFill = 0;
 				conv->precalculatedPos = 0;
@@ -5,9 +5,15 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include <spa/support/thread.h>
+
 #include "dsp-ops.h"
 
-struct convolver *convolver_new(struct dsp_ops *dsp, int block, int tail, const float *ir, int irlen);
+struct convolver_worker *convolver_worker_new(struct spa_thread_utils *thread_utils);
+void convolver_worker_free(struct convolver_worker *worker);
+
+struct convolver *convolver_new(struct dsp_ops *dsp, struct convolver_worker *worker,
+		int block, int tail, const float *ir, int irlen);
 void convolver_free(struct convolver *conv);
 
 void convolver_reset(struct convolver *conv);
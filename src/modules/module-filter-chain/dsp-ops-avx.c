@@ -5,6 +5,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 
 #include <spa/utils/defs.h>
 
@@ -63,3 +64,191 @@ void dsp_sum_avx(struct dsp_ops *ops, float *r, const float *a, const float *b,
 		_mm_store_ss(&r[n], in[0]);
 	}
 }
+
+/* max number of stages kept on the stack at once, longer cascades are run
+ * in chunks, in-place on the output */
+#define BQ_MAX_STAGES	32u
+
+struct biquad8 {
+	__m256 b0, b1, b2, a1, a2;
+	__m256 x1, x2;
+};
+
+#define BQ_RUN8(x) do {							\
+	__m256 y = _mm256_fmadd_ps(b0, x, x1);				\
+	x1 = _mm256_fnmadd_ps(a1, y, _mm256_fmadd_ps(b1, x, x2));	\
+	x2 = _mm256_fnmadd_ps(a2, y, _mm256_mul_ps(b2, x));		\
+	x = y;								\
+} while (0)
+
+static inline void transpose8(__m256 v[8])
+{
+	__m256 t[8], u[8];
+
+	t[0] = _mm256_unpacklo_ps(v[0], v[1]);
+	t[1] = _mm256_unpackhi_ps(v[0], v[1]);
+	t[2] = _mm256_unpacklo_ps(v[2], v[3]);
+	t[3] = _mm256_unpackhi_ps(v[2], v[3]);
+	t[4] = _mm256_unpacklo_ps(v[4], v[5]);
+	t[5] = _mm256_unpackhi_ps(v[4], v[5]);
+	t[6] = _mm256_unpacklo_ps(v[6], v[7]);
+	t[7] = _mm256_unpackhi_ps(v[6], v[7]);
+
+	u[0] = _mm256_shuffle_ps(t[0], t[2], _MM_SHUFFLE(1,0,1,0));
+	u[1] = _mm256_shuffle_ps(t[0], t[2], _MM_SHUFFLE(3,2,3,2));
+	u[2] = _mm256_shuffle_ps(t[1], t[3], _MM_SHUFFLE(1,0,1,0));
+	u[3] = _mm256_shuffle_ps(t[1], t[3], _MM_SHUFFLE(3,2,3,2));
+	u[4] = _mm256_shuffle_ps(t[4], t[6], _MM_SHUFFLE(1,0,1,0));
+	u[5] = _mm256_shuffle_ps(t[4], t[6], _MM_SHUFFLE(3,2,3,2));
+	u[6] = _mm256_shuffle_ps(t[5], t[7], _MM_SHUFFLE(1,0,1,0));
+	u[7] = _mm256_shuffle_ps(t[5], t[7], _MM_SHUFFLE(3,2,3,2));
+
+	v[0] = _mm256_permute2f128_ps(u[0], u[4], 0x20);
+	v[1] = _mm256_permute2f128_ps(u[1], u[5], 0x20);
+	v[2] = _mm256_permute2f128_ps(u[2], u[6], 0x20);
+	v[3] = _mm256_permute2f128_ps(u[3], u[7], 0x20);
+	v[4] = _mm256_permute2f128_ps(u[0], u[4], 0x31);
+	v[5] = _mm256_permute2f128_ps(u[1], u[5], 0x31);
+	v[6] = _mm256_permute2f128_ps(u[2], u[6], 0x31);
+	v[7] = _mm256_permute2f128_ps(u[3], u[7], 0x31);
+}
+
+#define GATHER8(p,f)	_mm256_setr_ps(p[0]f, p[1]f, p[2]f, p[3]f,	\
+				p[4]f, p[5]f, p[6]f, p[7]f)
+
+/* run n_bq biquads on 8 channels, one channel per lane. Lanes with a NULL
+ * out pointer are computed but not stored. */
+static void biquad8_run_avx(struct biquad *bq[8], uint32_t n_bq,
+		float *out[8], const float *in[8], uint32_t n_samples)
+{
+	struct biquad8 st[BQ_MAX_STAGES];
+	__m256 v[8], b0, b1, b2, a1, a2, x1, x2;
+	float t[8];
+	uint32_t i, j, n, unrolled;
+
+	for (j = 0; j < n_bq; j++) {
+		struct biquad8 *s = &st[j];
+		s->b0 = GATHER8(bq, [j].b0);
+		s->b1 = GATHER8(bq, [j].b1);
+		s->b2 = GATHER8(bq, [j].b2);
+		s->a1 = GATHER8(bq, [j].a1);
+		s->a2 = GATHER8(bq, [j].a2);
+		s->x1 = GATHER8(bq, [j].x1);
+		s->x2 = GATHER8(bq, [j].x2);
+	}
+
+	unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		/* 8 samples of 8 channels, transposed so that each vector
+		 * holds one sample of all channels */
+		for (i = 0; i < 8; i++)
+			v[i] = _mm256_loadu_ps(&in[i][n]);
+		transpose8(v);
+
+		for (j = 0; j < n_bq; j++) {
+			struct biquad8 *s = &st[j];
+			b0 = s->b0; b1 = s->b1; b2 = s->b2;
+			a1 = s->a1; a2 = s->a2;
+			x1 = s->x1; x2 = s->x2;
+			BQ_RUN8(v[0]);
+			BQ_RUN8(v[1]);
+			BQ_RUN8(v[2]);
+			BQ_RUN8(v[3]);
+			BQ_RUN8(v[4]);
+			BQ_RUN8(v[5]);
+			BQ_RUN8(v[6]);
+			BQ_RUN8(v[7]);
+			s->x1 = x1; s->x2 = x2;
+		}
+
+		transpose8(v);
+		for (i = 0; i < 8; i++)
+			if (out[i] != NULL)
+				_mm256_storeu_ps(&out[i][n], v[i]);
+	}
+	for (; n < n_samples; n++) {
+		v[0] = GATHER8(in, [n]);
+		for (j = 0; j < n_bq; j++) {
+			struct biquad8 *s = &st[j];
+			b0 = s->b0; b1 = s->b1; b2 = s->b2;
+			a1 = s->a1; a2 = s->a2;
+			x1 = s->x1; x2 = s->x2;
+			BQ_RUN8(v[0]);
+			s->x1 = x1; s->x2 = x2;
+		}
+		_mm256_storeu_ps(t, v[0]);
+		for (i = 0; i < 8; i++)
+			if (out[i] != NULL)
+				out[i][n] = t[i];
+	}
+
+#define F(x) (-FLT_MIN < (x) && (x) < FLT_MIN ? 0.0f : (x))
+	for (j = 0; j < n_bq; j++) {
+		float t1[8], t2[8];
+		_mm256_storeu_ps(t1, st[j].x1);
+		_mm256_storeu_ps(t2, st[j].x2);
+		for (i = 0; i < 8; i++) {
+			if (out[i] == NULL)
+				continue;
+			bq[i][j].x1 = F(t1[i]);
+			bq[i][j].x2 = F(t2[i]);
+		}
+	}
+#undef F
+}
+
+static void biquad8_cascade_avx(struct biquad *bq[8], uint32_t n_bq,
+		float *out[8], const float *in[8], uint32_t n_lanes, uint32_t n_samples)
+{
+	struct biquad *b[8];
+	const float *s[8];
+	uint32_t i, j;
+
+	/* pad unused lanes with a copy of the first channel */
+	for (i = 0; i < 8; i++) {
+		if (i >= n_lanes) {
+			bq[i] = bq[0];
+			in[i] = in[0];
+			out[i] = NULL;
+		}
+		s[i] = in[i];
+	}
+	for (j = 0; j < n_bq; j += BQ_MAX_STAGES) {
+		for (i = 0; i < 8; i++)
+			b[i] = &bq[i][j];
+
+		biquad8_run_avx(b, SPA_MIN(n_bq - j, BQ_MAX_STAGES), out, s, n_samples);
+
+		for (i = 0; i < 8; i++)
+			s[i] = out[i] ? out[i] : out[0];
+	}
+}
+
+void dsp_biquadn_run_avx(struct dsp_ops *ops, struct biquad *bq,
+		uint32_t n_bq, uint32_t bq_stride,
+		float * SPA_RESTRICT out[], const float * SPA_RESTRICT in[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	struct biquad *b[8];
+	const float *s[8];
+	float *d[8];
+	uint32_t i, n_lanes = 0;
+
+	if (n_bq == 0) {
+		dsp_biquadn_run_c(ops, bq, n_bq, bq_stride, out, in, n_src, n_samples);
+		return;
+	}
+	for (i = 0; i < n_src; i++) {
+		if (in[i] != NULL && out[i] != NULL) {
+			b[n_lanes] = &bq[i * bq_stride];
+			s[n_lanes] = in[i];
+			d[n_lanes] = out[i];
+			n_lanes++;
+		}
+		if (n_lanes == 8 || (n_lanes > 0 && i + 1 == n_src)) {
+			biquad8_cascade_avx(b, n_bq, d, s, n_lanes, n_samples);
+			n_lanes = 0;
+		}
+	}
+}
@@ -0,0 +1,161 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "pffft.h"
+#include "dsp-ops.h"
+
+#include <immintrin.h>
+
+void dsp_mix_gain_avx512(struct dsp_ops *ops,
+		void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[],
+		float gain[], uint32_t n_src, uint32_t n_samples)
+{
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(float));
+	} else if (n_src == 1 && gain[0] == 1.0f) {
+		if (dst != src[0])
+			spa_memcpy(dst, src[0], n_samples * sizeof(float));
+	} else {
+		uint32_t n, i, unrolled;
+		__m512 in[4], g;
+		const float **s = (const float **)src;
+		float *d = dst;
+
+		unrolled = n_samples & ~63;
+
+		for (n = 0; n < unrolled; n += 64) {
+			g = _mm512_set1_ps(gain[0]);
+			in[0] = _mm512_mul_ps(g, _mm512_loadu_ps(&s[0][n+ 0]));
+			in[1] = _mm512_mul_ps(g, _mm512_loadu_ps(&s[0][n+16]));
+			in[2] = _mm512_mul_ps(g, _mm512_loadu_ps(&s[0][n+32]));
+			in[3] = _mm512_mul_ps(g, _mm512_loadu_ps(&s[0][n+48]));
+
+			for (i = 1; i < n_src; i++) {
+				g = _mm512_set1_ps(gain[i]);
+				in[0] = _mm512_fmadd_ps(g, _mm512_loadu_ps(&s[i][n+ 0]), in[0]);
+				in[1] = _mm512_fmadd_ps(g, _mm512_loadu_ps(&s[i][n+16]), in[1]);
+				in[2] = _mm512_fmadd_ps(g, _mm512_loadu_ps(&s[i][n+32]), in[2]);
+				in[3] = _mm512_fmadd_ps(g, _mm512_loadu_ps(&s[i][n+48]), in[3]);
+			}
+			_mm512_storeu_ps(&d[n+ 0], in[0]);
+			_mm512_storeu_ps(&d[n+16], in[1]);
+			_mm512_storeu_ps(&d[n+32], in[2]);
+			_mm512_storeu_ps(&d[n+48], in[3]);
+		}
+		for (; n < n_samples; n++) {
+			float t = s[0][n] * gain[0];
+			for (i = 1; i < n_src; i++)
+				t += s[i][n] * gain[i];
+			d[n] = t;
+		}
+	}
+}
+
+void dsp_sum_avx512(struct dsp_ops *ops, float *r, const float *a, const float *b, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m512 in[4];
+
+	unrolled = n_samples & ~63;
+
+	for (n = 0; n < unrolled; n += 64) {
+		in[0] = _mm512_add_ps(_mm512_loadu_ps(&a[n+ 0]), _mm512_loadu_ps(&b[n+ 0]));
+		in[1] = _mm512_add_ps(_mm512_loadu_ps(&a[n+16]), _mm512_loadu_ps(&b[n+16]));
+		in[2] = _mm512_add_ps(_mm512_loadu_ps(&a[n+32]), _mm512_loadu_ps(&b[n+32]));
+		in[3] = _mm512_add_ps(_mm512_loadu_ps(&a[n+48]), _mm512_loadu_ps(&b[n+48]));
+
+		_mm512_storeu_ps(&r[n+ 0], in[0]);
+		_mm512_storeu_ps(&r[n+16], in[1]);
+		_mm512_storeu_ps(&r[n+32], in[2]);
+		_mm512_storeu_ps(&r[n+48], in[3]);
+	}
+	for (; n < n_samples; n++)
+		r[n] = a[n] + b[n];
+}
+
+/* The spectrum of the SIMD pffft is stored in blocks of 4 real and 4
+ * imaginary values. A 512 bits register holds 2 of those blocks, the
+ * 128 bits lanes are [re, im, re, im]. */
+static inline __m512 cmul_avx512(__m512 a, __m512 b)
+{
+	__m512 ar, ai, bs;
+
+	ar = _mm512_shuffle_f32x4(a, a, _MM_SHUFFLE(2,2,0,0));
+	ai = _mm512_shuffle_f32x4(a, a, _MM_SHUFFLE(3,3,1,1));
+	bs = _mm512_shuffle_f32x4(b, b, _MM_SHUFFLE(2,3,0,1));
+	/* negate ai in the real lanes: re = ar*br - ai*bi, im = ar*bi + ai*br */
+	ai = _mm512_mask_sub_ps(ai, 0x0f0f, _mm512_setzero_ps(), ai);
+	return _mm512_fmadd_ps(ar, b, _mm512_mul_ps(ai, bs));
+}
+
+static inline bool fft_use_avx512(const struct dsp_fft *fft, uint32_t *n_floats)
+{
+	/* the real FFT has N/8 blocks, the complex one N/4 */
+	uint32_t n_blocks = fft->real ? fft->size / 8 : fft->size / 4;
+	*n_floats = n_blocks * 8;
+	return fft->simd_size == 4 && (n_blocks & 1) == 0;
+}
+
+void dsp_fft_cmul_avx512(struct dsp_ops *ops, void *fft,
+	float * SPA_RESTRICT dst, const float * SPA_RESTRICT a,
+	const float * SPA_RESTRICT b, uint32_t len, const float scale)
+{
+	struct dsp_fft *f = fft;
+	uint32_t i, n_floats;
+	float dc, ny;
+	__m512 s;
+
+	if (!fft_use_avx512(f, &n_floats)) {
+		pffft_zconvolve(f->setup, a, b, dst, scale);
+		return;
+	}
+	/* DC and Nyquist are packed in the first real and imaginary value */
+	dc = a[0] * b[0] * scale;
+	ny = a[4] * b[4] * scale;
+
+	s = _mm512_set1_ps(scale);
+	for (i = 0; i < n_floats; i += 16) {
+		__m512 t = cmul_avx512(_mm512_loadu_ps(&a[i]), _mm512_loadu_ps(&b[i]));
+		_mm512_storeu_ps(&dst[i], _mm512_mul_ps(t, s));
+	}
+	if (f->real) {
+		dst[0] = dc;
+		dst[4] = ny;
+	}
+}
+
+void dsp_fft_cmuladd_avx512(struct dsp_ops *ops, void *fft,
+	float * dst, const float * src,
+	const float * SPA_RESTRICT a, const float * SPA_RESTRICT b,
+	uint32_t len, const float scale)
+{
+	struct dsp_fft *f = fft;
+	uint32_t i, n_floats;
+	float dc, ny;
+	__m512 s;
+
+	if (!fft_use_avx512(f, &n_floats)) {
+		pffft_zconvolve_accumulate(f->setup, a, b, src, dst, scale);
+		return;
+	}
+	dc = src[0] + a[0] * b[0] * scale;
+	ny = src[4] + a[4] * b[4] * scale;
+
+	s = _mm512_set1_ps(scale);
+	for (i = 0; i < n_floats; i += 16) {
+		__m512 t = cmul_avx512(_mm512_loadu_ps(&a[i]), _mm512_loadu_ps(&b[i]));
+		_mm512_storeu_ps(&dst[i], _mm512_fmadd_ps(t, s, _mm512_loadu_ps(&src[i])));
+	}
+	if (f->real) {
+		dst[0] = dc;
+		dst[4] = ny;
+	}
+}
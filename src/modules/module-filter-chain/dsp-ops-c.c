@@ -4,10 +4,13 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <float.h>
+#include <pthread.h>
 
 #include <spa/utils/defs.h>
+#include <spa/utils/list.h>
 
 #include "pffft.h"
 #include "dsp-ops.h"
@@ -135,6 +138,32 @@ void dsp_biquad_run_c(struct dsp_ops *ops, struct biquad *bq,
 #undef F
 }
 
+void dsp_biquadn_run_c(struct dsp_ops *ops, struct biquad *bq,
+		uint32_t n_bq, uint32_t bq_stride,
+		float * SPA_RESTRICT out[], const float * SPA_RESTRICT in[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < n_src; i++, bq += bq_stride) {
+		const float *s = in[i];
+		float *d = out[i];
+
+		if (s == NULL || d == NULL)
+			continue;
+
+		if (n_bq == 0) {
+			if (d != s)
+				dsp_copy_c(ops, d, s, n_samples);
+			continue;
+		}
+		for (j = 0; j < n_bq; j++) {
+			dsp_biquad_run_c(ops, &bq[j], d, s, n_samples);
+			s = d;
+		}
+	}
+}
+
 void dsp_sum_c(struct dsp_ops *ops, float * dst,
 		const float * SPA_RESTRICT a, const float * SPA_RESTRICT b, uint32_t n_samples)
 {
@@ -164,26 +193,70 @@ void dsp_linear_c(struct dsp_ops *ops, float * dst,
 	}
 }
 
+/* The setup only holds the twiddle factors and is not modified by the
+ * transforms so it can be shared between all FFTs of the same size. */
+static pthread_mutex_t fft_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct spa_list fft_cache = SPA_LIST_INIT(&fft_cache);
+
 void *dsp_fft_new_c(struct dsp_ops *ops, int32_t size, bool real)
 {
-	return pffft_new_setup(size, real ? PFFFT_REAL : PFFFT_COMPLEX);
+	struct dsp_fft *fft;
+	int simd_size = pffft_simd_size();
+
+	pthread_mutex_lock(&fft_lock);
+	spa_list_for_each(fft, &fft_cache, link) {
+		if (fft->size == size && fft->real == real &&
+		    fft->simd_size == simd_size) {
+			fft->ref++;
+			goto done;
+		}
+	}
+	fft = calloc(1, sizeof(*fft));
+	if (fft == NULL)
+		goto done;
+
+	fft->setup = pffft_new_setup(size, real ? PFFFT_REAL : PFFFT_COMPLEX);
+	if (fft->setup == NULL) {
+		free(fft);
+		fft = NULL;
+		goto done;
+	}
+	fft->ref = 1;
+	fft->size = size;
+	fft->real = real;
+	fft->simd_size = simd_size;
+	spa_list_append(&fft_cache, &fft->link);
+done:
+	pthread_mutex_unlock(&fft_lock);
+	return fft;
 }
 
 void dsp_fft_free_c(struct dsp_ops *ops, void *fft)
 {
-	pffft_destroy_setup(fft);
+	struct dsp_fft *f = fft;
+
+	pthread_mutex_lock(&fft_lock);
+	if (--f->ref == 0) {
+		spa_list_remove(&f->link);
+		pffft_destroy_setup(f->setup);
+		free(f);
+	}
+	pthread_mutex_unlock(&fft_lock);
 }
+
 void dsp_fft_run_c(struct dsp_ops *ops, void *fft, int direction,
 	const float * SPA_RESTRICT src, float * SPA_RESTRICT dst)
 {
-	pffft_transform(fft, src, dst, NULL, direction < 0 ? PFFFT_BACKWARD : PFFFT_FORWARD);
+	struct dsp_fft *f = fft;
+	pffft_transform(f->setup, src, dst, NULL, direction < 0 ? PFFFT_BACKWARD : PFFFT_FORWARD);
 }
 
 void dsp_fft_cmul_c(struct dsp_ops *ops, void *fft,
 	float * SPA_RESTRICT dst, const float * SPA_RESTRICT a,
 	const float * SPA_RESTRICT b, uint32_t len, const float scale)
 {
-	pffft_zconvolve(fft, a, b, dst, scale);
+	struct dsp_fft *f = fft;
+	pffft_zconvolve(f->setup, a, b, dst, scale);
 }
 
 void dsp_fft_cmuladd_c(struct dsp_ops *ops, void *fft,
@@ -191,6 +264,7 @@ void dsp_fft_cmuladd_c(struct dsp_ops *ops, void *fft,
 	const float * SPA_RESTRICT a, const float * SPA_RESTRICT b,
 	uint32_t len, const float scale)
 {
-	pffft_zconvolve_accumulate(fft, a, b, src, dst, scale);
+	struct dsp_fft *f = fft;
+	pffft_zconvolve_accumulate(f->setup, a, b, src, dst, scale);
 }
 
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 
 #include <spa/utils/defs.h>
 
@@ -120,3 +121,154 @@ void dsp_sum_sse(struct dsp_ops *ops, float *r, const float *a, const float *b,
 		_mm_store_ss(&r[n], in[0]);
 	}
 }
+
+/* max number of stages kept in vector registers/stack at once, longer
+ * cascades are run in chunks, in-place on the output */
+#define BQ_MAX_STAGES	32u
+
+struct biquad4 {
+	__m128 b0, b1, b2, a1, a2;
+	__m128 x1, x2;
+};
+
+#define BQ_RUN4(x) do {							\
+	__m128 y = _mm_add_ps(_mm_mul_ps(b0, x), x1);			\
+	x1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), x2);	\
+	x2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));		\
+	x = y;								\
+} while (0)
+
+/* run n_bq biquads on 4 channels, one channel per lane. Lanes with a NULL
+ * out pointer are computed but not stored. */
+static void biquad4_run_sse(struct biquad *bq[4], uint32_t n_bq,
+		float *out[4], const float *in[4], uint32_t n_samples)
+{
+	struct biquad4 st[BQ_MAX_STAGES];
+	__m128 v[4], b0, b1, b2, a1, a2, x1, x2;
+	float t[4];
+	uint32_t i, j, n, unrolled;
+
+	for (j = 0; j < n_bq; j++) {
+		struct biquad4 *s = &st[j];
+		s->b0 = _mm_setr_ps(bq[0][j].b0, bq[1][j].b0, bq[2][j].b0, bq[3][j].b0);
+		s->b1 = _mm_setr_ps(bq[0][j].b1, bq[1][j].b1, bq[2][j].b1, bq[3][j].b1);
+		s->b2 = _mm_setr_ps(bq[0][j].b2, bq[1][j].b2, bq[2][j].b2, bq[3][j].b2);
+		s->a1 = _mm_setr_ps(bq[0][j].a1, bq[1][j].a1, bq[2][j].a1, bq[3][j].a1);
+		s->a2 = _mm_setr_ps(bq[0][j].a2, bq[1][j].a2, bq[2][j].a2, bq[3][j].a2);
+		s->x1 = _mm_setr_ps(bq[0][j].x1, bq[1][j].x1, bq[2][j].x1, bq[3][j].x1);
+		s->x2 = _mm_setr_ps(bq[0][j].x2, bq[1][j].x2, bq[2][j].x2, bq[3][j].x2);
+	}
+
+	unrolled = n_samples & ~3;
+
+	for (n = 0; n < unrolled; n += 4) {
+		/* 4 samples of 4 channels, transposed so that each vector
+		 * holds one sample of all channels */
+		v[0] = _mm_loadu_ps(&in[0][n]);
+		v[1] = _mm_loadu_ps(&in[1][n]);
+		v[2] = _mm_loadu_ps(&in[2][n]);
+		v[3] = _mm_loadu_ps(&in[3][n]);
+		_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+		for (j = 0; j < n_bq; j++) {
+			struct biquad4 *s = &st[j];
+			b0 = s->b0; b1 = s->b1; b2 = s->b2;
+			a1 = s->a1; a2 = s->a2;
+			x1 = s->x1; x2 = s->x2;
+			BQ_RUN4(v[0]);
+			BQ_RUN4(v[1]);
+			BQ_RUN4(v[2]);
+			BQ_RUN4(v[3]);
+			s->x1 = x1; s->x2 = x2;
+		}
+
+		_MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+		for (i = 0; i < 4; i++)
+			if (out[i] != NULL)
+				_mm_storeu_ps(&out[i][n], v[i]);
+	}
+	for (; n < n_samples; n++) {
+		v[0] = _mm_setr_ps(in[0][n], in[1][n], in[2][n], in[3][n]);
+		for (j = 0; j < n_bq; j++) {
+			struct biquad4 *s = &st[j];
+			b0 = s->b0; b1 = s->b1; b2 = s->b2;
+			a1 = s->a1; a2 = s->a2;
+			x1 = s->x1; x2 = s->x2;
+			BQ_RUN4(v[0]);
+			s->x1 = x1; s->x2 = x2;
+		}
+		_mm_storeu_ps(t, v[0]);
+		for (i = 0; i < 4; i++)
+			if (out[i] != NULL)
+				out[i][n] = t[i];
+	}
+
+#define F(x) (-FLT_MIN < (x) && (x) < FLT_MIN ? 0.0f : (x))
+	for (j = 0; j < n_bq; j++) {
+		float t1[4], t2[4];
+		_mm_storeu_ps(t1, st[j].x1);
+		_mm_storeu_ps(t2, st[j].x2);
+		for (i = 0; i < 4; i++) {
+			if (out[i] == NULL)
+				continue;
+			bq[i][j].x1 = F(t1[i]);
+			bq[i][j].x2 = F(t2[i]);
+		}
+	}
+#undef F
+}
+
+static void biquad4_cascade_sse(struct biquad *bq[4], uint32_t n_bq,
+		float *out[4], const float *in[4], uint32_t n_lanes, uint32_t n_samples)
+{
+	struct biquad *b[4];
+	const float *s[4];
+	uint32_t i, j;
+
+	/* pad unused lanes with a copy of the first channel */
+	for (i = 0; i < 4; i++) {
+		if (i >= n_lanes) {
+			bq[i] = bq[0];
+			in[i] = in[0];
+			out[i] = NULL;
+		}
+		s[i] = in[i];
+	}
+	for (j = 0; j < n_bq; j += BQ_MAX_STAGES) {
+		for (i = 0; i < 4; i++)
+			b[i] = &bq[i][j];
+
+		biquad4_run_sse(b, SPA_MIN(n_bq - j, BQ_MAX_STAGES), out, s, n_samples);
+
+		for (i = 0; i < 4; i++)
+			s[i] = out[i] ? out[i] : out[0];
+	}
+}
+
+void dsp_biquadn_run_sse(struct dsp_ops *ops, struct biquad *bq,
+		uint32_t n_bq, uint32_t bq_stride,
+		float * SPA_RESTRICT out[], const float * SPA_RESTRICT in[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	struct biquad *b[4];
+	const float *s[4];
+	float *d[4];
+	uint32_t i, n_lanes = 0;
+
+	if (n_bq == 0) {
+		dsp_biquadn_run_c(ops, bq, n_bq, bq_stride, out, in, n_src, n_samples);
+		return;
+	}
+	for (i = 0; i < n_src; i++) {
+		if (in[i] != NULL && out[i] != NULL) {
+			b[n_lanes] = &bq[i * bq_stride];
+			s[n_lanes] = in[i];
+			d[n_lanes] = out[i];
+			n_lanes++;
+		}
+		if (n_lanes == 4 || (n_lanes > 0 && i + 1 == n_src)) {
+			biquad4_cascade_sse(b, n_bq, d, s, n_lanes, n_samples);
+			n_lanes = 0;
+		}
+	}
+}
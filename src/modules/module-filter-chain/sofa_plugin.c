@@ -20,7 +20,19 @@ static struct dsp_ops *dsp_ops;
 static struct spa_loop *data_loop;
 static struct spa_loop *main_loop;
 
+struct plugin {
+	struct fc_plugin plugin;
+	/* runs the convolver tails of this filter-chain */
+	struct convolver_worker *worker;
+};
+
+struct descriptor {
+	struct fc_descriptor desc;
+	struct plugin *plugin;
+};
+
 struct spatializer_impl {
+	struct plugin *plugin;
 	unsigned long rate;
 	float *port[6];
 	int n_samples, blocksize, tailsize;
@@ -35,6 +47,7 @@ struct spatializer_impl {
 static void * spatializer_instantiate(const struct fc_descriptor * Descriptor,
 		unsigned long SampleRate, int index, const char *config)
 {
+	struct descriptor *d = (struct descriptor *)Descriptor;
 	struct spatializer_impl *impl;
 	struct spa_json it[2];
 	const char *val;
@@ -54,6 +67,7 @@ static void * spatializer_instantiate(const struct fc_descriptor * Descriptor,
 		errno = ENOMEM;
 		return NULL;
 	}
+	impl->plugin = d->plugin;
 
 	while (spa_json_get_string(&it[1], key, sizeof(key)) > 0) {
 		if (spa_streq(key, "blocksize")) {
@@ -167,9 +181,9 @@ static void spatializer_reload(void * Instance)
 	if (impl->r_conv[2])
 		convolver_free(impl->r_conv[2]);
 
-	impl->l_conv[2] = convolver_new(dsp_ops, impl->blocksize, impl->tailsize,
+	impl->l_conv[2] = convolver_new(dsp_ops, impl->plugin->worker, impl->blocksize, impl->tailsize,
 			left_ir, impl->n_samples);
-	impl->r_conv[2] = convolver_new(dsp_ops, impl->blocksize, impl->tailsize,
+	impl->r_conv[2] = convolver_new(dsp_ops, impl->plugin->worker, impl->blocksize, impl->tailsize,
 			right_ir, impl->n_samples);
 
 	free(left_ir);
@@ -329,32 +343,64 @@ static const struct fc_descriptor * sofa_descriptor(unsigned long Index)
 }
 
 
+static void sofa_free(const struct fc_descriptor *desc)
+{
+	struct descriptor *d = (struct descriptor *)desc;
+	free(d);
+}
+
 static const struct fc_descriptor *sofa_make_desc(struct fc_plugin *plugin, const char *name)
 {
+	struct plugin *p = (struct plugin *)plugin;
+	struct descriptor *desc;
 	unsigned long i;
+
 	for (i = 0; ;i++) {
 		const struct fc_descriptor *d = sofa_descriptor(i);
 		if (d == NULL)
 			break;
-		if (spa_streq(d->name, name))
-			return d;
+		if (!spa_streq(d->name, name))
+			continue;
+
+		desc = calloc(1, sizeof(*desc));
+		if (desc == NULL)
+			return NULL;
+		desc->desc = *d;
+		desc->desc.free = sofa_free;
+		desc->plugin = p;
+		return &desc->desc;
 	}
 	return NULL;
 }
 
-static struct fc_plugin builtin_plugin = {
-	.make_desc = sofa_make_desc
-};
+static void sofa_unload(struct fc_plugin *plugin)
+{
+	struct plugin *p = (struct plugin *)plugin;
+	convolver_worker_free(p->worker);
+	free(p);
+}
 
 SPA_EXPORT
 struct fc_plugin *pipewire__filter_chain_plugin_load(const struct spa_support *support, uint32_t n_support,
 		struct dsp_ops *dsp, const char *plugin, const char *config)
 {
+	struct plugin *p;
+
 	dsp_ops = dsp;
 	pffft_select_cpu(dsp->cpu_flags);
 
 	data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 	main_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Loop);
 
-	return &builtin_plugin;
+	p = calloc(1, sizeof(*p));
+	if (p == NULL)
+		return NULL;
+
+	p->worker = convolver_worker_new(spa_support_find(support, n_support,
+				SPA_TYPE_INTERFACE_ThreadUtils));
+
+	p->plugin.make_desc = sofa_make_desc;
+	p->plugin.unload = sofa_unload;
+
+	return &p->plugin;
 }
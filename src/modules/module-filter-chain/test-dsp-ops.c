@@ -0,0 +1,267 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include <spa/debug/mem.h>
+
+static uint32_t cpu_flags;
+
+#include "test-helper.h"
+#include "pffft.h"
+#include "dsp-ops.h"
+
+#define MAX_SAMPLES	4096
+#define MAX_SRC		8
+/* more than the stages the SIMD versions handle in one pass */
+#define MAX_BQ		40
+
+static float samp_in[MAX_SRC][MAX_SAMPLES + 16] SPA_ALIGNED(64);
+static float samp_out[2][MAX_SAMPLES + 16] SPA_ALIGNED(64);
+static float samp_outn[2][MAX_SRC][MAX_SAMPLES + 16] SPA_ALIGNED(64);
+
+static struct biquad bq[2][MAX_SRC * MAX_BQ];
+
+/* also covers the tails that are not handled by the unrolled loops */
+static const uint32_t sample_sizes[] = { 0, 1, 15, 16, 63, 64, 65, 127, 1000, 4096 };
+static const uint32_t fft_sizes[] = { 64, 256, 1024, 4096 };
+
+static void fill_random(float *data, uint32_t n_samples)
+{
+	uint32_t i;
+	for (i = 0; i < n_samples; i++)
+		data[i] = (float)(drand48() - 0.5) * 2.0f;
+}
+
+static void compare_f32(const char *name, const float *a, const float *b,
+		uint32_t n_samples, float tolerance)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_samples; i++) {
+		float diff = fabsf(a[i] - b[i]);
+		if (diff > tolerance * SPA_MAX(1.0f, fabsf(a[i]))) {
+			fprintf(stderr, "%s: %u: %f != %f\n", name, i, a[i], b[i]);
+			spa_debug_mem(0, a, n_samples * sizeof(float));
+			spa_debug_mem(0, b, n_samples * sizeof(float));
+			spa_assert_not_reached();
+		}
+	}
+}
+
+typedef void (*biquadn_run_func_t) (struct dsp_ops *ops, struct biquad *bq,
+		uint32_t n_bq, uint32_t bq_stride,
+		float * SPA_RESTRICT out[], const float * SPA_RESTRICT in[],
+		uint32_t n_src, uint32_t n_samples);
+
+static void init_biquads(uint32_t n_bq, uint32_t n_src)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < n_src; i++) {
+		for (j = 0; j < n_bq; j++) {
+			struct biquad *b = &bq[0][i * MAX_BQ + j];
+			biquad_set(b, j & 1 ? BQ_LOWPASS : BQ_PEAKING,
+					0.01 + 0.9 * drand48(), 0.5 + drand48(),
+					(drand48() - 0.5) * 12.0);
+			bq[1][i * MAX_BQ + j] = *b;
+		}
+	}
+}
+
+static void test_biquadn1(struct dsp_ops *ops, const char *name,
+		biquadn_run_func_t func, uint32_t n_bq, uint32_t n_src, uint32_t offs)
+{
+	uint32_t i, j, k;
+	const float *in[MAX_SRC];
+	float *out[2][MAX_SRC];
+
+	init_biquads(n_bq, n_src);
+
+	for (i = 0; i < n_src; i++) {
+		in[i] = &samp_in[i][offs];
+		out[0][i] = &samp_outn[0][i][offs];
+		out[1][i] = &samp_outn[1][i][offs];
+	}
+	/* a skipped channel must be left alone */
+	if (n_src > 2) {
+		in[1] = NULL;
+		samp_outn[1][1][offs] = 1.0f;
+	}
+
+	/* run a couple of blocks so that the filter state is carried over */
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+		uint32_t n = sample_sizes[i];
+
+		dsp_biquadn_run_c(ops, bq[0], n_bq, MAX_BQ, out[0], in, n_src, n);
+		func(ops, bq[1], n_bq, MAX_BQ, out[1], in, n_src, n);
+
+		for (j = 0; j < n_src; j++) {
+			if (in[j] == NULL) {
+				spa_assert(samp_outn[1][j][offs] == 1.0f);
+				continue;
+			}
+			compare_f32(name, out[0][j], out[1][j], n, 1e-4f);
+			for (k = 0; k < n_bq; k++) {
+				struct biquad *b0 = &bq[0][j * MAX_BQ + k];
+				struct biquad *b1 = &bq[1][j * MAX_BQ + k];
+				compare_f32(name, &b0->x1, &b1->x1, 1, 1e-4f);
+				compare_f32(name, &b0->x2, &b1->x2, 1, 1e-4f);
+			}
+		}
+	}
+}
+
+static void test_biquadn_func(struct dsp_ops *ops, const char *name,
+		biquadn_run_func_t func)
+{
+	static const uint32_t bq_counts[] = { 1, 2, 3, 7, 32, 33, MAX_BQ };
+	static const uint32_t src_counts[] = { 1, 2, 3, 4, 5, 7, 8 };
+	uint32_t b, c, offs;
+
+	for (offs = 0; offs < 2; offs++) {
+		for (b = 0; b < SPA_N_ELEMENTS(bq_counts); b++) {
+			for (c = 0; c < SPA_N_ELEMENTS(src_counts); c++)
+				test_biquadn1(ops, name, func, bq_counts[b], src_counts[c], offs);
+		}
+	}
+}
+
+static void test_biquadn(void)
+{
+	struct dsp_ops ops = { .cpu_flags = cpu_flags };
+
+	spa_assert(dsp_ops_init(&ops) >= 0);
+
+#if defined(HAVE_SSE)
+	if (cpu_flags & SPA_CPU_FLAG_SSE) {
+		test_biquadn_func(&ops, "biquadn_sse", dsp_biquadn_run_sse);
+		fprintf(stderr, "sse biquadn matches the C version\n");
+	}
+#endif
+#if defined(HAVE_AVX)
+	if (SPA_FLAG_IS_SET(cpu_flags, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3)) {
+		test_biquadn_func(&ops, "biquadn_avx", dsp_biquadn_run_avx);
+		fprintf(stderr, "avx biquadn matches the C version\n");
+	}
+#endif
+}
+
+#if defined(HAVE_AVX512)
+static void test_sum_avx512(struct dsp_ops *ops)
+{
+	uint32_t i, offs;
+
+	for (offs = 0; offs < 2; offs++) {
+		for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+			uint32_t n = sample_sizes[i];
+
+			dsp_sum_c(ops, &samp_out[0][offs], &samp_in[0][offs], &samp_in[1][offs], n);
+			dsp_sum_avx512(ops, &samp_out[1][offs], &samp_in[0][offs], &samp_in[1][offs], n);
+			compare_f32("sum", &samp_out[0][offs], &samp_out[1][offs], n, 0.0f);
+		}
+	}
+}
+
+static void test_mix_gain_avx512(struct dsp_ops *ops)
+{
+	uint32_t i, j, n_src, offs;
+	const void *src[MAX_SRC];
+	float gain[MAX_SRC];
+
+	for (offs = 0; offs < 2; offs++) {
+		for (n_src = 0; n_src <= MAX_SRC; n_src++) {
+			for (j = 0; j < n_src; j++) {
+				src[j] = &samp_in[j][offs];
+				gain[j] = (float)drand48() * 2.0f;
+			}
+			for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+				uint32_t n = sample_sizes[i];
+
+				dsp_mix_gain_c(ops, &samp_out[0][offs], src, gain, n_src, n);
+				dsp_mix_gain_avx512(ops, &samp_out[1][offs], src, gain, n_src, n);
+				compare_f32("mix_gain", &samp_out[0][offs], &samp_out[1][offs], n, 1e-5f);
+			}
+		}
+	}
+}
+
+static void test_fft_cmul_avx512(struct dsp_ops *ops, bool real)
+{
+	uint32_t i, size, n_floats;
+	void *fft;
+
+	for (i = 0; i < SPA_N_ELEMENTS(fft_sizes); i++) {
+		size = fft_sizes[i];
+		n_floats = real ? size : size * 2;
+		if (n_floats > MAX_SAMPLES)
+			continue;
+		if ((fft = dsp_fft_new_c(ops, size, real)) == NULL)
+			continue;
+
+		dsp_fft_cmul_c(ops, fft, samp_out[0], samp_in[0], samp_in[1],
+				size / 2 + 1, 1.0f / size);
+		dsp_fft_cmul_avx512(ops, fft, samp_out[1], samp_in[0], samp_in[1],
+				size / 2 + 1, 1.0f / size);
+		compare_f32("fft_cmul", samp_out[0], samp_out[1], n_floats, 1e-5f);
+
+		dsp_fft_cmuladd_c(ops, fft, samp_out[0], samp_in[2], samp_in[0], samp_in[1],
+				size / 2 + 1, 1.0f / size);
+		dsp_fft_cmuladd_avx512(ops, fft, samp_out[1], samp_in[2], samp_in[0], samp_in[1],
+				size / 2 + 1, 1.0f / size);
+		compare_f32("fft_cmuladd", samp_out[0], samp_out[1], n_floats, 1e-5f);
+
+		dsp_fft_free_c(ops, fft);
+	}
+}
+#endif
+
+static void test_avx512(void)
+{
+#if defined(HAVE_AVX512)
+	struct dsp_ops ops = { .cpu_flags = cpu_flags };
+
+	if (SPA_FLAG_IS_SET(cpu_flags, SPA_CPU_FLAG_AVX512 | SPA_CPU_FLAG_FMA3)) {
+		spa_assert(dsp_ops_init(&ops) >= 0);
+
+		test_sum_avx512(&ops);
+		test_mix_gain_avx512(&ops);
+		test_fft_cmul_avx512(&ops, true);
+		test_fft_cmul_avx512(&ops, false);
+		fprintf(stderr, "avx512 ops match the C versions\n");
+		return;
+	}
+#endif
+	fprintf(stderr, "skipping avx512 tests\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec ts;
+	uint32_t i;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	srand48(SPA_TIMESPEC_TO_NSEC(&ts));
+
+	cpu_flags = get_cpu_flags();
+	printf("got CPU flags %d\n", cpu_flags);
+
+	pffft_select_cpu(cpu_flags);
+
+	for (i = 0; i < MAX_SRC; i++)
+		fill_random(samp_in[i], SPA_N_ELEMENTS(samp_in[i]));
+
+	test_biquadn();
+	test_avx512();
+
+	return 0;
+}
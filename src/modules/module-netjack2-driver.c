@@ -33,6 +33,7 @@
 #include <pipewire/i18n.h>
 
 #include "module-netjack2/packets.h"
+#include "udp-batch.h"
 #include "module-netjack2/peer.c"
 
 #ifndef IPTOS_DSCP
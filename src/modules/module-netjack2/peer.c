@@ -127,12 +127,17 @@ struct netjack2_peer {
 #endif
 
 	unsigned fix_midi:1;
+
+	/* the packets of a cycle, sent in netjack2_send_data */
+	struct udp_batch batch;
 };
 
 static int netjack2_init(struct netjack2_peer *peer)
 {
 	int res = 0;
 
+	udp_batch_init(&peer->batch);
+
 	peer->empty = calloc(peer->quantum_limit, sizeof(float));
 
 	peer->midi_size = peer->params.period_size * sizeof(float) *
@@ -337,6 +342,33 @@ static inline void netjack2_to_midi(float *dst, uint32_t size, struct nj2_midi_b
 	spa_pod_builder_pop(&b, &f);
 }
 
+static void netjack2_send_flush(struct netjack2_peer *peer)
+{
+	int res;
+
+	if ((res = udp_batch_flush(&peer->batch, peer->fd)) < 0)
+		pw_log_debug("send failed: %s", spa_strerror(res));
+}
+
+static void netjack2_send_packet(struct netjack2_peer *peer, void *buffer, size_t size)
+{
+	struct iovec iov[1];
+	int res;
+
+	iov[0].iov_base = buffer;
+	iov[0].iov_len = size;
+
+	if ((res = udp_batch_add(&peer->batch, iov, 1)) == -ENOSPC) {
+		netjack2_send_flush(peer);
+		res = udp_batch_add(&peer->batch, iov, 1);
+	}
+	if (res < 0) {
+		/* too large for the batch, keep the order and send it now */
+		netjack2_send_flush(peer);
+		send(peer->fd, buffer, size, 0);
+	}
+}
+
 static int netjack2_send_sync(struct netjack2_peer *peer, uint32_t nframes)
 {
 	struct nj2_packet_header header;
@@ -366,7 +398,7 @@ static int netjack2_send_sync(struct netjack2_peer *peer, uint32_t nframes)
 	p = SPA_PTROFF(buffer, sizeof(header), int32_t);
 	for (i = 0; i < active_ports; i++)
 		p[i] = htonl(i);
-	send(peer->fd, buffer, packet_size, 0);
+	netjack2_send_packet(peer, buffer, packet_size);
 	return 0;
 }
 
@@ -426,7 +458,7 @@ static int netjack2_send_midi(struct netjack2_peer *peer, uint32_t nframes,
 		memcpy(SPA_PTROFF(buffer, sizeof(header), void),
 			SPA_PTROFF(midi_data, i * max_size, void),
 			copy_size);
-		send(peer->fd, buffer, packet_size, 0);
+		netjack2_send_packet(peer, buffer, packet_size);
 		//nj2_dump_packet_header(&header);
 	}
 	return 0;
@@ -483,7 +515,7 @@ static int netjack2_send_float(struct netjack2_peer *peer, uint32_t nframes,
 		header.is_last = htonl(is_last);
 		header.packet_size = htonl(packet_size);
 		memcpy(buffer, &header, sizeof(header));
-		send(peer->fd, buffer, packet_size, 0);
+		netjack2_send_packet(peer, buffer, packet_size);
 		//nj2_dump_packet_header(&header);
 	}
 	return 0;
@@ -557,7 +589,7 @@ static int netjack2_send_opus(struct netjack2_peer *peer, uint32_t nframes,
 						j * max_encoded + i * sub_period_bytes, void),
 					data_size);
 		}
-		send(peer->fd, buffer, packet_size, 0);
+		netjack2_send_packet(peer, buffer, packet_size);
 		//nj2_dump_packet_header(&header);
 	}
 	return 0;
@@ -625,7 +657,7 @@ static int netjack2_send_int(struct netjack2_peer *peer, uint32_t nframes,
 						j * max_encoded + i * sub_period_bytes, void),
 					data_size);
 		}
-		send(peer->fd, buffer, packet_size, 0);
+		netjack2_send_packet(peer, buffer, packet_size);
 		//nj2_dump_packet_header(&header);
 	}
 	return 0;
@@ -648,6 +680,7 @@ static int netjack2_send_data(struct netjack2_peer *peer, uint32_t nframes,
 		netjack2_send_opus(peer, nframes, audio, n_audio);
 		break;
 	}
+	netjack2_send_flush(peer);
 	return 0;
 }
 
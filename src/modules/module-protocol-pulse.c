@@ -71,6 +71,7 @@
  *     #pulse.min.quantum      = 128/48000     # 2.7ms
  *     #pulse.default.format   = F32
  *     #pulse.default.position = [ FL FR ]
+ *     #pulse.memfd            = false
  *     # These overrides are only applied when running in a vm.
  *     vm.overrides = {
  *         pulse.min.quantum = 1024/48000      # 22ms
@@ -185,6 +186,17 @@
  * This is equivalent to the PulseAudio `default-sample-channels` and
  * `default-channel-map` options in `/etc/pulse/daemon.conf`.
  *
+ * ### Transport options
+ *
+ *\code{.unparsed}
+ *     pulse.memfd = false
+ *\endcode
+ *
+ * Exchange the audio data with libpulse clients in memfd shared memory pools
+ * instead of copying it over the socket. This is only used for local clients of
+ * the same user and is disabled by default (Since 1.0.4). This is equivalent to
+ * the PulseAudio `enable-memfd` option in `/etc/pulse/daemon.conf`.
+ *
  * ### VM options
  *
  *\code{.unparsed}
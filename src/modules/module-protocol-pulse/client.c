@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 
@@ -27,6 +29,7 @@
 #include "operation.h"
 #include "pending-sample.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 
 #define client_emit_disconnect(c) spa_hook_list_call(&(c)->listener_list, struct client_events, disconnect, 0)
@@ -143,6 +146,9 @@ void client_free(struct client *client)
 	spa_list_consume(msg, &client->out_messages, link)
 		message_free(msg, true, false);
 
+	client_close_fds(client);
+	shm_clear(client);
+
 	spa_list_consume(o, &client->operations, link)
 		operation_free(o);
 
@@ -167,6 +173,23 @@ void client_free(struct client *client)
 	free(client);
 }
 
+void client_close_fds(struct client *client)
+{
+	while (client->n_fds > 0)
+		close(client->fds[--client->n_fds]);
+}
+
+int client_take_fd(struct client *client)
+{
+	int fd;
+
+	if (client->n_fds == 0)
+		return -1;
+	fd = client->fds[0];
+	memmove(&client->fds[0], &client->fds[1], --client->n_fds * sizeof(int));
+	return fd;
+}
+
 int client_queue_message(struct client *client, struct message *msg)
 {
 	struct impl *impl = client->impl;
@@ -180,7 +203,7 @@ int client_queue_message(struct client *client, struct message *msg)
 		goto error;
 	}
 
-	if (msg->length == 0) {
+	if (msg->length == 0 && msg->flags == 0) {
 		res = 0;
 		goto error;
 	} else if (msg->length > msg->allocated) {
@@ -206,6 +229,28 @@ error:
 	return res;
 }
 
+static ssize_t send_with_fd(int fd, const void *data, size_t size, int pass_fd)
+{
+	struct iovec iov = { .iov_base = (void *)data, .iov_len = size };
+	char buf[CMSG_SPACE(sizeof(int))];
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = buf,
+		.msg_controllen = sizeof(buf),
+	};
+	struct cmsghdr *cmsg;
+
+	spa_zero(buf);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof(int));
+
+	return sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
 static int client_try_flush_messages(struct client *client)
 {
 	pw_log_trace("client %p: flushing", client);
@@ -221,9 +266,9 @@ static int client_try_flush_messages(struct client *client)
 		if (client->out_index < sizeof(desc)) {
 			desc.length = htonl(m->length);
 			desc.channel = htonl(m->channel);
-			desc.offset_hi = 0;
+			desc.offset_hi = m->flags == FLAG_SHMRELEASE ? htonl(m->block_id) : 0;
 			desc.offset_lo = 0;
-			desc.flags = 0;
+			desc.flags = htonl(m->flags);
 
 			data = SPA_PTROFF(&desc, client->out_index, void);
 			size = sizeof(desc) - client->out_index;
@@ -240,7 +285,13 @@ static int client_try_flush_messages(struct client *client)
 		}
 
 		while (true) {
-			ssize_t sent = send(client->source->fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+			ssize_t sent;
+
+			/* the fd goes along with the first byte of the message */
+			if (client->out_index == 0 && m->fd >= 0)
+				sent = send_with_fd(client->source->fd, data, size, m->fd);
+			else
+				sent = send(client->source->fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
 			if (sent < 0) {
 				int res = -errno;
 				if (res == -EINTR)
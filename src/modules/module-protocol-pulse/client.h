@@ -21,6 +21,9 @@ struct pw_core;
 struct pw_manager;
 struct pw_manager_object;
 struct pw_properties;
+struct shm;
+
+#define MAX_CLIENT_FDS	4
 
 struct descriptor {
 	uint32_t length;
@@ -67,6 +70,11 @@ struct client {
 	struct descriptor desc;
 	struct message *message;
 
+	int fds[MAX_CLIENT_FDS];		/**< fds received with the current message */
+	uint32_t n_fds;
+
+	struct shm *shm;			/**< memfd pools, when memfd is negotiated */
+
 	struct pw_map streams;
 	struct spa_list out_messages;
 
@@ -77,6 +85,7 @@ struct client {
 	unsigned int disconnect:1;
 	unsigned int new_msg_since_last_flush:1;
 	unsigned int authenticated:1;
+	unsigned int memfd:1;			/**< memfd transport negotiated */
 
 	struct pw_manager_object *prev_default_sink;
 	struct pw_manager_object *prev_default_source;
@@ -95,6 +104,8 @@ struct client *client_new(struct server *server);
 bool client_detach(struct client *client);
 void client_disconnect(struct client *client);
 void client_free(struct client *client);
+void client_close_fds(struct client *client);
+int client_take_fd(struct client *client);
 int client_queue_message(struct client *client, struct message *msg);
 int client_flush_messages(struct client *client);
 int client_queue_subscribe_event(struct client *client, uint32_t mask, uint32_t event, uint32_t id);
@@ -29,11 +29,67 @@ void select_best(struct selector *s, struct pw_manager_object *o)
 	}
 }
 
+static bool select_filter(struct selector *s, struct pw_manager_object *o)
+{
+	return o != NULL && !o->creating && !o->removing &&
+		(s->type == NULL || s->type(o));
+}
+
+/* the first one in the object list */
+static struct pw_manager_object *select_first(struct pw_manager_object *a,
+		struct pw_manager_object *b)
+{
+	return a == NULL || (b != NULL && b->seq < a->seq) ? b : a;
+}
+
+struct select_data {
+	struct selector *sel;
+	struct pw_manager_object *found;
+};
+
+static int select_named(void *data, struct pw_manager_object *o)
+{
+	struct select_data *d = data;
+	if (!select_filter(d->sel, o))
+		return 0;
+	d->found = o;
+	return 1;
+}
+
+static int select_indexed(struct pw_manager *m, struct selector *s,
+		struct pw_manager_object **result)
+{
+	struct select_data d = { .sel = s, };
+	struct pw_manager_object *o;
+	int res;
+
+	if (s->key != NULL && s->value != NULL &&
+	    (res = pw_manager_for_each_named_object(m, s->key, s->value,
+			select_named, &d)) < 0)
+		return res;
+
+	if (select_filter(s, o = pw_manager_find_object(m, s->id)))
+		d.found = select_first(d.found, o);
+	if (select_filter(s, o = pw_manager_find_object_by_index(m, s->index)))
+		d.found = select_first(d.found, o);
+	if (s->value != NULL &&
+	    select_filter(s, o = pw_manager_find_object_by_index(m, (uint32_t)atoi(s->value))))
+		d.found = select_first(d.found, o);
+
+	*result = d.found;
+	return 0;
+}
+
 struct pw_manager_object *select_object(struct pw_manager *m, struct selector *s)
 {
 	struct pw_manager_object *o;
 	const char *str;
 
+	/* the accumulator needs to see all objects, without it we can find the
+	 * first match in the indexes unless we select on a key without index */
+	if (s->accumulate == NULL && select_indexed(m, s, &o) == 0)
+		return o;
+
 	spa_list_for_each(o, &m->object_list, link) {
 		if (o->creating || o->removing)
 			continue;
@@ -57,32 +113,18 @@ struct pw_manager_object *select_object(struct pw_manager *m, struct selector *s
 
 uint32_t id_to_index(struct pw_manager *m, uint32_t id)
 {
-	struct pw_manager_object *o;
-	spa_list_for_each(o, &m->object_list, link) {
-		if (o->id == id)
-			return o->index;
-	}
-	return SPA_ID_INVALID;
+	struct pw_manager_object *o = pw_manager_find_object(m, id);
+	return o ? o->index : SPA_ID_INVALID;
 }
 
-static bool collect_is_linked(struct pw_manager *m, uint32_t id, enum pw_direction direction)
+static int is_linked(void *data, struct pw_manager_object *o)
 {
-	struct pw_manager_object *o;
-	uint32_t in_node, out_node;
-
-	spa_list_for_each(o, &m->object_list, link) {
-		if (o->props == NULL || !pw_manager_object_is_link(o))
-			continue;
-
-		if (pw_properties_fetch_uint32(o->props, PW_KEY_LINK_OUTPUT_NODE, &out_node) != 0 ||
-                    pw_properties_fetch_uint32(o->props, PW_KEY_LINK_INPUT_NODE, &in_node) != 0)
-                        continue;
+	return 1;
+}
 
-		if ((direction == PW_DIRECTION_OUTPUT && id == out_node) ||
-		    (direction == PW_DIRECTION_INPUT && id == in_node))
-			return true;
-	}
-	return false;
+static bool collect_is_linked(struct pw_manager *m, uint32_t id, enum pw_direction direction)
+{
+	return pw_manager_for_each_link(m, id, direction, is_linked, NULL) > 0;
 }
 
 struct pw_manager_object *find_peer_for_link(struct pw_manager *m,
@@ -111,17 +153,26 @@ struct pw_manager_object *find_peer_for_link(struct pw_manager *m,
 	return NULL;
 }
 
+struct linked_data {
+	struct pw_manager *manager;
+	uint32_t id;
+	enum pw_direction direction;
+	struct pw_manager_object *peer;
+};
+
+static int find_linked_peer(void *data, struct pw_manager_object *o)
+{
+	struct linked_data *d = data;
+	d->peer = find_peer_for_link(d->manager, o, d->id, d->direction);
+	return d->peer != NULL;
+}
+
 struct pw_manager_object *find_linked(struct pw_manager *m, uint32_t id, enum pw_direction direction)
 {
-	struct pw_manager_object *o, *p;
+	struct linked_data d = { .manager = m, .id = id, .direction = direction, };
 
-	spa_list_for_each(o, &m->object_list, link) {
-		if (!pw_manager_object_is_link(o))
-			continue;
-		if ((p = find_peer_for_link(m, o, id, direction)) != NULL)
-			return p;
-	}
-	return NULL;
+	pw_manager_for_each_link(m, id, direction, find_linked_peer, &d);
+	return d.peer;
 }
 
 void collect_card_info(struct pw_manager_object *card, struct card_info *info)
@@ -35,6 +35,7 @@ struct defs {
 	struct channel_map channel_map;
 	uint32_t quantum_limit;
 	uint32_t idle_timeout;
+	bool memfd;
 };
 
 struct stats {
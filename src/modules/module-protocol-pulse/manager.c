@@ -23,6 +23,20 @@
 
 struct object;
 
+/* the objects are hashed on these keys so that the lookups of the clients
+ * don't need to walk the object list */
+enum {
+	KEY_ID,
+	KEY_INDEX,
+	KEY_NODE_NAME,
+	KEY_DEVICE_NAME,
+	KEY_LINK_OUTPUT,
+	KEY_LINK_INPUT,
+	N_KEYS,
+};
+
+#define MIN_BUCKETS	64u
+
 struct manager {
 	struct pw_manager this;
 
@@ -33,6 +47,10 @@ struct manager {
 	int sync_seq;
 
 	struct spa_hook_list hooks;
+
+	uint64_t seq;
+	uint32_t n_buckets;
+	struct spa_list *buckets;	/* n_buckets for each key */
 };
 
 struct object_info {
@@ -51,11 +69,19 @@ struct object_data {
 	struct spa_source *timer;
 };
 
+struct object_key {
+	struct spa_list link;		/* link in the bucket of the key */
+	uint32_t hash;
+	unsigned int active:1;
+};
+
 struct object {
 	struct pw_manager_object this;
 
 	struct manager *manager;
 
+	struct object_key keys[N_KEYS];
+
 	const struct object_info *info;
 
 	int changed;
@@ -132,11 +158,119 @@ static bool has_param(struct spa_list *param_list, struct pw_manager_param *p)
 	return false;
 }
 
-static struct object *find_object_by_id(struct manager *m, uint32_t id)
+/* this is a bijection, equal hashes mean equal values */
+static inline uint32_t hash_uint32(uint32_t val)
+{
+	return val * 0x9e3779b1u;
+}
+
+static inline uint32_t hash_string(const char *str)
 {
+	uint32_t hash = 0x811c9dc5u;
+	while (*str)
+		hash = (hash ^ (uint8_t)*str++) * 0x01000193u;
+	return hash;
+}
+
+static const char * const name_keys[] = {
+	[KEY_NODE_NAME] = PW_KEY_NODE_NAME,
+	[KEY_DEVICE_NAME] = PW_KEY_DEVICE_NAME,
+};
+
+static inline struct spa_list *key_bucket(struct manager *m, uint32_t key, uint32_t hash)
+{
+	return &m->buckets[key * m->n_buckets + (hash & (m->n_buckets - 1))];
+}
+
+static inline struct object *key_object(struct object_key *k, uint32_t key)
+{
+	return SPA_CONTAINER_OF(k - key, struct object, keys);
+}
+
+static void object_set_key(struct object *o, uint32_t key, uint32_t hash)
+{
+	o->keys[key].hash = hash;
+	o->keys[key].active = true;
+}
+
+/* the keys are taken from the global, they don't change */
+static void object_init_keys(struct object *o)
+{
+	struct pw_manager_object *obj = &o->this;
+	uint32_t i, node;
+	const char *str;
+
+	object_set_key(o, KEY_ID, hash_uint32(obj->id));
+	if (obj->index != SPA_ID_INVALID)
+		object_set_key(o, KEY_INDEX, hash_uint32(obj->index));
+
+	if (obj->props == NULL)
+		return;
+
+	for (i = KEY_NODE_NAME; i <= KEY_DEVICE_NAME; i++) {
+		if ((str = pw_properties_get(obj->props, name_keys[i])) != NULL)
+			object_set_key(o, i, hash_string(str));
+	}
+	if (pw_manager_object_is_link(obj)) {
+		if (pw_properties_fetch_uint32(obj->props, PW_KEY_LINK_OUTPUT_NODE, &node) == 0)
+			object_set_key(o, KEY_LINK_OUTPUT, hash_uint32(node));
+		if (pw_properties_fetch_uint32(obj->props, PW_KEY_LINK_INPUT_NODE, &node) == 0)
+			object_set_key(o, KEY_LINK_INPUT, hash_uint32(node));
+	}
+}
+
+/* objects are added in the order of the object list so that the buckets
+ * keep that order */
+static void object_add_keys(struct manager *m, struct object *o)
+{
+	uint32_t i;
+
+	for (i = 0; i < N_KEYS; i++) {
+		if (o->keys[i].active)
+			spa_list_append(key_bucket(m, i, o->keys[i].hash), &o->keys[i].link);
+	}
+}
+
+static void object_remove_keys(struct object *o)
+{
+	uint32_t i;
+
+	for (i = 0; i < N_KEYS; i++) {
+		if (o->keys[i].active)
+			spa_list_remove(&o->keys[i].link);
+		o->keys[i].active = false;
+	}
+}
+
+static int manager_rehash(struct manager *m, uint32_t n_buckets)
+{
+	struct spa_list *buckets;
 	struct object *o;
-	spa_list_for_each(o, &m->this.object_list, this.link) {
-		if (o->this.id == id)
+	uint32_t i;
+
+	buckets = pw_reallocarray(m->buckets, n_buckets * N_KEYS, sizeof(struct spa_list));
+	if (buckets == NULL)
+		return -errno;
+
+	m->buckets = buckets;
+	m->n_buckets = n_buckets;
+	for (i = 0; i < n_buckets * N_KEYS; i++)
+		spa_list_init(&buckets[i]);
+
+	spa_list_for_each(o, &m->this.object_list, this.link)
+		object_add_keys(m, o);
+
+	return 0;
+}
+
+static struct object *find_object_by_id(struct manager *m, uint32_t id)
+{
+	uint32_t hash = hash_uint32(id);
+	struct object_key *k;
+
+	spa_list_for_each(k, key_bucket(m, KEY_ID, hash), link) {
+		struct object *o = key_object(k, KEY_ID);
+		if (k->hash == hash && !o->this.removing)
 			return o;
 	}
 	return NULL;
@@ -184,6 +318,7 @@ static void object_destroy(struct object *o)
 	struct manager *m = o->manager;
 	struct object_data *d;
 	spa_list_remove(&o->this.link);
+	object_remove_keys(o);
 	m->this.n_objects--;
 	if (o->this.proxy)
 		pw_proxy_destroy(o->this.proxy);
@@ -634,11 +769,18 @@ static void registry_event_global(void *data, uint32_t id,
 	spa_list_init(&o->pending_list);
 	spa_list_init(&o->data_list);
 
+	o->this.seq = m->seq++;
 	o->manager = m;
 	o->info = info;
 	spa_list_append(&m->this.object_list, &o->this.link);
 	m->this.n_objects++;
 
+	/* the rehash adds the new object with the others */
+	object_init_keys(o);
+	if (m->this.n_objects <= m->n_buckets ||
+	    manager_rehash(m, m->n_buckets * 2) < 0)
+		object_add_keys(m, o);
+
 	if (info->events)
 		pw_proxy_add_object_listener(proxy,
 				&o->object_listener,
@@ -752,6 +894,12 @@ struct pw_manager *pw_manager_new(struct pw_core *core)
 
 	spa_list_init(&m->this.object_list);
 
+	if (manager_rehash(m, MIN_BUCKETS) < 0) {
+		pw_proxy_destroy((struct pw_proxy*)m->this.registry);
+		free(m);
+		return NULL;
+	}
+
 	pw_core_add_listener(m->this.core,
 			&m->core_listener,
 			&core_events, m);
@@ -826,6 +974,80 @@ int pw_manager_for_each_object(struct pw_manager *manager,
 	return 0;
 }
 
+struct pw_manager_object *pw_manager_find_object(struct pw_manager *manager, uint32_t id)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *o = find_object_by_id(m, id);
+	return o ? &o->this : NULL;
+}
+
+struct pw_manager_object *pw_manager_find_object_by_index(struct pw_manager *manager,
+		uint32_t index)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	uint32_t hash = hash_uint32(index);
+	struct object_key *k;
+
+	if (index == SPA_ID_INVALID)
+		return NULL;
+
+	spa_list_for_each(k, key_bucket(m, KEY_INDEX, hash), link) {
+		if (k->hash == hash)
+			return &key_object(k, KEY_INDEX)->this;
+	}
+	return NULL;
+}
+
+int pw_manager_for_each_named_object(struct pw_manager *manager,
+		const char *key, const char *name,
+		int (*callback) (void *data, struct pw_manager_object *object),
+		void *data)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object_key *k;
+	uint32_t i, hash;
+	int res;
+
+	for (i = KEY_NODE_NAME; i <= KEY_DEVICE_NAME; i++) {
+		if (spa_streq(key, name_keys[i]))
+			break;
+	}
+	if (i > KEY_DEVICE_NAME)
+		return -ENOTSUP;
+
+	hash = hash_string(name);
+	spa_list_for_each(k, key_bucket(m, i, hash), link) {
+		struct object *o = key_object(k, i);
+		if (k->hash != hash ||
+		    !spa_streq(pw_properties_get(o->this.props, key), name))
+			continue;
+		if ((res = callback(data, &o->this)) != 0)
+			return res;
+	}
+	return 0;
+}
+
+int pw_manager_for_each_link(struct pw_manager *manager,
+		uint32_t node_id, enum pw_direction direction,
+		int (*callback) (void *data, struct pw_manager_object *object),
+		void *data)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	uint32_t key, hash = hash_uint32(node_id);
+	struct object_key *k;
+	int res;
+
+	key = direction == PW_DIRECTION_OUTPUT ? KEY_LINK_OUTPUT : KEY_LINK_INPUT;
+
+	spa_list_for_each(k, key_bucket(m, key, hash), link) {
+		if (k->hash != hash)
+			continue;
+		if ((res = callback(data, &key_object(k, key)->this)) != 0)
+			return res;
+	}
+	return 0;
+}
+
 void pw_manager_destroy(struct pw_manager *manager)
 {
 	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
@@ -844,6 +1066,7 @@ void pw_manager_destroy(struct pw_manager *manager)
 	if (m->this.info)
 		pw_core_info_free(m->this.info);
 
+	free(m->buckets);
 	free(m);
 }
 
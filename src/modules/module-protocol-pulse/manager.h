@@ -62,6 +62,7 @@ struct pw_manager_param {
 
 struct pw_manager_object {
 	struct spa_list link;           /**< link in manager object_list */
+	uint64_t seq;                   /**< position in manager object_list */
 	uint64_t serial;
 	uint32_t id;
 	uint32_t permissions;
@@ -105,6 +106,26 @@ int pw_manager_for_each_object(struct pw_manager *manager,
 		int (*callback) (void *data, struct pw_manager_object *object),
 		void *data);
 
+/* the lookups below use the indexes of the manager and also return the
+ * objects that are being created or removed */
+struct pw_manager_object *pw_manager_find_object(struct pw_manager *manager, uint32_t id);
+struct pw_manager_object *pw_manager_find_object_by_index(struct pw_manager *manager,
+		uint32_t index);
+
+/* objects with the given PW_KEY_NODE_NAME or PW_KEY_DEVICE_NAME, in the order
+ * of the object list, returns -ENOTSUP for other keys */
+int pw_manager_for_each_named_object(struct pw_manager *manager,
+		const char *key, const char *name,
+		int (*callback) (void *data, struct pw_manager_object *object),
+		void *data);
+
+/* links with node_id as the output (PW_DIRECTION_OUTPUT) or input node,
+ * in the order of the object list */
+int pw_manager_for_each_link(struct pw_manager *manager,
+		uint32_t node_id, enum pw_direction direction,
+		int (*callback) (void *data, struct pw_manager_object *object),
+		void *data);
+
 void *pw_manager_object_add_data(struct pw_manager_object *o, const char *key, size_t size);
 void *pw_manager_object_get_data(struct pw_manager_object *obj, const char *key);
 void *pw_manager_object_add_temporary_data(struct pw_manager_object *o, const char *key,
@@ -833,6 +833,9 @@ struct message *message_alloc(struct impl *impl, uint32_t channel, uint32_t size
 	msg->channel = channel;
 	msg->offset = 0;
 	msg->length = size;
+	msg->flags = 0;
+	msg->block_id = 0;
+	msg->fd = -1;
 
 	return msg;
 }
@@ -22,6 +22,9 @@ struct message {
 	uint32_t length;
 	uint32_t offset;
 	uint8_t *data;
+	uint32_t flags;		/* descriptor flags */
+	uint32_t block_id;	/* block id of SHM release frames */
+	int fd;			/* fd to pass along with the message or -1 */
 };
 
 enum {
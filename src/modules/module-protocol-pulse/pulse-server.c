@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include <sys/time.h>
 
 #include <pipewire/log.h>
@@ -52,6 +53,7 @@
 #include "reply.h"
 #include "sample.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 #include "utils.h"
 #include "volume.h"
@@ -65,6 +67,7 @@
 #define DEFAULT_FORMAT		"F32"
 #define DEFAULT_POSITION	"[ FL FR ]"
 #define DEFAULT_IDLE_TIMEOUT	"0"
+#define DEFAULT_MEMFD		"false"
 
 #define MAX_FORMATS	32
 /* The max amount of data we send in one block when capturing. In PulseAudio this
@@ -113,12 +116,26 @@ void broadcast_subscribe_event(struct impl *impl, uint32_t mask, uint32_t event,
 	}
 }
 
+static bool client_can_memfd(struct client *client, bool shm, bool memfd)
+{
+	struct impl *impl = client->impl;
+
+	if (!impl->defs.memfd || !shm || !memfd ||
+	    client->version < PROTOCOL_VERSION_MEMFD)
+		return false;
+
+	/* like PulseAudio, only share memory with clients of the same user,
+	 * this also rules out tcp clients */
+	return get_client_uid(client, client->source->fd) == getuid();
+}
+
 static int do_command_auth(struct client *client, uint32_t command, uint32_t tag, struct message *m)
 {
 	struct message *reply;
-	uint32_t version;
+	uint32_t version, flags = 0;
 	const void *cookie;
 	size_t len;
+	bool shm = false, memfd = false;
 
 	if (message_get(m,
 			TAG_U32, &version,
@@ -131,17 +148,27 @@ static int do_command_auth(struct client *client, uint32_t command, uint32_t tag
 	if (len != NATIVE_COOKIE_LENGTH)
 		return -EINVAL;
 
-	if ((version & PROTOCOL_VERSION_MASK) >= 13)
+	if ((version & PROTOCOL_VERSION_MASK) >= 13) {
+		shm = SPA_FLAG_IS_SET(version, PROTOCOL_FLAG_SHM);
+		memfd = SPA_FLAG_IS_SET(version, PROTOCOL_FLAG_MEMFD);
 		version &= PROTOCOL_VERSION_MASK;
+	}
 
 	client->version = version;
 	client->authenticated = true;
 
-	pw_log_info("client:%p AUTH tag:%u version:%d", client, tag, version);
+	/* we only do memfd pools, without memfd the client would
+	 * try POSIX shm when we announce shm */
+	client->memfd = client_can_memfd(client, shm, memfd);
+	if (client->memfd)
+		flags |= PROTOCOL_FLAG_SHM | PROTOCOL_FLAG_MEMFD;
+
+	pw_log_info("client:%p AUTH tag:%u version:%d shm:%d memfd:%d/%d", client, tag,
+			version, shm, memfd, client->memfd);
 
 	reply = reply_new(client, tag);
 	message_put(reply,
-			TAG_U32, PROTOCOL_VERSION,
+			TAG_U32, PROTOCOL_VERSION | flags,
 			TAG_INVALID);
 
 	return client_queue_message(client, reply);
@@ -573,13 +600,15 @@ static int reply_create_playback_stream(struct stream *stream, struct pw_manager
 	uint32_t missing, peer_index;
 	const char *peer_name;
 	uint64_t lat_usec;
-
-	stream->buffer = calloc(1, MAXLENGTH);
-	if (stream->buffer == NULL)
-		return -errno;
+	int res;
 
 	lat_usec = set_playback_buffer_attr(stream, &stream->attr);
 
+	/* room for the requested data, more when the client sends more */
+	if ((res = stream_grow_buffer(stream,
+			stream->attr.tlength + stream->attr.minreq)) < 0)
+		return res;
+
 	missing = stream_pop_missing(stream);
 	stream->index = id_to_index(manager, stream->id);
 	stream->lat_usec = lat_usec;
@@ -728,13 +757,14 @@ static int reply_create_record_stream(struct stream *stream, struct pw_manager_o
 	const char *peer_name, *name;
 	uint32_t peer_index;
 	uint64_t lat_usec;
-
-	stream->buffer = calloc(1, MAXLENGTH);
-	if (stream->buffer == NULL)
-		return -errno;
+	int res;
 
 	lat_usec = set_record_buffer_attr(stream, &stream->attr);
 
+	/* room for a few fragments, more when the client reads slowly */
+	if ((res = stream_grow_buffer(stream, stream->attr.fragsize * 4)) < 0)
+		return res;
+
 	stream->index = id_to_index(manager, stream->id);
 	stream->lat_usec = lat_usec;
 
@@ -1285,6 +1315,7 @@ do_process_done(struct spa_loop *loop,
 	const struct process_data *pd = data;
 	uint32_t index, towrite;
 	int32_t avail;
+	void *p;
 
 	stream->timestamp = pd->pwt.now;
 	stream->delay = pd->pwt.buffered * SPA_USEC_PER_SEC / stream->ss.rate;
@@ -1346,14 +1377,19 @@ do_process_done(struct spa_loop *loop,
 			pw_log_warn("%p: [%s] underrun read:%u avail:%d",
 					stream, client->name, index, avail);
 		} else {
-			if ((uint32_t)avail > stream->attr.maxlength) {
+			uint32_t maxlength = SPA_MIN(stream->attr.maxlength, stream->buffer_size);
+
+			if ((uint32_t)avail > maxlength) {
 				uint32_t skip = avail - stream->attr.fragsize;
 				/* overrun, catch up to latest fragment and send it */
 				pw_log_warn("%p: [%s] overrun recover read:%u avail:%d max:%u skip:%u",
-					stream, client->name, index, avail, stream->attr.maxlength, skip);
+					stream, client->name, index, avail, maxlength, skip);
 				index += skip;
 				stream->read_index += skip;
 				avail = stream->attr.fragsize;
+			} else if ((uint32_t)avail > stream->buffer_size / 2) {
+				/* the client is slow, make room before we overrun */
+				stream_grow_buffer(stream, avail * 2);
 			}
 			pw_log_trace("avail:%d index:%u", avail, index);
 
@@ -1362,14 +1398,19 @@ do_process_done(struct spa_loop *loop,
 				towrite = SPA_MIN(towrite, stream->attr.fragsize);
 				towrite = SPA_ROUND_DOWN(towrite, stream->frame_size);
 
-				msg = message_alloc(impl, stream->channel, towrite);
-				if (msg == NULL)
-					return -errno;
+				/* send the data in our memfd pool when we can */
+				msg = shm_export_block(client, stream->channel, towrite, &p);
+				if (msg == NULL) {
+					msg = message_alloc(impl, stream->channel, towrite);
+					if (msg == NULL)
+						return -errno;
+					p = msg->data;
+				}
 
 				spa_ringbuffer_read_data(&stream->ring,
-						stream->buffer, MAXLENGTH,
-						index % MAXLENGTH,
-						msg->data, towrite);
+						stream->buffer, stream->buffer_size,
+						index & (stream->buffer_size - 1),
+						p, towrite);
 
 				client_queue_message(client, msg);
 
@@ -1451,8 +1492,8 @@ static void stream_process(void *data)
 				if (avail > 0) {
 					avail = SPA_MIN((uint32_t)avail, size);
 					spa_ringbuffer_read_data(&stream->ring,
-						stream->buffer, MAXLENGTH,
-						index % MAXLENGTH,
+						stream->buffer, stream->buffer_size,
+						index & (stream->buffer_size - 1),
 						p, avail);
 				}
 				index += size;
@@ -1480,8 +1521,8 @@ static void stream_process(void *data)
 			size = SPA_MIN(size, minreq);
 
 			spa_ringbuffer_read_data(&stream->ring,
-					stream->buffer, MAXLENGTH,
-					index % MAXLENGTH,
+					stream->buffer, stream->buffer_size,
+					index & (stream->buffer_size - 1),
 					p, size);
 
 			index += size;
@@ -1516,10 +1557,10 @@ static void stream_process(void *data)
 		}
 
 		spa_ringbuffer_write_data(&stream->ring,
-				stream->buffer, MAXLENGTH,
-				index % MAXLENGTH,
+				stream->buffer, stream->buffer_size,
+				index & (stream->buffer_size - 1),
 				SPA_PTROFF(p, offs, void),
-				SPA_MIN(size, MAXLENGTH));
+				SPA_MIN(size, stream->buffer_size));
 
 		index += size;
 		pd.write_inc = size;
@@ -2301,9 +2342,8 @@ static int do_create_upload_stream(struct client *client, uint32_t command, uint
 
 	stream->props = props;
 
-	stream->buffer = calloc(1, MAXLENGTH);
-	if (stream->buffer == NULL)
-		goto error_errno;
+	if ((res = stream_grow_buffer(stream, length)) < 0)
+		goto error;
 
 	reply = reply_new(client, tag);
 	message_put(reply,
@@ -5145,6 +5185,25 @@ static int do_send_object_message(struct client *client, uint32_t command, uint3
 	return res;
 }
 
+static int do_register_memfd_shmid(struct client *client, uint32_t command, uint32_t tag, struct message *m)
+{
+	uint32_t shm_id;
+	int fd;
+
+	if (message_get(m,
+			TAG_U32, &shm_id,
+			TAG_INVALID) < 0)
+		return -EPROTO;
+
+	pw_log_info("[%s] REGISTER_MEMFD_SHMID tag:%u shm_id:%u", client->name, tag, shm_id);
+
+	if ((fd = client_take_fd(client)) < 0)
+		return -EPROTO;
+
+	/* there is no reply, a failure is a protocol error */
+	return shm_register_pool(client, shm_id, fd) < 0 ? -EPROTO : 0;
+}
+
 static int do_error_access(struct client *client, uint32_t command, uint32_t tag, struct message *m)
 {
 	return -EACCES;
@@ -5313,7 +5372,7 @@ const struct command commands[COMMAND_MAX] =
 
 	/* Supported since protocol v31 (9.0)
 	 * BOTH DIRECTIONS */
-	COMMAND(REGISTER_MEMFD_SHMID, do_error_access),
+	COMMAND(REGISTER_MEMFD_SHMID, do_register_memfd_shmid, COMMAND_ACCESS_WITHOUT_MANAGER),
 
 	/* Supported since protocol v35 (15.0) */
 	COMMAND(SEND_OBJECT_MESSAGE, do_send_object_message),
@@ -5451,6 +5510,18 @@ static int parse_uint32(struct pw_properties *props, const char *key, const char
 	return 0;
 }
 
+static int parse_bool(struct pw_properties *props, const char *key, const char *def,
+		bool *res)
+{
+	const char *str;
+	if (props == NULL ||
+	    (str = pw_properties_get(props, key)) == NULL)
+		str = def;
+	*res = spa_atob(str);
+	pw_log_info(": defaults: %s = %s", key, *res ? "true" : "false");
+	return 0;
+}
+
 static void load_defaults(struct defs *def, struct pw_properties *props)
 {
 	parse_frac(props, "pulse.min.req", DEFAULT_MIN_REQ, &def->min_req);
@@ -5462,6 +5533,7 @@ static void load_defaults(struct defs *def, struct pw_properties *props)
 	parse_format(props, "pulse.default.format", DEFAULT_FORMAT, &def->sample_spec);
 	parse_position(props, "pulse.default.position", DEFAULT_POSITION, &def->channel_map);
 	parse_uint32(props, "pulse.idle.timeout", DEFAULT_IDLE_TIMEOUT, &def->idle_timeout);
+	parse_bool(props, "pulse.memfd", DEFAULT_MEMFD, &def->memfd);
 	def->sample_spec.channels = def->channel_map.channels;
 	def->quantum_limit = 8192;
 }
@@ -39,6 +39,7 @@
 #include "message.h"
 #include "reply.h"
 #include "server.h"
+#include "shm.h"
 #include "stream.h"
 #include "utils.h"
 #include "flatpak-utils.h"
@@ -92,6 +93,7 @@ static int handle_packet(struct client *client, struct message *msg)
 
 finish:
 	message_free(msg, false, false);
+	client_close_fds(client);
 	if (res < 0)
 		reply_error(client, command, tag, res);
 
@@ -101,9 +103,10 @@ finish:
 static int handle_memblock(struct client *client, struct message *msg)
 {
 	struct stream *stream;
-	uint32_t channel, flags, index;
+	uint32_t channel, flags, index, length, block_id = SPA_ID_INVALID;
 	int64_t offset, diff;
 	int32_t filled;
+	const void *data;
 	int res = 0;
 
 	channel = ntohl(client->desc.channel);
@@ -112,8 +115,20 @@ static int handle_memblock(struct client *client, struct message *msg)
 		(((uint64_t) ntohl(client->desc.offset_lo))));
 	flags = ntohl(client->desc.flags);
 
+	if (flags & FLAG_SHMDATA) {
+		/* the data is in one of the memfd pools of the client */
+		if ((data = shm_get_block(client, msg, &block_id, &length)) == NULL) {
+			block_id = SPA_ID_INVALID;
+			res = -EPROTO;
+			goto finish;
+		}
+	} else {
+		data = msg->data;
+		length = msg->length;
+	}
+
 	pw_log_debug("client %p: received memblock channel:%d offset:%" PRIi64 " flags:%08x size:%u",
-		     client, channel, offset, flags, msg->length);
+		     client, channel, offset, flags, length);
 
 	stream = pw_map_lookup(&client->streams, channel);
 	if (stream == NULL || stream->type == STREAM_TYPE_RECORD) {
@@ -124,7 +139,7 @@ static int handle_memblock(struct client *client, struct message *msg)
 
 	filled = spa_ringbuffer_get_write_index(&stream->ring, &index);
 	pw_log_debug("new block %p %p/%u filled:%d index:%d flags:%02x offset:%" PRIu64,
-		     msg, msg->data, msg->length, filled, index, flags, offset);
+		     msg, data, length, filled, index, flags, offset);
 
 	switch (flags & FLAG_SEEKMASK) {
 	case SEEK_RELATIVE:
@@ -152,23 +167,27 @@ static int handle_memblock(struct client *client, struct message *msg)
 
 	if (filled < 0) {
 		/* underrun, reported on reader side */
-	} else if (filled + msg->length > stream->attr.maxlength) {
+	} else if (filled + length > stream->attr.maxlength) {
 		/* overrun */
 		stream_send_overflow(stream);
 	}
 
+	/* make room for the data, when this fails we overwrite the oldest
+	 * data like in an overrun */
+	stream_grow_buffer(stream, SPA_MAX(filled, 0) + length);
+
 	/* always write data to ringbuffer, we expect the other side
 	 * to recover */
 	spa_ringbuffer_write_data(&stream->ring,
-			stream->buffer, MAXLENGTH,
-			index % MAXLENGTH,
-			msg->data,
-			SPA_MIN(msg->length, MAXLENGTH));
-	index += msg->length;
+			stream->buffer, stream->buffer_size,
+			index & (stream->buffer_size - 1),
+			data,
+			SPA_MIN(length, stream->buffer_size));
+	index += length;
 	spa_ringbuffer_write_update(&stream->ring, index);
 
-	stream->write_index += msg->length;
-	stream->requested -= msg->length;
+	stream->write_index += length;
+	stream->requested -= length;
 
 	stream_send_request(stream);
 
@@ -176,10 +195,64 @@ static int handle_memblock(struct client *client, struct message *msg)
 		stream_set_paused(stream, false, "new data");
 
 finish:
+	/* the data was copied, the client can reuse the block */
+	if (block_id != SPA_ID_INVALID)
+		shm_release_block(client, block_id);
 	message_free(msg, false, false);
+	/* memblocks don't carry fds */
+	client_close_fds(client);
 	return res;
 }
 
+static int handle_shm_frame(struct client *client, uint32_t flags, uint32_t block_id)
+{
+	pw_log_trace("client %p: shm frame flags:%08x block:%u", client, flags, block_id);
+
+	/* these frames don't carry fds */
+	client_close_fds(client);
+
+	/* we copy the data of the blocks of the client right away, there is
+	 * nothing to do when a block is revoked */
+	if (flags == FLAG_SHMRELEASE)
+		shm_free_block(client, block_id);
+	return 0;
+}
+
+static ssize_t recv_with_fds(struct client *client, void *data, size_t size)
+{
+	struct iovec iov = { .iov_base = data, .iov_len = size };
+	char buf[CMSG_SPACE(MAX_CLIENT_FDS * sizeof(int))];
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = buf,
+		.msg_controllen = sizeof(buf),
+	};
+	struct cmsghdr *cmsg;
+	ssize_t r;
+
+	if ((r = recvmsg(client->source->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC)) < 0)
+		return r;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		uint32_t i, n_fds;
+		int fd;
+
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (i = 0; i < n_fds; i++) {
+			memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+			if (client->n_fds < MAX_CLIENT_FDS)
+				client->fds[client->n_fds++] = fd;
+			else
+				close(fd);
+		}
+	}
+	return r;
+}
+
 static int do_read(struct client *client)
 {
 	struct impl * const impl = client->impl;
@@ -203,7 +276,13 @@ static int do_read(struct client *client)
 	}
 
 	while (true) {
-		ssize_t r = recv(client->source->fd, data, size, MSG_DONTWAIT);
+		ssize_t r;
+
+		/* only unix sockets can pass fds, for the memfd pools */
+		if (client->memfd)
+			r = recv_with_fds(client, data, size);
+		else
+			r = recv(client->source->fd, data, size, MSG_DONTWAIT);
 
 		if (r == 0 && size != 0) {
 			res = -EPIPE;
@@ -226,10 +305,16 @@ static int do_read(struct client *client)
 		uint32_t flags, length, channel;
 
 		flags = ntohl(client->desc.flags);
-		if ((flags & FLAG_SHMMASK) != 0) {
+		if ((flags & FLAG_SHMMASK) != 0 && !client->memfd) {
 			res = -EPROTO;
 			goto exit;
 		}
+		if (flags == FLAG_SHMRELEASE || flags == FLAG_SHMREVOKE) {
+			/* frames without payload */
+			client->in_index = 0;
+			res = handle_shm_frame(client, flags, ntohl(client->desc.offset_hi));
+			goto exit;
+		}
 
 		length = ntohl(client->desc.length);
 		if (length > FRAME_SIZE_MAX_ALLOW || length <= 0) {
@@ -247,6 +332,19 @@ static int do_read(struct client *client)
 				res = -EPROTO;
 				goto exit;
 			}
+		} else if (flags & FLAG_SHMDATA) {
+			/* only memfd blocks, we don't support POSIX shm */
+			if (!(flags & FLAG_SHMDATA_MEMFD_BLOCK) || length != SHM_INFO_SIZE) {
+				pw_log_warn("client %p: received invalid shm memblock frame",
+					    client);
+				res = -EPROTO;
+				goto exit;
+			}
+		} else if ((flags & FLAG_SHMMASK) != 0) {
+			pw_log_warn("client %p: received memblock frame with invalid flags",
+				    client);
+			res = -EPROTO;
+			goto exit;
 		}
 
 		if (client->message)
@@ -0,0 +1,292 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+
+#include <spa/buffer/buffer.h>
+#include <spa/utils/defs.h>
+#include <spa/utils/result.h>
+#include <pipewire/log.h>
+#include <pipewire/mem.h>
+#include <pipewire/utils.h>
+
+#include "client.h"
+#include "commands.h"
+#include "defs.h"
+#include "log.h"
+#include "message.h"
+#include "shm.h"
+
+/* PulseAudio uses 64MB pools by default */
+#define MAX_POOL_SIZE		(256u*1024*1024)
+#define MAX_POOLS		16u
+
+/* our pool for record data, one slot per memblock in flight */
+#define EXPORT_SLOTS		64u
+#define EXPORT_SLOT_SIZE	(64u*1024)
+
+struct shm {
+	struct pw_mempool *pool;	/* the pools of the client and our export pool */
+	uint32_t n_pools;
+
+	struct pw_memblock *export;
+	uint32_t export_id;
+	uint64_t used;			/* bitmask of the used export slots */
+	unsigned int export_failed:1;
+};
+
+static struct shm *ensure_shm(struct client *client)
+{
+	struct shm *shm;
+
+	if (client->shm != NULL)
+		return client->shm;
+
+	if ((shm = calloc(1, sizeof(*shm))) == NULL)
+		return NULL;
+	if ((shm->pool = pw_mempool_new(NULL)) == NULL) {
+		free(shm);
+		return NULL;
+	}
+	client->shm = shm;
+	return shm;
+}
+
+/* the mappings of the client pools are tagged with the shm_id, the second
+ * word keeps them apart from the untagged mapping of our export pool */
+#define POOL_TAG(shm_id)	{ (shm_id), 1, }
+
+static struct pw_memmap *find_pool(struct shm *shm, uint32_t shm_id)
+{
+	uint32_t tag[5] = POOL_TAG(shm_id);
+	return pw_mempool_find_tag(shm->pool, tag, 2 * sizeof(uint32_t));
+}
+
+/* takes ownership of the fd */
+int shm_register_pool(struct client *client, uint32_t shm_id, int fd)
+{
+	uint32_t tag[5] = POOL_TAG(shm_id);
+	struct pw_memblock *block;
+	struct pw_memmap *map;
+	struct shm *shm;
+	struct stat st;
+	int res;
+
+	if (!client->memfd) {
+		res = -EPROTO;
+		goto error_close;
+	}
+	if ((shm = ensure_shm(client)) == NULL) {
+		res = -errno;
+		goto error_close;
+	}
+#ifdef F_ADD_SEALS
+	/* a pool that shrinks below our mapping would crash the server, only
+	 * accept pools that can't shrink anymore */
+	if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+		pw_log_debug("client %p [%s]: can't seal pool %u: %m",
+				client, client->name, shm_id);
+	if ((res = fcntl(fd, F_GET_SEALS)) < 0 || !(res & F_SEAL_SHRINK)) {
+		pw_log_warn("client %p [%s]: pool %u is not sealed against shrinking",
+				client, client->name, shm_id);
+		res = -EPERM;
+		goto error_close;
+	}
+#else
+	res = -ENOTSUP;
+	goto error_close;
+#endif
+	/* after sealing, the size can only grow */
+	if (fstat(fd, &st) < 0) {
+		res = -errno;
+		goto error_close;
+	}
+	if (st.st_size <= 0 || st.st_size > MAX_POOL_SIZE) {
+		res = -EINVAL;
+		goto error_close;
+	}
+	if ((map = find_pool(shm, shm_id)) != NULL) {
+		pw_memblock_free(map->block);
+		shm->n_pools--;
+	}
+	if (shm->n_pools >= MAX_POOLS) {
+		res = -ENOSPC;
+		goto error_close;
+	}
+
+	block = pw_mempool_import(shm->pool,
+			PW_MEMBLOCK_FLAG_READABLE | PW_MEMBLOCK_FLAG_DONT_NOTIFY,
+			SPA_DATA_MemFd, fd);
+	if (block == NULL) {
+		res = -errno;
+		goto error_close;
+	}
+	block->size = st.st_size;
+
+	if (pw_memblock_map(block, PW_MEMMAP_FLAG_READ, 0, block->size, tag) == NULL) {
+		res = -errno;
+		pw_memblock_free(block);
+		return res;
+	}
+	shm->n_pools++;
+
+	pw_log_info("client %p [%s]: registered memfd pool %u size:%u",
+			client, client->name, shm_id, block->size);
+	return 0;
+
+error_close:
+	close(fd);
+	return res;
+}
+
+const void *shm_get_block(struct client *client, const struct message *msg,
+		uint32_t *block_id, uint32_t *length)
+{
+	const uint32_t *info = (const uint32_t *)msg->data;
+	uint32_t shm_id, offset, size;
+	struct pw_memmap *map;
+
+	if (msg->length != SHM_INFO_SIZE) {
+		errno = EPROTO;
+		return NULL;
+	}
+	*block_id = ntohl(info[SHM_INFO_BLOCK_ID]);
+	shm_id = ntohl(info[SHM_INFO_SHM_ID]);
+	offset = ntohl(info[SHM_INFO_OFFSET]);
+	size = ntohl(info[SHM_INFO_LENGTH]);
+
+	if (client->shm == NULL || (map = find_pool(client->shm, shm_id)) == NULL) {
+		pw_log_warn("client %p [%s]: unknown memfd pool %u",
+				client, client->name, shm_id);
+		errno = ENOENT;
+		return NULL;
+	}
+	if (size > map->size || offset > map->size - size) {
+		pw_log_warn("client %p [%s]: invalid block %u %u:%u in pool %u of size %u",
+				client, client->name, *block_id, offset, size,
+				shm_id, map->size);
+		errno = EINVAL;
+		return NULL;
+	}
+	*length = size;
+	return SPA_PTROFF(map->ptr, offset, void);
+}
+
+int shm_release_block(struct client *client, uint32_t block_id)
+{
+	struct message *msg;
+
+	if ((msg = message_alloc(client->impl, -1, 0)) == NULL)
+		return -errno;
+
+	msg->flags = FLAG_SHMRELEASE;
+	msg->block_id = block_id;
+
+	return client_queue_message(client, msg);
+}
+
+static int export_pool_init(struct client *client, struct shm *shm)
+{
+	struct message *msg;
+	int res;
+
+	shm->export = pw_mempool_alloc(shm->pool,
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, EXPORT_SLOTS * EXPORT_SLOT_SIZE);
+	if (shm->export == NULL)
+		return -errno;
+
+	shm->export_id = pw_rand32();
+
+	if ((msg = message_alloc(client->impl, -1, 0)) == NULL)
+		return -errno;
+
+	message_put(msg,
+		TAG_U32, COMMAND_REGISTER_MEMFD_SHMID,
+		TAG_U32, -1,
+		TAG_U32, shm->export_id,
+		TAG_INVALID);
+	msg->fd = shm->export->fd;
+
+	if ((res = client_queue_message(client, msg)) < 0)
+		return res;
+
+	pw_log_info("client %p [%s]: exporting memfd pool %u size:%u",
+			client, client->name, shm->export_id, shm->export->size);
+	return 0;
+}
+
+struct message *shm_export_block(struct client *client, uint32_t channel,
+		uint32_t size, void **data)
+{
+	struct shm *shm = client->shm;
+	struct message *msg;
+	uint32_t *info, slot;
+	int res;
+
+	/* libpulse only accepts memfds once it enabled the memfd transport
+	 * itself, which it did when it registered its own pool */
+	if (shm == NULL || shm->n_pools == 0 || shm->export_failed ||
+	    size > EXPORT_SLOT_SIZE)
+		return NULL;
+
+	if (shm->export == NULL &&
+	    (res = export_pool_init(client, shm)) < 0) {
+		pw_log_warn("client %p [%s]: can't export memfd pool: %s",
+				client, client->name, spa_strerror(res));
+		shm->export_failed = true;
+		return NULL;
+	}
+	if (shm->used == UINT64_MAX)
+		return NULL;
+
+	if ((msg = message_alloc(client->impl, channel, SHM_INFO_SIZE)) == NULL)
+		return NULL;
+
+	slot = __builtin_ctzll(~shm->used);
+	shm->used |= UINT64_C(1) << slot;
+
+	info = (uint32_t *)msg->data;
+	info[SHM_INFO_BLOCK_ID] = htonl(slot);
+	info[SHM_INFO_SHM_ID] = htonl(shm->export_id);
+	info[SHM_INFO_OFFSET] = htonl(slot * EXPORT_SLOT_SIZE);
+	info[SHM_INFO_LENGTH] = htonl(size);
+	msg->flags = FLAG_SHMDATA | FLAG_SHMDATA_MEMFD_BLOCK;
+
+	*data = SPA_PTROFF(shm->export->map->ptr, slot * EXPORT_SLOT_SIZE, void);
+	return msg;
+}
+
+void shm_free_block(struct client *client, uint32_t block_id)
+{
+	struct shm *shm = client->shm;
+
+	if (shm == NULL || shm->export == NULL || block_id >= EXPORT_SLOTS) {
+		pw_log_warn("client %p [%s]: release of unknown block %u",
+				client, client->name, block_id);
+		return;
+	}
+	shm->used &= ~(UINT64_C(1) << block_id);
+}
+
+void shm_clear(struct client *client)
+{
+	struct shm *shm = client->shm;
+
+	if (shm == NULL)
+		return;
+
+	pw_mempool_destroy(shm->pool);
+	free(shm);
+	client->shm = NULL;
+}
@@ -0,0 +1,31 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef PULSE_SERVER_SHM_H
+#define PULSE_SERVER_SHM_H
+
+#include <stdint.h>
+
+struct client;
+struct message;
+
+/* the payload of a memblock frame with FLAG_SHMDATA */
+#define SHM_INFO_BLOCK_ID	0
+#define SHM_INFO_SHM_ID		1
+#define SHM_INFO_OFFSET		2
+#define SHM_INFO_LENGTH		3
+#define SHM_INFO_SIZE		(4 * sizeof(uint32_t))
+
+int shm_register_pool(struct client *client, uint32_t shm_id, int fd);
+const void *shm_get_block(struct client *client, const struct message *msg,
+		uint32_t *block_id, uint32_t *length);
+int shm_release_block(struct client *client, uint32_t block_id);
+
+struct message *shm_export_block(struct client *client, uint32_t channel,
+		uint32_t size, void **data);
+void shm_free_block(struct client *client, uint32_t block_id);
+
+void shm_clear(struct client *client);
+
+#endif /* PULSE_SERVER_SHM_H */
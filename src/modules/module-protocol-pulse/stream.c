@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <spa/utils/hook.h>
 #include <spa/utils/ringbuffer.h>
@@ -157,6 +158,72 @@ void stream_flush(struct stream *stream)
 	}
 }
 
+struct grow_buffer {
+	struct stream *stream;
+	void *buffer;
+	uint32_t size;
+};
+
+static int do_grow_buffer(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct grow_buffer *g = user_data;
+	struct stream *stream = g->stream;
+	uint32_t index, avail, old_size = stream->buffer_size;
+	void *old = stream->buffer;
+	int32_t filled;
+
+	filled = spa_ringbuffer_get_write_index(&stream->ring, &index);
+
+	/* move the queued data to its place in the new ring, whatever
+	 * does not fit in the old ring was overwritten already */
+	avail = SPA_CLAMP(filled, 0, (int32_t)old_size);
+	index -= avail;
+	while (avail > 0) {
+		uint32_t o = index & (old_size - 1), n = index & (g->size - 1);
+		uint32_t l = SPA_MIN(avail, SPA_MIN(old_size - o, g->size - n));
+		memcpy(SPA_PTROFF(g->buffer, n, void), SPA_PTROFF(old, o, void), l);
+		index += l;
+		avail -= l;
+	}
+	stream->buffer = g->buffer;
+	stream->buffer_size = g->size;
+	g->buffer = old;
+	return 0;
+}
+
+int stream_grow_buffer(struct stream *stream, uint32_t size)
+{
+	struct grow_buffer g = { .stream = stream, };
+	struct pw_loop *data_loop;
+
+	/* the ring holds at most maxlength bytes, rounded up so that the
+	 * indexes keep wrapping correctly */
+	size = SPA_MIN(size, SPA_MAX(stream->attr.maxlength, MIN_BUFFER_SIZE));
+	if (size <= stream->buffer_size)
+		return 0;
+
+	g.size = SPA_MAX(stream->buffer_size, MIN_BUFFER_SIZE);
+	while (g.size < size)
+		g.size <<= 1;
+
+	if ((g.buffer = calloc(1, g.size)) == NULL)
+		return -errno;
+
+	pw_log_debug("stream %p: grow buffer %u -> %u", stream,
+			stream->buffer_size, g.size);
+
+	/* the process function uses the ring in the data thread of the stream */
+	data_loop = stream->stream ? pw_stream_get_data_loop(stream->stream) : NULL;
+	if (data_loop != NULL)
+		pw_loop_invoke(data_loop, do_grow_buffer, 0, NULL, 0, true, &g);
+	else
+		do_grow_buffer(NULL, false, 0, NULL, 0, &g);
+
+	free(g.buffer);
+	return 0;
+}
+
 static bool stream_prebuf_active(struct stream *stream, int32_t avail)
 {
 	if (stream->in_prebuf) {
@@ -54,6 +54,7 @@ struct stream {
 	struct spa_io_position *position;
 	struct spa_ringbuffer ring;
 	void *buffer;
+	uint32_t buffer_size;	/* power of 2, grows up to maxlength */
 
 	int64_t read_index;
 	int64_t write_index;
@@ -105,6 +106,7 @@ struct stream *stream_new(struct client *client, enum stream_type type, uint32_t
 			  const struct buffer_attr *attr);
 void stream_free(struct stream *stream);
 void stream_flush(struct stream *stream);
+int stream_grow_buffer(struct stream *stream, uint32_t size);
 uint32_t stream_pop_missing(struct stream *stream);
 
 void stream_set_paused(struct stream *stream, bool paused, const char *reason);
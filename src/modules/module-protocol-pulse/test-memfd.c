@@ -0,0 +1,273 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/string.h>
+
+#include <pipewire/impl.h>
+#include <pipewire/pipewire.h>
+
+#include "commands.h"
+#include "defs.h"
+#include "message.h"
+#include "shm.h"
+
+#define POOL_SIZE	(64u*1024)
+#define POOL_ID		0x1234u
+
+struct descriptor {
+	uint32_t length;
+	uint32_t channel;
+	uint32_t offset_hi;
+	uint32_t offset_lo;
+	uint32_t flags;
+};
+
+static void send_frame(int fd, uint32_t channel, uint32_t offset_hi, uint32_t flags,
+		const void *data, uint32_t size, int pass_fd)
+{
+	struct descriptor desc = {
+		.length = htonl(size),
+		.channel = htonl(channel),
+		.offset_hi = htonl(offset_hi),
+		.flags = htonl(flags),
+	};
+	struct iovec iov[2] = {
+		{ .iov_base = &desc, .iov_len = sizeof(desc) },
+		{ .iov_base = (void *)data, .iov_len = size },
+	};
+	char buf[CMSG_SPACE(sizeof(int))];
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = size > 0 ? 2 : 1,
+	};
+
+	if (pass_fd >= 0) {
+		struct cmsghdr *cmsg;
+
+		spa_zero(buf);
+		msg.msg_control = buf;
+		msg.msg_controllen = sizeof(buf);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof(int));
+	}
+	spa_assert_se(sendmsg(fd, &msg, MSG_NOSIGNAL) == (ssize_t)(sizeof(desc) + size));
+}
+
+static int recv_all(int fd, void *data, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t r = recv(fd, SPA_PTROFF(data, done, void), size - done, 0);
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r < 0)
+			return -errno;
+		if (r == 0)
+			return -EPIPE;
+		done += r;
+	}
+	return 0;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t val)
+{
+	*p++ = TAG_U32;
+	val = htonl(val);
+	memcpy(p, &val, sizeof(val));
+	return p + sizeof(val);
+}
+
+static uint32_t get_u32(const uint8_t **p)
+{
+	uint32_t val;
+
+	spa_assert_se(**p == TAG_U32);
+	memcpy(&val, *p + 1, sizeof(val));
+	*p += 1 + sizeof(val);
+	return ntohl(val);
+}
+
+static void test_auth(int fd)
+{
+	uint8_t packet[512], *p = packet, reply[64];
+	const uint8_t *r = reply;
+	struct descriptor desc;
+	uint32_t len;
+
+	p = put_u32(p, COMMAND_AUTH);
+	p = put_u32(p, 1);
+	p = put_u32(p, PROTOCOL_VERSION | PROTOCOL_FLAG_SHM | PROTOCOL_FLAG_MEMFD);
+	*p++ = TAG_ARBITRARY;
+	len = htonl(NATIVE_COOKIE_LENGTH);
+	memcpy(p, &len, sizeof(len));
+	p += sizeof(len);
+	memset(p, 0, NATIVE_COOKIE_LENGTH);
+	p += NATIVE_COOKIE_LENGTH;
+
+	send_frame(fd, -1, 0, 0, packet, p - packet, -1);
+
+	spa_assert_se(recv_all(fd, &desc, sizeof(desc)) == 0);
+	len = ntohl(desc.length);
+	spa_assert_se(ntohl(desc.channel) == (uint32_t)-1);
+	spa_assert_se(len <= sizeof(reply));
+	spa_assert_se(recv_all(fd, reply, len) == 0);
+
+	spa_assert_se(get_u32(&r) == COMMAND_REPLY);
+	spa_assert_se(get_u32(&r) == 1);
+	/* the server offers the memfd transport to clients of the same user */
+	spa_assert_se(SPA_FLAG_IS_SET(get_u32(&r), PROTOCOL_FLAG_SHM | PROTOCOL_FLAG_MEMFD));
+}
+
+static void register_pool(int fd, int pool_fd)
+{
+	uint8_t packet[64], *p = packet;
+
+	p = put_u32(p, COMMAND_REGISTER_MEMFD_SHMID);
+	p = put_u32(p, 2);
+	p = put_u32(p, POOL_ID);
+
+	send_frame(fd, -1, 0, 0, packet, p - packet, pool_fd);
+}
+
+static void send_memblock(int fd, uint32_t block_id, uint32_t offset, uint32_t length)
+{
+	uint32_t info[4];
+
+	info[SHM_INFO_BLOCK_ID] = htonl(block_id);
+	info[SHM_INFO_SHM_ID] = htonl(POOL_ID);
+	info[SHM_INFO_OFFSET] = htonl(offset);
+	info[SHM_INFO_LENGTH] = htonl(length);
+
+	send_frame(fd, 0, 0, FLAG_SHMDATA | FLAG_SHMDATA_MEMFD_BLOCK | SEEK_RELATIVE,
+			info, sizeof(info), -1);
+}
+
+static void expect_release(int fd, uint32_t block_id)
+{
+	struct descriptor desc;
+
+	spa_assert_se(recv_all(fd, &desc, sizeof(desc)) == 0);
+	spa_assert_se(ntohl(desc.flags) == FLAG_SHMRELEASE);
+	spa_assert_se(ntohl(desc.length) == 0);
+	spa_assert_se(ntohl(desc.offset_hi) == block_id);
+}
+
+#ifdef HAVE_MEMFD_CREATE
+static void test_memfd(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	struct timeval tv = { .tv_sec = 5 };
+	struct descriptor desc;
+	int fd, pool_fd, res;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	spa_assert_se(fd >= 0);
+	spa_assert_se(setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0);
+	spa_scnprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+	spa_assert_se(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+	test_auth(fd);
+
+	pool_fd = memfd_create("pulse-test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	spa_assert_se(pool_fd >= 0);
+	spa_assert_se(ftruncate(pool_fd, POOL_SIZE) == 0);
+	register_pool(fd, pool_fd);
+
+	/* the block is released right away after the data was handled */
+	send_memblock(fd, 7, 0, 1024);
+	expect_release(fd, 7);
+
+	/* the server sealed the pool so that it can't shrink below its mapping */
+	spa_assert_se(ftruncate(pool_fd, POOL_SIZE / 2) < 0);
+
+	send_memblock(fd, 8, POOL_SIZE - 1024, 1024);
+	expect_release(fd, 8);
+
+	/* a release of a block the server never exported is ignored */
+	send_frame(fd, -1, 3, FLAG_SHMRELEASE, NULL, 0, -1);
+	send_memblock(fd, 9, 4096, 4096);
+	expect_release(fd, 9);
+
+	/* a block outside of the pool is a protocol error, the server
+	 * disconnects the client */
+	send_memblock(fd, 10, POOL_SIZE - 512, 1024);
+	res = recv_all(fd, &desc, sizeof(desc));
+	spa_assert_se(res == -EPIPE || res == -ECONNRESET);
+
+	close(pool_fd);
+	close(fd);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+	char dir[] = "/tmp/pulse-test-XXXXXX", path[PATH_MAX];
+	struct pw_thread_loop *loop;
+	struct pw_context *context;
+	struct pw_impl_module *module;
+
+#ifndef HAVE_MEMFD_CREATE
+	fprintf(stderr, "skipping memfd test, no memfd_create\n");
+	return 77;
+#endif
+	spa_assert_se(mkdtemp(dir) != NULL);
+	setenv("PULSE_RUNTIME_PATH", dir, 1);
+	snprintf(path, sizeof(path), "%s/native", dir);
+
+	pw_init(&argc, &argv);
+
+	loop = pw_thread_loop_new("pulse-test", NULL);
+	spa_assert_se(loop != NULL);
+	context = pw_context_new(pw_thread_loop_get_loop(loop),
+			pw_properties_new(
+				PW_KEY_CONFIG_NAME, "null",
+				NULL), 0);
+	spa_assert_se(context != NULL);
+
+	module = pw_context_load_module(context, "libpipewire-module-protocol-pulse",
+			"{ server.address = [ \"unix:native\" ] "
+			"  server.dbus-name = \"\" "
+			"  pulse.memfd = true }", NULL);
+	spa_assert_se(module != NULL);
+
+	spa_assert_se(pw_thread_loop_start(loop) == 0);
+
+#ifdef HAVE_MEMFD_CREATE
+	test_memfd(path);
+#endif
+
+	pw_thread_loop_stop(loop);
+	pw_impl_module_destroy(module);
+	pw_context_destroy(context);
+	pw_thread_loop_destroy(loop);
+
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/pid", dir);
+	unlink(path);
+	rmdir(dir);
+
+	pw_deinit();
+
+	return 0;
+}
@@ -27,6 +27,8 @@
 
 #include <module-rtp/stream.h>
 
+#include "udp-batch.h"
+
 #ifndef IPTOS_DSCP
 #define IPTOS_DSCP_MASK 0xfc
 #define IPTOS_DSCP(x) ((x) & IPTOS_DSCP_MASK)
@@ -179,6 +181,7 @@ struct impl {
 	socklen_t dst_len;
 
 	int rtp_fd;
+	struct udp_batch batch;
 };
 
 static void stream_destroy(void *d)
@@ -187,11 +190,32 @@ static void stream_destroy(void *d)
 	impl->stream = NULL;
 }
 
+static void stream_send_flush(void *data)
+{
+	struct impl *impl = data;
+	int res;
+
+	if ((res = udp_batch_flush(&impl->batch, impl->rtp_fd)) < 0)
+		pw_log_debug("send failed: %s", spa_strerror(res));
+}
+
 static void stream_send_packet(void *data, struct iovec *iov, size_t iovlen)
 {
 	struct impl *impl = data;
 	struct msghdr msg;
 	ssize_t n;
+	int res;
+
+	/* queue the packet, it is sent with the others in stream_send_flush */
+	if ((res = udp_batch_add(&impl->batch, iov, iovlen)) == -ENOSPC) {
+		stream_send_flush(impl);
+		res = udp_batch_add(&impl->batch, iov, iovlen);
+	}
+	if (res == 0)
+		return;
+
+	/* too large for the batch, keep the order and send it now */
+	stream_send_flush(impl);
 
 	spa_zero(msg);
 	msg.msg_iov = iov;
@@ -220,6 +244,7 @@ static const struct rtp_stream_events stream_events = {
 	.destroy = stream_destroy,
 	.state_changed = stream_state_changed,
 	.send_packet = stream_send_packet,
+	.send_flush = stream_send_flush,
 };
 
 static int parse_address(const char *address, uint16_t port,
@@ -534,6 +559,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		goto out;
 	}
 	impl->rtp_fd = res;
+	udp_batch_init(&impl->batch);
 
 	impl->stream = rtp_stream_new(impl->core,
 			PW_DIRECTION_INPUT, pw_properties_copy(stream_props),
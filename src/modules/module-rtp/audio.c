@@ -247,6 +247,8 @@ static void rtp_audio_flush_packets(struct impl *impl)
 		timestamp += tosend;
 		avail -= tosend;
 	}
+	rtp_stream_emit_send_flush(impl);
+
 	spa_ringbuffer_read_update(&impl->ring, timestamp);
 }
 
@@ -254,6 +254,7 @@ static void rtp_opus_flush_packets(struct impl *impl)
 		offset += tosend;
 		avail -= tosend;
 	}
+	rtp_stream_emit_send_flush(impl);
 
 	pw_log_debug("move %d offset:%d", avail, offset);
 	memmove(impl->buffer, &impl->buffer[offset * stride], avail * stride);
@@ -24,7 +24,7 @@ struct rtp_stream;
 #define DEFAULT_MAX_PTIME	20
 
 struct rtp_stream_events {
-#define RTP_VERSION_STREAM_EVENTS        0
+#define RTP_VERSION_STREAM_EVENTS        1
 	uint32_t version;
 
 	void (*destroy) (void *data);
@@ -36,6 +36,10 @@ struct rtp_stream_events {
 	void (*send_packet) (void *data, struct iovec *iov, size_t iovlen);
 
 	void (*send_feedback) (void *data, uint32_t seqnum);
+
+	/* since 1, the send_packet calls of a cycle are done, batched
+	 * packets can be sent now */
+	void (*send_flush) (void *data);
 };
 
 struct rtp_stream *rtp_stream_new(struct pw_core *core,
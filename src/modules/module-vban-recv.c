@@ -31,6 +31,8 @@
 
 #include <module-vban/stream.h>
 
+#include "udp-batch.h"
+
 #ifdef __FreeBSD__
 #define ifr_ifindex ifr_index
 #endif
@@ -156,6 +158,7 @@ struct impl {
 	struct sockaddr_storage src_addr;
 	socklen_t src_len;
 	struct spa_source *source;
+	struct udp_batch batch;
 
 	unsigned receiving:1;
 };
@@ -164,28 +167,32 @@ static void
 on_vban_io(void *data, int fd, uint32_t mask)
 {
 	struct impl *impl = data;
-	ssize_t len;
-	uint8_t buffer[2048];
+	int i, n;
 
 	if (mask & SPA_IO_IN) {
-		if ((len = recv(fd, buffer, sizeof(buffer), 0)) < 0)
+		/* all the packets that are queued in one go */
+		if ((n = udp_batch_recv(&impl->batch, fd)) < 0)
 			goto receive_error;
 
-		if (len < 12)
-			goto short_packet;
+		for (i = 0; i < n; i++) {
+			size_t len;
+			uint8_t *buffer = udp_batch_get_data(&impl->batch, i, &len);
 
-		if (SPA_LIKELY(impl->stream))
-			vban_stream_receive_packet(impl->stream, buffer, len);
+			if (len < 12) {
+				pw_log_warn("short packet received");
+				continue;
+			}
+			if (SPA_LIKELY(impl->stream))
+				vban_stream_receive_packet(impl->stream, buffer, len);
 
-		impl->receiving = true;
+			impl->receiving = true;
+		}
 	}
 	return;
 
 receive_error:
-	pw_log_warn("recv error: %m");
-	return;
-short_packet:
-	pw_log_warn("short packet received");
+	if (n != -EAGAIN)
+		pw_log_warn("recv error: %s", spa_strerror(n));
 	return;
 }
 
@@ -302,6 +309,8 @@ static int stream_start(struct impl *impl)
 		return fd;
 	}
 
+	udp_batch_init(&impl->batch);
+
 	impl->source = pw_loop_add_io(impl->data_loop, fd,
 				SPA_IO_IN, true, on_vban_io, impl);
 	if (impl->source == NULL) {
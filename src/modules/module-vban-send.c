@@ -27,6 +27,8 @@
 
 #include <module-vban/stream.h>
 
+#include "udp-batch.h"
+
 #ifndef IPTOS_DSCP
 #define IPTOS_DSCP_MASK 0xfc
 #define IPTOS_DSCP(x) ((x) & IPTOS_DSCP_MASK)
@@ -175,6 +177,7 @@ struct impl {
 	socklen_t dst_len;
 
 	int vban_fd;
+	struct udp_batch batch;
 };
 
 static void stream_destroy(void *d)
@@ -183,11 +186,32 @@ static void stream_destroy(void *d)
 	impl->stream = NULL;
 }
 
+static void stream_send_flush(void *data)
+{
+	struct impl *impl = data;
+	int res;
+
+	if ((res = udp_batch_flush(&impl->batch, impl->vban_fd)) < 0)
+		pw_log_debug("send failed: %s", spa_strerror(res));
+}
+
 static void stream_send_packet(void *data, struct iovec *iov, size_t iovlen)
 {
 	struct impl *impl = data;
 	struct msghdr msg;
 	ssize_t n;
+	int res;
+
+	/* queue the packet, it is sent with the others in stream_send_flush */
+	if ((res = udp_batch_add(&impl->batch, iov, iovlen)) == -ENOSPC) {
+		stream_send_flush(impl);
+		res = udp_batch_add(&impl->batch, iov, iovlen);
+	}
+	if (res == 0)
+		return;
+
+	/* too large for the batch, keep the order and send it now */
+	stream_send_flush(impl);
 
 	spa_zero(msg);
 	msg.msg_iov = iov;
@@ -216,6 +240,7 @@ static const struct vban_stream_events stream_events = {
 	.destroy = stream_destroy,
 	.state_changed = stream_state_changed,
 	.send_packet = stream_send_packet,
+	.send_flush = stream_send_flush,
 };
 
 static int parse_address(const char *address, uint16_t port,
@@ -515,6 +540,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 		goto out;
 	}
 	impl->vban_fd = res;
+	udp_batch_init(&impl->batch);
 
 	impl->stream = vban_stream_new(impl->core,
 			PW_DIRECTION_INPUT, pw_properties_copy(stream_props),
@@ -211,6 +211,8 @@ static void vban_audio_flush_packets(struct impl *impl)
 		avail -= tosend;
 		header.n_frames++;
 	}
+	vban_stream_emit_send_flush(impl);
+
 	impl->header.n_frames = header.n_frames;
 	spa_ringbuffer_read_update(&impl->ring, timestamp);
 }
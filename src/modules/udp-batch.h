@@ -0,0 +1,200 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#ifndef PIPEWIRE_UDP_BATCH_H
+#define PIPEWIRE_UDP_BATCH_H
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#include <spa/utils/defs.h>
+
+/* Batched I/O on connected UDP sockets. The packets that are queued on the
+ * socket are received with one recvmmsg() and a burst of packets is sent
+ * with one sendmmsg() or, when they have the same size, as one UDP GSO
+ * buffer that the kernel splits in packets. */
+
+#define UDP_BATCH_PACKETS	32u
+#define UDP_BATCH_PACKET_SIZE	2048u
+
+#define UDP_MAX_PAYLOAD		65507u
+#define UDP_MAX_SEGMENTS	64u
+
+struct udp_batch {
+	uint32_t n_packets;
+	unsigned int no_gso:1;
+	struct iovec iov[UDP_BATCH_PACKETS];
+#if defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)
+	struct mmsghdr msgs[UDP_BATCH_PACKETS];
+#endif
+	uint8_t data[UDP_BATCH_PACKETS][UDP_BATCH_PACKET_SIZE];
+};
+
+static inline void udp_batch_init(struct udp_batch *b)
+{
+	b->n_packets = 0;
+#ifdef UDP_SEGMENT
+	b->no_gso = false;
+#else
+	b->no_gso = true;
+#endif
+}
+
+static inline void *udp_batch_get_data(struct udp_batch *b, uint32_t index, size_t *len)
+{
+	*len = b->iov[index].iov_len;
+	return b->iov[index].iov_base;
+}
+
+/* Receive the packets that are queued on the socket without blocking.
+ * Returns the number of packets or a negative errno. */
+static inline int udp_batch_recv(struct udp_batch *b, int fd)
+{
+	uint32_t i;
+	int n;
+
+#ifdef HAVE_RECVMMSG
+	for (i = 0; i < UDP_BATCH_PACKETS; i++) {
+		b->iov[i].iov_base = b->data[i];
+		b->iov[i].iov_len = UDP_BATCH_PACKET_SIZE;
+		spa_zero(b->msgs[i]);
+		b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+		b->msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	if ((n = recvmmsg(fd, b->msgs, UDP_BATCH_PACKETS, MSG_DONTWAIT, NULL)) < 0)
+		return -errno;
+	for (i = 0; i < (uint32_t)n; i++)
+		b->iov[i].iov_len = b->msgs[i].msg_len;
+#else
+	ssize_t len;
+
+	if ((len = recv(fd, b->data[0], UDP_BATCH_PACKET_SIZE, MSG_DONTWAIT)) < 0)
+		return -errno;
+	b->iov[0].iov_base = b->data[0];
+	b->iov[0].iov_len = len;
+	n = 1;
+	(void)i;
+#endif
+	b->n_packets = n;
+	return n;
+}
+
+/* Copy a packet into the batch. Returns -ENOSPC when the batch is full and
+ * needs a flush and -EMSGSIZE when the packet needs to be sent directly. */
+static inline int udp_batch_add(struct udp_batch *b, const struct iovec *iov, size_t iovlen)
+{
+	size_t i, len = 0;
+	uint8_t *data;
+
+	if (b->n_packets >= UDP_BATCH_PACKETS)
+		return -ENOSPC;
+
+	for (i = 0; i < iovlen; i++)
+		len += iov[i].iov_len;
+	if (len > UDP_BATCH_PACKET_SIZE)
+		return -EMSGSIZE;
+
+	data = b->data[b->n_packets];
+	b->iov[b->n_packets].iov_base = data;
+	b->iov[b->n_packets].iov_len = len;
+	for (i = 0; i < iovlen; i++) {
+		memcpy(data, iov[i].iov_base, iov[i].iov_len);
+		data += iov[i].iov_len;
+	}
+	b->n_packets++;
+	return 0;
+}
+
+#ifdef UDP_SEGMENT
+/* send the packets from index with the same size as one GSO buffer, returns
+ * the number of packets sent */
+static inline int udp_batch_send_gso(struct udp_batch *b, int fd, uint32_t index,
+		uint32_t n_packets)
+{
+	char ctrl[CMSG_SPACE(sizeof(uint16_t))];
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	size_t size = b->iov[index].iov_len;
+	uint32_t i, max;
+
+	max = SPA_MIN(UDP_MAX_SEGMENTS, UDP_MAX_PAYLOAD / SPA_MAX(size, 1u));
+	max = SPA_MIN(max, n_packets - index);
+	for (i = 1; i < max; i++) {
+		if (b->iov[index + i].iov_len != size)
+			break;
+	}
+	if (i < 2)
+		return 0;
+
+	spa_zero(msg);
+	msg.msg_iov = &b->iov[index];
+	msg.msg_iovlen = i;
+	msg.msg_control = ctrl;
+	msg.msg_controllen = sizeof(ctrl);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_UDP;
+	cmsg->cmsg_type = UDP_SEGMENT;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+	*(uint16_t*)CMSG_DATA(cmsg) = size;
+
+	if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+		/* no GSO for this socket or device, don't try again */
+		if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT ||
+		    errno == EOPNOTSUPP) {
+			b->no_gso = true;
+			return 0;
+		}
+		return -errno;
+	}
+	return i;
+}
+#endif
+
+/* Send all the packets in the batch and empty it. Returns 0 or a negative
+ * errno when some packets could not be sent. */
+static inline int udp_batch_flush(struct udp_batch *b, int fd)
+{
+	uint32_t i, index = 0, n_packets = b->n_packets;
+	int n;
+
+	b->n_packets = 0;
+
+	while (index < n_packets) {
+#ifdef UDP_SEGMENT
+		if (!b->no_gso) {
+			if ((n = udp_batch_send_gso(b, fd, index, n_packets)) < 0)
+				return n;
+			if (n > 0) {
+				index += n;
+				continue;
+			}
+		}
+#endif
+#ifdef HAVE_SENDMMSG
+		for (i = index; i < n_packets; i++) {
+			spa_zero(b->msgs[i]);
+			b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+			b->msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		if ((n = sendmmsg(fd, &b->msgs[index], n_packets - index, MSG_NOSIGNAL)) < 0)
+			return -errno;
+#else
+		if (send(fd, b->iov[index].iov_base, b->iov[index].iov_len, MSG_NOSIGNAL) < 0)
+			return -errno;
+		n = 1;
+		(void)i;
+#endif
+		index += n;
+	}
+	return 0;
+}
+
+#endif /* PIPEWIRE_UDP_BATCH_H */
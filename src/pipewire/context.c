@@ -18,6 +18,7 @@
 #include <spa/support/plugin-loader.h>
 #include <spa/node/utils.h>
 #include <spa/utils/atomic.h>
+#include <spa/utils/json.h>
 #include <spa/utils/names.h>
 #include <spa/utils/string.h>
 #include <spa/debug/types.h>
@@ -33,16 +34,33 @@ PW_LOG_TOPIC_EXTERN(log_context);
 #define PW_LOG_TOPIC_DEFAULT log_context
 
 #define MAX_HOPS	64
+#define MAX_DATA_LOOPS	64
+
+#define DEFAULT_LOOP_CLASS	"data.rt"
 
 /** \cond */
+struct data_loop {
+	struct pw_data_loop *impl;
+	char *name;
+	char *class;
+};
+
 struct impl {
 	struct pw_context this;
 	struct spa_handle *dbus_handle;
 	struct spa_plugin_loader plugin_loader;
 	unsigned int recalc:1;
 	unsigned int recalc_pending:1;
+	unsigned int recalc_full:1;
+	unsigned int incremental:1;
 
-	struct pw_data_loop *data_loop_impl;
+	struct spa_source *recalc_source;
+	const char *recalc_reason;
+	uint32_t recalc_requests;
+	struct pw_impl_node *last_target;
+
+	struct data_loop data_loops[MAX_DATA_LOOPS];
+	uint32_t n_data_loops;
 };
 
 
@@ -90,23 +108,30 @@ static int context_set_freewheel(struct pw_context *context, bool freewheel)
 {
 	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
 	struct spa_thread *thr;
+	uint32_t i;
 	int res = 0;
 
-	if ((thr = pw_data_loop_get_thread(impl->data_loop_impl)) == NULL)
-		return -EIO;
+	pw_log_info("%p: %s freewheel", context, freewheel ? "enter" : "exit");
+
+	for (i = 0; i < impl->n_data_loops; i++) {
+		struct pw_data_loop *l = impl->data_loops[i].impl;
 
-	if (freewheel) {
-		pw_log_info("%p: enter freewheel", context);
-		if (context->thread_utils)
+		if ((thr = pw_data_loop_get_thread(l)) == NULL)
+			return -EIO;
+
+		if (context->thread_utils == NULL)
+			continue;
+
+		if (freewheel)
 			res = spa_thread_utils_drop_rt(context->thread_utils, thr);
-	} else {
-		pw_log_info("%p: exit freewheel", context);
-		/* Use the priority as configured within the realtime module */
-		if (context->thread_utils)
-			res = spa_thread_utils_acquire_rt(context->thread_utils, thr, -1);
+		else
+			/* Use the priority as configured for the loop or
+			 * within the realtime module */
+			res = spa_thread_utils_acquire_rt(context->thread_utils,
+					thr, l->rt_prio);
+		if (res < 0)
+			pw_log_info("%p: freewheel error:%s", context, spa_strerror(res));
 	}
-	if (res < 0)
-		pw_log_info("%p: freewheel error:%s", context, spa_strerror(res));
 
 	context->freewheeling = freewheel;
 
@@ -163,6 +188,156 @@ static int do_data_loop_setup(struct spa_loop *loop, bool async, uint32_t seq,
 	return 0;
 }
 
+static int add_data_loop(struct impl *impl, const struct spa_dict *props)
+{
+	struct pw_context *this = &impl->this;
+	struct data_loop *l;
+	struct pw_properties *pr;
+	const char *str;
+	int res = 0;
+
+	if (impl->n_data_loops >= MAX_DATA_LOOPS) {
+		pw_log_warn("%p: too many data loops, max %d", this, MAX_DATA_LOOPS);
+		return -ENOSPC;
+	}
+	l = &impl->data_loops[impl->n_data_loops];
+
+	pr = pw_properties_copy(this->properties);
+	if (pr == NULL)
+		return -errno;
+	if ((str = pw_properties_get(pr, "context.data-loop." PW_KEY_LIBRARY_NAME_SYSTEM)))
+		pw_properties_set(pr, PW_KEY_LIBRARY_NAME_SYSTEM, str);
+	if (props)
+		pw_properties_update(pr, props);
+
+	if ((str = pw_properties_get(pr, PW_KEY_LOOP_NAME)) == NULL) {
+		pw_properties_setf(pr, PW_KEY_LOOP_NAME, "data-loop.%u", impl->n_data_loops);
+		str = pw_properties_get(pr, PW_KEY_LOOP_NAME);
+	}
+	if (pw_properties_get(pr, SPA_KEY_THREAD_NAME) == NULL && impl->n_data_loops > 0)
+		pw_properties_set(pr, SPA_KEY_THREAD_NAME, str);
+
+	l->name = strdup(str);
+	l->class = strdup(pw_properties_get(pr, PW_KEY_LOOP_CLASS) ?: DEFAULT_LOOP_CLASS);
+	l->impl = pw_data_loop_new(&pr->dict);
+	pw_properties_free(pr);
+
+	if (l->name == NULL || l->class == NULL || l->impl == NULL) {
+		res = -errno;
+		free(l->name);
+		free(l->class);
+		l->name = l->class = NULL;
+		if (l->impl)
+			pw_data_loop_destroy(l->impl);
+		l->impl = NULL;
+		return res;
+	}
+	pw_log_info("%p: added data loop %u '%s' class:%s", this, impl->n_data_loops,
+			l->name, l->class);
+	impl->n_data_loops++;
+	return 0;
+}
+
+/*
+ * context.data-loops = [
+ *   {   loop.name = <name>
+ *       ( loop.class = <class> )
+ *       ( thread.name = <thread-name> )
+ *       ( thread.affinity = [ <cpu> ... ] )
+ *       ( loop.rt-prio = <priority> )
+ *       ( loop.cancel = <bool> )
+ *       ( library.name.system = <library> )
+ *   }
+ * ]
+ */
+static int parse_data_loops(void *user_data, const char *location,
+		const char *section, const char *str, size_t len)
+{
+	struct impl *impl = user_data;
+	struct spa_json it[2];
+	const char *val;
+	int l, res = 0;
+
+	spa_json_init(&it[0], str, len);
+	if (spa_json_enter_array(&it[0], &it[1]) < 0) {
+		pw_log_error("config file error: context.data-loops is not an array");
+		return -EINVAL;
+	}
+	while ((l = spa_json_next(&it[1], &val)) > 0) {
+		struct pw_properties *props;
+
+		if (!spa_json_is_object(val, l))
+			continue;
+		l = spa_json_container_len(&it[1], val, l);
+
+		if ((props = pw_properties_new(NULL, NULL)) == NULL)
+			return -errno;
+		pw_properties_update_string(props, val, l);
+
+		res = add_data_loop(impl, &props->dict);
+		pw_properties_free(props);
+		if (res < 0)
+			break;
+	}
+	return res;
+}
+
+static int setup_data_loops(struct impl *impl, struct spa_cpu *cpu)
+{
+	struct pw_context *this = &impl->this;
+	int32_t i, n_loops;
+	int res;
+
+	if ((res = pw_context_conf_section_for_each(this, "context.data-loops",
+				parse_data_loops, impl)) < 0)
+		return res;
+
+	if (impl->n_data_loops > 0)
+		return 0;
+
+	n_loops = pw_properties_get_int32(this->properties, "context.num-data-loops", 1);
+	if (n_loops < 0)
+		n_loops = cpu ? (int32_t)spa_cpu_get_count(cpu) : 1;
+	n_loops = SPA_CLAMP(n_loops, 1, MAX_DATA_LOOPS);
+
+	for (i = 0; i < n_loops; i++) {
+		if ((res = add_data_loop(impl, NULL)) < 0)
+			return res;
+	}
+	return 0;
+}
+
+static struct data_loop *find_data_loop(struct impl *impl, const struct spa_dict *props)
+{
+	const char *str;
+	uint32_t i;
+
+	if (props != NULL &&
+	    (str = spa_dict_lookup(props, PW_KEY_NODE_LOOP_NAME)) != NULL) {
+		for (i = 0; i < impl->n_data_loops; i++) {
+			if (spa_streq(impl->data_loops[i].name, str))
+				return &impl->data_loops[i];
+		}
+		pw_log_warn("%p: unknown data loop '%s', using default",
+				&impl->this, str);
+	}
+	return impl->n_data_loops > 0 ? &impl->data_loops[0] : NULL;
+}
+
+static uint32_t count_loop_nodes(struct pw_context *context, struct pw_data_loop *loop)
+{
+	struct pw_impl_node *n;
+	uint32_t count = 0;
+
+	spa_list_for_each(n, &context->node_list, link) {
+		if (n->data_loop == loop->loop)
+			count++;
+	}
+	return count;
+}
+
+static void on_recalc_graph(void *data, uint64_t count);
+
 /** Create a new context object
  *
  * \param main_loop the main loop to use
@@ -180,8 +355,9 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	const char *lib, *str;
 	void *dbus_iface = NULL;
 	uint32_t n_support;
-	struct pw_properties *pr, *conf;
+	struct pw_properties *conf;
 	struct spa_cpu *cpu;
+	uint32_t i;
 	int res = 0;
 
 	impl = calloc(1, sizeof(struct impl) + user_data_size);
@@ -276,16 +452,8 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	pw_settings_init(this);
 	this->settings = this->defaults;
 
-	pr = pw_properties_copy(properties);
-	if ((str = pw_properties_get(pr, "context.data-loop." PW_KEY_LIBRARY_NAME_SYSTEM)))
-		pw_properties_set(pr, PW_KEY_LIBRARY_NAME_SYSTEM, str);
-
-	impl->data_loop_impl = pw_data_loop_new(&pr->dict);
-	pw_properties_free(pr);
-	if (impl->data_loop_impl == NULL)  {
-		res = -errno;
+	if ((res = setup_data_loops(impl, cpu)) < 0)
 		goto error_free;
-	}
 
 	this->pool = pw_mempool_new(NULL);
 	if (this->pool == NULL) {
@@ -293,7 +461,7 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 		goto error_free;
 	}
 
-	this->data_loop = pw_data_loop_get_loop(impl->data_loop_impl);
+	this->data_loop = pw_data_loop_get_loop(impl->data_loops[0].impl);
 	this->data_system = this->data_loop->system;
 	this->main_loop = main_loop;
 
@@ -303,6 +471,16 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 		goto error_free;
 	}
 
+	impl->incremental = pw_properties_get_bool(properties, "context.graph.incremental", false);
+	if (impl->incremental) {
+		impl->recalc_source = pw_loop_add_event(this->main_loop, on_recalc_graph, impl);
+		if (impl->recalc_source == NULL) {
+			res = -errno;
+			goto error_free;
+		}
+		pw_log_info("%p: using incremental graph recalculation", this);
+	}
+
 	init_plugin_loader(impl);
 
 	this->support[n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_System, this->main_loop->system);
@@ -359,11 +537,13 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 		goto error_free;
 	pw_log_info("%p: parsed %d context.exec items", this, res);
 
-	if ((res = pw_data_loop_start(impl->data_loop_impl)) < 0)
-		goto error_free;
+	for (i = 0; i < impl->n_data_loops; i++) {
+		if ((res = pw_data_loop_start(impl->data_loops[i].impl)) < 0)
+			goto error_free;
 
-	pw_data_loop_invoke(impl->data_loop_impl,
-			do_data_loop_setup, 0, NULL, 0, false, this);
+		pw_data_loop_invoke(impl->data_loops[i].impl,
+				do_data_loop_setup, 0, NULL, 0, false, this);
+	}
 
 	pw_settings_expose(this);
 
@@ -396,6 +576,7 @@ void pw_context_destroy(struct pw_context *context)
 	struct factory_entry *entry;
 	struct pw_impl_metadata *metadata;
 	struct pw_impl_core *core_impl;
+	uint32_t i;
 
 	pw_log_debug("%p: destroy", context);
 	pw_context_emit_destroy(context);
@@ -415,8 +596,8 @@ void pw_context_destroy(struct pw_context *context)
 	spa_list_consume(resource, &context->registry_resource_list, link)
 		pw_resource_destroy(resource);
 
-	if (impl->data_loop_impl)
-		pw_data_loop_stop(impl->data_loop_impl);
+	for (i = 0; i < impl->n_data_loops; i++)
+		pw_data_loop_stop(impl->data_loops[i].impl);
 
 	spa_list_consume(module, &context->module_list, link)
 		pw_impl_module_destroy(module);
@@ -433,12 +614,18 @@ void pw_context_destroy(struct pw_context *context)
 	pw_log_debug("%p: free", context);
 	pw_context_emit_free(context);
 
-	if (impl->data_loop_impl)
-		pw_data_loop_destroy(impl->data_loop_impl);
+	for (i = 0; i < impl->n_data_loops; i++) {
+		pw_data_loop_destroy(impl->data_loops[i].impl);
+		free(impl->data_loops[i].name);
+		free(impl->data_loops[i].class);
+	}
 
 	if (context->pool)
 		pw_mempool_destroy(context->pool);
 
+	if (impl->recalc_source)
+		pw_loop_destroy_source(context->main_loop, impl->recalc_source);
+
 	if (context->work_queue)
 		pw_work_queue_destroy(context->work_queue);
 
@@ -498,7 +685,60 @@ SPA_EXPORT
 struct pw_data_loop *pw_context_get_data_loop(struct pw_context *context)
 {
 	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
-	return impl->data_loop_impl;
+	return impl->data_loops[0].impl;
+}
+
+SPA_EXPORT
+struct pw_data_loop *pw_context_find_data_loop(struct pw_context *context,
+		const struct spa_dict *props)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct data_loop *l = find_data_loop(impl, props);
+	return l ? l->impl : NULL;
+}
+
+SPA_EXPORT
+int pw_context_select_data_loop(struct pw_context *context, struct pw_properties *props)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct data_loop *best = NULL;
+	uint32_t i, count, best_count = UINT32_MAX;
+	const char *class;
+
+	if (pw_properties_get(props, PW_KEY_NODE_LOOP_NAME) != NULL)
+		return 0;
+
+	/* placement is opt-in, without a class the node runs on the
+	 * default loop */
+	if ((class = pw_properties_get(props, PW_KEY_NODE_LOOP_CLASS)) == NULL)
+		return 0;
+
+	/* with only one loop, everything runs on the default loop */
+	if (impl->n_data_loops < 2)
+		return 0;
+
+	/* place the node on the loop of the class with the least nodes so
+	 * that independent nodes of a graph can run concurrently */
+	for (i = 0; i < impl->n_data_loops; i++) {
+		struct data_loop *l = &impl->data_loops[i];
+
+		if (!spa_streq(l->class, class))
+			continue;
+
+		count = count_loop_nodes(context, l->impl);
+		if (count < best_count) {
+			best = l;
+			best_count = count;
+		}
+	}
+	if (best == NULL) {
+		pw_log_warn("%p: no data loop with class '%s'", context, class);
+		return -ENOENT;
+	}
+	pw_log_debug("%p: selected data loop '%s' with %u nodes", context,
+			best->name, best_count);
+
+	return pw_properties_set(props, PW_KEY_NODE_LOOP_NAME, best->name);
 }
 
 SPA_EXPORT
@@ -1175,7 +1415,87 @@ static uint32_t find_best_rate(const uint32_t *rates, uint32_t n_rates, uint32_t
 	return def;
 }
 
-/* here we evaluate the complete state of the graph.
+static inline void add_to_region(struct spa_list *queue, struct pw_impl_node *n)
+{
+	if (n == NULL || n->recalc_region)
+		return;
+	n->recalc_region = true;
+	spa_list_append(queue, &n->region_link);
+}
+
+/* Collect the part of the graph that needs to be evaluated again into region.
+ *
+ * When full is set, all nodes are added. Else we start from the nodes that
+ * were marked dirty and add everything that can influence their scheduling:
+ * their driver, the followers of drivers, the peers of all links (prepared or
+ * not) and the nodes in the same (link) groups. The region is a set of
+ * complete driver groups and the result of collect_nodes() from any node in the
+ * region stays inside the region.
+ *
+ * Returns the number of nodes in the region, n_total is set to the total
+ * number of nodes in the graph.
+ */
+static uint32_t collect_region(struct pw_context *context, bool full,
+		struct spa_list *region, uint32_t *n_total)
+{
+	struct spa_list queue;
+	struct pw_impl_node *n, *t;
+	struct pw_impl_port *p;
+	struct pw_impl_link *l;
+	uint32_t count = 0, total = 0;
+
+	spa_list_init(&queue);
+	spa_list_for_each(n, &context->node_list, link) {
+		total++;
+		if (full || n->recalc_dirty)
+			add_to_region(&queue, n);
+		n->recalc_dirty = false;
+	}
+	*n_total = total;
+
+	spa_list_consume(n, &queue, region_link) {
+		spa_list_remove(&n->region_link);
+		spa_list_append(region, &n->region_link);
+		count++;
+
+		if (full)
+			continue;
+
+		add_to_region(&queue, n->driver_node);
+		spa_list_for_each(t, &n->follower_list, follower_link)
+			add_to_region(&queue, t);
+
+		spa_list_for_each(p, &n->input_ports, link)
+			spa_list_for_each(l, &p->links, input_link)
+				add_to_region(&queue, l->output->node);
+		spa_list_for_each(p, &n->output_ports, link)
+			spa_list_for_each(l, &p->links, output_link)
+				add_to_region(&queue, l->input->node);
+
+		if (n->groups != NULL || n->link_groups != NULL) {
+			spa_list_for_each(t, &context->node_list, link) {
+				if (t->recalc_region)
+					continue;
+				if (pw_strv_find_common(t->groups, n->groups) < 0 &&
+				    pw_strv_find_common(t->link_groups, n->link_groups) < 0)
+					continue;
+				add_to_region(&queue, t);
+			}
+		}
+	}
+	return count;
+}
+
+static void clear_region(struct spa_list *region)
+{
+	struct pw_impl_node *n;
+	spa_list_consume(n, region, region_link) {
+		spa_list_remove(&n->region_link);
+		n->recalc_region = false;
+	}
+}
+
+/* here we evaluate the state of the graph.
  *
  * It roughly operates in 3 stages:
  *
@@ -1189,20 +1509,30 @@ static uint32_t find_best_rate(const uint32_t *rates, uint32_t n_rates, uint32_t
  * 3. go over all drivers again, collect the quantum/rate of all followers, select
  *    the desired final value and activate the followers and then the driver.
  *
- * A complete graph evaluation is performed for each change that is made to the
+ * A graph evaluation is performed for each change that is made to the
  * graph, such as making/destroying links, adding/removing nodes, property changes such
  * as quantum/rate changes or metadata changes.
+ *
+ * Normally the complete graph is evaluated. In incremental mode, only the
+ * region around the changed nodes (see collect_region()) is evaluated. The
+ * drivers outside of the region keep their followers and state, we only look
+ * at them to select the target driver for unassigned nodes. When the target
+ * driver changes or a driver needs to be reconfigured, we fall back to a
+ * complete evaluation.
  */
-int pw_context_recalc_graph(struct pw_context *context, const char *reason)
+static int recalc_graph(struct pw_context *context, const char *reason,
+		bool full, uint32_t n_requests)
 {
 	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
 	struct settings *settings = &context->settings;
 	struct pw_impl_node *n, *s, *target, *fallback;
 	const uint32_t *rates;
 	uint32_t max_quantum, min_quantum, def_quantum, lim_quantum, rate_quantum;
-	uint32_t n_rates, def_rate;
-	bool freewheel = false, global_force_rate, global_force_quantum;
-	struct spa_list collect;
+	uint32_t n_rates, def_rate, n_region, n_total;
+	bool freewheel = false, global_force_rate, global_force_quantum, target_used;
+	struct spa_list collect, region;
+	struct timespec ts_start, ts_end;
+	uint64_t elapsed;
 
 	pw_log_info("%p: busy:%d reason:%s", context, impl->recalc, reason);
 
@@ -1211,11 +1541,19 @@ int pw_context_recalc_graph(struct pw_context *context, const char *reason)
 		return -EBUSY;
 	}
 
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+	spa_list_init(&region);
+
 again:
 	impl->recalc = true;
+	target_used = false;
+
+	n_region = collect_region(context, full, &region, &n_total);
+	if (n_region == 0)
+		goto done;
 
 	/* clean up the flags first */
-	spa_list_for_each(n, &context->node_list, link) {
+	spa_list_for_each(n, &region, region_link) {
 		n->visited = false;
 		n->checked = 0;
 		n->runnable = n->always_process && n->active;
@@ -1236,11 +1574,19 @@ again:
 		if (n->exported)
 			continue;
 
-		if (!n->visited) {
+		if (n->recalc_region && !n->visited) {
 			spa_list_init(&collect);
 			collect_nodes(context, n, &collect);
 			move_to_driver(context, &collect, n);
 		}
+		/* remember the runnable state of the collected driver. The
+		 * drivers outside of the region keep the state of the last
+		 * recalc that collected them, which is also what a complete
+		 * evaluation would find. The runnable flag itself is changed
+		 * again when we move unassigned nodes to the target. */
+		if (n->recalc_region)
+			n->collect_runnable = n->runnable;
+
 		/* from now on we are only interested in active driving nodes
 		 * with a driver_priority. We're going to see if there are
 		 * active followers. */
@@ -1251,7 +1597,7 @@ again:
 		if (fallback == NULL)
 			fallback = n;
 
-		if (!n->runnable)
+		if (!n->collect_runnable)
 			continue;
 
 		spa_list_for_each(s, &n->follower_list, follower_link) {
@@ -1272,6 +1618,16 @@ again:
 	if (target == NULL)
 		target = fallback;
 
+	if (!full && target != impl->last_target) {
+		/* unassigned nodes outside of the region might need to move */
+		pw_log_debug("%p: target changed %p -> %p, full recalc", context,
+				impl->last_target, target);
+		clear_region(&region);
+		full = true;
+		goto again;
+	}
+	impl->last_target = target;
+
 	/* update the freewheel status */
 	if (context->freewheeling != freewheel)
 		context_set_freewheel(context, freewheel);
@@ -1281,7 +1637,7 @@ again:
 	 * to either an active driver or the first driver if they are in a
 	 * group that needs a driver. Else we remove them from a driver
 	 * and stop them. */
-	spa_list_for_each(n, &context->node_list, link) {
+	spa_list_for_each(n, &region, region_link) {
 		struct pw_impl_node *t, *driver;
 
 		if (n->exported || n->visited)
@@ -1305,6 +1661,7 @@ again:
 		}
 		if (driver != NULL) {
 			driver->runnable = true;
+			target_used = true;
 			/* driver needed for this group */
 			move_to_driver(context, &collect, driver);
 		} else {
@@ -1329,6 +1686,10 @@ again:
 
 		if (!n->driving || n->exported)
 			continue;
+		/* only the drivers in the region and the target, when we
+		 * moved nodes to it, can have changed followers */
+		if (!n->recalc_region && !(n == target && target_used))
+			continue;
 
 		node_def_quantum = def_quantum;
 		node_min_quantum = min_quantum;
@@ -1524,6 +1885,8 @@ again:
 			if (do_reconfigure) {
 				reconfigure_driver(context, n);
 				/* we might be suspended now and the links need to be prepared again */
+				clear_region(&region);
+				full = true;
 				goto again;
 			}
 			/* we have a pending change. We place the new values in the
@@ -1563,12 +1926,78 @@ again:
 		/* now that all the followers are ready, start the driver */
 		ensure_state(n, running);
 	}
+	clear_region(&region);
+done:
 	impl->recalc = false;
 	if (impl->recalc_pending) {
 		impl->recalc_pending = false;
+		full = true;
 		goto again;
 	}
 
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	elapsed = SPA_TIMESPEC_TO_NSEC(&ts_end) - SPA_TIMESPEC_TO_NSEC(&ts_start);
+	pw_log_info("%p: %s recalc reason:%s nodes:%u/%u requests:%u time:%"PRIu64"us",
+			context, full ? "full" : "incremental", reason, n_region, n_total,
+			n_requests, (uint64_t)(elapsed / SPA_NSEC_PER_USEC));
+
+	return 0;
+}
+
+static void schedule_recalc(struct impl *impl, const char *reason)
+{
+	impl->recalc_reason = reason;
+	impl->recalc_requests++;
+	pw_loop_signal_event(impl->this.main_loop, impl->recalc_source);
+}
+
+static void on_recalc_graph(void *data, uint64_t count)
+{
+	struct impl *impl = data;
+	const char *reason = impl->recalc_reason;
+	uint32_t n_requests = impl->recalc_requests;
+	bool full = impl->recalc_full;
+
+	impl->recalc_reason = NULL;
+	impl->recalc_requests = 0;
+	impl->recalc_full = false;
+
+	if (n_requests > 0)
+		recalc_graph(&impl->this, reason, full, n_requests);
+}
+
+/* Evaluate the complete graph. In incremental mode, this is deferred to the
+ * next main loop iteration so that multiple changes can be evaluated at once. */
+int pw_context_recalc_graph(struct pw_context *context, const char *reason)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+
+	if (!impl->incremental)
+		return recalc_graph(context, reason, true, 1);
+
+	impl->recalc_full = true;
+	schedule_recalc(impl, reason);
+	return 0;
+}
+
+/* Evaluate the graph after a change to nodes. In incremental mode, only the
+ * nodes and everything that is (or was) scheduled together with them is
+ * evaluated, in the next main loop iteration. Else this is the same as
+ * pw_context_recalc_graph(). */
+int pw_context_recalc_graph_nodes(struct pw_context *context,
+		struct pw_impl_node **nodes, uint32_t n_nodes, const char *reason)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	uint32_t i;
+
+	if (!impl->incremental)
+		return recalc_graph(context, reason, true, 1);
+
+	for (i = 0; i < n_nodes; i++) {
+		if (nodes[i] != NULL)
+			nodes[i]->recalc_dirty = true;
+	}
+	schedule_recalc(impl, reason);
 	return 0;
 }
 
@@ -1614,10 +2043,13 @@ struct spa_handle *pw_context_load_spa_handle(struct pw_context *context,
 		const char *factory_name,
 		const struct spa_dict *info)
 {
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
 	const char *lib;
 	const struct spa_support *support;
-	uint32_t n_support;
+	struct spa_support loop_support[SPA_N_ELEMENTS(context->support)];
+	uint32_t i, n_support;
 	struct spa_handle *handle;
+	struct data_loop *l;
 
 	pw_log_debug("%p: load factory %s", context, factory_name);
 
@@ -1633,6 +2065,20 @@ struct spa_handle *pw_context_load_spa_handle(struct pw_context *context,
 
 	support = pw_context_get_support(context, &n_support);
 
+	/* give the plugin the data loop it was configured to run on */
+	if ((l = find_data_loop(impl, info)) != NULL && l != &impl->data_loops[0]) {
+		struct pw_loop *loop = pw_data_loop_get_loop(l->impl);
+
+		for (i = 0; i < n_support; i++) {
+			loop_support[i] = support[i];
+			if (spa_streq(support[i].type, SPA_TYPE_INTERFACE_DataLoop))
+				loop_support[i].data = loop->loop;
+			else if (spa_streq(support[i].type, SPA_TYPE_INTERFACE_DataSystem))
+				loop_support[i].data = loop->system;
+		}
+		support = loop_support;
+	}
+
 	handle = pw_load_spa_handle(lib, factory_name,
 			info, n_support, support);
 
@@ -1698,9 +2144,10 @@ int pw_context_set_object(struct pw_context *context, const char *type, void *va
 		entry->value = value;
 	}
 	if (spa_streq(type, SPA_TYPE_INTERFACE_ThreadUtils)) {
+		uint32_t i;
 		context->thread_utils = value;
-		if (impl->data_loop_impl)
-			pw_data_loop_set_thread_utils(impl->data_loop_impl,
+		for (i = 0; i < impl->n_data_loops; i++)
+			pw_data_loop_set_thread_utils(impl->data_loops[i].impl,
 					context->thread_utils);
 	}
 	return 0;
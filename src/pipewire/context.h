@@ -125,6 +125,16 @@ struct pw_loop *pw_context_get_main_loop(struct pw_context *context);
 /** get the context data loop. Since 0.3.56 */
 struct pw_data_loop *pw_context_get_data_loop(struct pw_context *context);
 
+/** find the data loop for an object with the given properties. This is the
+ * loop named by PW_KEY_NODE_LOOP_NAME or the default data loop. Since 1.0.4 */
+struct pw_data_loop *pw_context_find_data_loop(struct pw_context *context,
+		const struct spa_dict *props);
+
+/** select the least used data loop of the PW_KEY_NODE_LOOP_CLASS in props
+ * and store its name in PW_KEY_NODE_LOOP_NAME. Nothing is done when a loop
+ * name is already set or when no loop class is given. Since 1.0.4 */
+int pw_context_select_data_loop(struct pw_context *context, struct pw_properties *props);
+
 /** Get the work queue from the context: Since 0.3.26 */
 struct pw_work_queue *pw_context_get_work_queue(struct pw_context *context);
 
@@ -8,6 +8,7 @@
 
 #include "pipewire/log.h"
 #include "pipewire/data-loop.h"
+#include "pipewire/keys.h"
 #include "pipewire/private.h"
 #include "pipewire/thread.h"
 
@@ -108,9 +109,18 @@ static struct pw_data_loop *loop_new(struct pw_loop *loop, const struct spa_dict
 	}
 	this->loop = loop;
 
-	if (props != NULL &&
-	    (str = spa_dict_lookup(props, "loop.cancel")) != NULL)
-		this->cancel = pw_properties_parse_bool(str);
+	this->rt_prio = -1;
+
+	if (props != NULL) {
+		if ((str = spa_dict_lookup(props, "loop.cancel")) != NULL)
+			this->cancel = pw_properties_parse_bool(str);
+		if ((str = spa_dict_lookup(props, SPA_KEY_THREAD_NAME)) != NULL)
+			this->thread_name = strdup(str);
+		if ((str = spa_dict_lookup(props, SPA_KEY_THREAD_AFFINITY)) != NULL)
+			this->affinity = strdup(str);
+		if ((str = spa_dict_lookup(props, PW_KEY_LOOP_RT_PRIO)) != NULL)
+			this->rt_prio = atoi(str);
+	}
 
 	spa_hook_list_init(&this->listener_list);
 
@@ -151,6 +161,8 @@ void pw_data_loop_destroy(struct pw_data_loop *loop)
 
 	spa_hook_list_clean(&loop->listener_list);
 
+	free(loop->thread_name);
+	free(loop->affinity);
 	free(loop);
 }
 
@@ -189,18 +201,23 @@ int pw_data_loop_start(struct pw_data_loop *loop)
 		if ((utils = loop->thread_utils) == NULL)
 			utils = pw_thread_utils_get();
 
-		static const struct spa_dict_item items[] = {
-			{ SPA_KEY_THREAD_NAME, "pw-data-loop" },
-		};
+		struct spa_dict_item items[2];
+		uint32_t n_items = 0;
+
+		items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_THREAD_NAME,
+				loop->thread_name ? loop->thread_name : "pw-data-loop");
+		if (loop->affinity)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_THREAD_AFFINITY,
+					loop->affinity);
 
-		thr = spa_thread_utils_create(utils, &SPA_DICT_INIT_ARRAY(items), do_loop, loop);
+		thr = spa_thread_utils_create(utils, &SPA_DICT_INIT(items, n_items), do_loop, loop);
 		loop->thread = (pthread_t)thr;
 		if (thr == NULL) {
 			pw_log_error("%p: can't create thread: %m", loop);
 			loop->running = false;
 			return -errno;
 		}
-		spa_thread_utils_acquire_rt(utils, thr, -1);
+		spa_thread_utils_acquire_rt(utils, thr, loop->rt_prio);
 	}
 	return 0;
 }
@@ -11,6 +11,7 @@
 #include <spa/pod/parser.h>
 #include <spa/pod/compare.h>
 #include <spa/param/param.h>
+#include <spa/param/props.h>
 #include <spa/debug/types.h>
 
 #include "pipewire/impl-link.h"
@@ -98,7 +99,8 @@ static void pw_node_peer_activate(struct pw_node_peer *peer)
 	if (peer->active_count++ == 0) {
 		spa_list_append(&peer->output->rt.target_list, &peer->target.link);
 		if (!peer->target.active && peer->output->rt.driver_target.node != NULL) {
-			state->required++;
+			/* the input node can run in another loop */
+			SPA_ATOMIC_INC(state->required);
 			peer->target.active = true;
 		}
 	}
@@ -115,7 +117,7 @@ static void pw_node_peer_deactivate(struct pw_node_peer *peer)
 		spa_list_remove(&peer->target.link);
 
 		if (peer->target.active) {
-			state->required--;
+			SPA_ATOMIC_DEC(state->required);
 			peer->target.active = false;
 		}
 	}
@@ -164,6 +166,12 @@ static inline void output_set_busy_id(struct pw_impl_link *link, uint32_t id)
 		pw_log_error("%s: invalid busy count:%d", link->name, link->output->busy_count);
 }
 
+static void recalc_link_nodes(struct pw_impl_link *link, const char *reason)
+{
+	struct pw_impl_node *nodes[2] = { link->output->node, link->input->node };
+	pw_context_recalc_graph_nodes(link->context, nodes, 2, reason);
+}
+
 static void link_update_state(struct pw_impl_link *link, enum pw_link_state state, int res, char *error)
 {
 	struct impl *impl = SPA_CONTAINER_OF(link, struct impl, this);
@@ -210,11 +218,11 @@ static void link_update_state(struct pw_impl_link *link, enum pw_link_state stat
 	if (old < PW_LINK_STATE_PAUSED && state == PW_LINK_STATE_PAUSED) {
 		link->prepared = true;
 		link->preparing = false;
-		pw_context_recalc_graph(link->context, "link prepared");
+		recalc_link_nodes(link, "link prepared");
 	} else if (old == PW_LINK_STATE_PAUSED && state < PW_LINK_STATE_PAUSED) {
 		link->prepared = false;
 		link->preparing = false;
-		pw_context_recalc_graph(link->context, "link unprepared");
+		recalc_link_nodes(link, "link unprepared");
 	} else if (state == PW_LINK_STATE_INIT) {
 		link->prepared = false;
 		link->preparing = false;
@@ -1308,6 +1316,32 @@ static const struct pw_global_events input_global_events = {
 	.permissions_changed = input_permissions_changed,
 };
 
+static void setup_mix_props(struct pw_impl_link *this)
+{
+	const char *volume, *mute;
+	uint8_t buffer[256];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod_frame f;
+	int res;
+
+	volume = pw_properties_get(this->properties, PW_KEY_LINK_VOLUME);
+	mute = pw_properties_get(this->properties, PW_KEY_LINK_MUTE);
+	if (volume == NULL && mute == NULL)
+		return;
+
+	spa_pod_builder_push_object(&b, &f, SPA_TYPE_OBJECT_Props, SPA_PARAM_Props);
+	if (volume != NULL)
+		spa_pod_builder_add(&b,
+				SPA_PROP_volume, SPA_POD_Float(pw_properties_parse_float(volume)), 0);
+	if (mute != NULL)
+		spa_pod_builder_add(&b,
+				SPA_PROP_mute, SPA_POD_Bool(pw_properties_parse_bool(mute)), 0);
+
+	if ((res = pw_impl_port_set_mix_props(this->input, &this->rt.in_mix,
+			spa_pod_builder_pop(&b, &f))) < 0)
+		pw_log_warn("%p: can't set mixer props: %s", this, spa_strerror(res));
+}
+
 SPA_EXPORT
 struct pw_impl_link *pw_context_create_link(struct pw_context *context,
 			    struct pw_impl_port *output,
@@ -1391,6 +1425,8 @@ struct pw_impl_link *pw_context_create_link(struct pw_context *context,
 	if ((res = pw_impl_port_init_mix(input, &this->rt.in_mix)) < 0)
 		goto error_input_mix;
 
+	setup_mix_props(this);
+
 	pw_impl_port_add_listener(input, &impl->input_port_listener, &input_port_events, impl);
 	pw_impl_node_add_listener(input_node, &impl->input_node_listener, &input_node_events, impl);
 	pw_global_add_listener(input->global, &impl->input_global_listener, &input_global_events, impl);
@@ -1566,6 +1602,7 @@ void pw_impl_link_destroy(struct pw_impl_link *link)
 {
 	struct impl *impl = SPA_CONTAINER_OF(link, struct impl, this);
 	bool was_prepared = link->prepared;
+	struct pw_impl_node *nodes[2] = { link->output->node, link->input->node };
 
 	pw_log_debug("%p: destroy", impl);
 	pw_log_info("(%s) destroy", link->name);
@@ -1592,7 +1629,7 @@ void pw_impl_link_destroy(struct pw_impl_link *link)
 	}
 
 	if (was_prepared)
-		pw_context_recalc_graph(link->context, "link destroy");
+		pw_context_recalc_graph_nodes(link->context, nodes, 2, "link destroy");
 
 	pw_log_debug("%p: free", impl);
 	pw_impl_link_emit_free(link);
@@ -26,6 +26,9 @@ PW_LOG_TOPIC_EXTERN(log_node);
 #define PW_LOG_TOPIC_DEFAULT log_node
 
 #define DEFAULT_SYNC_TIMEOUT  ((uint64_t)(5 * SPA_NSEC_PER_SEC))
+/* upper bound for node.spin-nsec, the driver does not service the other
+ * sources of its data loop while it spins */
+#define MAX_SPIN_NSEC  ((uint64_t)(200 * SPA_NSEC_PER_USEC))
 
 /** \cond */
 struct impl {
@@ -70,25 +73,25 @@ struct resource_data {
 
 /** \endcond */
 
-/* Called from the node data loop when a node needs to be scheduled by
- * the given driver. 3 things needs to happen:
+/* A node that needs to be scheduled by a driver is added in two steps.
+ * Each step only changes the lists of the loop it runs in:
  *
- * - the node is added to the driver target list and the required state
- *   is incremented. This makes sure the node is woken up when the driver
- *   starts a new cycle.
- * - the node needs to trigger the driver when it completes. This means
- *   the driver is added to the target list.
- * - the node targets (including the driver we added above) have their
+ * - add_to_driver(), called from the driver data loop, adds the node to
+ *   the driver target list and increments the required state of the node.
+ *   This makes sure the node is woken up when the driver starts a new cycle.
+ * - add_driver_target(), called from the node data loop, adds the driver
+ *   to the node target list so that the node triggers the driver when it
+ *   completes. The node targets (including the driver) then have their
  *   required state incremented.
  *
- * This code is called from the data-loop to ensure synchronization
+ * The required state of an activation can be changed from the loops of
+ * all the nodes that trigger it and is only updated atomically.
  */
-static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
+static void add_to_driver(struct pw_impl_node *this, struct pw_impl_node *driver)
 {
-	struct pw_node_activation_state *dstate, *nstate;
-	struct pw_node_target *t;
+	struct pw_node_activation_state *nstate;
 
-	if (this->exported)
+	if (this->exported || this->rt.target.active)
 		return;
 
 	pw_log_trace("%p: add to driver %p %p %p", this, driver,
@@ -97,10 +100,17 @@ static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
 	/* let the driver trigger us as part of the processing cycle */
 	spa_list_append(&driver->rt.target_list, &this->rt.target.link);
 	nstate = &this->rt.target.activation->state[0];
-	if (!this->rt.target.active) {
-		nstate->required++;
-		this->rt.target.active = true;
-	}
+	SPA_ATOMIC_INC(nstate->required);
+	this->rt.target.active = true;
+}
+
+static void add_driver_target(struct pw_impl_node *this, struct pw_impl_node *driver)
+{
+	struct pw_node_activation_state *dstate;
+	struct pw_node_target *t;
+
+	if (this->exported || this->rt.driver_target.activation != NULL)
+		return;
 
 	/* trigger the driver when we complete */
 	copy_target(&this->rt.driver_target, &driver->rt.target);
@@ -111,51 +121,80 @@ static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
 	spa_list_for_each(t, &this->rt.target_list, link) {
 		dstate = &t->activation->state[0];
 		if (!t->active) {
-			dstate->required++;
+			SPA_ATOMIC_INC(dstate->required);
 			t->active = true;
 		}
-		pw_log_trace("%p: driver state:%p pending:%d/%d, node state:%p pending:%d/%d",
-				this, dstate, dstate->pending, dstate->required,
-				nstate, nstate->pending, nstate->required);
+		pw_log_trace("%p: driver state:%p pending:%d/%d", this,
+				dstate, dstate->pending, dstate->required);
 	}
 }
 
-/* called from the data loop and undoes the changes done in add_node.  */
-static void remove_node(struct pw_impl_node *this)
+/* called from the driver data loop and undoes add_to_driver() */
+static void remove_from_driver(struct pw_impl_node *this)
 {
-	struct pw_node_activation_state *dstate, *nstate;
-	struct pw_node_target *t;
+	struct pw_node_activation_state *nstate;
 
-	if (this->exported)
+	if (this->exported || !this->rt.target.active)
 		return;
 
-	pw_log_trace("%p: remove from driver %s %p %p",
-			this, this->rt.driver_target.name,
-			this->rt.driver_target.activation, this->rt.target.activation);
+	pw_log_trace("%p: remove from driver %p", this, this->rt.target.activation);
 
 	spa_list_remove(&this->rt.target.link);
-
 	nstate = &this->rt.target.activation->state[0];
-	if (this->rt.target.active) {
-		nstate->required--;
-		this->rt.target.active = false;
-	}
+	SPA_ATOMIC_DEC(nstate->required);
+	this->rt.target.active = false;
+}
+
+/* called from the node data loop and undoes add_driver_target() */
+static void remove_driver_target(struct pw_impl_node *this)
+{
+	struct pw_node_activation_state *dstate;
+	struct pw_node_target *t;
+
+	if (this->exported || this->rt.driver_target.activation == NULL)
+		return;
+
+	pw_log_trace("%p: remove driver target %s %p", this,
+			this->rt.driver_target.name, this->rt.driver_target.activation);
 
 	spa_list_for_each(t, &this->rt.target_list, link) {
+		/* a driver is in its own target list, remove_from_driver()
+		 * takes care of that one */
+		if (t == &this->rt.target)
+			continue;
 		dstate = &t->activation->state[0];
 		if (t->active) {
-			dstate->required--;
+			SPA_ATOMIC_DEC(dstate->required);
 			t->active = false;
 		}
-		pw_log_trace("%p: driver state:%p pending:%d/%d, node state:%p pending:%d/%d",
-				this, dstate, dstate->pending, dstate->required,
-				nstate, nstate->pending, nstate->required);
+		pw_log_trace("%p: driver state:%p pending:%d/%d", this,
+				dstate, dstate->pending, dstate->required);
 	}
 	spa_list_remove(&this->rt.driver_target.link);
 
 	spa_zero(this->rt.driver_target);
 }
 
+/* called from the data loop when the node and its driver share the loop */
+static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
+{
+	add_to_driver(this, driver);
+	add_driver_target(this, driver);
+}
+
+static void remove_node(struct pw_impl_node *this)
+{
+	remove_driver_target(this);
+	remove_from_driver(this);
+}
+
+/* When the node runs in another data loop than its driver, the two steps
+ * run in their own loop with an extra invoke. */
+static inline bool same_loop(struct pw_impl_node *this, struct pw_impl_node *driver)
+{
+	return this->data_loop == driver->data_loop;
+}
+
 static int
 do_node_add(struct spa_loop *loop, bool async, uint32_t seq,
 		const void *data, size_t size, void *user_data)
@@ -176,7 +215,8 @@ do_node_add(struct spa_loop *loop, bool async, uint32_t seq,
 		/* remote nodes have their source added in client-node instead */
 		if (!this->remote)
 			spa_loop_add_source(loop, &this->source);
-		add_node(this, driver);
+		if (same_loop(this, driver))
+			add_node(this, driver);
 	}
 	return 0;
 }
@@ -189,12 +229,69 @@ do_node_remove(struct spa_loop *loop, bool async, uint32_t seq,
 	if (this->added) {
 		if (!this->remote)
 			spa_loop_remove_source(loop, &this->source);
-		remove_node(this);
+		if (same_loop(this, this->driver_node))
+			remove_node(this);
+		else
+			remove_driver_target(this);
 		this->added = false;
 	}
 	return 0;
 }
 
+/* called from the driver loop */
+static int
+do_driver_add(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_node *this = user_data;
+	if (this->added)
+		add_to_driver(this, this->driver_node);
+	return 0;
+}
+
+/* called from the driver loop */
+static int
+do_driver_remove(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_node *this = user_data;
+	remove_from_driver(this);
+	return 0;
+}
+
+/* called from the node loop */
+static int
+do_driver_target_add(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_node *this = user_data;
+	if (this->added)
+		add_driver_target(this, this->driver_node);
+	return 0;
+}
+
+/* called from the main thread. With different loops, the node is first
+ * added to the driver so that it runs before it signals the driver. */
+static void node_add(struct pw_impl_node *this)
+{
+	pw_loop_invoke(this->data_loop, do_node_add, 1, NULL, 0, true, this);
+	if (!same_loop(this, this->driver_node)) {
+		pw_loop_invoke(this->driver_node->data_loop,
+				do_driver_add, 1, NULL, 0, true, this);
+		pw_loop_invoke(this->data_loop,
+				do_driver_target_add, 1, NULL, 0, true, this);
+	}
+}
+
+/* called from the main thread */
+static void node_remove(struct pw_impl_node *this)
+{
+	pw_loop_invoke(this->data_loop, do_node_remove, 1, NULL, 0, true, this);
+	if (!same_loop(this, this->driver_node))
+		pw_loop_invoke(this->driver_node->data_loop,
+				do_driver_remove, 1, NULL, 0, true, this);
+}
+
 static void node_deactivate(struct pw_impl_node *this)
 {
 	struct pw_impl_port *port;
@@ -203,7 +300,7 @@ static void node_deactivate(struct pw_impl_node *this)
 	pw_log_debug("%p: deactivate", this);
 
 	/* make sure the node doesn't get woken up while not active */
-	pw_loop_invoke(this->data_loop, do_node_remove, 1, NULL, 0, true, this);
+	node_remove(this);
 
 	spa_list_for_each(port, &this->input_ports, link) {
 		spa_list_for_each(link, &port->links, input_link)
@@ -371,16 +468,15 @@ static void node_update_state(struct pw_impl_node *node, enum pw_node_state stat
 		pw_log_debug("%p: start node driving:%d driver:%d added:%d", node,
 				node->driving, node->driver, node->added);
 
-		if (res >= 0) {
-			pw_loop_invoke(node->data_loop, do_node_add, 1, NULL, 0, true, node);
-		}
+		if (res >= 0)
+			node_add(node);
 		if (node->driving && node->driver) {
 			res = spa_node_send_command(node->node,
 				&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
 			if (res < 0) {
 				state = PW_NODE_STATE_ERROR;
 				error = spa_aprintf("Start error: %s", spa_strerror(res));
-				pw_loop_invoke(node->data_loop, do_node_remove, 1, NULL, 0, true, node);
+				node_remove(node);
 			}
 		}
 		break;
@@ -388,7 +484,7 @@ static void node_update_state(struct pw_impl_node *node, enum pw_node_state stat
 	case PW_NODE_STATE_SUSPENDED:
 	case PW_NODE_STATE_ERROR:
 		if (state != PW_NODE_STATE_IDLE || node->pause_on_idle)
-			pw_loop_invoke(node->data_loop, do_node_remove, 1, NULL, 0, true, node);
+			node_remove(node);
 		break;
 	default:
 		break;
@@ -808,7 +904,7 @@ int pw_impl_node_register(struct pw_impl_node *this,
 		pw_impl_port_register(port, NULL);
 
 	if (this->active)
-		pw_context_recalc_graph(context, "register active node");
+		pw_context_recalc_graph_nodes(context, &this, 1, "register active node");
 
 	return 0;
 
@@ -831,7 +927,8 @@ do_move_nodes(struct spa_loop *loop,
 		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
 	struct impl *impl = user_data;
-	struct pw_impl_node *driver = *(struct pw_impl_node **)data;
+	struct pw_impl_node * const *nodes = data;
+	struct pw_impl_node *old = nodes[0], *driver = nodes[1];
 	struct pw_impl_node *node = &impl->this;
 
 	pw_log_trace("%p: driver:%p->%p", node, node->driver_node, driver);
@@ -843,8 +940,13 @@ do_move_nodes(struct spa_loop *loop,
 	node->target_quantum = node->rt.position->clock.target_duration;
 
 	if (node->added) {
-		remove_node(node);
-		add_node(node, driver);
+		if (same_loop(node, old) && same_loop(node, driver)) {
+			remove_node(node);
+			add_node(node, driver);
+		} else {
+			/* the drivers update their own lists */
+			remove_driver_target(node);
+		}
 	}
 	return 0;
 }
@@ -860,7 +962,7 @@ SPA_EXPORT
 int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driver)
 {
 	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
-	struct pw_impl_node *old = node->driver_node;
+	struct pw_impl_node *old = node->driver_node, *nodes[2];
 	int res;
 	bool was_driving;
 
@@ -901,10 +1003,21 @@ int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driv
 		pw_log_debug("%p: set position: %s", node, spa_strerror(res));
 	}
 
+	nodes[0] = old;
+	nodes[1] = driver;
 	pw_loop_invoke(node->data_loop,
-		       do_move_nodes, SPA_ID_INVALID, &driver, sizeof(struct pw_impl_node *),
+		       do_move_nodes, SPA_ID_INVALID, nodes, sizeof(nodes),
 		       true, impl);
 
+	if (!same_loop(node, old) || !same_loop(node, driver)) {
+		/* the node moves between graphs running in different loops,
+		 * remove it from the old driver and add it to the new driver
+		 * in their loops, then let it trigger the new driver */
+		pw_loop_invoke(old->data_loop, do_driver_remove, 1, NULL, 0, true, node);
+		pw_loop_invoke(driver->data_loop, do_driver_add, 1, NULL, 0, true, node);
+		pw_loop_invoke(node->data_loop, do_driver_target_add, 1, NULL, 0, true, node);
+	}
+
 	pw_impl_node_emit_driver_changed(node, old, driver);
 
 	pw_impl_node_emit_peer_removed(old, node);
@@ -961,9 +1074,9 @@ static void check_properties(struct pw_impl_node *node)
 	if (trigger != node->trigger) {
 		node->trigger = trigger;
 		if (trigger)
-			node->rt.target.activation->state[0].required++;
+			SPA_ATOMIC_INC(node->rt.target.activation->state[0].required);
 		else
-			node->rt.target.activation->state[0].required--;
+			SPA_ATOMIC_DEC(node->rt.target.activation->state[0].required);
 	}
 
 	/* group defines what nodes are scheduled together */
@@ -1006,6 +1119,12 @@ static void check_properties(struct pw_impl_node *node)
 	else
 		node->in_passive = node->out_passive = spa_atob(str);
 
+	/* spinning is only useful for drivers, they wait for the graph to complete */
+	node->rt.spin_nsec = SPA_MIN(pw_properties_get_uint64(node->properties,
+				PW_KEY_NODE_SPIN_NSEC, 0), MAX_SPIN_NSEC);
+	SPA_FLAG_UPDATE(node->rt.target.activation->flags, PW_NODE_ACTIVATION_FLAG_SPIN,
+			node->rt.spin_nsec > 0);
+
 	node->want_driver = pw_properties_get_bool(node->properties, PW_KEY_NODE_WANT_DRIVER, false);
 	node->always_process = pw_properties_get_bool(node->properties, PW_KEY_NODE_ALWAYS_PROCESS, false);
 
@@ -1076,7 +1195,7 @@ static void check_properties(struct pw_impl_node *node)
 			recalc_reason, node->active);
 
 	if (recalc_reason != NULL && node->active)
-		pw_context_recalc_graph(context, recalc_reason);
+		pw_context_recalc_graph_nodes(context, &node, 1, recalc_reason);
 }
 
 static const char *str_status(uint32_t status)
@@ -1150,9 +1269,21 @@ static inline uint64_t get_time_ns(struct spa_system *system)
 	return SPA_TIMESPEC_TO_NSEC(&ts);
 }
 
+/* wake up a node. When the node is spinning on its wakeup word, it is
+ * woken by changing the word and we can skip the eventfd write and the
+ * poll wakeup of the node. */
+static inline bool node_wakeup_spinning(struct pw_node_activation *a)
+{
+	return SPA_UNLIKELY(a->flags & PW_NODE_ACTIVATION_FLAG_SPIN) &&
+		SPA_ATOMIC_CAS(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SPIN,
+				PW_NODE_ACTIVATION_WAKEUP_WOKEN);
+}
+
 static inline void node_trigger(struct pw_impl_node *this)
 {
 	pw_log_trace_fp("node %p %s", this, this->name);
+	if (node_wakeup_spinning(this->rt.target.activation))
+		return;
 	if (SPA_UNLIKELY(spa_system_eventfd_write(this->data_system, this->source.fd, 1) < 0))
 		pw_log_warn("node %p: write failed %m", this);
 }
@@ -1174,6 +1305,8 @@ static inline int trigger_targets(struct pw_impl_node *this, int status, uint64_
 		if (pw_node_activation_state_dec(state)) {
 			a->status = PW_NODE_ACTIVATION_TRIGGERED;
 			a->signal_time = nsec;
+			if (node_wakeup_spinning(a))
+				continue;
 			if (SPA_UNLIKELY(spa_system_eventfd_write(t->system, t->fd, 1) < 0))
 				pw_log_warn("node %p: write failed %m", this);
 		}
@@ -1272,6 +1405,34 @@ static inline int process_node(void *data)
 	return status;
 }
 
+/* called from the data thread of a driver after it started the graph. When
+ * all followers run in other threads, spin for a short while on the wakeup
+ * word so that the last node of the graph does not need to wake us up with
+ * the eventfd. Returns true when the graph completed while spinning, the
+ * eventfd was then not signaled and the caller needs to complete the cycle. */
+static inline bool node_spin_wait(struct pw_impl_node *this)
+{
+	struct pw_node_activation *a = this->rt.target.activation;
+	uint64_t end;
+
+	SPA_ATOMIC_STORE(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SPIN);
+
+	end = get_time_ns(this->data_system) + this->rt.spin_nsec;
+	while (SPA_ATOMIC_LOAD(a->wakeup) == PW_NODE_ACTIVATION_WAKEUP_SPIN &&
+	    SPA_ATOMIC_LOAD(a->state[0].pending) > 0 &&
+	    get_time_ns(this->data_system) < end)
+		SPA_CPU_PAUSE();
+
+	/* when this fails, a peer woke us while we were spinning */
+	if (SPA_ATOMIC_CAS(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SPIN,
+				PW_NODE_ACTIVATION_WAKEUP_SLEEP))
+		return false;
+
+	SPA_ATOMIC_STORE(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SLEEP);
+	pw_log_trace_fp("%p: %s woken while spinning", this, this->name);
+	return true;
+}
+
 int pw_impl_node_trigger(struct pw_impl_node *node)
 {
 	struct pw_node_activation *a = node->rt.target.activation;
@@ -1377,6 +1538,10 @@ struct pw_impl_node *pw_context_create_node(struct pw_context *context,
 
 	this->properties = properties;
 
+	this->data_loop = pw_data_loop_get_loop(
+			pw_context_find_data_loop(context, &properties->dict));
+	this->data_system = this->data_loop->system;
+
 	/* the eventfd used to signal the node */
 	if ((res = spa_system_eventfd_create(this->data_system,
 					SPA_FD_CLOEXEC | SPA_FD_NONBLOCK)) < 0)
@@ -1573,7 +1738,7 @@ static void node_info(void *data, const struct spa_node_info *info)
 		emit_params(node, changed_ids, n_changed_ids);
 
 	if (flags_changed)
-		pw_context_recalc_graph(node->context, "node flags changed");
+		pw_context_recalc_graph_nodes(node->context, &node, 1, "node flags changed");
 }
 
 static void node_port_info(void *data, enum spa_direction direction, uint32_t port_id,
@@ -1766,6 +1931,7 @@ static int node_ready(void *data, int status)
 	struct pw_node_target *t, *reposition_target = NULL;;
 	struct pw_impl_port *p;
 	uint64_t nsec;
+	bool spin = false;
 
 	pw_log_trace_fp("%p: ready driver:%d exported:%d %p status:%d added:%d", node,
 			node->driver, node->exported, driver, status, node->added);
@@ -1819,6 +1985,7 @@ again:
 		all_ready = sync_type == SYNC_CHECK;
 		update_sync = !all_ready;
 		target_sync = sync_type == SYNC_START ? true : false;
+		spin = node->rt.spin_nsec > 0;
 
 		spa_list_for_each(t, &driver->rt.target_list, link) {
 			struct pw_node_activation *ta = t->activation;
@@ -1839,6 +2006,11 @@ again:
 
 			min_timeout = SPA_MIN(min_timeout, ta->sync_timeout);
 
+			/* followers in our own thread can't complete while we spin */
+			if (t->node != NULL && t->node != node && !t->node->remote &&
+			    t->node->data_loop == node->data_loop)
+				spin = false;
+
 			if (SPA_UNLIKELY(update_sync)) {
 				ta->pending_sync = target_sync;
 				ta->pending_new_pos = target_sync;
@@ -1882,7 +2054,12 @@ again:
 			spa_node_process_fast(p->mix);
 	}
 	/* now signal all the nodes we drive */
-	return trigger_targets(node, status, nsec);
+	trigger_targets(node, status, nsec);
+
+	if (SPA_UNLIKELY(spin) && node_spin_wait(node))
+		process_node(node);
+
+	return 0;
 }
 
 static int node_reuse_buffer(void *data, uint32_t port_id, uint32_t buffer_id)
@@ -2465,10 +2642,10 @@ int pw_impl_node_set_active(struct pw_impl_node *node, bool active)
 		pw_impl_node_emit_active_changed(node, active);
 
 		if (node->registered)
-			pw_context_recalc_graph(node->context,
+			pw_context_recalc_graph_nodes(node->context, &node, 1,
 					active ? "node activate" : "node deactivate");
 		else if (!active && node->exported)
-			pw_loop_invoke(node->data_loop, do_node_remove, 1, NULL, 0, true, node);
+			node_remove(node);
 	}
 	return 0;
 }
@@ -331,6 +331,9 @@ int pw_impl_port_release_mix(struct pw_impl_port *port, struct pw_impl_port_mix
 	spa_list_remove(&mix->link);
 	port->n_mix--;
 
+	free(mix->props);
+	mix->props = NULL;
+
 	pw_log_debug("%p: release mix %d %d.%d", port,
 			port->n_mix, port->port_id, mix->port.port_id);
 
@@ -691,8 +694,13 @@ int pw_impl_port_set_mix(struct pw_impl_port *port, struct spa_node *node, uint3
 	port->mix = node;
 
 	if (port->mix) {
-		spa_list_for_each(mix, &port->mix_list, link)
+		spa_list_for_each(mix, &port->mix_list, link) {
 			spa_node_add_port(port->mix, mix->port.direction, mix->port.port_id, NULL);
+			if (mix->props != NULL)
+				spa_node_port_set_param(port->mix,
+						mix->port.direction, mix->port.port_id,
+						SPA_PARAM_Props, 0, mix->props);
+		}
 
 		spa_node_port_set_io(port->mix,
 			     pw_direction_reverse(port->direction), 0,
@@ -702,6 +710,27 @@ int pw_impl_port_set_mix(struct pw_impl_port *port, struct spa_node *node, uint3
 	return 0;
 }
 
+SPA_EXPORT
+int pw_impl_port_set_mix_props(struct pw_impl_port *port, struct pw_impl_port_mix *mix,
+		const struct spa_pod *props)
+{
+	struct spa_pod *p = NULL;
+	int res;
+
+	if (props != NULL && (p = spa_pod_copy(props)) == NULL)
+		return -errno;
+
+	free(mix->props);
+	mix->props = p;
+
+	res = spa_node_port_set_param(port->mix,
+			mix->port.direction, mix->port.port_id,
+			SPA_PARAM_Props, 0, mix->props);
+
+	/* the props are set again when the port gets a real mixer */
+	return res == -ENOTSUP ? 0 : res;
+}
+
 static int setup_mixer(struct pw_impl_port *port, const struct spa_pod *param)
 {
 	uint32_t media_type, media_subtype;
@@ -1728,10 +1757,13 @@ int pw_impl_port_set_param(struct pw_impl_port *port, uint32_t id, uint32_t flag
 			setup_mixer(port, param);
 		}
 
-		spa_list_for_each(mix, &port->mix_list, link) {
-			spa_node_port_set_param(port->mix,
-				mix->port.direction, mix->port.port_id,
-				id, flags, param);
+		/* Props of the mixer ports are per link, see pw_impl_port_set_mix_props() */
+		if (id != SPA_PARAM_Props) {
+			spa_list_for_each(mix, &port->mix_list, link) {
+				spa_node_port_set_param(port->mix,
+					mix->port.direction, mix->port.port_id,
+					id, flags, param);
+			}
 		}
 		spa_node_port_set_param(port->mix,
 				pw_direction_reverse(port->direction), 0,
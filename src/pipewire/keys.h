@@ -83,6 +83,14 @@ extern "C" {
 								  *  all CPU optimizations */
 #define PW_KEY_CPU_CORES		"cpu.cores"		/**< number of cores */
 
+/* loop */
+#define PW_KEY_LOOP_NAME		"loop.name"		/**< the name of a data loop. Since 1.0.4 */
+#define PW_KEY_LOOP_CLASS		"loop.class"		/**< the class of a data loop, default
+								  *  "data.rt". Since 1.0.4 */
+#define PW_KEY_LOOP_RT_PRIO		"loop.rt-prio"		/**< realtime priority of the data loop
+								  *  thread, -1 to use the default.
+								  *  Since 1.0.4 */
+
 /* priorities */
 #define PW_KEY_PRIORITY_SESSION		"priority.session"	/**< priority in session manager */
 #define PW_KEY_PRIORITY_DRIVER		"priority.driver"	/**< priority to be a driver */
@@ -181,6 +189,18 @@ extern "C" {
 								  *  nodes with the same link-group. Can be an
 								  *  array of group names. */
 #define PW_KEY_NODE_NETWORK		"node.network"		/**< the node is on a network */
+#define PW_KEY_NODE_LOOP_NAME		"node.loop.name"	/**< the name of the data loop that runs the
+								  *  node, see context.data-loops.
+								  *  Since 1.0.4 */
+#define PW_KEY_NODE_LOOP_CLASS		"node.loop.class"	/**< the class of the data loop to place
+								  *  the node on when no node.loop.name is
+								  *  given. Since 1.0.4 */
+#define PW_KEY_NODE_SPIN_NSEC		"node.spin-nsec"	/**< when driving, the time in nanoseconds to
+								  *  busy-wait for the graph to complete before
+								  *  sleeping in the data loop, at most 200000.
+								  *  Only used when all followers run in other
+								  *  threads, such as clients or other data
+								  *  loops. Since 1.0.4 */
 #define PW_KEY_NODE_TRIGGER		"node.trigger"		/**< the node is not scheduled automatically
 								  *   based on the dependencies in the graph
 								  *   but it will be triggered explicitly. */
@@ -218,6 +238,10 @@ extern "C" {
 #define PW_KEY_LINK_FEEDBACK		"link.feedback"		/**< indicate that a link is a feedback
 								  *  link and the target will receive data
 								  *  in the next cycle */
+#define PW_KEY_LINK_VOLUME		"link.volume"		/**< the volume of the link in the mixer
+								  *  of the input port, since 1.0.4 */
+#define PW_KEY_LINK_MUTE		"link.mute"		/**< mute the link in the mixer of the
+								  *  input port, since 1.0.4 */
 
 /** device properties */
 #define PW_KEY_DEVICE_ID		"device.id"		/**< device id */
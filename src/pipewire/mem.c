@@ -18,6 +18,7 @@
 #include <spa/utils/list.h>
 #include <spa/buffer/buffer.h>
 
+#include <pipewire/array.h>
 #include <pipewire/log.h>
 #include <pipewire/map.h>
 #include <pipewire/mem.h>
@@ -78,6 +79,17 @@ static inline int memfd_create(const char *name, unsigned int flags)
 #define pw_mempool_emit_added(p,b)	pw_mempool_emit(p, added, 0, b)
 #define pw_mempool_emit_removed(p,b)	pw_mempool_emit(p, removed, 0, b)
 
+#define HASH_MIN_BUCKETS	16
+
+/* chained hash table of spa_list links with uint32_t keys */
+struct hash_table {
+	struct spa_list *buckets;
+	uint32_t mask;
+	uint32_t count;
+};
+
+typedef uint32_t (*hash_key_func_t) (struct spa_list *link);
+
 struct mempool {
 	struct pw_mempool this;
 
@@ -86,12 +98,17 @@ struct mempool {
 	struct pw_map map;		/* map memblock to id */
 	struct spa_list blocks;		/* list of memblock */
 	uint32_t pagesize;
+
+	struct hash_table fds;		/* memblock by fd */
+	struct hash_table tags;		/* memmap by tag[0] */
+	struct pw_array mappings;	/* struct mapping * sorted by ptr */
 };
 
 struct memblock {
 	struct pw_memblock this;
 	struct spa_list link;		/* link in mempool */
-	struct spa_list mappings;	/* list of struct mapping */
+	struct spa_list fd_link;	/* link in mempool fds */
+	struct spa_list mappings;	/* list of struct mapping, sorted by offset */
 	struct spa_list memmaps;	/* list of struct memmap */
 };
 
@@ -111,8 +128,150 @@ struct memmap {
 	struct pw_memmap this;
 	struct mapping *mapping;
 	struct spa_list link;
+	struct spa_list tag_link;	/* link in mempool tags */
 };
 
+static inline uint32_t hash_u32(uint32_t key)
+{
+	key *= 0x9e3779b1u;
+	return key ^ (key >> 16);
+}
+
+static int hash_init(struct hash_table *t, uint32_t n_buckets)
+{
+	uint32_t i;
+
+	t->buckets = calloc(n_buckets, sizeof(struct spa_list));
+	if (t->buckets == NULL)
+		return -errno;
+	for (i = 0; i < n_buckets; i++)
+		spa_list_init(&t->buckets[i]);
+	t->mask = n_buckets - 1;
+	t->count = 0;
+	return 0;
+}
+
+static void hash_clear(struct hash_table *t)
+{
+	free(t->buckets);
+	t->buckets = NULL;
+}
+
+static inline struct spa_list *hash_bucket(struct hash_table *t, uint32_t key)
+{
+	return &t->buckets[hash_u32(key) & t->mask];
+}
+
+/* double the number of buckets, when this fails we simply keep the
+ * longer chains */
+static void hash_grow(struct hash_table *t, hash_key_func_t key)
+{
+	struct hash_table old = *t;
+	struct spa_list *link;
+	uint32_t i;
+
+	if (hash_init(t, (old.mask + 1) * 2) < 0) {
+		*t = old;
+		return;
+	}
+	for (i = 0; i <= old.mask; i++) {
+		while (!spa_list_is_empty(&old.buckets[i])) {
+			link = old.buckets[i].next;
+			spa_list_remove(link);
+			spa_list_append(hash_bucket(t, key(link)), link);
+		}
+	}
+	t->count = old.count;
+	hash_clear(&old);
+}
+
+static void hash_insert(struct hash_table *t, struct spa_list *link, uint32_t k,
+		hash_key_func_t key)
+{
+	if (t->count >= (t->mask + 1) * 2)
+		hash_grow(t, key);
+	spa_list_append(hash_bucket(t, k), link);
+	t->count++;
+}
+
+static void hash_remove(struct hash_table *t, struct spa_list *link)
+{
+	spa_list_remove(link);
+	t->count--;
+}
+
+static uint32_t block_fd_key(struct spa_list *link)
+{
+	return SPA_CONTAINER_OF(link, struct memblock, fd_link)->this.fd;
+}
+
+static uint32_t memmap_tag_key(struct spa_list *link)
+{
+	return SPA_CONTAINER_OF(link, struct memmap, tag_link)->this.tag[0];
+}
+
+/* find the index of the first mapping with a ptr > ptr */
+static uint32_t mappings_upper_bound(struct mempool *p, const void *ptr)
+{
+	struct mapping **maps = p->mappings.data;
+	uint32_t lo = 0, hi = pw_array_get_len(&p->mappings, struct mapping *);
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+		if ((const uint8_t *)maps[mid]->ptr <= (const uint8_t *)ptr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* add the mapping to the block, sorted by offset, and to the pool, sorted
+ * by ptr */
+static void mapping_link(struct mempool *p, struct memblock *b, struct mapping *m)
+{
+	struct mapping *t, **maps;
+	void *slot;
+	uint32_t idx, len;
+
+	spa_list_for_each(t, &b->mappings, link) {
+		if (t->offset > m->offset)
+			break;
+	}
+	spa_list_append(&t->link, &m->link);
+
+	idx = mappings_upper_bound(p, m->ptr);
+
+	/* when this fails, pw_mempool_find_ptr() will find the mapping
+	 * with a linear search */
+	if ((slot = pw_array_add(&p->mappings, sizeof(struct mapping *))) == NULL)
+		return;
+
+	maps = p->mappings.data;
+	len = pw_array_get_len(&p->mappings, struct mapping *);
+	if (idx < len - 1)
+		memmove(&maps[idx + 1], &maps[idx], (len - 1 - idx) * sizeof(struct mapping *));
+	maps[idx] = m;
+}
+
+static void mapping_unlink(struct mempool *p, struct mapping *m)
+{
+	struct mapping **maps = p->mappings.data;
+	uint32_t idx, len = pw_array_get_len(&p->mappings, struct mapping *);
+
+	spa_list_remove(&m->link);
+
+	for (idx = mappings_upper_bound(p, m->ptr); idx > 0; idx--) {
+		if (maps[idx - 1] == m) {
+			memmove(&maps[idx - 1], &maps[idx], (len - idx) * sizeof(struct mapping *));
+			p->mappings.size -= sizeof(struct mapping *);
+			break;
+		}
+		if (maps[idx - 1]->ptr != m->ptr)
+			break;
+	}
+}
+
 SPA_EXPORT
 struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 {
@@ -120,8 +279,10 @@ struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 	struct pw_mempool *this;
 
 	impl = calloc(1, sizeof(struct mempool));
-	if (impl == NULL)
+	if (impl == NULL) {
+		pw_properties_free(props);
 		return NULL;
+	}
 
 	this = &impl->this;
 	this->props = props;
@@ -133,6 +294,16 @@ struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 	spa_hook_list_init(&impl->listener_list);
 	pw_map_init(&impl->map, 64, 64);
 	spa_list_init(&impl->blocks);
+	pw_array_init(&impl->mappings, 64);
+
+	if (hash_init(&impl->fds, HASH_MIN_BUCKETS) < 0 ||
+	    hash_init(&impl->tags, HASH_MIN_BUCKETS) < 0) {
+		hash_clear(&impl->fds);
+		pw_map_clear(&impl->map);
+		pw_properties_free(props);
+		free(impl);
+		return NULL;
+	}
 
 	return this;
 }
@@ -164,6 +335,9 @@ void pw_mempool_destroy(struct pw_mempool *pool)
 	spa_hook_list_clean(&impl->listener_list);
 
 	pw_map_clear(&impl->map);
+	hash_clear(&impl->fds);
+	hash_clear(&impl->tags);
+	pw_array_clear(&impl->mappings);
 	pw_properties_free(pool->props);
 	free(impl);
 }
@@ -248,7 +422,10 @@ static struct mapping * memblock_find_mapping(struct memblock *b,
 		pw_log_debug("%p: check %p offset:(%u <= %u) end:(%u >= %u)",
 				pool, m, m->offset, offset, m->offset + m->size,
 				offset + size);
-		if (m->offset <= offset && (m->offset + m->size) >= (offset + size)) {
+		/* sorted by offset, no more candidates */
+		if (m->offset > offset)
+			break;
+		if ((m->offset + m->size) >= (offset + size)) {
 			pw_log_debug("%p: found %p id:%u fd:%d offs:%u size:%u ref:%d",
 					pool, &b->this, b->this.id, b->this.fd,
 					offset, size, b->this.ref);
@@ -304,7 +481,7 @@ static struct mapping * memblock_map(struct memblock *b,
 	m->offset = offset;
 	m->size = size;
 	b->this.ref++;
-	spa_list_append(&b->mappings, &m->link);
+	mapping_link(p, b, m);
 
         pw_log_debug("%p: block:%p fd:%d map:%p ptr:%p (%u %u) block-ref:%d", p, &b->this,
 			b->this.fd, m, m->ptr, offset, size, b->this.ref);
@@ -322,7 +499,7 @@ static void mapping_free(struct mapping *m)
 
 	if (m->do_unmap)
 		munmap(m->ptr, m->size);
-	spa_list_remove(&m->link);
+	mapping_unlink(p, m);
 	free(m);
 }
 
@@ -396,6 +573,7 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 	}
 
 	spa_list_append(&b->memmaps, &mm->link);
+	hash_insert(&p->tags, &mm->tag_link, mm->this.tag[0], memmap_tag_key);
 
 	return &mm->this;
 }
@@ -435,6 +613,7 @@ int pw_memmap_free(struct pw_memmap *map)
 			&mm->this, b, b->this.fd, mm->this.ptr, m, m->ref);
 
 	spa_list_remove(&mm->link);
+	hash_remove(&p->tags, &mm->tag_link);
 
 	if (--m->ref == 0)
 		mapping_unmap(m);
@@ -544,6 +723,7 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 
 	b->this.id = pw_map_insert_new(&impl->map, b);
 	spa_list_append(&impl->blocks, &b->link);
+	hash_insert(&impl->fds, &b->fd_link, b->this.fd, block_fd_key);
 	pw_log_debug("%p: block:%p id:%d type:%u size:%zu", pool,
 			&b->this, b->this.id, type, size);
 
@@ -566,7 +746,7 @@ static struct memblock * mempool_find_fd(struct pw_mempool *pool, int fd)
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 	struct memblock *b;
 
-	spa_list_for_each(b, &impl->blocks, link) {
+	spa_list_for_each(b, hash_bucket(&impl->fds, fd), fd_link) {
 		if (fd == b->this.fd) {
 			pw_log_debug("%p: found %p id:%u fd:%d ref:%d",
 					pool, &b->this, b->this.id, fd, b->this.ref);
@@ -603,6 +783,7 @@ struct pw_memblock * pw_mempool_import(struct pw_mempool *pool,
 	b->this.flags = flags;
 	b->this.id = pw_map_insert_new(&impl->map, b);
 	spa_list_append(&impl->blocks, &b->link);
+	hash_insert(&impl->fds, &b->fd_link, b->this.fd, block_fd_key);
 
 	pw_log_debug("%p: block:%p id:%u flags:%08x type:%u fd:%d",
 			pool, b, b->this.id, flags, type, fd);
@@ -644,6 +825,7 @@ struct pw_memmap * pw_mempool_import_map(struct pw_mempool *pool,
 		return NULL;
 
 	if (block->ref == 1) {
+		struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 		struct mapping *m;
 
 		b = SPA_CONTAINER_OF(block, struct memblock, this);
@@ -657,7 +839,7 @@ struct pw_memmap * pw_mempool_import_map(struct pw_mempool *pool,
 		m->block = b;
 		m->offset = old->map->offset;
 		m->size = old->map->size;
-		spa_list_append(&b->mappings, &m->link);
+		mapping_link(impl, b, m);
 		pw_log_debug("%p: mapping:%p block:%p offset:%u size:%u ref:%u",
 				pool, m, block, m->offset, m->size, block->ref);
 	} else {
@@ -721,6 +903,7 @@ void pw_memblock_free(struct pw_memblock *block)
 	if (block->id != SPA_ID_INVALID)
 		pw_map_remove(&impl->map, block->id);
 	spa_list_remove(&b->link);
+	hash_remove(&impl->fds, &b->fd_link);
 
 	if (!SPA_FLAG_IS_SET(block->flags, PW_MEMBLOCK_FLAG_DONT_NOTIFY))
 		pw_mempool_emit_removed(impl, block);
@@ -746,7 +929,21 @@ struct pw_memblock * pw_mempool_find_ptr(struct pw_mempool *pool, const void *pt
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 	struct memblock *b;
 	struct mapping *m;
+	uint32_t idx;
+
+	/* the mapping with the highest ptr <= ptr */
+	idx = mappings_upper_bound(impl, ptr);
+	if (idx > 0) {
+		m = pw_array_get_unchecked(&impl->mappings, idx - 1, struct mapping *)[0];
+		if (ptr < SPA_PTROFF(m->ptr, m->size, void)) {
+			b = m->block;
+			pw_log_debug("%p: block:%p id:%u for %p", pool,
+					b, b->this.id, ptr);
+			return &b->this;
+		}
+	}
 
+	/* overlapping mappings or mappings we could not index */
 	spa_list_for_each(b, &impl->blocks, link) {
 		spa_list_for_each(m, &b->mappings, link) {
 			if (ptr >= m->ptr && ptr < SPA_PTROFF(m->ptr, m->size, void)) {
@@ -795,6 +992,16 @@ struct pw_memmap * pw_mempool_find_tag(struct pw_mempool *pool, uint32_t tag[5],
 	pw_log_debug("%p: find tag %u:%u:%u:%u:%u size:%zu", pool,
 			tag[0], tag[1], tag[2], tag[3], tag[4], size);
 
+	if (size >= sizeof(uint32_t)) {
+		spa_list_for_each(mm, hash_bucket(&impl->tags, tag[0]), tag_link) {
+			if (memcmp(tag, mm->this.tag, size) == 0) {
+				pw_log_debug("%p: found %p", pool, mm);
+				return &mm->this;
+			}
+		}
+		return NULL;
+	}
+
 	spa_list_for_each(b, &impl->blocks, link) {
 		spa_list_for_each(mm, &b->memmaps, link) {
 			if (memcmp(tag, mm->this.tag, size) == 0) {
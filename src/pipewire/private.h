@@ -442,6 +442,10 @@ struct pw_data_loop {
 
 	struct spa_thread_utils *thread_utils;
 
+	char *thread_name;
+	char *affinity;
+	int rt_prio;
+
 	pthread_t thread;
 	unsigned int cancel:1;
 	unsigned int created:1;
@@ -574,9 +578,19 @@ struct pw_node_activation {
 	uint32_t segment_owner[16];			/* id of owners for each segment info struct.
 							 * nodes that want to update segment info need to
 							 * CAS their node id in this array. */
-	uint32_t padding[15];
+	uint32_t padding[14];
+#define PW_NODE_ACTIVATION_WAKEUP_SLEEP		0	/* the node waits on the eventfd */
+#define PW_NODE_ACTIVATION_WAKEUP_SPIN		1	/* the node spins on this word */
+#define PW_NODE_ACTIVATION_WAKEUP_WOKEN		2	/* the node was woken while spinning */
+	uint32_t wakeup;				/* wakeup word, only valid when
+							 * PW_NODE_ACTIVATION_FLAG_SPIN is set.
+							 * Peers that change SPIN into WOKEN must
+							 * not write the eventfd. */
 #define PW_NODE_ACTIVATION_FLAG_NONE		0
 #define PW_NODE_ACTIVATION_FLAG_PROFILER	(1<<0)	/* the profiler is running */
+#define PW_NODE_ACTIVATION_FLAG_SPIN		(1<<1)	/* the node can be woken with the
+							 * wakeup word. Peers that don't know
+							 * this flag keep using the eventfd. */
 	uint32_t flags;					/* extra flags */
 	struct spa_io_position position;		/* contains current position and segment info.
 							 * extra info is updated by nodes that have set
@@ -677,6 +691,9 @@ struct pw_impl_node {
 	unsigned int trigger:1;		/**< has the TRIGGER property and needs an extra
 					  *  trigger to start processing. */
 	unsigned int can_suspend:1;
+	unsigned int recalc_dirty:1;	/**< needs incremental graph recalc */
+	unsigned int recalc_region:1;	/**< part of the graph recalc region */
+	unsigned int collect_runnable:1;	/**< driver runnable after collecting its nodes */
 	unsigned int checked;		/**< for sorting */
 
 	uint32_t port_user_data_size;	/**< extra size for port user data */
@@ -687,6 +704,7 @@ struct pw_impl_node {
 	struct spa_list follower_link;
 
 	struct spa_list sort_link;	/**< link used to sort nodes */
+	struct spa_list region_link;	/**< link in the graph recalc region */
 
 	struct spa_list peer_list;	/* list of peers */
 
@@ -727,6 +745,9 @@ struct pw_impl_node {
 		struct spa_list driver_link;		/* our link in driver */
 
 		struct spa_ratelimit rate_limit;
+
+		uint64_t spin_nsec;			/* max time to spin for the graph to
+							 * complete before sleeping */
 	} rt;
 	struct spa_fraction target_rate;
 	uint64_t target_quantum;
@@ -748,6 +769,7 @@ struct pw_impl_port_mix {
 	struct spa_io_buffers *io;
 	uint32_t id;
 	uint32_t peer_id;
+	struct spa_pod *props;		/**< Props of the mixer port, kept over mixer changes */
 	unsigned int have_buffers:1;
 	unsigned int active:1;
 };
@@ -1165,6 +1187,8 @@ int pw_proxy_init(struct pw_proxy *proxy, struct pw_core *core, const char *type
 void pw_proxy_remove(struct pw_proxy *proxy);
 
 int pw_context_recalc_graph(struct pw_context *context, const char *reason);
+int pw_context_recalc_graph_nodes(struct pw_context *context,
+		struct pw_impl_node **nodes, uint32_t n_nodes, const char *reason);
 
 void pw_impl_port_update_info(struct pw_impl_port *port, const struct spa_port_info *info);
 
@@ -1178,6 +1202,8 @@ int pw_impl_port_set_mix(struct pw_impl_port *port, struct spa_node *node, uint3
 
 int pw_impl_port_init_mix(struct pw_impl_port *port, struct pw_impl_port_mix *mix);
 int pw_impl_port_release_mix(struct pw_impl_port *port, struct pw_impl_port_mix *mix);
+int pw_impl_port_set_mix_props(struct pw_impl_port *port, struct pw_impl_port_mix *mix,
+		const struct spa_pod *props);
 
 void pw_impl_port_update_state(struct pw_impl_port *port, enum pw_impl_port_state state, int res, char *error);
 
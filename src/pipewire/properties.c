@@ -17,18 +17,144 @@
 PW_LOG_TOPIC_EXTERN(log_properties);
 #define PW_LOG_TOPIC_DEFAULT log_properties
 
+/* build a hash index for the keys when we have this many items */
+#define INDEX_MIN_ITEMS	16
+
 /** \cond */
+struct index_slot {
+	uint32_t hash;
+	uint32_t pos;		/**< item index + 1, 0 when the slot is free */
+};
+
 struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+
+	struct index_slot *index;
+	uint32_t index_mask;
 };
 /** \endcond */
 
+static inline uint32_t hash_key(const char *key)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	while (*key) {
+		h ^= (uint8_t)*key++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static inline const struct spa_dict_item *get_item(const struct properties *impl, uint32_t pos)
+{
+	return &((const struct spa_dict_item *)impl->items.data)[pos];
+}
+
+static void index_insert(struct properties *impl, uint32_t hash, uint32_t pos)
+{
+	uint32_t i = hash & impl->index_mask;
+	while (impl->index[i].pos != 0)
+		i = (i + 1) & impl->index_mask;
+	impl->index[i].hash = hash;
+	impl->index[i].pos = pos + 1;
+}
+
+/* find the slot of key, returns -1 when not found */
+static int index_find(const struct properties *impl, const char *key, uint32_t hash)
+{
+	uint32_t i = hash & impl->index_mask;
+	while (impl->index[i].pos != 0) {
+		if (impl->index[i].hash == hash &&
+		    spa_streq(get_item(impl, impl->index[i].pos - 1)->key, key))
+			return i;
+		i = (i + 1) & impl->index_mask;
+	}
+	return -1;
+}
+
+/* find the slot that points to item pos */
+static uint32_t index_find_pos(const struct properties *impl, uint32_t hash, uint32_t pos)
+{
+	uint32_t i = hash & impl->index_mask;
+	while (impl->index[i].pos != pos + 1)
+		i = (i + 1) & impl->index_mask;
+	return i;
+}
+
+/* remove slot i, move the following slots in the probe sequence back so
+ * that lookups don't need tombstones */
+static void index_remove(struct properties *impl, uint32_t i)
+{
+	uint32_t j = i, k, mask = impl->index_mask;
+
+	while (true) {
+		impl->index[i].pos = 0;
+		while (true) {
+			j = (j + 1) & mask;
+			if (impl->index[j].pos == 0)
+				return;
+			k = impl->index[j].hash & mask;
+			/* move j to i when its home slot k is not in (i, j] */
+			if (i <= j ? (i >= k || k > j) : (i >= k && k > j))
+				break;
+		}
+		impl->index[i] = impl->index[j];
+		i = j;
+	}
+}
+
+static void index_free(struct properties *impl)
+{
+	free(impl->index);
+	impl->index = NULL;
+	impl->index_mask = 0;
+}
+
+static int index_build(struct properties *impl)
+{
+	uint32_t i, size, n_items = impl->this.dict.n_items;
+	struct index_slot *index;
+
+	size = 32;
+	while (size < n_items * 2)
+		size <<= 1;
+
+	if (impl->index == NULL || size > impl->index_mask + 1) {
+		if ((index = calloc(size, sizeof(struct index_slot))) == NULL) {
+			/* we can still do linear lookups */
+			index_free(impl);
+			return -errno;
+		}
+		free(impl->index);
+		impl->index = index;
+		impl->index_mask = size - 1;
+	} else {
+		memset(impl->index, 0, (impl->index_mask + 1) * sizeof(struct index_slot));
+	}
+	for (i = 0; i < n_items; i++)
+		index_insert(impl, hash_key(get_item(impl, i)->key), i);
+
+	return 0;
+}
+
+/* Someone sorted the dict items, rebuild the index before we make changes.
+ * We clear the SORTED flag so that we can see when it is sorted again. */
+static inline void index_check(struct properties *impl)
+{
+	struct spa_dict *dict = &impl->this.dict;
+	if (impl->index != NULL && SPA_FLAG_IS_SET(dict->flags, SPA_DICT_FLAG_SORTED)) {
+		index_build(impl);
+		SPA_FLAG_CLEAR(dict->flags, SPA_DICT_FLAG_SORTED);
+	}
+}
+
 static int add_func(struct pw_properties *this, char *key, char *value)
 {
 	struct spa_dict_item *item;
 	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
+	uint32_t pos = this->dict.n_items;
 
 	item = pw_array_add(&impl->items, sizeof(struct spa_dict_item));
 	if (item == NULL) {
@@ -42,6 +168,15 @@ static int add_func(struct pw_properties *this, char *key, char *value)
 
 	this->dict.items = impl->items.data;
 	this->dict.n_items++;
+
+	if (impl->index != NULL) {
+		if (this->dict.n_items * 2 > impl->index_mask + 1)
+			index_build(impl);
+		else
+			index_insert(impl, hash_key(key), pos);
+	} else if (this->dict.n_items >= INDEX_MIN_ITEMS) {
+		index_build(impl);
+	}
 	return 0;
 }
 
@@ -53,7 +188,14 @@ static void clear_item(struct spa_dict_item *item)
 
 static int find_index(const struct pw_properties *this, const char *key)
 {
+	const struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
 	const struct spa_dict_item *item;
+
+	/* a sorted dict uses a binary search, the index might be stale */
+	if (impl->index != NULL && !SPA_FLAG_IS_SET(this->dict.flags, SPA_DICT_FLAG_SORTED)) {
+		int slot = index_find(impl, key, hash_key(key));
+		return slot < 0 ? -1 : (int)impl->index[slot].pos - 1;
+	}
 	item = spa_dict_lookup_item(&this->dict, key);
 	if (item == NULL)
 		return -1;
@@ -269,6 +411,7 @@ void pw_properties_clear(struct pw_properties *properties)
 		clear_item(item);
 	pw_array_reset(&impl->items);
 	properties->dict.n_items = 0;
+	index_free(impl);
 }
 
 /** Update properties
@@ -368,6 +511,7 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 	if (key == NULL || key[0] == 0)
 		goto exit_noupdate;
 
+	index_check(impl);
 	index = find_index(properties, key);
 
 	if (index == -1) {
@@ -383,9 +527,15 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 			goto exit_noupdate;
 
 		if (value == NULL) {
+			uint32_t last_index = pw_array_get_len(&impl->items, struct spa_dict_item) - 1;
 			struct spa_dict_item *last = pw_array_get_unchecked(&impl->items,
-						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
-						     struct spa_dict_item);
+						     last_index, struct spa_dict_item);
+			if (impl->index != NULL) {
+				index_remove(impl, index_find_pos(impl, hash_key(item->key), index));
+				if (item != last)
+					impl->index[index_find_pos(impl, hash_key(last->key),
+							last_index)].pos = index + 1;
+			}
 			clear_item(item);
 			item->key = last->key;
 			item->value = last->value;
@@ -2151,6 +2151,13 @@ uint32_t pw_stream_get_node_id(struct pw_stream *stream)
 	return stream->node_id;
 }
 
+SPA_EXPORT
+struct pw_loop *pw_stream_get_data_loop(struct pw_stream *stream)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	return impl->data_loop;
+}
+
 SPA_EXPORT
 int pw_stream_disconnect(struct pw_stream *stream)
 {
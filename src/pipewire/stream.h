@@ -464,6 +464,14 @@ pw_stream_connect(struct pw_stream *stream,		/**< a \ref pw_stream */
 uint32_t
 pw_stream_get_node_id(struct pw_stream *stream);
 
+/** Get the data loop of the stream. This is the data loop of the node
+ * of the stream, where the realtime processing of the stream runs. The
+ * process event is only emitted from this loop with
+ * PW_STREAM_FLAG_RT_PROCESS. Returns NULL when the stream is not
+ * connected. Since 1.0.4 */
+struct pw_loop *
+pw_stream_get_data_loop(struct pw_stream *stream);
+
 /** Disconnect \a stream  */
 int pw_stream_disconnect(struct pw_stream *stream);
 
@@ -6,8 +6,10 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include <spa/utils/dict.h>
+#include <spa/utils/json.h>
 #include <spa/utils/defs.h>
 #include <spa/utils/list.h>
 
@@ -24,6 +26,25 @@ do {									\
 	}								\
 } while(false);
 
+#ifdef __linux__
+static int parse_affinity(const char *affinity, cpu_set_t *set)
+{
+	struct spa_json it[2];
+	int v;
+
+	CPU_ZERO(set);
+	spa_json_init(&it[0], affinity, strlen(affinity));
+	if (spa_json_enter_array(&it[0], &it[1]) <= 0)
+		spa_json_init(&it[1], affinity, strlen(affinity));
+
+	while (spa_json_get_int(&it[1], &v) > 0) {
+		if (v >= 0 && v < CPU_SETSIZE)
+			CPU_SET(v, set);
+	}
+	return CPU_COUNT(set);
+}
+#endif
+
 SPA_EXPORT
 void *pw_thread_fill_attr(const struct spa_dict *props, void *_attr)
 {
@@ -37,6 +58,16 @@ void *pw_thread_fill_attr(const struct spa_dict *props, void *_attr)
 	pthread_attr_init(attr);
 	if ((str = spa_dict_lookup(props, SPA_KEY_THREAD_STACK_SIZE)) != NULL)
 		CHECK(pthread_attr_setstacksize(attr, atoi(str)), error);
+#ifdef __linux__
+	if ((str = spa_dict_lookup(props, SPA_KEY_THREAD_AFFINITY)) != NULL) {
+		cpu_set_t set;
+		if (parse_affinity(str, &set) > 0) {
+			CHECK(pthread_attr_setaffinity_np(attr, sizeof(set), &set), error);
+		} else {
+			pw_log_warn("invalid thread affinity '%s'", str);
+		}
+	}
+#endif
 	return attr;
 error:
 	errno = -res;
@@ -0,0 +1,143 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+#include <spa/utils/dict.h>
+#include <spa/utils/string.h>
+
+#include <pipewire/pipewire.h>
+
+#define MAX_COUNT 1000000
+#define MAX_ITEMS 200
+
+/* keys with common prefixes, like the properties of nodes and devices */
+static const char * const prefixes[] = {
+	"node.", "media.", "audio.", "object.", "factory.", "client.",
+	"device.", "api.alsa.", "api.alsa.pcm.", "alsa.", "port.", "priority.",
+};
+
+static char keys[MAX_ITEMS][64];
+static char values[MAX_ITEMS][32];
+static uint32_t queries[MAX_COUNT];
+
+static void gen_keys(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < MAX_ITEMS; i++) {
+		snprintf(keys[i], sizeof(keys[i]), "%s%s.%u",
+				prefixes[random() % SPA_N_ELEMENTS(prefixes)],
+				i & 1 ? "name" : "id", i);
+		snprintf(values[i], sizeof(values[i]), "value-%u", i);
+	}
+	for (i = 0; i < MAX_COUNT; i++)
+		queries[i] = random();
+}
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void report(const char *name, uint32_t n_items, uint64_t t1, uint64_t t2)
+{
+	fprintf(stderr, "%-10s %3u items: elapsed %"PRIu64" count %u = %"PRIu64"/sec\n",
+			name, n_items, t2 - t1, MAX_COUNT,
+			MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+}
+
+static void test_lookup(uint32_t n_items)
+{
+	struct pw_properties *props;
+	struct spa_dict_item items[MAX_ITEMS];
+	struct spa_dict dict;
+	uint32_t i, idx;
+	uint64_t t1, t2;
+	const char *str;
+
+	props = pw_properties_new(NULL, NULL);
+	for (i = 0; i < n_items; i++) {
+		pw_properties_set(props, keys[i], values[i]);
+		items[i] = SPA_DICT_ITEM_INIT(keys[i], values[i]);
+	}
+	dict = SPA_DICT_INIT(items, n_items);
+
+	/* the plain dict, linear search */
+	t1 = get_time_ns();
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = queries[i] % n_items;
+		str = spa_dict_lookup(&dict, keys[idx]);
+		assert(str == values[idx]);
+	}
+	t2 = get_time_ns();
+	report("linear", n_items, t1, t2);
+
+	/* the properties, with the hashed index */
+	t1 = get_time_ns();
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = queries[i] % n_items;
+		str = pw_properties_get(props, keys[idx]);
+		assert(spa_streq(str, values[idx]));
+	}
+	t2 = get_time_ns();
+	report("properties", n_items, t1, t2);
+
+	/* missing keys */
+	t1 = get_time_ns();
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = queries[i] % n_items;
+		str = pw_properties_get(props, values[idx]);
+		assert(str == NULL);
+	}
+	t2 = get_time_ns();
+	report("missing", n_items, t1, t2);
+
+	/* sorted dict, binary search */
+	spa_dict_qsort(&dict);
+	t1 = get_time_ns();
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = queries[i] % n_items;
+		str = spa_dict_lookup(&dict, keys[idx]);
+		assert(str == values[idx]);
+	}
+	t2 = get_time_ns();
+	report("sorted", n_items, t1, t2);
+
+	/* updating existing keys */
+	t1 = get_time_ns();
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = queries[i] % n_items;
+		pw_properties_set(props, keys[idx], (i & 1) ? "1" : "0");
+	}
+	t2 = get_time_ns();
+	report("update", n_items, t1, t2);
+
+	pw_properties_free(props);
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t sizes[] = { 10, 20, 50, 100, 200 };
+	uint32_t i;
+
+	pw_init(&argc, &argv);
+
+	gen_keys();
+
+	/* warmup */
+	test_lookup(MAX_ITEMS);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sizes); i++)
+		test_lookup(sizes[i]);
+
+	pw_deinit();
+
+	return 0;
+}
@@ -0,0 +1,167 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+
+#include <spa/utils/defs.h>
+
+#include "udp-batch.h"
+
+#define MAX_COUNT	200000
+#define PACKET_SIZE	300		/* 1ms of 48kHz stereo S24 with an RTP header */
+#define BURST		8
+
+static int fds[2];
+static struct udp_batch batch;
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static uint64_t get_cpu_ns(void)
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return SPA_TIMEVAL_TO_NSEC(&ru.ru_utime) + SPA_TIMEVAL_TO_NSEC(&ru.ru_stime);
+}
+
+static void report(const char *name, uint32_t count, uint64_t t1, uint64_t t2,
+		uint64_t c1, uint64_t c2)
+{
+	fprintf(stderr, "%-10s elapsed %"PRIu64" count %u = %"PRIu64"/sec cpu %"PRIu64"ns/packet\n",
+			name, t2 - t1, count,
+			count * (uint64_t)SPA_NSEC_PER_SEC / SPA_MAX(t2 - t1, 1u),
+			(c2 - c1) / SPA_MAX(count, 1u));
+}
+
+static int make_socket(struct sockaddr_in *addr)
+{
+	socklen_t len = sizeof(*addr);
+	int fd, val;
+
+	fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	assert(fd >= 0);
+
+	/* room for a full burst of every test */
+	val = 4 * 1024 * 1024;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &val, sizeof(val));
+
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr->sin_port = 0;
+	assert(bind(fd, (struct sockaddr*)addr, len) == 0);
+	assert(getsockname(fd, (struct sockaddr*)addr, &len) == 0);
+	return fd;
+}
+
+static void setup_sockets(void)
+{
+	struct sockaddr_in addr[2];
+
+	fds[0] = make_socket(&addr[0]);
+	fds[1] = make_socket(&addr[1]);
+	assert(connect(fds[0], (struct sockaddr*)&addr[1], sizeof(addr[1])) == 0);
+	assert(connect(fds[1], (struct sockaddr*)&addr[0], sizeof(addr[0])) == 0);
+}
+
+/* send a burst and receive it again, like one cycle of a sender and a
+ * receiver */
+static uint32_t cycle_plain(uint8_t *packet, uint8_t *buffer)
+{
+	uint32_t i, n = 0;
+
+	for (i = 0; i < BURST; i++) {
+		packet[0] = i;
+		assert(send(fds[0], packet, PACKET_SIZE, MSG_NOSIGNAL) == PACKET_SIZE);
+	}
+	while (recv(fds[1], buffer, UDP_BATCH_PACKET_SIZE, MSG_DONTWAIT) > 0)
+		n++;
+	return n;
+}
+
+static uint32_t cycle_batch(uint8_t *packet, struct udp_batch *recv_batch)
+{
+	struct iovec iov[1];
+	uint32_t i, n = 0;
+	int res;
+
+	iov[0].iov_base = packet;
+	iov[0].iov_len = PACKET_SIZE;
+
+	for (i = 0; i < BURST; i++) {
+		packet[0] = i;
+		assert(udp_batch_add(&batch, iov, 1) == 0);
+	}
+	assert(udp_batch_flush(&batch, fds[0]) == 0);
+
+	while ((res = udp_batch_recv(recv_batch, fds[1])) > 0) {
+		for (i = 0; i < (uint32_t)res; i++) {
+			size_t len;
+			uint8_t *data = udp_batch_get_data(recv_batch, i, &len);
+			assert(len == PACKET_SIZE);
+			assert(data[0] == (n + i) % BURST);
+		}
+		n += res;
+	}
+	return n;
+}
+
+static void test_udp(bool gso)
+{
+	static struct udp_batch recv_batch;
+	uint8_t packet[PACKET_SIZE], buffer[UDP_BATCH_PACKET_SIZE];
+	uint64_t t1, t2, c1, c2;
+	uint32_t i, n;
+
+	memset(packet, 0x55, sizeof(packet));
+
+	n = 0;
+	c1 = get_cpu_ns();
+	t1 = get_time_ns();
+	for (i = 0; i < MAX_COUNT / BURST; i++)
+		n += cycle_plain(packet, buffer);
+	t2 = get_time_ns();
+	c2 = get_cpu_ns();
+	report("plain", n, t1, t2, c1, c2);
+
+	udp_batch_init(&batch);
+	udp_batch_init(&recv_batch);
+	batch.no_gso = !gso;
+
+	n = 0;
+	c1 = get_cpu_ns();
+	t1 = get_time_ns();
+	for (i = 0; i < MAX_COUNT / BURST; i++)
+		n += cycle_batch(packet, &recv_batch);
+	t2 = get_time_ns();
+	c2 = get_cpu_ns();
+	report(batch.no_gso ? "batch" : "batch-gso", n, t1, t2, c1, c2);
+}
+
+int main(void)
+{
+	setup_sockets();
+
+	/* warmup */
+	test_udp(false);
+
+	test_udp(false);
+#ifdef UDP_SEGMENT
+	test_udp(true);
+#endif
+
+	close(fds[0]);
+	close(fds[1]);
+
+	return 0;
+}
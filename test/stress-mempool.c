@@ -0,0 +1,233 @@
+/* PipeWire */
+/* SPDX-FileCopyrightText: Copyright © 2026 PipeWire authors */
+/* SPDX-License-Identifier: MIT */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+#include <sys/resource.h>
+
+#include <spa/buffer/buffer.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/mem.h>
+
+#define MAX_BLOCKS	4096
+#define N_PAGES		4
+#define MAX_COUNT	200000
+
+struct block {
+	struct pw_memblock *block;
+	struct pw_memmap *maps[N_PAGES];
+	uint32_t tag[5];
+};
+
+static struct block blocks[MAX_BLOCKS];
+static uint32_t n_blocks;
+static long pagesize;
+
+static uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void report(const char *name, uint32_t count, uint64_t t1, uint64_t t2)
+{
+	fprintf(stderr, "%-10s %u blocks: elapsed %"PRIu64" count %u = %"PRIu64"/sec\n",
+			name, n_blocks, t2 - t1, count,
+			count * (uint64_t)SPA_NSEC_PER_SEC / SPA_MAX(t2 - t1, 1u));
+}
+
+/* we need an fd per block, use as many as we are allowed */
+static void setup_limits(void)
+{
+	struct rlimit rl;
+
+	n_blocks = MAX_BLOCKS;
+	if (getrlimit(RLIMIT_NOFILE, &rl) < 0)
+		return;
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < MAX_BLOCKS + 64)
+		n_blocks = rl.rlim_cur > 128 ? rl.rlim_cur - 64 : 64;
+}
+
+static void alloc_blocks(struct pw_mempool *pool)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < n_blocks; i++) {
+		struct block *b = &blocks[i];
+		/* half of the blocks are mapped as a whole, the other half
+		 * gets a mapping per page */
+		uint32_t flags = PW_MEMBLOCK_FLAG_READWRITE |
+			(i & 1 ? PW_MEMBLOCK_FLAG_MAP : 0);
+
+		b->block = pw_mempool_alloc(pool, flags, SPA_DATA_MemFd, N_PAGES * pagesize);
+		assert(b->block != NULL);
+
+		for (j = 0; j < N_PAGES; j++) {
+			uint32_t tag[5] = { i / 16 + 1, i, j, 0, 0 };
+			b->maps[j] = pw_memblock_map(b->block, PW_MEMMAP_FLAG_READWRITE,
+					(N_PAGES - 1 - j) * pagesize, pagesize, tag);
+			assert(b->maps[j] != NULL);
+		}
+		memcpy(b->tag, b->maps[0]->tag, sizeof(b->tag));
+	}
+}
+
+static void check_lookups(struct pw_mempool *pool, uint32_t count)
+{
+	uint32_t i, idx, page;
+	uint64_t t1, t2;
+	struct block *b;
+
+	t1 = get_time_ns();
+	for (i = 0; i < count; i++) {
+		idx = random() % n_blocks;
+		if ((b = &blocks[idx])->block == NULL)
+			continue;
+		page = random() % N_PAGES;
+		assert(pw_mempool_find_ptr(pool,
+			SPA_PTROFF(b->maps[page]->ptr, random() % pagesize, void)) == b->block);
+	}
+	t2 = get_time_ns();
+	report("find_ptr", count, t1, t2);
+
+	t1 = get_time_ns();
+	for (i = 0; i < count; i++) {
+		idx = random() % n_blocks;
+		if ((b = &blocks[idx])->block == NULL)
+			continue;
+		assert(pw_mempool_find_tag(pool, b->tag, sizeof(b->tag)) == b->maps[0]);
+	}
+	t2 = get_time_ns();
+	report("find_tag", count, t1, t2);
+
+	t1 = get_time_ns();
+	for (i = 0; i < count; i++) {
+		idx = random() % n_blocks;
+		if ((b = &blocks[idx])->block == NULL)
+			continue;
+		assert(pw_mempool_find_fd(pool, b->block->fd) == b->block);
+	}
+	t2 = get_time_ns();
+	report("find_fd", count, t1, t2);
+
+	t1 = get_time_ns();
+	for (i = 0; i < count; i++) {
+		idx = random() % n_blocks;
+		if ((b = &blocks[idx])->block == NULL)
+			continue;
+		page = random() % N_PAGES;
+		/* this reuses the existing mapping of the page */
+		pw_memmap_free(pw_memblock_map(b->block, PW_MEMMAP_FLAG_READWRITE,
+				(N_PAGES - 1 - page) * pagesize + 16, 32, NULL));
+	}
+	t2 = get_time_ns();
+	report("map", count, t1, t2);
+}
+
+static void free_blocks(struct pw_mempool *pool, uint32_t step)
+{
+	uint32_t i, tag[5];
+
+	for (i = 0; i < n_blocks; i += step) {
+		struct block *b = &blocks[i];
+		if (b->block == NULL)
+			continue;
+		pw_memblock_free(b->block);
+		b->block = NULL;
+
+		memcpy(tag, b->tag, sizeof(tag));
+		assert(pw_mempool_find_tag(pool, tag, sizeof(tag)) == NULL);
+	}
+}
+
+static void remove_tags(struct pw_mempool *pool)
+{
+	uint32_t i, tag[5] = { 0, };
+	struct pw_memmap *mm;
+
+	/* remove all maps of the first 8 tag groups */
+	for (i = 1; i <= 8; i++) {
+		tag[0] = i;
+		while ((mm = pw_mempool_find_tag(pool, tag, sizeof(uint32_t))) != NULL) {
+			struct block *b = &blocks[mm->tag[1]];
+			assert(mm->tag[0] == i);
+			if (mm->tag[2] == 0)
+				b->tag[0] = 0;
+			pw_memmap_free(mm);
+		}
+	}
+	for (i = 0; i < n_blocks; i++) {
+		if (blocks[i].tag[0] == 0)
+			blocks[i].block = NULL;
+	}
+}
+
+static void import_maps(struct pw_mempool *pool, struct pw_mempool *other)
+{
+	uint32_t i, n = 0;
+	uint64_t t1, t2;
+
+	t1 = get_time_ns();
+	for (i = 0; i < n_blocks; i++) {
+		struct block *b = &blocks[i];
+		struct pw_memmap *mm;
+		if (b->block == NULL || !(i & 1))
+			continue;
+		mm = pw_mempool_import_map(other, pool, b->maps[1]->ptr, pagesize, b->tag);
+		assert(mm != NULL);
+		assert(pw_mempool_find_ptr(other, mm->ptr) == mm->block);
+		assert(pw_mempool_find_tag(other, b->tag, sizeof(b->tag)) == mm);
+		n++;
+	}
+	t2 = get_time_ns();
+	fprintf(stderr, "imported %u maps in %"PRIu64"ns\n", n, t2 - t1);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_mempool *pool, *other;
+	uint64_t t1, t2;
+
+	pw_init(&argc, &argv);
+
+	pagesize = sysconf(_SC_PAGESIZE);
+	setup_limits();
+
+	pool = pw_mempool_new(NULL);
+	assert(pool != NULL);
+	other = pw_mempool_new(NULL);
+	assert(other != NULL);
+
+	t1 = get_time_ns();
+	alloc_blocks(pool);
+	t2 = get_time_ns();
+	fprintf(stderr, "allocated %u blocks in %"PRIu64"ns\n", n_blocks, t2 - t1);
+
+	check_lookups(pool, MAX_COUNT);
+
+	free_blocks(pool, 3);
+	check_lookups(pool, MAX_COUNT / 10);
+
+	remove_tags(pool);
+	check_lookups(pool, MAX_COUNT / 10);
+
+	import_maps(pool, other);
+
+	t1 = get_time_ns();
+	pw_mempool_destroy(other);
+	pw_mempool_destroy(pool);
+	t2 = get_time_ns();
+	fprintf(stderr, "destroyed pools in %"PRIu64"ns\n", t2 - t1);
+
+	pw_deinit();
+
+	return 0;
+}
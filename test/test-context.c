@@ -7,9 +7,16 @@
 #include <spa/utils/string.h>
 #include <spa/support/dbus.h>
 #include <spa/support/cpu.h>
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/pod/builder.h>
+#include <spa/param/param.h>
 
 #include <pipewire/pipewire.h>
 #include <pipewire/global.h>
+#include <pipewire/impl-node.h>
+#include <pipewire/impl-port.h>
+#include <pipewire/impl-link.h>
 
 #define TEST_FUNC(a,b,func)	\
 do {				\
@@ -259,12 +266,310 @@ PWTEST(context_support)
 	return PWTEST_PASS;
 }
 
+#define N_NODES	5
+
+struct graph_node {
+	struct spa_node impl;
+	struct spa_hook_list hooks;
+	struct pw_impl_node *node;
+	struct spa_hook listener;
+	struct pw_impl_node *driver;
+};
+
+/* a node with one control port in each direction, links between control
+ * ports are prepared without negotiating formats and buffers */
+static int node_add_listener(void *object, struct spa_hook *listener,
+		const struct spa_node_events *events, void *data)
+{
+	struct graph_node *n = object;
+	struct spa_hook_list save;
+	struct spa_node_info info = SPA_NODE_INFO_INIT();
+	struct spa_port_info port_info = SPA_PORT_INFO_INIT();
+	struct spa_param_info params[1];
+
+	spa_hook_list_isolate(&n->hooks, &save, listener, events, data);
+
+	info.max_input_ports = 1;
+	info.max_output_ports = 1;
+	info.change_mask = SPA_NODE_CHANGE_MASK_FLAGS;
+	spa_node_emit_info(&n->hooks, &info);
+
+	params[0] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port_info.change_mask = SPA_PORT_CHANGE_MASK_PARAMS;
+	port_info.params = params;
+	port_info.n_params = 1;
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_INPUT, 0, &port_info);
+	spa_node_emit_port_info(&n->hooks, SPA_DIRECTION_OUTPUT, 0, &port_info);
+
+	spa_hook_list_join(&n->hooks, &save);
+	return 0;
+}
+
+static int node_set_callbacks(void *object,
+		const struct spa_node_callbacks *callbacks, void *data)
+{
+	return 0;
+}
+
+static int node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static int node_send_command(void *object, const struct spa_command *command)
+{
+	return 0;
+}
+
+static int node_port_enum_params(void *object, int seq,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t start, uint32_t num,
+		const struct spa_pod *filter)
+{
+	struct graph_node *n = object;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+
+	if (id != SPA_PARAM_IO)
+		return -ENOENT;
+	if (start > 0)
+		return 0;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	result.id = id;
+	result.index = 0;
+	result.next = 1;
+	result.param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamIO, id,
+			SPA_PARAM_IO_id, SPA_POD_Id(direction == SPA_DIRECTION_INPUT ?
+				SPA_IO_Control : SPA_IO_Notify),
+			SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_sequence)));
+
+	spa_node_emit_result(&n->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+	return 0;
+}
+
+static int node_port_set_io(void *object,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static const struct spa_node_methods node_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = node_add_listener,
+	.set_callbacks = node_set_callbacks,
+	.set_io = node_set_io,
+	.send_command = node_send_command,
+	.port_enum_params = node_port_enum_params,
+	.port_set_io = node_port_set_io,
+};
+
+struct graph {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct graph_node nodes[N_NODES];
+	struct pw_impl_link *link;
+};
+
+static void node_driver_changed(void *data, struct pw_impl_node *old,
+		struct pw_impl_node *driver)
+{
+	struct graph_node *n = data;
+	n->driver = driver;
+}
+
+static const struct pw_impl_node_events node_events = {
+	PW_VERSION_IMPL_NODE_EVENTS,
+	.driver_changed = node_driver_changed,
+};
+
+static void graph_init(struct graph *g, bool incremental)
+{
+	static const struct {
+		const char *name;
+		const char *props;
+	} nodes[N_NODES] = {
+		{ "d1", "{ node.driver = true priority.driver = 2000 node.group = g1 }" },
+		{ "d2", "{ node.driver = true priority.driver = 1000 node.group = g2 }" },
+		{ "u", "{ node.always-process = true }" },
+		{ "f1", "{ node.always-process = true node.group = g1 }" },
+		{ "f2", "{ node.always-process = true node.group = g2 }" },
+	};
+	uint32_t i;
+
+	spa_zero(*g);
+	g->loop = pw_main_loop_new(NULL);
+	pwtest_ptr_notnull(g->loop);
+	g->context = pw_context_new(pw_main_loop_get_loop(g->loop),
+			pw_properties_new(
+				PW_KEY_CONFIG_NAME, "null",
+				"context.graph.incremental", incremental ? "true" : "false",
+				NULL), 0);
+	pwtest_ptr_notnull(g->context);
+
+	for (i = 0; i < N_NODES; i++) {
+		struct graph_node *n = &g->nodes[i];
+		struct pw_properties *props;
+
+		props = pw_properties_new(PW_KEY_NODE_NAME, nodes[i].name, NULL);
+		pw_properties_update_string(props, nodes[i].props, strlen(nodes[i].props));
+
+		n->impl.iface = SPA_INTERFACE_INIT(SPA_TYPE_INTERFACE_Node,
+				SPA_VERSION_NODE, &node_methods, n);
+		spa_hook_list_init(&n->hooks);
+		n->node = pw_context_create_node(g->context, props, 0);
+		pwtest_ptr_notnull(n->node);
+		/* a new node drives itself until it is moved */
+		n->driver = n->node;
+		pw_impl_node_add_listener(n->node, &n->listener, &node_events, n);
+		pwtest_neg_errno_ok(pw_impl_node_set_implementation(n->node, &n->impl));
+		pwtest_neg_errno_ok(pw_impl_node_register(n->node, NULL));
+	}
+}
+
+static void graph_set_active(struct graph *g, uint32_t index, bool active)
+{
+	pw_impl_node_set_active(g->nodes[index].node, active);
+}
+
+static void graph_link(struct graph *g, uint32_t output, uint32_t input)
+{
+	struct pw_impl_port *out, *in;
+
+	out = pw_impl_node_find_port(g->nodes[output].node, PW_DIRECTION_OUTPUT, 0);
+	in = pw_impl_node_find_port(g->nodes[input].node, PW_DIRECTION_INPUT, 0);
+	pwtest_ptr_notnull(out);
+	pwtest_ptr_notnull(in);
+
+	g->link = pw_context_create_link(g->context, out, in, NULL, NULL, 0);
+	pwtest_ptr_notnull(g->link);
+	pwtest_neg_errno_ok(pw_impl_link_register(g->link, NULL));
+}
+
+static void graph_unlink(struct graph *g)
+{
+	pw_impl_link_destroy(g->link);
+	g->link = NULL;
+}
+
+static void graph_iterate(struct graph *g)
+{
+	while (pw_loop_iterate(pw_main_loop_get_loop(g->loop), 0) > 0);
+}
+
+static void graph_clear(struct graph *g)
+{
+	uint32_t i;
+
+	for (i = 0; i < N_NODES; i++) {
+		spa_hook_remove(&g->nodes[i].listener);
+		pw_impl_node_destroy(g->nodes[i].node);
+	}
+	pw_context_destroy(g->context);
+	pw_main_loop_destroy(g->loop);
+}
+
+static void graph_compare(struct graph *a, struct graph *b)
+{
+	uint32_t i;
+
+	for (i = 0; i < N_NODES; i++) {
+		struct pw_impl_node *da = a->nodes[i].driver, *db = b->nodes[i].driver;
+
+		pwtest_ptr_notnull(da);
+		pwtest_ptr_notnull(db);
+		pwtest_str_eq(pw_properties_get(pw_impl_node_get_properties(da), PW_KEY_NODE_NAME),
+			pw_properties_get(pw_impl_node_get_properties(db), PW_KEY_NODE_NAME));
+	}
+}
+
+PWTEST(context_recalc_incremental)
+{
+	struct graph full, incremental;
+	struct graph *graphs[2] = { &full, &incremental };
+	uint32_t i;
+
+	pw_init(0, NULL);
+
+	graph_init(&full, false);
+	graph_init(&incremental, true);
+
+	/* the drivers and a node without a driver, it is scheduled by
+	 * the first driver */
+	for (i = 0; i < 2; i++) {
+		graph_set_active(graphs[i], 0, true);
+		graph_set_active(graphs[i], 1, true);
+		graph_set_active(graphs[i], 2, true);
+		graph_iterate(graphs[i]);
+	}
+	graph_compare(&full, &incremental);
+	pwtest_ptr_eq(full.nodes[2].driver, full.nodes[0].node);
+
+	/* a follower of the second driver makes it the target for the
+	 * unassigned node, the first driver is not part of the region */
+	for (i = 0; i < 2; i++) {
+		graph_set_active(graphs[i], 4, true);
+		graph_iterate(graphs[i]);
+	}
+	graph_compare(&full, &incremental);
+	pwtest_ptr_eq(full.nodes[2].driver, full.nodes[1].node);
+
+	/* coalesce the changes around both drivers in one recalc */
+	for (i = 0; i < 2; i++) {
+		graph_set_active(graphs[i], 3, true);
+		graph_set_active(graphs[i], 4, false);
+		graph_iterate(graphs[i]);
+	}
+	graph_compare(&full, &incremental);
+	pwtest_ptr_eq(full.nodes[2].driver, full.nodes[0].node);
+
+	for (i = 0; i < 2; i++) {
+		graph_set_active(graphs[i], 3, false);
+		graph_set_active(graphs[i], 4, true);
+		graph_iterate(graphs[i]);
+	}
+	graph_compare(&full, &incremental);
+	pwtest_ptr_eq(full.nodes[2].driver, full.nodes[1].node);
+
+	/* a link from the first driver pulls the unassigned node into its
+	 * group, the region reaches the old driver of the node */
+	for (i = 0; i < 2; i++) {
+		graph_link(graphs[i], 0, 2);
+		graph_iterate(graphs[i]);
+		pwtest_int_ge(pw_impl_link_get_info(graphs[i]->link)->state,
+				PW_LINK_STATE_PAUSED);
+	}
+	graph_compare(&full, &incremental);
+	pwtest_ptr_eq(full.nodes[2].driver, full.nodes[0].node);
+	pwtest_ptr_eq(full.nodes[4].driver, full.nodes[1].node);
+
+	/* without the link, it goes back to the target driver */
+	for (i = 0; i < 2; i++) {
+		graph_unlink(graphs[i]);
+		graph_iterate(graphs[i]);
+	}
+	graph_compare(&full, &incremental);
+	pwtest_ptr_eq(full.nodes[2].driver, full.nodes[1].node);
+	pwtest_ptr_eq(full.nodes[4].driver, full.nodes[1].node);
+
+	graph_clear(&incremental);
+	graph_clear(&full);
+
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(context)
 {
 	pwtest_add(context_abi, PWTEST_NOARG);
 	pwtest_add(context_create, PWTEST_NOARG);
 	pwtest_add(context_properties, PWTEST_NOARG);
 	pwtest_add(context_support, PWTEST_NOARG);
+	pwtest_add(context_recalc_incremental, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
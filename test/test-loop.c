@@ -6,10 +6,13 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/eventfd.h>
 
 #include "pwtest.h"
 
+#include <spa/utils/atomic.h>
+
 #include <pipewire/pipewire.h>
 
 struct obj {
@@ -435,6 +438,120 @@ PWTEST(cancel_thread_while_dispatching)
 	return PWTEST_PASS;
 }
 
+#define CTT_TIMERS	256
+
+static void ctt_on_timer(void *data, uint64_t expirations)
+{
+	uint32_t *count = data;
+	SPA_ATOMIC_INC(*count);
+}
+
+PWTEST(cross_thread_timers)
+{
+	struct pw_data_loop *dl;
+	struct pw_loop *l;
+	struct spa_source *timers[CTT_TIMERS];
+	struct timespec value = { 0, 1 }, interval = { 0, 100 * SPA_NSEC_PER_USEC };
+	uint32_t i, count = 0, n;
+
+	pw_init(NULL, NULL);
+
+	dl = pw_data_loop_new(NULL);
+	pwtest_ptr_notnull(dl);
+	l = pw_data_loop_get_loop(dl);
+	pwtest_neg_errno_ok(pw_data_loop_start(dl));
+
+	/* the loop thread grows the heap and dispatches the timers while we
+	 * keep adding more */
+	for (i = 0; i < CTT_TIMERS; i++) {
+		timers[i] = pw_loop_add_timer(l, ctt_on_timer, &count);
+		pwtest_ptr_notnull(timers[i]);
+		pwtest_neg_errno_ok(pw_loop_update_timer(l, timers[i],
+					&value, &interval, false));
+	}
+	while (SPA_ATOMIC_LOAD(count) < CTT_TIMERS)
+		usleep(1000);
+
+	/* destroyed timers don't fire anymore */
+	for (i = 0; i < CTT_TIMERS; i++)
+		pw_loop_destroy_source(l, timers[i]);
+	n = SPA_ATOMIC_LOAD(count);
+	usleep(10000);
+	pwtest_int_eq(SPA_ATOMIC_LOAD(count), n);
+
+	pwtest_neg_errno_ok(pw_data_loop_stop(dl));
+	pw_data_loop_destroy(dl);
+
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
+#define QO_SIZE		(64 * 1024)
+
+struct qo_data {
+	struct pw_loop *l;
+	uint32_t n_invoked;
+	uint32_t n_called;
+	int res;
+};
+
+static int qo_invoke(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct qo_data *d = user_data;
+	d->n_called++;
+	return 0;
+}
+
+static void *qo_fill(void *user_data)
+{
+	struct qo_data *d = user_data;
+	static uint8_t data[QO_SIZE];
+
+	d->n_invoked = 0;
+	while ((d->res = pw_loop_invoke(d->l, qo_invoke, SPA_ID_INVALID,
+					data, sizeof(data), false, d)) == 0)
+		d->n_invoked++;
+	return NULL;
+}
+
+PWTEST(invoke_queue_overflow)
+{
+	struct qo_data d = { 0 };
+	pthread_t thread;
+
+	pw_init(NULL, NULL);
+
+	d.l = pw_loop_new(NULL);
+	pwtest_ptr_notnull(d.l);
+
+	/* we are the loop thread but don't dispatch, the queue of the other
+	 * thread fills up */
+	pw_loop_enter(d.l);
+	pwtest_int_eq(pthread_create(&thread, NULL, qo_fill, &d), 0);
+	pwtest_int_eq(pthread_join(thread, NULL), 0);
+	pwtest_int_eq(d.res, -EPIPE);
+	pwtest_int_gt(d.n_invoked, 0u);
+
+	/* all queued items are still called and the queue takes new ones */
+	while (pw_loop_iterate(d.l, 0) > 0);
+	pwtest_int_eq(d.n_called, d.n_invoked);
+
+	pwtest_int_eq(pthread_create(&thread, NULL, qo_fill, &d), 0);
+	pwtest_int_eq(pthread_join(thread, NULL), 0);
+	pwtest_int_eq(d.res, -EPIPE);
+	pwtest_int_gt(d.n_invoked, 0u);
+
+	while (pw_loop_iterate(d.l, 0) > 0);
+	pw_loop_leave(d.l);
+	pw_loop_destroy(d.l);
+
+	pw_deinit();
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(support)
 {
 	pwtest_add(pwtest_loop_destroy2, PWTEST_NOARG);
@@ -443,6 +560,8 @@ PWTEST_SUITE(support)
 	pwtest_add(destroy_managed_source_before_dispatch, PWTEST_NOARG);
 	pwtest_add(destroy_managed_source_before_dispatch_recurse, PWTEST_NOARG);
 	pwtest_add(cancel_thread_while_dispatching, PWTEST_NOARG);
+	pwtest_add(cross_thread_timers, PWTEST_NOARG);
+	pwtest_add(invoke_queue_overflow, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }
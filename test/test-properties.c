@@ -584,6 +584,70 @@ PWTEST(properties_update)
 	return PWTEST_PASS;
 }
 
+PWTEST(properties_many)
+{
+	struct pw_properties *props, *copy;
+	char key[64], value[64];
+	int i;
+
+	props = pw_properties_new(NULL, NULL);
+	pwtest_ptr_notnull(props);
+
+	for (i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		snprintf(value, sizeof(value), "value.%d", i);
+		pwtest_int_eq(pw_properties_set(props, key, value), 1);
+	}
+	pwtest_int_eq(props->dict.n_items, 200U);
+
+	/* remove the even keys, this moves the last items around */
+	for (i = 0; i < 200; i += 2) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		pwtest_int_eq(pw_properties_set(props, key, NULL), 1);
+		pwtest_int_eq(pw_properties_set(props, key, NULL), 0);
+	}
+	pwtest_int_eq(props->dict.n_items, 100U);
+
+	for (i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		snprintf(value, sizeof(value), "value.%d", i);
+		if (i & 1)
+			pwtest_str_eq(pw_properties_get(props, key), value);
+		else
+			pwtest_ptr_null(pw_properties_get(props, key));
+	}
+
+	/* the dict can be sorted from the outside */
+	spa_dict_qsort(&props->dict);
+	for (i = 1; i < 200; i += 2) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		snprintf(value, sizeof(value), "value.%d", i);
+		pwtest_str_eq(pw_properties_get(props, key), value);
+	}
+	pwtest_int_eq(pw_properties_set(props, "key.1", NULL), 1);
+	pwtest_int_eq(pw_properties_set(props, "key.0", "foo"), 1);
+	pwtest_ptr_null(pw_properties_get(props, "key.1"));
+	pwtest_str_eq(pw_properties_get(props, "key.0"), "foo");
+	pwtest_str_eq(pw_properties_get(props, "key.199"), "value.199");
+
+	copy = pw_properties_copy(props);
+	pwtest_ptr_notnull(copy);
+	pwtest_int_eq(copy->dict.n_items, 100U);
+	pwtest_str_eq(pw_properties_get(copy, "key.0"), "foo");
+	pwtest_str_eq(pw_properties_get(copy, "key.3"), "value.3");
+	pw_properties_free(copy);
+
+	pw_properties_clear(props);
+	pwtest_int_eq(props->dict.n_items, 0U);
+	pwtest_ptr_null(pw_properties_get(props, "key.3"));
+	pwtest_int_eq(pw_properties_set(props, "key.3", "bar"), 1);
+	pwtest_str_eq(pw_properties_get(props, "key.3"), "bar");
+
+	pw_properties_free(props);
+
+	return PWTEST_PASS;
+}
+
 PWTEST_SUITE(properties)
 {
 	pwtest_add(properties_abi, PWTEST_NOARG);
@@ -603,6 +667,7 @@ PWTEST_SUITE(properties)
 	pwtest_add(properties_new_dict, PWTEST_NOARG);
 	pwtest_add(properties_new_json, PWTEST_NOARG);
 	pwtest_add(properties_update, PWTEST_NOARG);
+	pwtest_add(properties_many, PWTEST_NOARG);
 
 	return PWTEST_PASS;
 }